@@ -0,0 +1,526 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * A class that transfers data between the host and buffers with the 
+ * strategy that is fastest for the respective device and transfer
+ * size.<br>
+ * <br>
+ * Whether copying data with <code>clEnqueueWriteBuffer</code> and 
+ * <code>clEnqueueReadBuffer</code>, or mapping the buffer with 
+ * <code>clEnqueueMapBuffer</code> is faster depends on the memory 
+ * topology of the device and on the size of the transfer. The 
+ * strategy is chosen per device and size class:
+ * <ul>
+ *   <li>
+ *     Initially, it is derived from the device properties: For CPU 
+ *     devices and devices with <code>CL_DEVICE_HOST_UNIFIED_MEMORY</code>,
+ *     buffers are created with <code>CL_MEM_ALLOC_HOST_PTR</code> and 
+ *     transferred by mapping them, which does not copy the data 
+ *     between host and device memory. For other devices, the data is 
+ *     copied.
+ *   </li>
+ *   <li>
+ *     Optionally, {@link #calibrate()} runs a short benchmark for each
+ *     size class, once per device and process, and records the faster
+ *     strategy. 
+ *   </li>
+ * </ul>
+ * The chosen strategies can be queried with {@link #getStrategy(long)}.
+ * Additionally, {@link #wrap(ByteBuffer, long)} creates buffers from
+ * host data: On devices with unified memory, direct buffers are used
+ * with <code>CL_MEM_USE_HOST_PTR</code>, so that the device accesses
+ * the host memory without a copy. Otherwise, the data is copied with
+ * <code>CL_MEM_COPY_HOST_PTR</code>.<br>
+ * <br>
+ * All transfers of this class are blocking. Mapping requires OpenCL 1.2.
+ * A failing OpenCL call causes a CLException, regardless of whether 
+ * exceptions are enabled with {@link CL#setExceptionsEnabled(boolean)},
+ * so that a failed transfer can not go unnoticed, and a failed 
+ * calibration does not record arbitrary strategies.
+ */
+public final class AdaptiveTransfer
+{
+    /**
+     * The strategies for transferring data
+     */
+    public static enum Strategy
+    {
+        /**
+         * Copy the data with <code>clEnqueueWriteBuffer</code> and 
+         * <code>clEnqueueReadBuffer</code>
+         */
+        COPY,
+        
+        /**
+         * Map the buffer with <code>clEnqueueMapBuffer</code>, and copy
+         * the data on the host
+         */
+        MAP,
+        
+        /**
+         * Create the buffer with <code>CL_MEM_USE_HOST_PTR</code>, so 
+         * that the host memory is used directly. This is only used
+         * by {@link AdaptiveTransfer#wrap(ByteBuffer, long)}.
+         */
+        USE_HOST_PTR
+    }
+    
+    /**
+     * The upper bounds of the size classes, in bytes. Transfers that 
+     * are larger than the last bound belong to the last class.
+     */
+    private static final long SIZE_CLASS_BOUNDS[] = 
+    {
+        4L << 10, 16L << 10, 64L << 10, 256L << 10, 
+        1L << 20, 4L << 20, 16L << 20, 64L << 20
+    };
+    
+    /**
+     * The number of timed repetitions for each strategy and size class
+     * in the calibration
+     */
+    private static final int CALIBRATION_RUNS = 3;
+    
+    /**
+     * The maximum size that is used in the calibration
+     */
+    private static final long MAX_CALIBRATION_SIZE = 16L << 20;
+    
+    /**
+     * The calibrated strategies, by the native pointer of the device
+     */
+    private static final Map<Long, Strategy[]> calibratedStrategies = 
+        new HashMap<Long, Strategy[]>();
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue commandQueue;
+    
+    /**
+     * The device of the command queue
+     */
+    private final cl_device_id device;
+    
+    /**
+     * Whether the device shares the memory with the host
+     */
+    private final boolean hostUnifiedMemory;
+    
+    /**
+     * The strategy for each size class
+     */
+    private volatile Strategy strategies[];
+    
+    /**
+     * Creates a new instance for the device of the given command queue.
+     * If the device has been calibrated before, the calibrated 
+     * strategies are used.
+     * 
+     * @param context The context
+     * @param commandQueue The command queue
+     */
+    public AdaptiveTransfer(cl_context context, cl_command_queue commandQueue)
+    {
+        this.context = context;
+        this.commandQueue = commandQueue;
+        
+        cl_device_id devices[] = new cl_device_id[1];
+        clGetCommandQueueInfo(commandQueue, CL_QUEUE_DEVICE, 
+            Sizeof.cl_device_id, Pointer.to(devices), null);
+        this.device = devices[0];
+        
+        long deviceType[] = new long[1];
+        clGetDeviceInfo(device, CL_DEVICE_TYPE, 
+            Sizeof.cl_long, Pointer.to(deviceType), null);
+        int unified[] = new int[1];
+        clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, 
+            Sizeof.cl_int, Pointer.to(unified), null);
+        this.hostUnifiedMemory = 
+            (deviceType[0] & CL_DEVICE_TYPE_CPU) != 0 || unified[0] != 0;
+        
+        Strategy calibrated[] = null;
+        synchronized (calibratedStrategies)
+        {
+            calibrated = calibratedStrategies.get(device.getNativePointer());
+        }
+        if (calibrated != null)
+        {
+            this.strategies = calibrated;
+        }
+        else
+        {
+            Strategy defaults[] = new Strategy[SIZE_CLASS_BOUNDS.length];
+            Arrays.fill(defaults, 
+                hostUnifiedMemory ? Strategy.MAP : Strategy.COPY);
+            this.strategies = defaults;
+        }
+    }
+    
+    /**
+     * Returns whether the device shares its memory with the host, 
+     * meaning that it is a CPU device or reports 
+     * <code>CL_DEVICE_HOST_UNIFIED_MEMORY</code>
+     * 
+     * @return Whether the device has host unified memory
+     */
+    public boolean isHostUnifiedMemory()
+    {
+        return hostUnifiedMemory;
+    }
+    
+    /**
+     * Returns whether the strategies have been calibrated for the device
+     * 
+     * @return Whether the device has been calibrated
+     */
+    public boolean isCalibrated()
+    {
+        synchronized (calibratedStrategies)
+        {
+            return calibratedStrategies.containsKey(device.getNativePointer());
+        }
+    }
+    
+    /**
+     * Returns the strategy that is used for transfers of the given size
+     * 
+     * @param size The size, in bytes
+     * @return The strategy
+     */
+    public Strategy getStrategy(long size)
+    {
+        return strategies[sizeClassOf(size)];
+    }
+    
+    /**
+     * Returns the upper bounds of the size classes, in bytes. Sizes 
+     * that are larger than the last bound belong to the last class.
+     * 
+     * @return The size class bounds
+     */
+    public static long[] getSizeClassBounds()
+    {
+        return SIZE_CLASS_BOUNDS.clone();
+    }
+    
+    /**
+     * Run a short benchmark that compares the strategies for each size
+     * class, and record the faster one. This is only done once per 
+     * device and process. Later instances for the same device use the
+     * recorded strategies. If the calibration fails, no strategies 
+     * are recorded.<br>
+     * <br>
+     * The benchmark is not run while holding the lock for the recorded
+     * strategies, so that instances for other devices are not blocked.
+     * If two threads calibrate the same device concurrently, the result
+     * that is recorded first is used by both.
+     * 
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void calibrate()
+    {
+        Long key = device.getNativePointer();
+        synchronized (calibratedStrategies)
+        {
+            Strategy calibrated[] = calibratedStrategies.get(key);
+            if (calibrated != null)
+            {
+                strategies = calibrated;
+                return;
+            }
+        }
+        Strategy measured[] = runCalibration();
+        synchronized (calibratedStrategies)
+        {
+            Strategy calibrated[] = calibratedStrategies.get(key);
+            if (calibrated == null)
+            {
+                calibrated = measured;
+                calibratedStrategies.put(key, calibrated);
+            }
+            strategies = calibrated;
+        }
+    }
+    
+    /**
+     * Create a buffer with the given size that is suitable for the 
+     * strategies of this instance: On devices with unified memory, 
+     * it is created with <code>CL_MEM_ALLOC_HOST_PTR</code>.
+     * 
+     * @param flags The memory flags
+     * @param size The size, in bytes
+     * @return The buffer
+     * @throws CLException If the buffer can not be created
+     */
+    public cl_mem createBuffer(long flags, long size)
+    {
+        if (hostUnifiedMemory)
+        {
+            flags |= CL_MEM_ALLOC_HOST_PTR;
+        }
+        int errorCode[] = new int[1];
+        cl_mem buffer = clCreateBuffer(context, flags, size, null, errorCode);
+        requireSuccess(errorCode[0]);
+        return buffer;
+    }
+    
+    /**
+     * Create a buffer for the remaining bytes of the given host data. 
+     * On devices with unified memory, a direct buffer is used with 
+     * <code>CL_MEM_USE_HOST_PTR</code>, and must then remain valid 
+     * and unmodified (except through mapping) as long as the buffer 
+     * is used. Otherwise, the data is copied.
+     * 
+     * @param data The host data
+     * @param flags The memory flags, not including host pointer flags
+     * @return The buffer
+     * @throws CLException If the buffer can not be created
+     */
+    public cl_mem wrap(ByteBuffer data, long flags)
+    {
+        Strategy strategy = getWrapStrategy(data);
+        long hostPointerFlags = strategy == Strategy.USE_HOST_PTR ? 
+            CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR;
+        Pointer pointer = Pointer.toBuffer(data);
+        int errorCode[] = new int[1];
+        cl_mem buffer = clCreateBuffer(context, flags | hostPointerFlags, 
+            data.remaining(), pointer, errorCode);
+        requireSuccess(errorCode[0]);
+        return buffer;
+    }
+    
+    /**
+     * Returns the strategy that {@link #wrap(ByteBuffer, long)} uses 
+     * for the given data: {@link Strategy#USE_HOST_PTR} for direct 
+     * buffers on devices with unified memory, and {@link Strategy#COPY}
+     * otherwise.
+     * 
+     * @param data The host data
+     * @return The strategy
+     */
+    public Strategy getWrapStrategy(ByteBuffer data)
+    {
+        if (hostUnifiedMemory && data.isDirect())
+        {
+            return Strategy.USE_HOST_PTR;
+        }
+        return Strategy.COPY;
+    }
+    
+    /**
+     * Write the remaining bytes of the given data into the given buffer,
+     * using the strategy for the size of the data. The position of the
+     * data is not modified.
+     * 
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param data The data
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void write(cl_mem buffer, long offset, ByteBuffer data)
+    {
+        write(buffer, offset, data, getStrategy(data.remaining()));
+    }
+    
+    /**
+     * Read data from the given buffer into the remaining bytes of the
+     * given target, using the strategy for the size of the target. The
+     * position of the target is not modified.
+     * 
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param target The target
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void read(cl_mem buffer, long offset, ByteBuffer target)
+    {
+        read(buffer, offset, target, getStrategy(target.remaining()));
+    }
+    
+    /**
+     * Write the given data with the given strategy
+     * 
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param data The data
+     * @param strategy The strategy
+     */
+    private void write(cl_mem buffer, long offset, ByteBuffer data, 
+        Strategy strategy)
+    {
+        int size = data.remaining();
+        if (size == 0)
+        {
+            return;
+        }
+        if (strategy == Strategy.MAP)
+        {
+            int errorCode[] = new int[1];
+            ByteBuffer mapped = clEnqueueMapBuffer(commandQueue, buffer, 
+                CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, offset, size, 
+                0, null, null, errorCode);
+            requireSuccess(errorCode[0]);
+            mapped.put(data.duplicate());
+            requireSuccess(clEnqueueUnmapMemObject(commandQueue, buffer, 
+                mapped, 0, null, null));
+        }
+        else
+        {
+            requireSuccess(clEnqueueWriteBuffer(commandQueue, buffer, 
+                CL_TRUE, offset, size, Pointer.toBuffer(data), 0, null, null));
+        }
+    }
+    
+    /**
+     * Read data with the given strategy
+     * 
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param target The target
+     * @param strategy The strategy
+     */
+    private void read(cl_mem buffer, long offset, ByteBuffer target, 
+        Strategy strategy)
+    {
+        int size = target.remaining();
+        if (size == 0)
+        {
+            return;
+        }
+        if (strategy == Strategy.MAP)
+        {
+            int errorCode[] = new int[1];
+            ByteBuffer mapped = clEnqueueMapBuffer(commandQueue, buffer, 
+                CL_TRUE, CL_MAP_READ, offset, size, 0, null, null, errorCode);
+            requireSuccess(errorCode[0]);
+            target.duplicate().put(mapped);
+            requireSuccess(clEnqueueUnmapMemObject(commandQueue, buffer, 
+                mapped, 0, null, null));
+        }
+        else
+        {
+            requireSuccess(clEnqueueReadBuffer(commandQueue, buffer, 
+                CL_TRUE, offset, size, Pointer.toBuffer(target), 
+                0, null, null));
+        }
+    }
+    
+    /**
+     * Measure the strategies for each size class, and return the 
+     * faster one for each class
+     * 
+     * @return The strategies
+     * @throws CLException If an OpenCL operation fails
+     */
+    private Strategy[] runCalibration()
+    {
+        long maxSize = Math.min(MAX_CALIBRATION_SIZE, 
+            SIZE_CLASS_BOUNDS[SIZE_CLASS_BOUNDS.length - 1]);
+        cl_mem buffer = createBuffer(CL_MEM_READ_WRITE, maxSize);
+        ByteBuffer host = ByteBuffer.allocateDirect((int)maxSize)
+            .order(ByteOrder.nativeOrder());
+        Strategy result[] = new Strategy[SIZE_CLASS_BOUNDS.length];
+        try
+        {
+            for (int i = 0; i < SIZE_CLASS_BOUNDS.length; i++)
+            {
+                int size = (int)Math.min(maxSize, SIZE_CLASS_BOUNDS[i]);
+                host.clear();
+                host.limit(size);
+                long copyTime = measure(buffer, host, Strategy.COPY);
+                long mapTime = measure(buffer, host, Strategy.MAP);
+                result[i] = mapTime < copyTime ? Strategy.MAP : Strategy.COPY;
+            }
+        }
+        finally
+        {
+            clReleaseMemObject(buffer);
+        }
+        return result;
+    }
+    
+    /**
+     * Returns the minimum time for a write and a read of the given 
+     * data with the given strategy, after one warm-up run
+     * 
+     * @param buffer The buffer
+     * @param host The host data
+     * @param strategy The strategy
+     * @return The time, in nanoseconds
+     */
+    private long measure(cl_mem buffer, ByteBuffer host, Strategy strategy)
+    {
+        long minTime = Long.MAX_VALUE;
+        for (int run = 0; run <= CALIBRATION_RUNS; run++)
+        {
+            long before = System.nanoTime();
+            write(buffer, 0, host, strategy);
+            read(buffer, 0, host, strategy);
+            requireSuccess(clFinish(commandQueue));
+            long time = System.nanoTime() - before;
+            if (run > 0)
+            {
+                minTime = Math.min(minTime, time);
+            }
+        }
+        return minTime;
+    }
+    
+    /**
+     * Returns the size class of the given size
+     * 
+     * @param size The size
+     * @return The size class
+     */
+    private static int sizeClassOf(long size)
+    {
+        for (int i = 0; i < SIZE_CLASS_BOUNDS.length; i++)
+        {
+            if (size <= SIZE_CLASS_BOUNDS[i])
+            {
+                return i;
+            }
+        }
+        return SIZE_CLASS_BOUNDS.length - 1;
+    }
+}
@@ -0,0 +1,704 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayDeque;
+import java.util.Deque;
+
+/**
+ * Utility methods for writing the contents of device buffers into a 
+ * checkpoint file, and restoring them from such a file.<br>
+ * <br>
+ * The buffer contents are transferred directly between the device and
+ * memory-mapped regions of the file, without intermediate Java arrays.
+ * The transfers are split into chunks. Several chunks are in flight 
+ * at the same time, so that the transfer of one chunk overlaps with
+ * the writing of the previous chunks to the file, or with reading the
+ * next chunks from the file.<br>
+ * <br>
+ * The file starts with a compact index that contains the size and the
+ * <code>cl_mem_flags</code> of each buffer, and the offset of its
+ * contents in the file. The contents are aligned to 4096 bytes. The
+ * index may be read with {@link #readIndex(File)}.
+ */
+public final class BufferSnapshot
+{
+    /**
+     * The magic number at the start of a snapshot file ("JOCLSNAP")
+     */
+    private static final long MAGIC = 0x4A4F434C534E4150L;
+    
+    /**
+     * The version of the file format
+     */
+    private static final int VERSION = 1;
+    
+    /**
+     * The size of the file header: Magic, version and count
+     */
+    private static final int HEADER_SIZE = 8 + 4 + 4;
+    
+    /**
+     * The size of one index entry: Size, flags and offset
+     */
+    private static final int ENTRY_SIZE = 8 + 8 + 8;
+    
+    /**
+     * The alignment of the buffer contents in the file
+     */
+    private static final long ALIGNMENT = 4096;
+    
+    /**
+     * The default chunk size for the transfers
+     */
+    public static final int DEFAULT_CHUNK_SIZE = 16 * 1024 * 1024;
+    
+    /**
+     * The number of chunks that may be in flight at the same time
+     */
+    private static final int CHUNKS_IN_FLIGHT = 4;
+    
+    /**
+     * The memory flags that refer to the host pointer that was used 
+     * when the buffer was created. They are removed from the flags 
+     * of restored buffers.
+     */
+    private static final long HOST_PTR_FLAGS = 
+        CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR;
+    
+    /**
+     * An entry of the index of a snapshot file
+     */
+    public static final class Entry
+    {
+        /**
+         * The size of the buffer, in bytes
+         */
+        private final long size;
+        
+        /**
+         * The cl_mem_flags of the buffer
+         */
+        private final long flags;
+        
+        /**
+         * The offset of the contents in the file
+         */
+        private final long offset;
+        
+        /**
+         * Creates a new entry
+         * 
+         * @param size The size of the buffer
+         * @param flags The cl_mem_flags of the buffer
+         * @param offset The offset of the contents in the file
+         */
+        Entry(long size, long flags, long offset)
+        {
+            this.size = size;
+            this.flags = flags;
+            this.offset = offset;
+        }
+        
+        /**
+         * Returns the size of the buffer, in bytes
+         * 
+         * @return The size
+         */
+        public long getSize()
+        {
+            return size;
+        }
+        
+        /**
+         * Returns the <code>cl_mem_flags</code> that the buffer was 
+         * created with
+         * 
+         * @return The flags
+         */
+        public long getFlags()
+        {
+            return flags;
+        }
+        
+        /**
+         * Returns the offset of the buffer contents in the file
+         * 
+         * @return The offset
+         */
+        public long getOffset()
+        {
+            return offset;
+        }
+        
+        @Override
+        public String toString()
+        {
+            return "Entry[size=" + size + ",flags=" + 
+                stringFor_cl_mem_flags(flags) + ",offset=" + offset + "]";
+        }
+    }
+    
+    /**
+     * Write the contents of the given buffers into the given file, 
+     * using the {@link #DEFAULT_CHUNK_SIZE}. The file is created or 
+     * overwritten.
+     * 
+     * @param command_queue The command queue for the read operations
+     * @param buffers The buffers
+     * @param file The file
+     * @return The index of the file
+     * @throws IOException If an IO error occurs
+     * @throws CLException If a read operation fails
+     */
+    public static Entry[] save(cl_command_queue command_queue, 
+        cl_mem buffers[], File file) throws IOException
+    {
+        return save(command_queue, buffers, file, DEFAULT_CHUNK_SIZE);
+    }
+    
+    /**
+     * Write the contents of the given buffers into the given file, 
+     * with the given chunk size. The file is created or overwritten.
+     * 
+     * @param command_queue The command queue for the read operations
+     * @param buffers The buffers
+     * @param file The file
+     * @param chunkSize The chunk size, in bytes
+     * @return The index of the file
+     * @throws IOException If an IO error occurs
+     * @throws IllegalArgumentException If the chunk size is not positive
+     * @throws CLException If a read operation fails
+     */
+    public static Entry[] save(cl_command_queue command_queue, 
+        cl_mem buffers[], File file, int chunkSize) throws IOException
+    {
+        checkChunkSize(chunkSize);
+        Entry entries[] = createIndex(buffers);
+        long fileSize = entries.length == 0 ? 
+            indexSize(0) : entries[entries.length - 1].getOffset() + 
+            entries[entries.length - 1].getSize();
+        RandomAccessFile randomAccessFile = new RandomAccessFile(file, "rw");
+        try
+        {
+            randomAccessFile.setLength(fileSize);
+            FileChannel channel = randomAccessFile.getChannel();
+            MappedByteBuffer index = channel.map(
+                FileChannel.MapMode.READ_WRITE, 0, indexSize(entries.length));
+            writeIndex(index, entries);
+            
+            Deque<Chunk> inFlight = new ArrayDeque<Chunk>();
+            try
+            {
+                for (int i = 0; i < buffers.length; i++)
+                {
+                    Entry entry = entries[i];
+                    for (long offset = 0; offset < entry.getSize(); 
+                        offset += chunkSize)
+                    {
+                        if (inFlight.size() >= CHUNKS_IN_FLIGHT)
+                        {
+                            completeChunk(inFlight.removeFirst(), true);
+                        }
+                        long size = Math.min(chunkSize, entry.getSize() - offset);
+                        MappedByteBuffer region = channel.map(
+                            FileChannel.MapMode.READ_WRITE, 
+                            entry.getOffset() + offset, size);
+                        cl_event event = new cl_event();
+                        clEnqueueReadBuffer(command_queue, buffers[i], 
+                            false, offset, size, Pointer.to(region), 
+                            0, null, event);
+                        inFlight.addLast(new Chunk(region, event));
+                    }
+                }
+                clFlush(command_queue);
+                while (!inFlight.isEmpty())
+                {
+                    completeChunk(inFlight.removeFirst(), true);
+                }
+            }
+            finally
+            {
+                while (!inFlight.isEmpty())
+                {
+                    Chunk chunk = inFlight.removeFirst();
+                    clWaitForEvents(1, new cl_event[]{ chunk.event });
+                    clReleaseEvent(chunk.event);
+                }
+            }
+            index.force();
+        }
+        finally
+        {
+            randomAccessFile.close();
+        }
+        return entries;
+    }
+    
+    /**
+     * Read the index of the given snapshot file
+     * 
+     * @param file The file
+     * @return The index
+     * @throws IOException If an IO error occurs, or the file is not 
+     * a valid snapshot file
+     */
+    public static Entry[] readIndex(File file) throws IOException
+    {
+        RandomAccessFile randomAccessFile = new RandomAccessFile(file, "r");
+        try
+        {
+            return readIndex(randomAccessFile.getChannel());
+        }
+        finally
+        {
+            randomAccessFile.close();
+        }
+    }
+    
+    /**
+     * Restore the contents of the given buffers from the given file. 
+     * The buffers must have the same sizes as the buffers that the 
+     * file was created from.
+     * 
+     * @param command_queue The command queue for the write operations
+     * @param buffers The buffers
+     * @param file The file
+     * @throws IOException If an IO error occurs, or the file is not 
+     * a valid snapshot file
+     * @throws IllegalArgumentException If the number or sizes of the
+     * buffers do not match the index of the file
+     * @throws CLException If a write operation fails
+     */
+    public static void restore(cl_command_queue command_queue, 
+        cl_mem buffers[], File file) throws IOException
+    {
+        restore(command_queue, buffers, file, DEFAULT_CHUNK_SIZE);
+    }
+    
+    /**
+     * Restore the contents of the given buffers from the given file,
+     * with the given chunk size. The buffers must have the same sizes 
+     * as the buffers that the file was created from.
+     * 
+     * @param command_queue The command queue for the write operations
+     * @param buffers The buffers
+     * @param file The file
+     * @param chunkSize The chunk size, in bytes
+     * @throws IOException If an IO error occurs, or the file is not 
+     * a valid snapshot file
+     * @throws IllegalArgumentException If the number or sizes of the
+     * buffers do not match the index of the file, or the chunk size is
+     * not positive
+     * @throws CLException If a write operation fails
+     */
+    public static void restore(cl_command_queue command_queue, 
+        cl_mem buffers[], File file, int chunkSize) throws IOException
+    {
+        checkChunkSize(chunkSize);
+        RandomAccessFile randomAccessFile = new RandomAccessFile(file, "r");
+        try
+        {
+            FileChannel channel = randomAccessFile.getChannel();
+            Entry entries[] = readIndex(channel);
+            if (entries.length != buffers.length)
+            {
+                throw new IllegalArgumentException(
+                    "The file contains " + entries.length + 
+                    " buffers, but " + buffers.length + " were given");
+            }
+            for (int i = 0; i < buffers.length; i++)
+            {
+                long size = getMemObjectInfo(buffers[i], CL_MEM_SIZE);
+                if (size != entries[i].getSize())
+                {
+                    throw new IllegalArgumentException(
+                        "Buffer " + i + " has a size of " + size + 
+                        ", but the file contains " + entries[i].getSize());
+                }
+            }
+            restore(command_queue, buffers, entries, channel, chunkSize);
+        }
+        finally
+        {
+            randomAccessFile.close();
+        }
+    }
+    
+    /**
+     * Create new buffers in the given context, with the sizes and 
+     * flags that are stored in the given file, and restore their 
+     * contents from the file. The <code>CL_MEM_USE_HOST_PTR</code> 
+     * and <code>CL_MEM_COPY_HOST_PTR</code> flags are removed.
+     * 
+     * @param context The context
+     * @param command_queue The command queue for the write operations
+     * @param file The file
+     * @return The buffers
+     * @throws IOException If an IO error occurs, or the file is not 
+     * a valid snapshot file
+     * @throws CLException If a buffer can not be created, or a write 
+     * operation fails
+     */
+    public static cl_mem[] restore(cl_context context, 
+        cl_command_queue command_queue, File file) throws IOException
+    {
+        RandomAccessFile randomAccessFile = new RandomAccessFile(file, "r");
+        try
+        {
+            FileChannel channel = randomAccessFile.getChannel();
+            Entry entries[] = readIndex(channel);
+            cl_mem buffers[] = new cl_mem[entries.length];
+            try
+            {
+                for (int i = 0; i < entries.length; i++)
+                {
+                    int errcode_ret[] = new int[1];
+                    buffers[i] = clCreateBuffer(context, 
+                        entries[i].getFlags() & ~HOST_PTR_FLAGS, 
+                        entries[i].getSize(), null, errcode_ret);
+                    if (errcode_ret[0] != CL_SUCCESS)
+                    {
+                        throw new CLException("clCreateBuffer failed: " + 
+                            stringFor_errorCode(errcode_ret[0]), 
+                            errcode_ret[0]);
+                    }
+                }
+                restore(command_queue, buffers, entries, channel, 
+                    DEFAULT_CHUNK_SIZE);
+            }
+            catch (RuntimeException e)
+            {
+                releaseAll(buffers);
+                throw e;
+            }
+            catch (IOException e)
+            {
+                releaseAll(buffers);
+                throw e;
+            }
+            return buffers;
+        }
+        finally
+        {
+            randomAccessFile.close();
+        }
+    }
+    
+    /**
+     * A chunk that is currently in flight: The mapped region of the
+     * file, and the event of the transfer
+     */
+    private static final class Chunk
+    {
+        /**
+         * The mapped region of the file
+         */
+        final MappedByteBuffer region;
+        
+        /**
+         * The event of the transfer
+         */
+        final cl_event event;
+        
+        /**
+         * Creates a new chunk
+         * 
+         * @param region The mapped region
+         * @param event The event
+         */
+        Chunk(MappedByteBuffer region, cl_event event)
+        {
+            this.region = region;
+            this.event = event;
+        }
+    }
+    
+    /**
+     * Wait for the transfer of the given chunk to complete, and 
+     * release its event. If the chunk was read from the device, then
+     * the mapped region is written to the file.
+     * 
+     * @param chunk The chunk
+     * @param force Whether the region should be written to the file
+     */
+    private static void completeChunk(Chunk chunk, boolean force)
+    {
+        try
+        {
+            clWaitForEvents(1, new cl_event[]{ chunk.event });
+        }
+        finally
+        {
+            clReleaseEvent(chunk.event);
+        }
+        if (force)
+        {
+            chunk.region.force();
+        }
+    }
+    
+    /**
+     * Restore the contents of the given buffers from the given channel
+     * 
+     * @param command_queue The command queue
+     * @param buffers The buffers
+     * @param entries The index
+     * @param channel The channel
+     * @param chunkSize The chunk size
+     * @throws IOException If an IO error occurs
+     */
+    private static void restore(cl_command_queue command_queue, 
+        cl_mem buffers[], Entry entries[], FileChannel channel, 
+        int chunkSize) throws IOException
+    {
+        Deque<Chunk> inFlight = new ArrayDeque<Chunk>();
+        try
+        {
+            for (int i = 0; i < buffers.length; i++)
+            {
+                Entry entry = entries[i];
+                for (long offset = 0; offset < entry.getSize(); 
+                    offset += chunkSize)
+                {
+                    if (inFlight.size() >= CHUNKS_IN_FLIGHT)
+                    {
+                        completeChunk(inFlight.removeFirst(), false);
+                    }
+                    long size = Math.min(chunkSize, entry.getSize() - offset);
+                    MappedByteBuffer region = channel.map(
+                        FileChannel.MapMode.READ_ONLY, 
+                        entry.getOffset() + offset, size);
+                    
+                    // Read the region from the file while the previous
+                    // chunks are transferred to the device
+                    region.load();
+                    cl_event event = new cl_event();
+                    clEnqueueWriteBuffer(command_queue, buffers[i], 
+                        false, offset, size, Pointer.to(region), 
+                        0, null, event);
+                    clFlush(command_queue);
+                    inFlight.addLast(new Chunk(region, event));
+                }
+            }
+            while (!inFlight.isEmpty())
+            {
+                completeChunk(inFlight.removeFirst(), false);
+            }
+        }
+        finally
+        {
+            while (!inFlight.isEmpty())
+            {
+                Chunk chunk = inFlight.removeFirst();
+                clWaitForEvents(1, new cl_event[]{ chunk.event });
+                clReleaseEvent(chunk.event);
+            }
+        }
+    }
+    
+    /**
+     * Create the index for the given buffers
+     * 
+     * @param buffers The buffers
+     * @return The index
+     */
+    private static Entry[] createIndex(cl_mem buffers[])
+    {
+        Entry entries[] = new Entry[buffers.length];
+        long offset = align(indexSize(buffers.length));
+        for (int i = 0; i < buffers.length; i++)
+        {
+            long size = getMemObjectInfo(buffers[i], CL_MEM_SIZE);
+            long flags = getMemObjectInfo(buffers[i], CL_MEM_FLAGS);
+            entries[i] = new Entry(size, flags, offset);
+            offset = align(offset + size);
+        }
+        return entries;
+    }
+    
+    /**
+     * Write the given index into the given buffer
+     * 
+     * @param buffer The buffer
+     * @param entries The index
+     */
+    private static void writeIndex(ByteBuffer buffer, Entry entries[])
+    {
+        buffer.order(ByteOrder.LITTLE_ENDIAN);
+        buffer.putLong(MAGIC);
+        buffer.putInt(VERSION);
+        buffer.putInt(entries.length);
+        for (Entry entry : entries)
+        {
+            buffer.putLong(entry.getSize());
+            buffer.putLong(entry.getFlags());
+            buffer.putLong(entry.getOffset());
+        }
+    }
+    
+    /**
+     * Read the index from the given channel
+     * 
+     * @param channel The channel
+     * @return The index
+     * @throws IOException If an IO error occurs, or the file is not 
+     * a valid snapshot file
+     */
+    private static Entry[] readIndex(FileChannel channel) throws IOException
+    {
+        long fileSize = channel.size();
+        if (fileSize < HEADER_SIZE)
+        {
+            throw new IOException("Invalid snapshot file: Too small");
+        }
+        ByteBuffer header = channel.map(
+            FileChannel.MapMode.READ_ONLY, 0, HEADER_SIZE);
+        header.order(ByteOrder.LITTLE_ENDIAN);
+        if (header.getLong() != MAGIC)
+        {
+            throw new IOException("Invalid snapshot file: Invalid magic");
+        }
+        int version = header.getInt();
+        if (version != VERSION)
+        {
+            throw new IOException(
+                "Invalid snapshot file: Unsupported version " + version);
+        }
+        int count = header.getInt();
+        if (count < 0 || indexSize(count) > fileSize)
+        {
+            throw new IOException(
+                "Invalid snapshot file: Invalid count " + count);
+        }
+        ByteBuffer index = channel.map(
+            FileChannel.MapMode.READ_ONLY, HEADER_SIZE, 
+            (long)count * ENTRY_SIZE);
+        index.order(ByteOrder.LITTLE_ENDIAN);
+        Entry entries[] = new Entry[count];
+        for (int i = 0; i < count; i++)
+        {
+            long size = index.getLong();
+            long flags = index.getLong();
+            long offset = index.getLong();
+            if (size < 0 || offset < 0 || offset + size > fileSize)
+            {
+                throw new IOException(
+                    "Invalid snapshot file: Invalid entry " + i);
+            }
+            entries[i] = new Entry(size, flags, offset);
+        }
+        return entries;
+    }
+    
+    /**
+     * Returns the size of the header and the index for the given 
+     * number of buffers
+     * 
+     * @param count The number of buffers
+     * @return The size
+     */
+    private static long indexSize(int count)
+    {
+        return HEADER_SIZE + (long)count * ENTRY_SIZE;
+    }
+    
+    /**
+     * Check whether the given chunk size is positive
+     * 
+     * @param chunkSize The chunk size
+     * @throws IllegalArgumentException If the chunk size is not positive
+     */
+    private static void checkChunkSize(int chunkSize)
+    {
+        if (chunkSize <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The chunk size must be positive, but is " + chunkSize);
+        }
+    }
+    
+    /**
+     * Returns the given offset, aligned to the {@link #ALIGNMENT}
+     * 
+     * @param offset The offset
+     * @return The aligned offset
+     */
+    private static long align(long offset)
+    {
+        return ((offset + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    }
+    
+    /**
+     * Returns the value of the given memory object info, which must be
+     * a <code>size_t</code> or <code>cl_mem_flags</code>
+     * 
+     * @param mem The memory object
+     * @param paramName The parameter name
+     * @return The value
+     */
+    private static long getMemObjectInfo(cl_mem mem, int paramName)
+    {
+        long value[] = new long[1];
+        int size = paramName == CL_MEM_FLAGS ? Sizeof.cl_long : Sizeof.size_t;
+        clGetMemObjectInfo(mem, paramName, size, Pointer.to(value), null);
+        return value[0];
+    }
+    
+    /**
+     * Release all non-<code>null</code> memory objects in the given array
+     * 
+     * @param buffers The memory objects
+     */
+    private static void releaseAll(cl_mem buffers[])
+    {
+        for (cl_mem buffer : buffers)
+        {
+            if (buffer != null)
+            {
+                clReleaseMemObject(buffer);
+            }
+        }
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private BufferSnapshot()
+    {
+        // Private constructor to prevent instantiation.
+    }
+}
@@ -62,8 +62,13 @@ public final class CL
             String libraryBaseName = "JOCL_" + versionString;
             String libraryName = 
                 LibUtils.createPlatformLibraryName(libraryBaseName);
+            long before = System.nanoTime();
             LibUtils.loadLibrary(libraryName);
+            long afterLoad = System.nanoTime();
             LibInitializer.initNativeLibrary();
+            long afterInit = System.nanoTime();
+            InitializationTimes.loadLibraryNanos = afterLoad - before;
+            InitializationTimes.initNativeLibraryNanos = afterInit - afterLoad;
             nativeLibraryLoaded = true;
         }
     }
@@ -78,6 +83,17 @@ public final class CL
      */
     static native boolean initNativeLibrary(String fullName);
 
+    /**
+     * Obtain the durations of the native initialization steps, in 
+     * nanoseconds. See {@link InitializationTimes}.
+     * 
+     * @param times The array that will store the times for JNI_OnLoad, 
+     * the registration of the native methods, the loading of the 
+     * OpenCL implementation library and the initialization of the
+     * function pointers, in this order
+     */
+    static native void getInitializationTimesNative(long times[]);
+
     // cl_platform.h constants
     public static final int CL_CHAR_BIT         = 8;
     public static final int CL_SCHAR_MAX        = 127;
@@ -326,6 +342,10 @@ public final class CL
     public static final int CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT    = 0x1059;
     public static final int CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT     = 0x105A;
 
+    // OPENCL_2_1
+    public static final int CL_DEVICE_MAX_NUM_SUB_GROUPS                     = 0x105C;
+    public static final int CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS = 0x105D;
+
     // CL_EXT
     public static final int CL_DEVICE_DOUBLE_FP_CONFIG                  = 0x1032;
     public static final int CL_DEVICE_HALF_FP_CONFIG                    = 0x1033;
@@ -377,6 +397,10 @@ public final class CL
     public static final int CL_CONTEXT_PLATFORM          = 0x1084;
     // OPENCL_1_2
     public static final int CL_CONTEXT_INTEROP_USER_SYNC = 0x1085;
+    
+    // cl_arm_printf
+    public static final int CL_PRINTF_CALLBACK_ARM       = 0x40B0;
+    public static final int CL_PRINTF_BUFFERSIZE_ARM     = 0x40B1;
 
     // OPENCL_1_2
     /* cl_device_partition_property */
@@ -409,6 +433,20 @@ public final class CL
     public static final int CL_QUEUE_PROPERTIES = 0x1093;
     // OPENCL_2_0
     public static final int CL_QUEUE_SIZE = 0x1094;
+    // cl_khr_priority_hints
+    public static final int CL_QUEUE_PRIORITY_KHR = 0x1096;
+    // cl_khr_throttle_hints
+    public static final int CL_QUEUE_THROTTLE_KHR = 0x1097;
+
+    // cl_queue_priority_khr - bitfield
+    public static final int CL_QUEUE_PRIORITY_HIGH_KHR = (1 << 0);
+    public static final int CL_QUEUE_PRIORITY_MED_KHR  = (1 << 1);
+    public static final int CL_QUEUE_PRIORITY_LOW_KHR  = (1 << 2);
+
+    // cl_queue_throttle_khr - bitfield
+    public static final int CL_QUEUE_THROTTLE_HIGH_KHR = (1 << 0);
+    public static final int CL_QUEUE_THROTTLE_MED_KHR  = (1 << 1);
+    public static final int CL_QUEUE_THROTTLE_LOW_KHR  = (1 << 2);
 
     // cl_mem_flags - bitfield
     public static final long CL_MEM_READ_WRITE = (1 << 0);
@@ -644,6 +682,18 @@ public final class CL
     public static final int CL_KERNEL_EXEC_INFO_SVM_PTRS               = 0x11B6;
     public static final int CL_KERNEL_EXEC_INFO_SVM_FINE_GRAIN_SYSTEM  = 0x11B7;
 
+    // OPENCL_2_1
+    // cl_kernel_sub_group_info
+    public static final int CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE = 0x2033;
+    public static final int CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE    = 0x2034;
+    public static final int CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT = 0x11B8;
+    public static final int CL_KERNEL_MAX_NUM_SUB_GROUPS             = 0x11B9;
+    public static final int CL_KERNEL_COMPILE_NUM_SUB_GROUPS         = 0x11BA;
+
+    // cl_khr_subgroups
+    public static final int CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR = 0x2033;
+    public static final int CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR    = 0x2034;
+
 
     // cl_event_info
     public static final int CL_EVENT_COMMAND_QUEUE = 0x11D0;
@@ -734,6 +784,9 @@ public final class CL
     public static final int CL_WGL_HDC_KHR                  = 0x200B;
     public static final int CL_CGL_SHAREGROUP_KHR           = 0x200C;
 
+    // cl_khr_gl_event
+    public static final int CL_COMMAND_GL_FENCE_SYNC_OBJECT_KHR = 0x200D;
+
     // cl_APPLE_gl_sharing
     public static final int CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE = 0x10000000;
     public static final int CL_CGL_DEVICE_FOR_CURRENT_VIRTUAL_SCREEN_APPLE = 0x10000002;
@@ -824,7 +877,7 @@ public final class CL
      * @throws CLException If exceptions have been enabled and
      * the given result code is not CL_SUCCESS
      */
-    private static int checkResult(int result)
+    static int checkResult(int result)
     {
         if (exceptionsEnabled && result != CL_SUCCESS)
         {
@@ -833,6 +886,25 @@ public final class CL
         return result;
     }
 
+    /**
+     * If the given result is different to CL_SUCCESS, this method will
+     * throw a CLException with an error message that corresponds to the
+     * given result code, regardless of whether exceptions have been 
+     * enabled. This is used by the utility classes that can not report
+     * error codes to the caller, for example because the result is 
+     * delivered through a Future.
+     *
+     * @param result The result to check
+     * @throws CLException If the given result code is not CL_SUCCESS
+     */
+    static void requireSuccess(int result)
+    {
+        if (result != CL_SUCCESS)
+        {
+            throw new CLException(stringFor_errorCode(result), result);
+        }
+    }
+
 
 
 
@@ -1043,6 +1115,8 @@ public final class CL
             case CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT: return "CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT";
             case CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT: return "CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT";
             case CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT: return "CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT";
+            case CL_DEVICE_MAX_NUM_SUB_GROUPS: return "CL_DEVICE_MAX_NUM_SUB_GROUPS";
+            case CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS: return "CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS";
         }
         return "INVALID cl_device_info: " + n;
     }
@@ -1116,6 +1190,8 @@ public final class CL
             case CL_WGL_HDC_KHR: return "CL_WGL_HDC_KHR";
             case CL_CGL_SHAREGROUP_KHR: return "CL_CGL_SHAREGROUP_KHR";
             case CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE: return "CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE";
+            case CL_PRINTF_CALLBACK_ARM: return "CL_PRINTF_CALLBACK_ARM";
+            case CL_PRINTF_BUFFERSIZE_ARM: return "CL_PRINTF_BUFFERSIZE_ARM";
         }
         return "INVALID cl_context_properties: " + n;
     }
@@ -1154,6 +1230,8 @@ public final class CL
             case CL_QUEUE_REFERENCE_COUNT: return "CL_QUEUE_REFERENCE_COUNT";
             case CL_QUEUE_PROPERTIES: return "CL_QUEUE_PROPERTIES";
             case CL_QUEUE_SIZE: return "CL_QUEUE_SIZE";
+            case CL_QUEUE_PRIORITY_KHR: return "CL_QUEUE_PRIORITY_KHR";
+            case CL_QUEUE_THROTTLE_KHR: return "CL_QUEUE_THROTTLE_KHR";
         }
         return "INVALID cl_command_queue_info: " + n;
     }
@@ -1544,6 +1622,25 @@ public final class CL
         return "INVALID cl_kernel_work_group_info: " + n;
     }
 
+    /**
+     * Returns the String identifying the given cl_kernel_sub_group_info
+     *
+     * @param n A cl_kernel_sub_group_info value
+     * @return The String for the given cl_kernel_sub_group_info
+     */
+    public static String stringFor_cl_kernel_sub_group_info(int n)
+    {
+        switch (n)
+        {
+            case CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE: return "CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE";
+            case CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE: return "CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE";
+            case CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT: return "CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT";
+            case CL_KERNEL_MAX_NUM_SUB_GROUPS: return "CL_KERNEL_MAX_NUM_SUB_GROUPS";
+            case CL_KERNEL_COMPILE_NUM_SUB_GROUPS: return "CL_KERNEL_COMPILE_NUM_SUB_GROUPS";
+        }
+        return "INVALID cl_kernel_sub_group_info: " + n;
+    }
+
     /**
      * Returns the String identifying the given cl_kernel_exec_info
      *
@@ -1620,6 +1717,7 @@ public final class CL
             case CL_COMMAND_SVM_MEMFILL: return "CL_COMMAND_SVM_MEMFILL";
             case CL_COMMAND_SVM_MAP: return "CL_COMMAND_SVM_MAP";
             case CL_COMMAND_SVM_UNMAP: return "CL_COMMAND_SVM_UNMAP";
+            case CL_COMMAND_GL_FENCE_SYNC_OBJECT_KHR: return "CL_COMMAND_GL_FENCE_SYNC_OBJECT_KHR";
         }
         return "INVALID cl_command_type: " + n;
     }
@@ -2055,8 +2153,7 @@ public final class CL
     
     /**
      * Keep a reference to the given object, to prevent it from
-     * being garbage collected, until waiting for the given
-     * event on a separate thread has completed.
+     * being garbage collected, until the given event is complete.
      *
      * @param event The event to wait for
      * @param object The object to which a reference should be kept
@@ -2078,10 +2175,24 @@ public final class CL
         // errors, possibly crashes or function calls that silently work 
         // on bogus data.
         // 
-        // To avoid this, for each non-blocking operation, a Runnable is 
-        // started (in an own thread), which only contains a reference to 
-        // the 'object' and waits for the OpenCL event that is associated with 
-        // the operation.
+        // To avoid this, the native side creates a global reference to the
+        // 'object', and registers an event callback for CL_COMPLETE. The
+        // callback only marks the reference as being releasable. The global
+        // references (and the events) of all completed operations are 
+        // released at the next call to this method, clFinish or 
+        // clWaitForEvents. So non-blocking operations do not require 
+        // any threads.
+        int result = scheduleReferenceReleaseNative(
+            event, object, doRetainEvent);
+        if (result == CL_SUCCESS)
+        {
+            return;
+        }
+        
+        // When event callbacks are not supported (OpenCL 1.0), then for 
+        // each non-blocking operation, a Runnable is started (in an own 
+        // thread), which only contains a reference to the 'object' and 
+        // waits for the OpenCL event that is associated with the operation.
         // 
         // But without further precautions, there are no guarantees that the
         // Runnable (and thus, the 'object') are NOT reclaimed by the garbage
@@ -2120,6 +2231,28 @@ public final class CL
         referenceReleaseExecutor.execute(runnable);
 
     }
+    
+    /**
+     * Create a global reference to the given object, which will be 
+     * deleted after the given event is complete. See 
+     * {@link #scheduleReferenceRelease(cl_event, Object, boolean)}.
+     * 
+     * @param event The event
+     * @param object The object
+     * @param doRetainEvent Whether the event has to be retained
+     * @return CL_SUCCESS, or an error code if the reference release
+     * could not be scheduled, and the caller has to fall back to
+     * waiting for the event on a separate thread
+     */
+    private static native int scheduleReferenceReleaseNative(
+        cl_event event, Object object, boolean doRetainEvent);
+    
+    /**
+     * Delete all global references that have been created by 
+     * {@link #scheduleReferenceReleaseNative(cl_event, Object, boolean)}
+     * and whose events are complete
+     */
+    private static native void drainReferenceReleasesNative();
 
 
 
@@ -14858,6 +14991,121 @@ public final class CL
 
     private static native int clGetKernelWorkGroupInfoNative(cl_kernel kernel, cl_device_id device, int param_name, long param_value_size, Pointer param_value, long param_value_size_ret[]);
 
+    /**
+     * Queries the local work size that the implementation suggests for 
+     * enqueueing the given kernel with the given global work size in 
+     * the given command queue. This requires the 
+     * <code>cl_khr_suggested_local_work_size</code> extension. The 
+     * function is obtained via 
+     * <code>clGetExtensionFunctionAddressForPlatform</code>, for the 
+     * platform of the device of the command queue.<br>
+     * <br>
+     * See {@link LocalWorkSizes} for a cached variant that falls back 
+     * to a heuristic when the extension is not supported.
+     *
+     * @param command_queue A valid command queue
+     * @param kernel A valid kernel object, whose arguments have been set
+     * @param work_dim The number of dimensions, between 1 and 3
+     * @param global_work_offset The global work offset. May be 
+     * <code>null</code>.
+     * @param global_work_size The global work size
+     * @param suggested_local_work_size Will store the suggested local 
+     * work size, with <code>work_dim</code> elements
+     * @return CL_SUCCESS if the function is executed successfully, or
+     * the error code otherwise
+     * @throws UnsupportedOperationException If the extension is not 
+     * supported by the platform of the command queue
+     */
+    public static int clGetKernelSuggestedLocalWorkSizeKHR(cl_command_queue command_queue, cl_kernel kernel, int work_dim, long global_work_offset[], long global_work_size[], long suggested_local_work_size[])
+    {
+        return checkResult(clGetKernelSuggestedLocalWorkSizeKHRNative(command_queue, kernel, work_dim, global_work_offset, global_work_size, suggested_local_work_size));
+    }
+
+    private static native int clGetKernelSuggestedLocalWorkSizeKHRNative(cl_command_queue command_queue, cl_kernel kernel, int work_dim, long global_work_offset[], long global_work_size[], long suggested_local_work_size[]);
+
+    /**
+     * Returns information about the sub-groups of a kernel object on 
+     * the given device. This function is part of OpenCL 2.1.
+     * The <code>param_name</code> is one of the 
+     * <code>cl_kernel_sub_group_info</code> values:
+     * <ul>
+     *   <li>
+     *     <code>CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE</code> and 
+     *     <code>CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE</code>: The 
+     *     input is the local work size, as an array of 
+     *     <code>size_t</code>, and the result is a <code>size_t</code>
+     *   </li>
+     *   <li>
+     *     <code>CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT</code>: The
+     *     input is the desired number of sub-groups, as a 
+     *     <code>size_t</code>, and the result is the local work size,
+     *     as an array of <code>size_t</code>
+     *   </li>
+     *   <li>
+     *     <code>CL_KERNEL_MAX_NUM_SUB_GROUPS</code> and 
+     *     <code>CL_KERNEL_COMPILE_NUM_SUB_GROUPS</code>: There is no 
+     *     input, and the result is a <code>size_t</code>
+     *   </li>
+     * </ul>
+     * See {@link SubGroups} for cached queries and launch helpers.
+     *
+     * @param kernel The kernel object being queried
+     * @param device The device for which the information is queried
+     * @param param_name The information to query
+     * @param input_value_size The size in bytes of the input value
+     * @param input_value The input value. May be <code>null</code> if 
+     * the query has no input.
+     * @param param_value_size The size in bytes of the memory pointed 
+     * to by <code>param_value</code>
+     * @param param_value A pointer to memory where the result will be 
+     * returned. May be <code>null</code>.
+     * @param param_value_size_ret Returns the actual size in bytes of 
+     * the result. May be <code>null</code>.
+     * @return CL_SUCCESS if the function is executed successfully, or
+     * the error code otherwise
+     */
+    public static int clGetKernelSubGroupInfo(cl_kernel kernel, cl_device_id device, int param_name, long input_value_size, Pointer input_value, long param_value_size, Pointer param_value, long param_value_size_ret[])
+    {
+        return checkResult(clGetKernelSubGroupInfoNative(kernel, device, param_name, input_value_size, input_value, param_value_size, param_value, param_value_size_ret));
+    }
+
+    private static native int clGetKernelSubGroupInfoNative(cl_kernel kernel, cl_device_id device, int param_name, long input_value_size, Pointer input_value, long param_value_size, Pointer param_value, long param_value_size_ret[]);
+
+    /**
+     * Returns information about the sub-groups of a kernel object on 
+     * the given device. This requires the <code>cl_khr_subgroups</code>
+     * extension, and supports the 
+     * <code>CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR</code> and 
+     * <code>CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR</code> queries. 
+     * The function is obtained via 
+     * <code>clGetExtensionFunctionAddressForPlatform</code>, for the 
+     * platform of the device. See 
+     * {@link #clGetKernelSubGroupInfo(cl_kernel, cl_device_id, int, long, Pointer, long, Pointer, long[])}
+     * for the parameters.
+     *
+     * @param kernel The kernel object being queried
+     * @param device The device for which the information is queried
+     * @param param_name The information to query
+     * @param input_value_size The size in bytes of the input value
+     * @param input_value The input value
+     * @param param_value_size The size in bytes of the memory pointed 
+     * to by <code>param_value</code>
+     * @param param_value A pointer to memory where the result will be 
+     * returned. May be <code>null</code>.
+     * @param param_value_size_ret Returns the actual size in bytes of 
+     * the result. May be <code>null</code>.
+     * @return CL_SUCCESS if the function is executed successfully, or
+     * the error code otherwise
+     * @throws UnsupportedOperationException If the extension is not 
+     * supported by the platform of the device
+     */
+    public static int clGetKernelSubGroupInfoKHR(cl_kernel kernel, cl_device_id device, int param_name, long input_value_size, Pointer input_value, long param_value_size, Pointer param_value, long param_value_size_ret[])
+    {
+        return checkResult(clGetKernelSubGroupInfoKHRNative(kernel, device, param_name, input_value_size, input_value, param_value_size, param_value, param_value_size_ret));
+    }
+
+    private static native int clGetKernelSubGroupInfoKHRNative(cl_kernel kernel, cl_device_id device, int param_name, long input_value_size, Pointer input_value, long param_value_size, Pointer param_value, long param_value_size_ret[]);
+
     /**
      * <p>
      *       Waits on the host thread for commands identified by event objects to complete.
@@ -14948,7 +15196,9 @@ public final class CL
      */
     public static int clWaitForEvents(int num_events, cl_event event_list[])
     {
-        return checkResult(clWaitForEventsNative(num_events, event_list));
+        int result = clWaitForEventsNative(num_events, event_list);
+        drainReferenceReleasesNative();
+        return checkResult(result);
     }
 
     private static native int clWaitForEventsNative(int num_events, cl_event event_list[]);
@@ -15608,6 +15858,30 @@ public final class CL
     }
     private static native int clSetUserEventStatusNative(cl_event event, int execution_status);
 
+    /**
+     * Create one user event for each non-<code>null</code> element of 
+     * the given array, and write it into this element. Stops at the
+     * first error. See {@link UserEventPool}.
+     * 
+     * @param context The context
+     * @param events The events that will be initialized
+     * @param errcode_ret The error code of the first failed creation, 
+     * or CL_SUCCESS
+     * @return The number of events that have been created
+     */
+    static native int createUserEventsNative(cl_context context, cl_event events[], int errcode_ret[]);
+
+    /**
+     * Release the first <code>count</code> non-<code>null</code> events 
+     * of the given array with a single native call. See 
+     * {@link UserEventPool}.
+     * 
+     * @param events The events
+     * @param count The number of events
+     * @return The first error code, or CL_SUCCESS
+     */
+    static native int releaseEventsNative(cl_event events[], int count);
+
     /**
      * <p>
      *       Registers a user callback function for a specific command execution status.
@@ -16177,7 +16451,9 @@ public final class CL
      */
     public static int clFinish(cl_command_queue command_queue)
     {
-        return checkResult(clFinishNative(command_queue));
+        int result = clFinishNative(command_queue);
+        drainReferenceReleasesNative();
+        return checkResult(result);
     }
 
     private static native int clFinishNative(cl_command_queue command_queue);
@@ -22235,7 +22511,31 @@ public final class CL
     public static int clEnqueueSVMMemcpy(cl_command_queue command_queue, boolean blocking_copy, Pointer dst_ptr, Pointer src_ptr, long size, int num_events_in_wait_list, cl_event event_wait_list[], cl_event event)
     {
         // OPENCL_2_0
-        return checkResult(clEnqueueSVMMemcpyNative(command_queue, blocking_copy, dst_ptr, src_ptr, size, num_events_in_wait_list, event_wait_list, event));
+        // Implementation note: The pointers may be SVM pointers (with 
+        // an offset), pointers to direct buffers or pointers to arrays. 
+        // Copies into arrays are always performed as blocking copies. 
+        // Non-blocking copies from arrays use a host staging area that 
+        // is freed natively. For non-blocking copies involving direct 
+        // buffers, the buffers have to be kept reachable until the copy 
+        // is finished. See notes about NON_BLOCKING_OPERATIONS.
+        if (blocking_copy || 
+            (!isDirectBufferPointer(dst_ptr) && !isDirectBufferPointer(src_ptr)))
+        {
+            return checkResult(clEnqueueSVMMemcpyNative(command_queue, blocking_copy, dst_ptr, src_ptr, size, num_events_in_wait_list, event_wait_list, event));
+        }
+        boolean doRetainEvent = true;
+        if (event == null)
+        {
+            doRetainEvent = false;
+            event = new cl_event();
+        }
+        int result = checkResult(clEnqueueSVMMemcpyNative(command_queue, blocking_copy, dst_ptr, src_ptr, size, num_events_in_wait_list, event_wait_list, event));
+        // Only schedule the reference release if the enqueue succeeds.
+        if (result == CL_SUCCESS)
+        {
+            scheduleReferenceRelease(event, new Object[]{ dst_ptr, src_ptr }, doRetainEvent);
+        }
+        return checkResult(result);
     }
     private static native int clEnqueueSVMMemcpyNative(cl_command_queue command_queue, boolean blocking_copy, Pointer dst_ptr, Pointer src_ptr, long size, int num_events_in_wait_list, cl_event event_wait_list[], cl_event event);
 
@@ -22486,6 +22786,18 @@ public final class CL
     }
     private static native int clEnqueueSVMMemFillNative(cl_command_queue command_queue, Pointer svm_ptr, Pointer pattern, long pattern_size, long size, int num_events_in_wait_list, cl_event event_wait_list[], cl_event event);
 
+    /**
+     * Returns whether the given pointer is a non-null pointer to a 
+     * direct buffer
+     * 
+     * @param pointer The pointer
+     * @return Whether the pointer is a direct buffer pointer
+     */
+    private static boolean isDirectBufferPointer(Pointer pointer)
+    {
+        return pointer != null && pointer.isDirectBufferPointer();
+    }
+
     /**
      * <p>
      *             Enqueues a command that will allow the host to update a region of a SVM buffer.
@@ -25854,6 +26166,48 @@ public final class CL
     }
 
     private static native int clEnqueueReleaseGLObjectsNative(cl_command_queue command_queue, int num_objects, cl_mem mem_objects[], int num_events_in_wait_list, cl_event event_wait_list[], cl_event event);
+
+    /**
+     * Creates an event object linked to an OpenGL fence sync object.
+     * This requires the <code>cl_khr_gl_event</code> extension.<br>
+     * <br>
+     * The event will be complete when the fence sync object (which 
+     * was created with <code>glFenceSync</code>) is signalled. It may 
+     * be used in the event wait list of 
+     * {@link #clEnqueueAcquireGLObjects}, so that the acquisition is 
+     * ordered after the OpenGL commands without calling 
+     * <code>glFinish</code>. The event has the command type 
+     * <code>CL_COMMAND_GL_FENCE_SYNC_OBJECT_KHR</code>, and may not 
+     * be used in <code>clSetUserEventStatus</code>. See 
+     * {@link GLInteropSync}.
+     *
+     * @param context A valid OpenCL context created from an OpenGL 
+     * context or share group
+     * @param sync The native handle of the <code>GLsync</code> object, 
+     * as it is returned by the OpenGL bindings
+     * @param errcode_ret Will return an appropriate error code. May be
+     * <code>null</code>.
+     * @return The event
+     */
+    public static cl_event clCreateEventFromGLsyncKHR(cl_context context, long sync, int errcode_ret[])
+    {
+        if (exceptionsEnabled)
+        {
+            if (errcode_ret == null)
+            {
+                errcode_ret = new int[1];
+            }
+            cl_event result = clCreateEventFromGLsyncKHRNative(context, sync, errcode_ret);
+            checkResult(errcode_ret[0]);
+            return result;
+        }
+        else
+        {
+            return clCreateEventFromGLsyncKHRNative(context, sync, errcode_ret);
+        }
+    }
+
+    private static native cl_event clCreateEventFromGLsyncKHRNative(cl_context context, long sync, int errcode_ret[]);
     
     /**
      * <p>
@@ -0,0 +1,883 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * A pool of pre-created contexts and command queues, which are leased 
+ * to tenants that have to be isolated from each other.<br>
+ * <br>
+ * Creating a context is expensive, and takes tens of milliseconds on 
+ * many implementations. This pool creates contexts in advance, each 
+ * with a single device and command queue, and leases them via 
+ * {@link #lease(cl_device_id)}. When a {@link Lease} is released, the
+ * context is scrubbed: The queue is finished, and all memory objects 
+ * and kernels that have been created or registered via the lease are 
+ * released. The context is then returned to the pool, unless one of
+ * these operations failed. In this case, the context is released 
+ * instead, and a fresh context is created in the background.<br>
+ * <br>
+ * The pool only knows the objects that have been created or registered
+ * via the lease. Tenants must therefore create their objects via the 
+ * lease, register them with {@link Lease#track(cl_mem)} or 
+ * {@link Lease#track(cl_kernel)}, or release them before releasing the
+ * lease. A tenant that can not guarantee this must call 
+ * {@link Lease#discard()} instead of {@link Lease#release()}, so that 
+ * the context is not leased to another tenant.<br>
+ * <br>
+ * Each context keeps a cache of built programs, so that tenants that
+ * use the same kernels do not have to build them again. Programs that
+ * are added with {@link #addWarmProgram(String, String)} are built 
+ * for all contexts in advance.<br>
+ * <br>
+ * When fewer than the minimum number of idle contexts are available 
+ * for a device, new contexts are created by a background thread. 
+ * When no idle context is available, {@link #lease(cl_device_id)} 
+ * creates one synchronously.<br>
+ * <br>
+ * This class is thread-safe.
+ */
+public final class ContextPool
+{
+    /**
+     * A context with a single device and command queue, and the cache 
+     * of programs that have been built for it
+     */
+    private static final class PooledContext
+    {
+        /**
+         * The device
+         */
+        final cl_device_id device;
+        
+        /**
+         * The context
+         */
+        final cl_context context;
+        
+        /**
+         * The command queue
+         */
+        final cl_command_queue queue;
+        
+        /**
+         * The programs that have been built for this context, with the
+         * key that is created by {@link ContextPool#programKey}
+         */
+        final Map<String, cl_program> programs;
+        
+        /**
+         * Creates a new pooled context
+         * 
+         * @param device The device
+         * @param context The context
+         * @param queue The command queue
+         */
+        PooledContext(cl_device_id device, cl_context context, 
+            cl_command_queue queue)
+        {
+            this.device = device;
+            this.context = context;
+            this.queue = queue;
+            this.programs = new HashMap<String, cl_program>();
+        }
+    }
+    
+    /**
+     * A lease of a pooled context. The memory objects and kernels that 
+     * are created or registered via a lease will be released when the
+     * lease is released.
+     */
+    public final class Lease
+    {
+        /**
+         * The pooled context
+         */
+        private final PooledContext pooledContext;
+        
+        /**
+         * The memory objects that will be released
+         */
+        private final List<cl_mem> mems;
+        
+        /**
+         * The kernels that will be released
+         */
+        private final List<cl_kernel> kernels;
+        
+        /**
+         * Whether this lease was already released
+         */
+        private boolean released;
+        
+        /**
+         * Whether this lease was discarded, meaning that its context 
+         * must not be returned to the pool
+         */
+        private boolean discarded;
+        
+        /**
+         * Creates a new lease for the given pooled context
+         * 
+         * @param pooledContext The pooled context
+         */
+        Lease(PooledContext pooledContext)
+        {
+            this.pooledContext = pooledContext;
+            this.mems = new ArrayList<cl_mem>();
+            this.kernels = new ArrayList<cl_kernel>();
+        }
+        
+        /**
+         * Returns the context of this lease
+         * 
+         * @return The context
+         */
+        public cl_context getContext()
+        {
+            return pooledContext.context;
+        }
+        
+        /**
+         * Returns the command queue of this lease
+         * 
+         * @return The command queue
+         */
+        public cl_command_queue getQueue()
+        {
+            return pooledContext.queue;
+        }
+        
+        /**
+         * Returns the device of this lease
+         * 
+         * @return The device
+         */
+        public cl_device_id getDevice()
+        {
+            return pooledContext.device;
+        }
+        
+        /**
+         * Create a buffer like {@link CL#clCreateBuffer}, which will be
+         * released when this lease is released
+         * 
+         * @param flags The memory flags
+         * @param size The size, in bytes
+         * @param host_ptr The host pointer. May be <code>null</code>.
+         * @return The buffer
+         * @throws IllegalStateException If this lease was already released
+         * @throws CLException If the buffer can not be created
+         */
+        public synchronized cl_mem createBuffer(
+            long flags, long size, Pointer host_ptr)
+        {
+            checkNotReleased();
+            int errcode_ret[] = new int[1];
+            cl_mem mem = clCreateBuffer(pooledContext.context, 
+                flags, size, host_ptr, errcode_ret);
+            requireSuccess(errcode_ret[0]);
+            mems.add(mem);
+            return mem;
+        }
+        
+        /**
+         * Register the given memory object, which has been created for
+         * the context of this lease, to be released when this lease is
+         * released
+         * 
+         * @param mem The memory object
+         * @throws IllegalStateException If this lease was already released
+         */
+        public synchronized void track(cl_mem mem)
+        {
+            checkNotReleased();
+            mems.add(mem);
+        }
+        
+        /**
+         * Register the given kernel, which has been created for the
+         * context of this lease, to be released when this lease is
+         * released
+         * 
+         * @param kernel The kernel
+         * @throws IllegalStateException If this lease was already released
+         */
+        public synchronized void track(cl_kernel kernel)
+        {
+            checkNotReleased();
+            kernels.add(kernel);
+        }
+        
+        /**
+         * Returns the program for the given source code and build 
+         * options. The program is taken from the cache of the context, 
+         * or built and stored in the cache. The program is owned by 
+         * the pool, and must not be released by the caller.
+         * 
+         * @param source The source code
+         * @param options The build options. May be <code>null</code>.
+         * @return The program
+         * @throws IllegalStateException If this lease was already released
+         * @throws CLException If the program can not be built
+         */
+        public synchronized cl_program getProgram(
+            String source, String options)
+        {
+            checkNotReleased();
+            return obtainProgram(pooledContext, source, options);
+        }
+        
+        /**
+         * Create the kernel with the given name, from the program that 
+         * is returned by {@link #getProgram(String, String)}. The kernel
+         * will be released when this lease is released.
+         * 
+         * @param source The source code
+         * @param options The build options. May be <code>null</code>.
+         * @param kernelName The kernel name
+         * @return The kernel
+         * @throws IllegalStateException If this lease was already released
+         * @throws CLException If the program can not be built or the
+         * kernel can not be created
+         */
+        public synchronized cl_kernel createKernel(
+            String source, String options, String kernelName)
+        {
+            cl_program program = getProgram(source, options);
+            int errcode_ret[] = new int[1];
+            cl_kernel kernel = 
+                clCreateKernel(program, kernelName, errcode_ret);
+            requireSuccess(errcode_ret[0]);
+            kernels.add(kernel);
+            return kernel;
+        }
+        
+        /**
+         * Release this lease and return the context to the pool. The
+         * command queue is finished, and all memory objects and kernels
+         * that have been created or registered via this lease are 
+         * released. Calling this method multiple times has no effect.
+         */
+        public void release()
+        {
+            synchronized (this)
+            {
+                if (released)
+                {
+                    return;
+                }
+                released = true;
+            }
+            returnLease(this);
+        }
+        
+        /**
+         * Release this lease like {@link #release()}, but release the
+         * context instead of returning it to the pool. This must be 
+         * called when objects have been created for the context that 
+         * have neither been created nor registered via this lease, and
+         * that are still alive. Calling this method after the lease 
+         * was released has no effect.
+         */
+        public void discard()
+        {
+            synchronized (this)
+            {
+                if (released)
+                {
+                    return;
+                }
+                released = true;
+                discarded = true;
+            }
+            returnLease(this);
+        }
+        
+        /**
+         * Scrub the context of this lease. Returns whether this succeeded,
+         * meaning that the queue was finished and all objects that have
+         * been created or registered via this lease have been released,
+         * so that the context may be reused.
+         * 
+         * @return Whether the context was scrubbed
+         */
+        synchronized boolean scrub()
+        {
+            boolean success = true;
+            try
+            {
+                requireSuccess(clFinish(pooledContext.queue));
+            }
+            catch (CLException e)
+            {
+                success = false;
+            }
+            for (cl_kernel kernel : kernels)
+            {
+                try
+                {
+                    requireSuccess(clReleaseKernel(kernel));
+                }
+                catch (CLException e)
+                {
+                    success = false;
+                }
+            }
+            kernels.clear();
+            for (cl_mem mem : mems)
+            {
+                try
+                {
+                    requireSuccess(clReleaseMemObject(mem));
+                }
+                catch (CLException e)
+                {
+                    success = false;
+                }
+            }
+            mems.clear();
+            return success && !discarded;
+        }
+        
+        /**
+         * Make sure that this lease was not released yet
+         * 
+         * @throws IllegalStateException If this lease was already released
+         */
+        private void checkNotReleased()
+        {
+            if (released)
+            {
+                throw new IllegalStateException(
+                    "The lease was already released");
+            }
+        }
+    }
+    
+    /**
+     * The platform of the devices
+     */
+    private final cl_platform_id platform;
+    
+    /**
+     * The command queue properties
+     */
+    private final long queueProperties;
+    
+    /**
+     * The minimum number of idle contexts per device
+     */
+    private final int minIdle;
+    
+    /**
+     * The maximum number of idle contexts per device
+     */
+    private final int maxIdle;
+    
+    /**
+     * The idle contexts, with the native pointer of the device as the key
+     */
+    private final Map<Long, ConcurrentLinkedQueue<PooledContext>> idle;
+    
+    /**
+     * The number of idle contexts and contexts that are currently 
+     * being created, with the native pointer of the device as the key
+     */
+    private final Map<Long, AtomicInteger> idleCounts;
+    
+    /**
+     * The programs that are built for all contexts, as pairs of 
+     * source code and build options
+     */
+    private final List<String[]> warmPrograms;
+    
+    /**
+     * The executor that creates contexts in the background
+     */
+    private final ExecutorService refillExecutor;
+    
+    /**
+     * The number of leases that received an idle context
+     */
+    private final AtomicLong hitCount = new AtomicLong();
+    
+    /**
+     * The number of leases that had to create a context
+     */
+    private final AtomicLong missCount = new AtomicLong();
+    
+    /**
+     * The number of contexts that have been created
+     */
+    private final AtomicLong createdCount = new AtomicLong();
+    
+    /**
+     * Whether this pool was shut down
+     */
+    private volatile boolean shutdown;
+    
+    /**
+     * Creates a new pool for the given devices of the given platform.
+     * The minimum number of idle contexts will be created for each 
+     * device before this constructor returns.
+     * 
+     * @param platform The platform
+     * @param devices The devices
+     * @param minIdle The minimum number of idle contexts per device
+     * @param maxIdle The maximum number of idle contexts per device. 
+     * Contexts that are returned when this number is reached are 
+     * released.
+     * @param queueProperties The <code>cl_command_queue_properties</code>
+     * for the command queues. May be 0.
+     * @throws IllegalArgumentException If the minimum is negative or
+     * larger than the maximum
+     * @throws CLException If a context can not be created
+     */
+    public ContextPool(cl_platform_id platform, cl_device_id devices[], 
+        int minIdle, int maxIdle, long queueProperties)
+    {
+        if (minIdle < 0 || maxIdle < minIdle)
+        {
+            throw new IllegalArgumentException(
+                "Invalid idle range: " + minIdle + " to " + maxIdle);
+        }
+        this.platform = platform;
+        this.queueProperties = queueProperties;
+        this.minIdle = minIdle;
+        this.maxIdle = maxIdle;
+        this.idle = 
+            new LinkedHashMap<Long, ConcurrentLinkedQueue<PooledContext>>();
+        this.idleCounts = new HashMap<Long, AtomicInteger>();
+        this.warmPrograms = new CopyOnWriteArrayList<String[]>();
+        this.refillExecutor = Executors.newSingleThreadExecutor(
+            new ThreadFactory()
+            {
+                @Override
+                public Thread newThread(Runnable r)
+                {
+                    Thread thread = new Thread(r, "ContextPoolThread");
+                    thread.setDaemon(true);
+                    return thread;
+                }
+            });
+        try
+        {
+            for (cl_device_id device : devices)
+            {
+                Long key = device.getNativePointer();
+                ConcurrentLinkedQueue<PooledContext> queue = 
+                    new ConcurrentLinkedQueue<PooledContext>();
+                idle.put(key, queue);
+                idleCounts.put(key, new AtomicInteger(minIdle));
+                for (int i = 0; i < minIdle; i++)
+                {
+                    queue.add(createPooledContext(device));
+                }
+            }
+        }
+        catch (RuntimeException e)
+        {
+            // Release the contexts that have already been created
+            shutdown();
+            throw e;
+        }
+    }
+    
+    /**
+     * Add a program that should be built for all contexts of this 
+     * pool. It is built immediately for all idle contexts, and for 
+     * all contexts that are created later. Contexts that are currently
+     * leased will build it when it is requested for the first time.
+     * 
+     * @param source The source code
+     * @param options The build options. May be <code>null</code>.
+     * @throws CLException If the program can not be built
+     */
+    public void addWarmProgram(String source, String options)
+    {
+        warmPrograms.add(new String[]{ source, options });
+        for (ConcurrentLinkedQueue<PooledContext> queue : idle.values())
+        {
+            for (PooledContext pooledContext : queue)
+            {
+                obtainProgram(pooledContext, source, options);
+            }
+        }
+    }
+    
+    /**
+     * Lease a context for the given device. If no idle context is 
+     * available, a new one is created.
+     * 
+     * @param device The device
+     * @return The lease
+     * @throws IllegalArgumentException If the device is not one of 
+     * the devices of this pool
+     * @throws IllegalStateException If this pool was shut down
+     * @throws CLException If a context has to be created and this fails
+     */
+    public Lease lease(cl_device_id device)
+    {
+        if (shutdown)
+        {
+            throw new IllegalStateException("The pool was shut down");
+        }
+        Long key = device.getNativePointer();
+        ConcurrentLinkedQueue<PooledContext> queue = idle.get(key);
+        if (queue == null)
+        {
+            throw new IllegalArgumentException(
+                "The device is not contained in this pool: " + device);
+        }
+        PooledContext pooledContext = queue.poll();
+        if (pooledContext != null)
+        {
+            hitCount.incrementAndGet();
+            idleCounts.get(key).decrementAndGet();
+        }
+        else
+        {
+            missCount.incrementAndGet();
+            pooledContext = createPooledContext(device);
+        }
+        scheduleRefill(device);
+        return new Lease(pooledContext);
+    }
+    
+    /**
+     * Returns the number of leases that received an idle context
+     * 
+     * @return The number of hits
+     */
+    public long getHitCount()
+    {
+        return hitCount.get();
+    }
+    
+    /**
+     * Returns the number of leases that had to create a context 
+     * synchronously
+     * 
+     * @return The number of misses
+     */
+    public long getMissCount()
+    {
+        return missCount.get();
+    }
+    
+    /**
+     * Returns the total number of contexts that have been created by 
+     * this pool
+     * 
+     * @return The number of created contexts
+     */
+    public long getCreatedCount()
+    {
+        return createdCount.get();
+    }
+    
+    /**
+     * Returns the number of idle contexts for the given device
+     * 
+     * @param device The device
+     * @return The number of idle contexts
+     */
+    public int getIdleCount(cl_device_id device)
+    {
+        ConcurrentLinkedQueue<PooledContext> queue = 
+            idle.get(device.getNativePointer());
+        if (queue == null)
+        {
+            return 0;
+        }
+        return queue.size();
+    }
+    
+    /**
+     * Shut down this pool, and release all idle contexts. Contexts 
+     * that are still leased will be released when their lease is 
+     * released. The background thread that creates contexts is 
+     * terminated.
+     */
+    public void shutdown()
+    {
+        shutdown = true;
+        refillExecutor.shutdown();
+        for (ConcurrentLinkedQueue<PooledContext> queue : idle.values())
+        {
+            PooledContext pooledContext = null;
+            while ((pooledContext = queue.poll()) != null)
+            {
+                destroyPooledContext(pooledContext);
+            }
+        }
+    }
+    
+    /**
+     * Called when the given lease is released. Scrubs the context and
+     * returns it to the pool, or releases it if the pool is full, was
+     * shut down, the lease was discarded, or the context could not be 
+     * scrubbed.
+     * 
+     * @param lease The lease
+     */
+    private void returnLease(Lease lease)
+    {
+        PooledContext pooledContext = lease.pooledContext;
+        boolean scrubbed = lease.scrub();
+        Long key = pooledContext.device.getNativePointer();
+        AtomicInteger idleCount = idleCounts.get(key);
+        if (!scrubbed || shutdown)
+        {
+            destroyPooledContext(pooledContext);
+            scheduleRefill(pooledContext.device);
+            return;
+        }
+        if (idleCount.incrementAndGet() > maxIdle)
+        {
+            idleCount.decrementAndGet();
+            destroyPooledContext(pooledContext);
+            return;
+        }
+        idle.get(key).add(pooledContext);
+        if (shutdown)
+        {
+            shutdown();
+        }
+    }
+    
+    /**
+     * Schedule the creation of contexts for the given device in the 
+     * background, until the minimum number of idle contexts is 
+     * available again
+     * 
+     * @param device The device
+     */
+    private void scheduleRefill(final cl_device_id device)
+    {
+        final Long key = device.getNativePointer();
+        final AtomicInteger idleCount = idleCounts.get(key);
+        while (true)
+        {
+            int count = idleCount.get();
+            if (count >= minIdle)
+            {
+                return;
+            }
+            if (idleCount.compareAndSet(count, count + 1))
+            {
+                break;
+            }
+        }
+        if (shutdown)
+        {
+            idleCount.decrementAndGet();
+            return;
+        }
+        Runnable refill = new Runnable()
+        {
+            @Override
+            public void run()
+            {
+                if (shutdown)
+                {
+                    idleCount.decrementAndGet();
+                    return;
+                }
+                try
+                {
+                    idle.get(key).add(createPooledContext(device));
+                }
+                catch (CLException e)
+                {
+                    idleCount.decrementAndGet();
+                    return;
+                }
+                scheduleRefill(device);
+            }
+        };
+        try
+        {
+            refillExecutor.execute(refill);
+        }
+        catch (RejectedExecutionException e)
+        {
+            // The pool was shut down concurrently
+            idleCount.decrementAndGet();
+        }
+    }
+    
+    /**
+     * Create a new context and command queue for the given device, 
+     * and build the warm programs for it
+     * 
+     * @param device The device
+     * @return The pooled context
+     * @throws CLException If the context, queue or a program can not 
+     * be created
+     */
+    @SuppressWarnings("deprecation")
+    private PooledContext createPooledContext(cl_device_id device)
+    {
+        cl_context_properties contextProperties = 
+            new cl_context_properties();
+        contextProperties.addProperty(CL_CONTEXT_PLATFORM, platform);
+        int errcode_ret[] = new int[1];
+        cl_context context = clCreateContext(contextProperties, 1, 
+            new cl_device_id[]{ device }, null, null, errcode_ret);
+        requireSuccess(errcode_ret[0]);
+        cl_command_queue queue = clCreateCommandQueue(
+            context, device, queueProperties, errcode_ret);
+        if (errcode_ret[0] != CL_SUCCESS)
+        {
+            clReleaseContext(context);
+            requireSuccess(errcode_ret[0]);
+        }
+        PooledContext pooledContext = 
+            new PooledContext(device, context, queue);
+        createdCount.incrementAndGet();
+        try
+        {
+            for (String[] warmProgram : warmPrograms)
+            {
+                obtainProgram(pooledContext, warmProgram[0], warmProgram[1]);
+            }
+        }
+        catch (CLException e)
+        {
+            destroyPooledContext(pooledContext);
+            throw e;
+        }
+        return pooledContext;
+    }
+    
+    /**
+     * Release the programs, queue and context of the given pooled context
+     * 
+     * @param pooledContext The pooled context
+     */
+    private static void destroyPooledContext(PooledContext pooledContext)
+    {
+        synchronized (pooledContext)
+        {
+            for (cl_program program : pooledContext.programs.values())
+            {
+                clReleaseProgram(program);
+            }
+            pooledContext.programs.clear();
+        }
+        clReleaseCommandQueue(pooledContext.queue);
+        clReleaseContext(pooledContext.context);
+    }
+    
+    /**
+     * Returns the program for the given source code and options from
+     * the cache of the given pooled context, building it if necessary.
+     * 
+     * @param pooledContext The pooled context
+     * @param source The source code
+     * @param options The build options. May be <code>null</code>.
+     * @return The program
+     * @throws CLException If the program can not be built
+     */
+    private static cl_program obtainProgram(PooledContext pooledContext, 
+        String source, String options)
+    {
+        String key = programKey(source, options);
+        synchronized (pooledContext)
+        {
+            cl_program program = pooledContext.programs.get(key);
+            if (program != null)
+            {
+                return program;
+            }
+            int errcode_ret[] = new int[1];
+            program = clCreateProgramWithSource(pooledContext.context, 1, 
+                new String[]{ source }, null, errcode_ret);
+            requireSuccess(errcode_ret[0]);
+            int result = clBuildProgramNoThrow(
+                program, pooledContext.device, options);
+            if (result != CL_SUCCESS)
+            {
+                clReleaseProgram(program);
+                requireSuccess(result);
+            }
+            pooledContext.programs.put(key, program);
+            return program;
+        }
+    }
+    
+    /**
+     * Build the given program, and return the error code
+     * 
+     * @param program The program
+     * @param device The device
+     * @param options The build options
+     * @return The error code
+     */
+    private static int clBuildProgramNoThrow(cl_program program, 
+        cl_device_id device, String options)
+    {
+        try
+        {
+            return clBuildProgram(program, 1, 
+                new cl_device_id[]{ device }, options, null, null);
+        }
+        catch (CLException e)
+        {
+            return e.getStatus();
+        }
+    }
+    
+    /**
+     * Returns the key for the program cache
+     * 
+     * @param source The source code
+     * @param options The build options
+     * @return The key
+     */
+    private static String programKey(String source, String options)
+    {
+        return (options == null ? "" : options) + "\0" + source;
+    }
+}
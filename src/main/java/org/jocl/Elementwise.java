@@ -0,0 +1,861 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.IdentityHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * A class for evaluating elementwise expressions over 
+ * <code>float</code> buffers with a single, generated kernel.<br>
+ * <br>
+ * Expressions are built from {@link #input(cl_mem) inputs} and 
+ * {@link #constant(float) constants}, for example
+ * <pre><code>
+ * Expression c = input(a).times(input(b)).plus(input(d));
+ * Expression e = c.max(0.0f);
+ * elementwise.evaluate(queue, n, 
+ *     new cl_mem[]{ cMem, eMem }, new Expression[]{ c, e }, 
+ *     0, null, null);
+ * </code></pre>
+ * Instead of launching one kernel per operation, the whole expression
+ * tree (including all outputs) is translated into the source code of 
+ * one fused kernel, which reads each input element once (also when 
+ * several input expressions refer to the same buffer) and writes 
+ * each output element once. Subexpressions that are used multiple 
+ * times are computed once.<br>
+ * <br>
+ * Buffers and constants are passed as kernel arguments, so the 
+ * generated source code only depends on the <i>shape</i> of the 
+ * expressions. The programs are cached by this shape, so evaluating 
+ * the same expressions with different buffers or constants does not
+ * compile a new program.<br>
+ * <br>
+ * Evaluations with the same shape share one kernel, and are therefore
+ * serialized while the arguments are set and the kernel is enqueued.
+ */
+public final class Elementwise
+{
+    /**
+     * An elementwise expression. Instances are immutable, and may be
+     * used in multiple expressions.
+     */
+    public static abstract class Expression
+    {
+        /**
+         * Package-private constructor
+         */
+        Expression()
+        {
+            // Package-private constructor
+        }
+        
+        /**
+         * Returns the sum of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression plus(Expression other)
+        {
+            return new Operation("(%s + %s)", this, other);
+        }
+        
+        /**
+         * Returns the sum of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression plus(float value)
+        {
+            return plus(constant(value));
+        }
+        
+        /**
+         * Returns the difference of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression minus(Expression other)
+        {
+            return new Operation("(%s - %s)", this, other);
+        }
+        
+        /**
+         * Returns the difference of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression minus(float value)
+        {
+            return minus(constant(value));
+        }
+        
+        /**
+         * Returns the product of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression times(Expression other)
+        {
+            return new Operation("(%s * %s)", this, other);
+        }
+        
+        /**
+         * Returns the product of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression times(float value)
+        {
+            return times(constant(value));
+        }
+        
+        /**
+         * Returns the quotient of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression dividedBy(Expression other)
+        {
+            return new Operation("(%s / %s)", this, other);
+        }
+        
+        /**
+         * Returns the quotient of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression dividedBy(float value)
+        {
+            return dividedBy(constant(value));
+        }
+        
+        /**
+         * Returns the maximum of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression max(Expression other)
+        {
+            return new Operation("fmax(%s, %s)", this, other);
+        }
+        
+        /**
+         * Returns the maximum of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression max(float value)
+        {
+            return max(constant(value));
+        }
+        
+        /**
+         * Returns the minimum of this and the given expression
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression min(Expression other)
+        {
+            return new Operation("fmin(%s, %s)", this, other);
+        }
+        
+        /**
+         * Returns the minimum of this expression and the given value
+         * 
+         * @param value The value
+         * @return The new expression
+         */
+        public final Expression min(float value)
+        {
+            return min(constant(value));
+        }
+        
+        /**
+         * Returns this expression raised to the power of the given one
+         * 
+         * @param other The other expression
+         * @return The new expression
+         */
+        public final Expression pow(Expression other)
+        {
+            return new Operation("pow(%s, %s)", this, other);
+        }
+        
+        /**
+         * Returns the negation of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression negate()
+        {
+            return new Operation("(-%s)", this);
+        }
+        
+        /**
+         * Returns the absolute value of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression abs()
+        {
+            return new Operation("fabs(%s)", this);
+        }
+        
+        /**
+         * Returns the square root of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression sqrt()
+        {
+            return new Operation("sqrt(%s)", this);
+        }
+        
+        /**
+         * Returns the exponential of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression exp()
+        {
+            return new Operation("exp(%s)", this);
+        }
+        
+        /**
+         * Returns the natural logarithm of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression log()
+        {
+            return new Operation("log(%s)", this);
+        }
+        
+        /**
+         * Returns the hyperbolic tangent of this expression
+         * 
+         * @return The new expression
+         */
+        public final Expression tanh()
+        {
+            return new Operation("tanh(%s)", this);
+        }
+    }
+    
+    /**
+     * An expression that reads the elements of a buffer
+     */
+    private static final class Input extends Expression
+    {
+        /**
+         * The buffer
+         */
+        private final cl_mem mem;
+        
+        /**
+         * Creates a new input expression
+         * 
+         * @param mem The buffer
+         */
+        Input(cl_mem mem)
+        {
+            this.mem = mem;
+        }
+    }
+    
+    /**
+     * An expression for a constant value
+     */
+    private static final class Constant extends Expression
+    {
+        /**
+         * The value
+         */
+        private final float value;
+        
+        /**
+         * Creates a new constant expression
+         * 
+         * @param value The value
+         */
+        Constant(float value)
+        {
+            this.value = value;
+        }
+    }
+    
+    /**
+     * An expression for an operation on other expressions
+     */
+    private static final class Operation extends Expression
+    {
+        /**
+         * The format string for the OpenCL C code of the operation,
+         * with one <code>%s</code> for each operand
+         */
+        private final String format;
+        
+        /**
+         * The operands
+         */
+        private final Expression operands[];
+        
+        /**
+         * Creates a new operation
+         * 
+         * @param format The format string
+         * @param operands The operands
+         */
+        Operation(String format, Expression ... operands)
+        {
+            for (Expression operand : operands)
+            {
+                if (operand == null)
+                {
+                    throw new NullPointerException(
+                        "The operand may not be null");
+                }
+            }
+            this.format = format;
+            this.operands = operands;
+        }
+    }
+    
+    /**
+     * Returns an expression that reads the elements of the given buffer
+     * 
+     * @param mem The buffer, containing <code>float</code> values
+     * @return The expression
+     */
+    public static Expression input(cl_mem mem)
+    {
+        if (mem == null)
+        {
+            throw new NullPointerException("The buffer may not be null");
+        }
+        return new Input(mem);
+    }
+    
+    /**
+     * Returns an expression for the given constant value. The value is
+     * passed as a kernel argument, and does not affect the shape of the
+     * expression.
+     * 
+     * @param value The value
+     * @return The expression
+     */
+    public static Expression constant(float value)
+    {
+        return new Constant(value);
+    }
+    
+    /**
+     * The result of translating expressions into a kernel: The source
+     * code, and the arguments for the kernel
+     */
+    private static final class Translation
+    {
+        /**
+         * The buffers that are passed as arguments, in order
+         */
+        private final List<cl_mem> mems = new ArrayList<cl_mem>();
+        
+        /**
+         * For each buffer, whether it is written
+         */
+        private final List<Boolean> written = new ArrayList<Boolean>();
+        
+        /**
+         * The constants that are passed as arguments, in order
+         */
+        private final List<Float> constants = new ArrayList<Float>();
+        
+        /**
+         * The name of the variable that stores each expression
+         */
+        private final Map<Expression, String> variables = 
+            new IdentityHashMap<Expression, String>();
+        
+        /**
+         * The name of the variable that stores the element of each 
+         * input buffer, by the index of the buffer. Different input 
+         * expressions for the same buffer share this variable.
+         */
+        private final Map<Integer, String> inputVariables = 
+            new HashMap<Integer, String>();
+        
+        /**
+         * The statements of the kernel body
+         */
+        private final StringBuilder body = new StringBuilder();
+        
+        /**
+         * The source code of the kernel
+         */
+        private String source;
+        
+        /**
+         * Returns the index of the given buffer in the list of buffers,
+         * adding it if necessary
+         * 
+         * @param mem The buffer
+         * @return The index
+         */
+        int indexOf(cl_mem mem)
+        {
+            for (int i = 0; i < mems.size(); i++)
+            {
+                if (mems.get(i).getNativePointer() == mem.getNativePointer())
+                {
+                    return i;
+                }
+            }
+            mems.add(mem);
+            written.add(Boolean.FALSE);
+            return mems.size() - 1;
+        }
+        
+        /**
+         * Emit the statements that compute the given expression, and
+         * return the name of the variable that stores its value
+         * 
+         * @param expression The expression
+         * @return The variable name
+         */
+        String emit(Expression expression)
+        {
+            String variable = variables.get(expression);
+            if (variable != null)
+            {
+                return variable;
+            }
+            String value = null;
+            int inputIndex = -1;
+            if (expression instanceof Input)
+            {
+                Input input = (Input)expression;
+                inputIndex = indexOf(input.mem);
+                variable = inputVariables.get(inputIndex);
+                if (variable != null)
+                {
+                    variables.put(expression, variable);
+                    return variable;
+                }
+                value = "m" + inputIndex + "[i]";
+            }
+            else if (expression instanceof Constant)
+            {
+                Constant constant = (Constant)expression;
+                value = "c" + constants.size();
+                constants.add(constant.value);
+            }
+            else
+            {
+                Operation operation = (Operation)expression;
+                Object operands[] = new Object[operation.operands.length];
+                for (int i = 0; i < operands.length; i++)
+                {
+                    operands[i] = emit(operation.operands[i]);
+                }
+                value = String.format(operation.format, operands);
+            }
+            variable = "t" + variables.size();
+            variables.put(expression, variable);
+            if (inputIndex != -1)
+            {
+                inputVariables.put(inputIndex, variable);
+            }
+            body.append("    float ").append(variable);
+            body.append(" = ").append(value).append(";\n");
+            return variable;
+        }
+    }
+    
+    /**
+     * A cached program and kernel for one shape
+     */
+    private static final class Entry
+    {
+        /**
+         * The program
+         */
+        private final cl_program program;
+        
+        /**
+         * The kernel
+         */
+        private final cl_kernel kernel;
+        
+        /**
+         * Creates a new entry
+         * 
+         * @param program The program
+         * @param kernel The kernel
+         */
+        Entry(cl_program program, cl_kernel kernel)
+        {
+            this.program = program;
+            this.kernel = kernel;
+        }
+    }
+    
+    /**
+     * The name of the generated kernels
+     */
+    private static final String KERNEL_NAME = "elementwise";
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The cached programs and kernels, by their source code
+     */
+    private final Map<String, Entry> cache = new HashMap<String, Entry>();
+    
+    /**
+     * The number of evaluations that used a cached kernel
+     */
+    private final AtomicLong cacheHits = new AtomicLong();
+    
+    /**
+     * The number of evaluations that compiled a new kernel
+     */
+    private final AtomicLong cacheMisses = new AtomicLong();
+    
+    /**
+     * Creates a new instance that compiles its kernels for all devices 
+     * of the given context
+     * 
+     * @param context The context
+     */
+    public Elementwise(cl_context context)
+    {
+        this.context = context;
+    }
+    
+    /**
+     * Evaluate the given expression for <code>n</code> elements, and 
+     * write the result into the given buffer
+     * 
+     * @param commandQueue The command queue
+     * @param n The number of elements
+     * @param output The output buffer
+     * @param expression The expression
+     * @return The error code (<code>CL_SUCCESS</code>) of building
+     * the program or of the launch
+     * @throws CLException If exceptions are enabled and building the
+     * program or the launch fails
+     */
+    public int evaluate(cl_command_queue commandQueue, long n, 
+        cl_mem output, Expression expression)
+    {
+        return evaluate(commandQueue, n, new cl_mem[]{ output }, 
+            new Expression[]{ expression }, 0, null, null);
+    }
+    
+    /**
+     * Evaluate the given expressions for <code>n</code> elements, and 
+     * write the results into the respective output buffers, with a
+     * single kernel launch. An output buffer may also be used as an
+     * input of the expressions. All expressions are evaluated before
+     * any output element is written. If <code>n</code> is 0, then 
+     * only a marker is enqueued for the wait list and the event.
+     * 
+     * @param commandQueue The command queue
+     * @param n The number of elements
+     * @param outputs The output buffers
+     * @param expressions The expressions
+     * @param num_events_in_wait_list The number of events in the wait list
+     * @param event_wait_list The wait list
+     * @param event The event for the kernel launch
+     * @return The error code (<code>CL_SUCCESS</code>) of building
+     * the program or of the launch
+     * @throws IllegalArgumentException If the number of outputs and 
+     * expressions differ, or there are no outputs
+     * @throws CLException If exceptions are enabled and building the
+     * program or the launch fails
+     */
+    public int evaluate(cl_command_queue commandQueue, long n, 
+        cl_mem outputs[], Expression expressions[], 
+        int num_events_in_wait_list, cl_event event_wait_list[], 
+        cl_event event)
+    {
+        if (outputs.length != expressions.length || outputs.length == 0)
+        {
+            throw new IllegalArgumentException(
+                "Expected the same, positive number of outputs and " + 
+                "expressions, but found " + outputs.length + " and " + 
+                expressions.length);
+        }
+        if (n == 0)
+        {
+            return clEnqueueMarkerWithWaitList(commandQueue, 
+                num_events_in_wait_list, event_wait_list, event);
+        }
+        Translation translation = translate(outputs, expressions);
+        int errorCode[] = new int[1];
+        Entry entry = obtainEntry(translation.source, errorCode);
+        if (entry == null)
+        {
+            return errorCode[0];
+        }
+        synchronized (entry)
+        {
+            cl_kernel kernel = entry.kernel;
+            int arg = 0;
+            for (cl_mem mem : translation.mems)
+            {
+                clSetKernelArg(kernel, arg++, Sizeof.cl_mem, Pointer.to(mem));
+            }
+            for (Float constant : translation.constants)
+            {
+                clSetKernelArg(kernel, arg++, Sizeof.cl_float, 
+                    Pointer.to(new float[]{ constant }));
+            }
+            clSetKernelArg(kernel, arg++, Sizeof.cl_long, 
+                Pointer.to(new long[]{ n }));
+            return clEnqueueNDRangeKernel(commandQueue, kernel, 1, null, 
+                new long[]{ n }, null, 
+                num_events_in_wait_list, event_wait_list, event);
+        }
+    }
+    
+    /**
+     * Returns the OpenCL C source code of the kernel that would be
+     * used for evaluating the given expressions
+     * 
+     * @param outputs The output buffers
+     * @param expressions The expressions
+     * @return The source code
+     */
+    public static String generateSource(
+        cl_mem outputs[], Expression expressions[])
+    {
+        return translate(outputs, expressions).source;
+    }
+    
+    /**
+     * Returns the number of evaluations that used a cached kernel
+     * 
+     * @return The number of cache hits
+     */
+    public long getCacheHitCount()
+    {
+        return cacheHits.get();
+    }
+    
+    /**
+     * Returns the number of evaluations that compiled a new kernel
+     * 
+     * @return The number of cache misses
+     */
+    public long getCacheMissCount()
+    {
+        return cacheMisses.get();
+    }
+    
+    /**
+     * Release all cached kernels and programs
+     */
+    public synchronized void release()
+    {
+        for (Entry entry : cache.values())
+        {
+            clReleaseKernel(entry.kernel);
+            clReleaseProgram(entry.program);
+        }
+        cache.clear();
+    }
+    
+    /**
+     * Translate the given expressions into a kernel
+     * 
+     * @param outputs The output buffers
+     * @param expressions The expressions
+     * @return The translation
+     */
+    private static Translation translate(
+        cl_mem outputs[], Expression expressions[])
+    {
+        Translation translation = new Translation();
+        StringBuilder stores = new StringBuilder();
+        for (int i = 0; i < outputs.length; i++)
+        {
+            String variable = translation.emit(expressions[i]);
+            int index = translation.indexOf(outputs[i]);
+            translation.written.set(index, Boolean.TRUE);
+            stores.append("    m").append(index).append("[i] = ");
+            stores.append(variable).append(";\n");
+        }
+        StringBuilder source = new StringBuilder();
+        source.append("__kernel void ").append(KERNEL_NAME).append("(");
+        for (int i = 0; i < translation.mems.size(); i++)
+        {
+            source.append(translation.written.get(i) ? 
+                "__global float *m" : "__global const float *m");
+            source.append(i).append(", ");
+        }
+        for (int i = 0; i < translation.constants.size(); i++)
+        {
+            source.append("float c").append(i).append(", ");
+        }
+        source.append("long n)\n");
+        source.append("{\n");
+        source.append("    long i = get_global_id(0);\n");
+        source.append("    if (i >= n) return;\n");
+        source.append(translation.body);
+        source.append(stores);
+        source.append("}\n");
+        translation.source = source.toString();
+        return translation;
+    }
+    
+    /**
+     * Returns the cached entry for the given source code, building the
+     * program and creating the kernel if necessary
+     * 
+     * @param source The source code
+     * @param errorCode Receives the error code if the entry can not
+     * be created
+     * @return The entry, or <code>null</code> if it can not be created
+     * @throws CLException If exceptions are enabled and the program 
+     * can not be built
+     */
+    private synchronized Entry obtainEntry(String source, int errorCode[])
+    {
+        Entry entry = cache.get(source);
+        if (entry != null)
+        {
+            cacheHits.incrementAndGet();
+            return entry;
+        }
+        cacheMisses.incrementAndGet();
+        cl_program program = clCreateProgramWithSource(
+            context, 1, new String[]{ source }, null, errorCode);
+        if (checkResult(errorCode[0]) != CL_SUCCESS)
+        {
+            return null;
+        }
+        int result = clBuildProgramNoThrow(program);
+        if (result != CL_SUCCESS)
+        {
+            String log = obtainBuildLog(program);
+            clReleaseProgram(program);
+            errorCode[0] = result;
+            try
+            {
+                checkResult(result);
+            }
+            catch (CLException e)
+            {
+                if (log == null)
+                {
+                    throw e;
+                }
+                throw new CLException(e.getMessage() + "\n" + log, e, result);
+            }
+            return null;
+        }
+        cl_kernel kernel = clCreateKernel(program, KERNEL_NAME, errorCode);
+        if (errorCode[0] != CL_SUCCESS)
+        {
+            clReleaseProgram(program);
+            checkResult(errorCode[0]);
+            return null;
+        }
+        entry = new Entry(program, kernel);
+        cache.put(source, entry);
+        return entry;
+    }
+    
+    /**
+     * Build the given program for all devices of the context, and 
+     * return the error code
+     * 
+     * @param program The program
+     * @return The error code
+     */
+    private static int clBuildProgramNoThrow(cl_program program)
+    {
+        try
+        {
+            return clBuildProgram(program, 0, null, null, null, null);
+        }
+        catch (CLException e)
+        {
+            return e.getStatus();
+        }
+    }
+    
+    /**
+     * Returns the build log of the given program for the first device
+     * of the context
+     * 
+     * @param program The program
+     * @return The build log
+     */
+    private String obtainBuildLog(cl_program program)
+    {
+        try
+        {
+            cl_device_id devices[] = new cl_device_id[1];
+            clGetContextInfo(context, CL_CONTEXT_DEVICES, 
+                Sizeof.cl_device_id, Pointer.to(devices), null);
+            long size[] = new long[1];
+            clGetProgramBuildInfo(program, devices[0], 
+                CL_PROGRAM_BUILD_LOG, 0, null, size);
+            byte buffer[] = new byte[(int)size[0]];
+            clGetProgramBuildInfo(program, devices[0], 
+                CL_PROGRAM_BUILD_LOG, buffer.length, Pointer.to(buffer), null);
+            return new String(buffer, 0, Math.max(0, buffer.length - 1));
+        }
+        catch (CLException e)
+        {
+            return null;
+        }
+    }
+}
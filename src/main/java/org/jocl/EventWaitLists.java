@@ -0,0 +1,193 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+/**
+ * Controls the optional normalization of the event wait lists that 
+ * are passed to the <code>clEnqueue*</code> functions.<br>
+ * <br>
+ * When the normalization is enabled, then each event wait list is 
+ * processed natively before it is passed to the implementation:
+ * <ul>
+ *   <li>
+ *     Duplicate events are removed
+ *   </li>
+ *   <li>
+ *     Events that are known to be complete are removed. For this, a
+ *     completion callback is registered for each event when it appears
+ *     in a wait list for the first time. The events that completed are
+ *     retained until they are evicted from a bounded set, or the 
+ *     normalization is disabled, so that the handles of these events 
+ *     are not reused by the implementation in the meantime.
+ *   </li>
+ *   <li>
+ *     If a collapse threshold was set, then lists that still contain 
+ *     more events than this threshold are replaced by a single marker
+ *     that is enqueued with <code>clEnqueueMarkerWithWaitList</code>.
+ *   </li>
+ * </ul>
+ * The wait lists of markers and barriers are never collapsed, and 
+ * always keep at least one event, because an empty wait list would 
+ * change their semantics.<br>
+ * <br>
+ * The normalization is disabled by default.
+ */
+public final class EventWaitLists
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * Enable or disable the normalization of event wait lists. When
+     * it is disabled, all events that are known to be complete are
+     * released.
+     * 
+     * @param enabled Whether the normalization is enabled
+     */
+    public static void setEnabled(boolean enabled)
+    {
+        setEnabledNative(enabled);
+    }
+    
+    /**
+     * Returns whether the normalization of event wait lists is enabled
+     * 
+     * @return Whether the normalization is enabled
+     */
+    public static boolean isEnabled()
+    {
+        return isEnabledNative();
+    }
+    
+    /**
+     * Set the number of events above which a wait list is collapsed 
+     * into a single marker event. A value of 0 (which is the default)
+     * means that lists are never collapsed.
+     * 
+     * @param threshold The threshold
+     * @throws IllegalArgumentException If the threshold is negative
+     */
+    public static void setCollapseThreshold(int threshold)
+    {
+        if (threshold < 0)
+        {
+            throw new IllegalArgumentException(
+                "The threshold may not be negative: " + threshold);
+        }
+        setCollapseThresholdNative(threshold);
+    }
+    
+    /**
+     * Returns the number of duplicate events that have been removed
+     * 
+     * @return The number of duplicates
+     */
+    public static long getDuplicatesRemovedCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of complete events that have been removed
+     * 
+     * @return The number of complete events
+     */
+    public static long getCompletedRemovedCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of wait lists that have been collapsed into
+     * a marker
+     * 
+     * @return The number of collapsed wait lists
+     */
+    public static long getCollapsedCount()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Returns the number of events that are currently known to be 
+     * complete, and are retained for this reason
+     * 
+     * @return The number of complete events
+     */
+    public static long getCompletedEventCount()
+    {
+        return getStatistics()[3];
+    }
+    
+    /**
+     * Returns the number of events that are currently tracked with a
+     * completion callback, and did not complete yet
+     * 
+     * @return The number of pending events
+     */
+    public static long getPendingEventCount()
+    {
+        return getStatistics()[4];
+    }
+    
+    /**
+     * Release all events that are known to be complete. They will be 
+     * tracked again when they appear in a wait list.
+     */
+    public static void clear()
+    {
+        clearNative();
+    }
+    
+    /**
+     * Returns the statistics of the normalization
+     * 
+     * @return The statistics
+     */
+    private static long[] getStatistics()
+    {
+        long statistics[] = new long[5];
+        getStatisticsNative(statistics);
+        return statistics;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private EventWaitLists()
+    {
+        // Private constructor to prevent instantiation.
+    }
+    
+    private static native void setEnabledNative(boolean enabled);
+    private static native boolean isEnabledNative();
+    private static native void setCollapseThresholdNative(int threshold);
+    private static native void getStatisticsNative(long statistics[]);
+    private static native void clearNative();
+}
@@ -0,0 +1,72 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+/**
+ * Utility methods for checking the extensions that are supported 
+ * by a device
+ */
+final class Extensions
+{
+    /**
+     * Returns whether the given device supports the extension with the
+     * given name, according to its <code>CL_DEVICE_EXTENSIONS</code>
+     * 
+     * @param device The device
+     * @param name The name of the extension
+     * @return Whether the extension is supported
+     */
+    static boolean isSupported(cl_device_id device, String name)
+    {
+        long size[] = new long[1];
+        clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, null, size);
+        byte buffer[] = new byte[(int)size[0]];
+        clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 
+            buffer.length, Pointer.to(buffer), null);
+        String extensions = 
+            new String(buffer, 0, Math.max(0, buffer.length - 1));
+        for (String extension : extensions.trim().split("\\s+"))
+        {
+            if (extension.equals(name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private Extensions()
+    {
+        // Private constructor to prevent instantiation.
+    }
+}
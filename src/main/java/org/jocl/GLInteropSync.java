@@ -0,0 +1,197 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+/**
+ * A class for synchronizing the acquisition and release of shared 
+ * OpenGL objects without stalling the OpenCL and OpenGL pipelines.<br>
+ * <br>
+ * Without further support, an application has to call 
+ * <code>glFinish</code> before {@link CL#clEnqueueAcquireGLObjects} and 
+ * <code>clFinish</code> after {@link CL#clEnqueueReleaseGLObjects}.
+ * When the device supports the <code>cl_khr_gl_event</code> extension, 
+ * this is not necessary:
+ * <ul>
+ *   <li>
+ *     The acquisition implicitly waits for the OpenGL commands that 
+ *     have been issued before in the OpenGL context that is current on 
+ *     the same thread. For OpenGL commands of other threads or contexts, 
+ *     the <code>GLsync</code> object that was created with 
+ *     <code>glFenceSync</code> may be passed to 
+ *     {@link #acquire(cl_mem[], long, cl_event)}, and the acquisition
+ *     will wait for an event created with 
+ *     {@link CL#clCreateEventFromGLsyncKHR}.
+ *   </li>
+ *   <li>
+ *     OpenGL commands that are issued after the release implicitly wait
+ *     for the release, so the queue only has to be flushed. The event
+ *     of the release may additionally be passed to OpenGL, via 
+ *     <code>glCreateSyncFromCLeventARB</code>.
+ *   </li>
+ * </ul>
+ * When the extension is not supported, this class falls back to 
+ * <code>clFinish</code> after the release. In this case, the caller 
+ * still has to call <code>glFinish</code> before the acquisition, 
+ * which can not be done by JOCL.
+ */
+public final class GLInteropSync
+{
+    /**
+     * The name of the extension that allows the implicit synchronization
+     */
+    private static final String GL_EVENT_EXTENSION = "cl_khr_gl_event";
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue queue;
+    
+    /**
+     * Whether the device of the queue supports cl_khr_gl_event
+     */
+    private final boolean glEventSupported;
+    
+    /**
+     * Creates a new instance for the given context, which must have been
+     * created for an OpenGL context or share group, and the given
+     * command queue
+     * 
+     * @param context The context
+     * @param queue The command queue
+     */
+    public GLInteropSync(cl_context context, cl_command_queue queue)
+    {
+        this.context = context;
+        this.queue = queue;
+        cl_device_id device[] = new cl_device_id[1];
+        clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, 
+            Sizeof.cl_device_id, Pointer.to(device), null);
+        this.glEventSupported = isGLEventSupported(device[0]);
+    }
+    
+    /**
+     * Returns whether the given device supports the 
+     * <code>cl_khr_gl_event</code> extension, according to its 
+     * <code>CL_DEVICE_EXTENSIONS</code>
+     * 
+     * @param device The device
+     * @return Whether the extension is supported
+     */
+    public static boolean isGLEventSupported(cl_device_id device)
+    {
+        return Extensions.isSupported(device, GL_EVENT_EXTENSION);
+    }
+    
+    /**
+     * Returns whether the acquisition and release are synchronized 
+     * implicitly, because the device supports the 
+     * <code>cl_khr_gl_event</code> extension. If this returns 
+     * <code>false</code>, then the caller has to call 
+     * <code>glFinish</code> before {@link #acquire}.
+     * 
+     * @return Whether the implicit synchronization is supported
+     */
+    public boolean isImplicitSyncSupported()
+    {
+        return glEventSupported;
+    }
+    
+    /**
+     * Enqueue the acquisition of the given OpenGL objects. If the given
+     * <code>GLsync</code> handle is not 0, then the acquisition waits 
+     * until the fence sync object is signalled.
+     * 
+     * @param objects The memory objects that have been created from 
+     * OpenGL objects
+     * @param glSync The native handle of a <code>GLsync</code> object,
+     * or 0
+     * @param event The event for the acquisition. May be 
+     * <code>null</code>.
+     * @throws IllegalStateException If a <code>GLsync</code> handle is
+     * given but the <code>cl_khr_gl_event</code> extension is not 
+     * supported
+     */
+    public void acquire(cl_mem objects[], long glSync, cl_event event)
+    {
+        if (glSync == 0)
+        {
+            clEnqueueAcquireGLObjects(queue, objects.length, objects, 
+                0, null, event);
+            return;
+        }
+        if (!glEventSupported)
+        {
+            throw new IllegalStateException(
+                "The device does not support " + GL_EVENT_EXTENSION + 
+                ", glFinish has to be called before the acquisition");
+        }
+        cl_event syncEvent = 
+            clCreateEventFromGLsyncKHR(context, glSync, null);
+        try
+        {
+            clEnqueueAcquireGLObjects(queue, objects.length, objects, 
+                1, new cl_event[]{ syncEvent }, event);
+        }
+        finally
+        {
+            clReleaseEvent(syncEvent);
+        }
+    }
+    
+    /**
+     * Enqueue the release of the given OpenGL objects. If the implicit 
+     * synchronization is supported, the queue is only flushed, so that 
+     * OpenGL commands that are issued afterwards will wait for the 
+     * release. Otherwise, this method waits until all commands in the
+     * queue are finished.
+     * 
+     * @param objects The memory objects that have been created from 
+     * OpenGL objects
+     * @param event The event for the release. May be <code>null</code>.
+     */
+    public void release(cl_mem objects[], cl_event event)
+    {
+        clEnqueueReleaseGLObjects(queue, objects.length, objects, 
+            0, null, event);
+        if (glEventSupported)
+        {
+            clFlush(queue);
+        }
+        else
+        {
+            clFinish(queue);
+        }
+    }
+}
@@ -0,0 +1,208 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+/**
+ * Controls the optional tracking of hazards on memory objects, which
+ * allows using out-of-order command queues without manually building
+ * event wait lists.<br>
+ * <br>
+ * When the tracking is enabled, the event of the last command that
+ * wrote each memory object, and the events of all commands that read 
+ * it since then, are stored natively. When a command is enqueued, its
+ * event wait list is extended with the events that it has to wait 
+ * for: A command that reads a memory object waits for the last writer
+ * (read-after-write), and a command that writes a memory object also
+ * waits for the readers (write-after-read and write-after-write).<br>
+ * <br>
+ * The following commands are tracked:
+ * <ul>
+ *   <li>
+ *     {@link CL#clEnqueueNDRangeKernel} (and 
+ *     {@link LocalWorkSizes#enqueueNDRangeKernel}), for kernels whose
+ *     argument access modes have been declared with 
+ *     {@link #declareKernelAccesses(cl_kernel, int...)}
+ *   </li>
+ *   <li>
+ *     {@link CL#clEnqueueReadBuffer}, {@link CL#clEnqueueWriteBuffer}, 
+ *     {@link CL#clEnqueueCopyBuffer} and {@link CL#clEnqueueFillBuffer}
+ *   </li>
+ * </ul>
+ * Other commands are not tracked, and have to be synchronized manually.
+ * The tracking applies to all command queues, so that it also orders
+ * commands on different queues of the same context.<br>
+ * <br>
+ * The tracking state is locked while a tracked command is enqueued, so
+ * tracked commands are enqueued one at a time. The stored events are
+ * retained, and released when they are replaced, when the memory 
+ * object is released for the last time, when {@link #clear()} is 
+ * called, or when the tracking is disabled.<br>
+ * <br>
+ * The tracking is disabled by default.
+ */
+public final class HazardTracker
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * The access mode for kernel arguments that are not memory objects,
+     * or that should not be tracked
+     */
+    public static final int NONE = 0;
+    
+    /**
+     * The access mode for memory objects that are only read
+     */
+    public static final int READ = 1;
+    
+    /**
+     * The access mode for memory objects that are only written
+     */
+    public static final int WRITE = 2;
+    
+    /**
+     * The access mode for memory objects that are read and written
+     */
+    public static final int READ_WRITE = READ | WRITE;
+    
+    /**
+     * Enable or disable the hazard tracking. When it is disabled, all
+     * stored events are released. The declared kernel access modes 
+     * are kept.
+     * 
+     * @param enabled Whether the tracking is enabled
+     */
+    public static void setEnabled(boolean enabled)
+    {
+        setEnabledNative(enabled);
+    }
+    
+    /**
+     * Returns whether the hazard tracking is enabled
+     * 
+     * @return Whether the tracking is enabled
+     */
+    public static boolean isEnabled()
+    {
+        return isEnabledNative();
+    }
+    
+    /**
+     * Declare the access modes of the arguments of the given kernel. 
+     * The memory objects that are set as arguments with one of the 
+     * modes {@link #READ}, {@link #WRITE} or {@link #READ_WRITE} are
+     * recorded in {@link CL#clSetKernelArg}, so the tracking has to be
+     * enabled and the access modes have to be declared before the 
+     * arguments are set. The declaration is removed when the kernel 
+     * is released.
+     * 
+     * @param kernel The kernel
+     * @param modes The access mode for each argument
+     * @throws IllegalArgumentException If any mode is invalid
+     */
+    public static void declareKernelAccesses(cl_kernel kernel, int ... modes)
+    {
+        for (int i = 0; i < modes.length; i++)
+        {
+            if (modes[i] < NONE || modes[i] > READ_WRITE)
+            {
+                throw new IllegalArgumentException(
+                    "Invalid access mode for argument " + i + ": " + 
+                    modes[i]);
+            }
+        }
+        declareKernelAccessesNative(kernel, modes);
+    }
+    
+    /**
+     * Returns the number of commands whose events have been recorded
+     * 
+     * @return The number of tracked commands
+     */
+    public static long getTrackedCommandCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of events that have been added to wait lists
+     * 
+     * @return The number of added dependencies
+     */
+    public static long getAddedDependencyCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of memory objects for which events are stored
+     * 
+     * @return The number of memory objects
+     */
+    public static long getTrackedMemObjectCount()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Release all stored events. Commands that are enqueued afterwards
+     * will not wait for commands that have been enqueued before.
+     */
+    public static void clear()
+    {
+        clearNative();
+    }
+    
+    /**
+     * Returns the statistics of the tracking
+     * 
+     * @return The statistics
+     */
+    private static long[] getStatistics()
+    {
+        long statistics[] = new long[3];
+        getStatisticsNative(statistics);
+        return statistics;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private HazardTracker()
+    {
+        // Private constructor to prevent instantiation.
+    }
+    
+    private static native void setEnabledNative(boolean enabled);
+    private static native boolean isEnabledNative();
+    private static native void declareKernelAccessesNative(cl_kernel kernel, int modes[]);
+    private static native void getStatisticsNative(long statistics[]);
+    private static native void clearNative();
+}
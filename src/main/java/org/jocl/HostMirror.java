@@ -0,0 +1,647 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.List;
+
+/**
+ * A host mirror of a device buffer, which uploads only the ranges that
+ * changed since the last upload.<br>
+ * <br>
+ * The mirror is stored in aligned native memory that is exposed as a
+ * direct ByteBuffer. Changes of the mirror may be marked explicitly,
+ * with {@link #markDirty(long, long)} for contiguous ranges and with 
+ * {@link #markDirtyRect(long, long, long, long)} for rectangular 
+ * regions of a buffer that is interpreted as a 2D array with a given 
+ * row pitch. When change detection is enabled, the mirror is 
+ * additionally compared to a snapshot of the data that was last 
+ * uploaded, in blocks of a fixed size, using SIMD instructions when 
+ * they are available.<br>
+ * <br>
+ * During an {@link #upload(cl_command_queue) upload}, the dirty ranges 
+ * are sorted, and ranges that are separated by at most the 
+ * {@link #setMergeGap(long) merge gap} are merged. Each resulting 
+ * range is written with <code>clEnqueueWriteBuffer</code>, and each 
+ * rectangular region with <code>clEnqueueWriteBufferRect</code>.<br>
+ * <br>
+ * Initially, the whole mirror is considered to be dirty, unless the
+ * mirror is filled from the device buffer with 
+ * {@link #download(cl_command_queue)}. Note that the device buffer 
+ * must not be modified by other means, because the unchanged ranges 
+ * are assumed to be identical on the host and the device.<br>
+ * <br>
+ * Instances of this class are not thread-safe.
+ */
+public final class HostMirror
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * The default alignment of the native memory, in bytes
+     */
+    public static final int DEFAULT_ALIGNMENT = 4096;
+    
+    /**
+     * The default block size for the change detection, in bytes
+     */
+    public static final int DEFAULT_BLOCK_SIZE = 256;
+    
+    /**
+     * The maximum number of ranges that are written in one upload. 
+     * When there are more ranges, the span of all ranges is written.
+     */
+    private static final int MAX_RANGES = 1024;
+    
+    /**
+     * The device buffer
+     */
+    private final cl_mem deviceBuffer;
+    
+    /**
+     * The size of the mirror, in bytes
+     */
+    private final int size;
+    
+    /**
+     * The block size for the change detection
+     */
+    private final int blockSize;
+    
+    /**
+     * The mirror
+     */
+    private ByteBuffer mirror;
+    
+    /**
+     * The snapshot of the last uploaded data, or null if the change
+     * detection is disabled
+     */
+    private ByteBuffer snapshot;
+    
+    /**
+     * The explicitly marked ranges, as (start, end) pairs
+     */
+    private final List<long[]> dirtyRanges = new ArrayList<long[]>();
+    
+    /**
+     * The explicitly marked regions, as (offset, row size, rows, 
+     * row pitch) tuples
+     */
+    private final List<long[]> dirtyRects = new ArrayList<long[]>();
+    
+    /**
+     * Whether the whole mirror is dirty
+     */
+    private boolean allDirty = true;
+    
+    /**
+     * The maximum gap between two ranges that are merged, in bytes
+     */
+    private long mergeGap;
+    
+    /**
+     * The array that receives the ranges from the change detection
+     */
+    private final long detectedRanges[] = new long[2 * MAX_RANGES];
+    
+    /**
+     * The statistics
+     */
+    private long uploadedBytes;
+    private long skippedBytes;
+    private long uploadCommands;
+    
+    /**
+     * Creates a new host mirror for the given device buffer, with the
+     * default alignment and block size
+     * 
+     * @param deviceBuffer The device buffer
+     * @param size The size of the mirror, in bytes
+     * @param detectChanges Whether changes should be detected by 
+     * comparing the mirror to a snapshot of the last uploaded data
+     * @throws IllegalArgumentException If the size is not positive
+     */
+    public HostMirror(cl_mem deviceBuffer, int size, boolean detectChanges)
+    {
+        this(deviceBuffer, size, detectChanges, 
+            DEFAULT_ALIGNMENT, DEFAULT_BLOCK_SIZE);
+    }
+    
+    /**
+     * Creates a new host mirror for the given device buffer
+     * 
+     * @param deviceBuffer The device buffer
+     * @param size The size of the mirror, in bytes
+     * @param detectChanges Whether changes should be detected by 
+     * comparing the mirror to a snapshot of the last uploaded data
+     * @param alignment The alignment of the native memory, in bytes
+     * @param blockSize The block size for the change detection, in bytes
+     * @throws IllegalArgumentException If the size or block size is not
+     * positive, or the alignment is not a power of two
+     */
+    public HostMirror(cl_mem deviceBuffer, int size, boolean detectChanges,
+        int alignment, int blockSize)
+    {
+        if (size <= 0 || blockSize <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The size and block size must be positive");
+        }
+        if (alignment < Sizeof.POINTER || (alignment & (alignment - 1)) != 0)
+        {
+            throw new IllegalArgumentException(
+                "The alignment must be a power of two that is at least " + 
+                Sizeof.POINTER + ", but is " + alignment);
+        }
+        this.deviceBuffer = deviceBuffer;
+        this.size = size;
+        this.blockSize = blockSize;
+        this.mirror = allocateNative(size, alignment)
+            .order(ByteOrder.nativeOrder());
+        if (detectChanges)
+        {
+            this.snapshot = allocateNative(size, alignment);
+        }
+    }
+    
+    /**
+     * Returns the device buffer
+     * 
+     * @return The device buffer
+     */
+    public cl_mem getDeviceBuffer()
+    {
+        return deviceBuffer;
+    }
+    
+    /**
+     * Returns the size of the mirror, in bytes
+     * 
+     * @return The size
+     */
+    public int getSize()
+    {
+        return size;
+    }
+    
+    /**
+     * Returns the buffer that contains the mirror. The buffer is only
+     * valid until {@link #release()} is called.
+     * 
+     * @return The mirror
+     * @throws IllegalStateException If the mirror was released
+     */
+    public ByteBuffer getBuffer()
+    {
+        checkNotReleased();
+        return mirror;
+    }
+    
+    /**
+     * Set the maximum gap between two dirty ranges that causes them to
+     * be merged into one range. Larger values cause fewer, but larger 
+     * writes.
+     * 
+     * @param mergeGap The merge gap, in bytes
+     * @throws IllegalArgumentException If the gap is negative
+     */
+    public void setMergeGap(long mergeGap)
+    {
+        if (mergeGap < 0)
+        {
+            throw new IllegalArgumentException(
+                "The merge gap may not be negative: " + mergeGap);
+        }
+        this.mergeGap = mergeGap;
+    }
+    
+    /**
+     * Mark the given range of the mirror as dirty
+     * 
+     * @param offset The offset, in bytes
+     * @param length The length, in bytes
+     * @throws IndexOutOfBoundsException If the range is not contained
+     * in the mirror
+     */
+    public void markDirty(long offset, long length)
+    {
+        checkRange(offset, length);
+        if (length > 0)
+        {
+            dirtyRanges.add(new long[]{ offset, offset + length });
+        }
+    }
+    
+    /**
+     * Mark the given rectangular region of the mirror as dirty. The 
+     * mirror is interpreted as a 2D array with the given row pitch.
+     * 
+     * @param offset The offset of the first byte of the region
+     * @param rowSize The size of each row of the region, in bytes
+     * @param rows The number of rows of the region
+     * @param rowPitch The row pitch, in bytes
+     * @throws IllegalArgumentException If the row pitch is not 
+     * positive, or the row size is larger than the row pitch
+     * @throws IndexOutOfBoundsException If the region is not contained
+     * in the mirror
+     */
+    public void markDirtyRect(long offset, long rowSize, long rows, 
+        long rowPitch)
+    {
+        if (rowPitch <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The row pitch must be positive, but is " + rowPitch);
+        }
+        if (rowSize > rowPitch || offset % rowPitch + rowSize > rowPitch)
+        {
+            throw new IllegalArgumentException(
+                "The region does not fit into a row pitch of " + rowPitch);
+        }
+        if (rowSize <= 0 || rows <= 0)
+        {
+            return;
+        }
+        checkRange(offset, (rows - 1) * rowPitch + rowSize);
+        dirtyRects.add(new long[]{ offset, rowSize, rows, rowPitch });
+    }
+    
+    /**
+     * Mark the whole mirror as dirty
+     */
+    public void markAllDirty()
+    {
+        allDirty = true;
+    }
+    
+    /**
+     * Upload the dirty ranges of the mirror to the device buffer. This 
+     * method blocks until the writes have completed.
+     * 
+     * @param commandQueue The command queue
+     * @return The number of bytes that have been written. If exceptions
+     * are disabled and an OpenCL operation fails, then 0 is returned,
+     * and the dirty ranges are kept.
+     * @throws IllegalStateException If the mirror was released
+     * @throws CLException If exceptions are enabled and an OpenCL 
+     * operation fails
+     */
+    public long upload(cl_command_queue commandQueue)
+    {
+        checkNotReleased();
+        List<long[]> ranges = new ArrayList<long[]>();
+        List<long[]> rects = new ArrayList<long[]>();
+        if (allDirty)
+        {
+            ranges.add(new long[]{ 0, size });
+        }
+        else
+        {
+            ranges.addAll(dirtyRanges);
+            rects.addAll(dirtyRects);
+            if (snapshot != null)
+            {
+                int n = findChangedRangesNative(mirror, snapshot, size, 
+                    blockSize, detectedRanges);
+                if (n < 0)
+                {
+                    ranges.add(new long[]{ 0, size });
+                }
+                for (int i = 0; i < n; i++)
+                {
+                    ranges.add(new long[]{ 
+                        detectedRanges[i * 2], detectedRanges[i * 2 + 1] });
+                }
+            }
+            ranges = mergeRanges(ranges);
+        }
+        
+        // The writes read from the mirror asynchronously, so all writes
+        // that have been enqueued are waited for, even if a later one 
+        // fails, before the mirror may be modified or freed
+        List<cl_event> events = new ArrayList<cl_event>();
+        long bytes = 0;
+        int result = CL_SUCCESS;
+        try
+        {
+            for (long range[] : ranges)
+            {
+                long length = range[1] - range[0];
+                cl_event event = new cl_event();
+                result = clEnqueueWriteBuffer(commandQueue, deviceBuffer, 
+                    CL_FALSE, range[0], length, 
+                    Pointer.to(mirror).withByteOffset(range[0]), 
+                    0, null, event);
+                if (result != CL_SUCCESS)
+                {
+                    break;
+                }
+                events.add(event);
+                bytes += length;
+            }
+            for (long rect[] : rects)
+            {
+                if (result != CL_SUCCESS)
+                {
+                    break;
+                }
+                long offset = rect[0];
+                long rowSize = rect[1];
+                long rows = rect[2];
+                long rowPitch = rect[3];
+                long origin[] = { offset % rowPitch, offset / rowPitch, 0 };
+                cl_event event = new cl_event();
+                result = clEnqueueWriteBufferRect(commandQueue, 
+                    deviceBuffer, CL_FALSE, origin, origin, 
+                    new long[]{ rowSize, rows, 1 }, rowPitch, 0, rowPitch, 
+                    0, Pointer.to(mirror), 0, null, event);
+                if (result != CL_SUCCESS)
+                {
+                    break;
+                }
+                events.add(event);
+                bytes += rowSize * rows;
+            }
+        }
+        finally
+        {
+            int waitResult = waitAndRelease(events);
+            if (result == CL_SUCCESS)
+            {
+                result = waitResult;
+            }
+        }
+        if (checkResult(result) != CL_SUCCESS)
+        {
+            return 0;
+        }
+        
+        if (snapshot != null)
+        {
+            for (long range[] : ranges)
+            {
+                copyToSnapshot(range[0], range[1] - range[0]);
+            }
+            for (long rect[] : rects)
+            {
+                for (long row = 0; row < rect[2]; row++)
+                {
+                    copyToSnapshot(rect[0] + row * rect[3], rect[1]);
+                }
+            }
+        }
+        dirtyRanges.clear();
+        dirtyRects.clear();
+        allDirty = false;
+        uploadedBytes += bytes;
+        skippedBytes += Math.max(0, size - bytes);
+        uploadCommands += events.size();
+        return bytes;
+    }
+    
+    /**
+     * Fill the mirror with the contents of the device buffer. Afterwards,
+     * no range of the mirror is dirty. This method blocks until the 
+     * read has completed.
+     * 
+     * @param commandQueue The command queue
+     * @throws IllegalStateException If the mirror was released
+     * @throws CLException If exceptions are enabled and an OpenCL 
+     * operation fails
+     */
+    public void download(cl_command_queue commandQueue)
+    {
+        checkNotReleased();
+        if (checkResult(clEnqueueReadBuffer(commandQueue, deviceBuffer, 
+            CL_TRUE, 0, size, Pointer.to(mirror), 0, null, null)) 
+                != CL_SUCCESS)
+        {
+            return;
+        }
+        if (snapshot != null)
+        {
+            copyToSnapshot(0, size);
+        }
+        dirtyRanges.clear();
+        dirtyRects.clear();
+        allDirty = false;
+    }
+    
+    /**
+     * Returns the total number of bytes that have been uploaded
+     * 
+     * @return The number of uploaded bytes
+     */
+    public long getUploadedBytes()
+    {
+        return uploadedBytes;
+    }
+    
+    /**
+     * Returns the total number of bytes that have not been uploaded,
+     * compared to uploading the whole mirror in each upload
+     * 
+     * @return The number of skipped bytes
+     */
+    public long getSkippedBytes()
+    {
+        return skippedBytes;
+    }
+    
+    /**
+     * Returns the total number of write commands of all uploads
+     * 
+     * @return The number of write commands
+     */
+    public long getUploadCommandCount()
+    {
+        return uploadCommands;
+    }
+    
+    /**
+     * Release the native memory of this mirror. The device buffer is 
+     * not released. Afterwards, the buffer that was returned by 
+     * {@link #getBuffer()} may no longer be used.
+     */
+    public void release()
+    {
+        if (mirror != null)
+        {
+            freeNative(mirror);
+            mirror = null;
+        }
+        if (snapshot != null)
+        {
+            freeNative(snapshot);
+            snapshot = null;
+        }
+    }
+    
+    /**
+     * Sort the given ranges, and merge the ranges that overlap or are
+     * separated by at most the merge gap. If the result contains more
+     * than {@link #MAX_RANGES} ranges, then it is replaced by the span
+     * of all ranges.
+     * 
+     * @param ranges The ranges
+     * @return The merged ranges
+     */
+    private List<long[]> mergeRanges(List<long[]> ranges)
+    {
+        Collections.sort(ranges, new Comparator<long[]>()
+        {
+            @Override
+            public int compare(long[] r0, long[] r1)
+            {
+                return r0[0] < r1[0] ? -1 : (r0[0] > r1[0] ? 1 : 0);
+            }
+        });
+        List<long[]> merged = new ArrayList<long[]>();
+        long current[] = null;
+        for (long range[] : ranges)
+        {
+            if (current != null && range[0] <= current[1] + mergeGap)
+            {
+                current[1] = Math.max(current[1], range[1]);
+            }
+            else
+            {
+                current = new long[]{ range[0], range[1] };
+                merged.add(current);
+            }
+        }
+        if (merged.size() > MAX_RANGES)
+        {
+            long first = merged.get(0)[0];
+            long last = merged.get(merged.size() - 1)[1];
+            merged.clear();
+            merged.add(new long[]{ first, last });
+        }
+        return merged;
+    }
+    
+    /**
+     * Wait for the given events and release them. Errors are returned
+     * and not thrown, because this is called while another exception
+     * may be pending.
+     * 
+     * @param events The events
+     * @return The result of waiting for the events
+     */
+    private static int waitAndRelease(List<cl_event> events)
+    {
+        if (events.isEmpty())
+        {
+            return CL_SUCCESS;
+        }
+        cl_event eventArray[] = events.toArray(new cl_event[events.size()]);
+        try
+        {
+            return clWaitForEvents(eventArray.length, eventArray);
+        }
+        catch (CLException e)
+        {
+            return e.getStatus();
+        }
+        finally
+        {
+            for (cl_event event : eventArray)
+            {
+                try
+                {
+                    clReleaseEvent(event);
+                }
+                catch (CLException e)
+                {
+                    // Releasing the other events is still attempted
+                }
+            }
+        }
+    }
+    
+    /**
+     * Copy the given range of the mirror into the snapshot
+     * 
+     * @param offset The offset
+     * @param length The length
+     */
+    private void copyToSnapshot(long offset, long length)
+    {
+        ByteBuffer source = mirror.duplicate();
+        source.limit((int)(offset + length));
+        source.position((int)offset);
+        ByteBuffer target = snapshot.duplicate();
+        target.position((int)offset);
+        target.put(source);
+    }
+    
+    /**
+     * Check whether the given range is contained in the mirror
+     * 
+     * @param offset The offset
+     * @param length The length
+     * @throws IndexOutOfBoundsException If the range is not contained
+     * in the mirror
+     */
+    private void checkRange(long offset, long length)
+    {
+        if (offset < 0 || length < 0 || offset + length > size)
+        {
+            throw new IndexOutOfBoundsException(
+                "The range [" + offset + ", " + (offset + length) + 
+                ") is not contained in a mirror of size " + size);
+        }
+    }
+    
+    /**
+     * Check whether this mirror was released
+     * 
+     * @throws IllegalStateException If the mirror was released
+     */
+    private void checkNotReleased()
+    {
+        if (mirror == null)
+        {
+            throw new IllegalStateException("The mirror was released");
+        }
+    }
+    
+    private static native ByteBuffer allocateNative(int size, int alignment);
+    private static native void freeNative(ByteBuffer buffer);
+    private static native int findChangedRangesNative(ByteBuffer current, 
+        ByteBuffer snapshot, long size, int blockSize, long ranges[]);
+}
@@ -0,0 +1,714 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.lang.reflect.Array;
+import java.nio.Buffer;
+import java.nio.ByteBuffer;
+import java.nio.CharBuffer;
+import java.nio.DoubleBuffer;
+import java.nio.FloatBuffer;
+import java.nio.IntBuffer;
+import java.nio.LongBuffer;
+import java.nio.ShortBuffer;
+
+/**
+ * A class for transferring 2D images between common host memory 
+ * layouts and OpenCL image objects.<br>
+ * <br>
+ * The host data may be given in one of the {@link HostLayout} formats,
+ * with an arbitrary row pitch. The data is repacked natively into a 
+ * pinned staging buffer (created with <code>CL_MEM_ALLOC_HOST_PTR</code>),
+ * converting it into an image format that is supported by the device,
+ * and then copied into the image. For example, packed RGB data is 
+ * converted into RGBA or BGRA, and planar YUV data is converted into 
+ * RGBA or BGRA. The image formats are chosen based on the result of 
+ * {@link CL#clGetSupportedImageFormats}.<br>
+ * <br>
+ * The copy from the staging buffer into the image is enqueued without
+ * waiting for it, so that it can overlap with other work of the caller.
+ * Since the staging buffers are mapped in the same in-order queue, the 
+ * next transfer waits for the previous copy to complete.<br>
+ * <br>
+ * The sizes of the host data that are implied by the width, height and
+ * row pitch are validated against the sizes of the buffers or arrays
+ * that the given pointers refer to. Pointers to native memory can not
+ * be validated.<br>
+ * <br>
+ * The command queue must be an in-order queue. This class is not 
+ * thread-safe.
+ */
+public final class ImageTransfer
+{
+    /**
+     * The host memory layouts of images. All layouts use 8 bits per
+     * channel.
+     */
+    public enum HostLayout
+    {
+        /**
+         * A single channel
+         */
+        GRAY8(1, false),
+        
+        /**
+         * Packed RGB pixels (3 bytes per pixel)
+         */
+        RGB8(3, false),
+        
+        /**
+         * Packed BGR pixels (3 bytes per pixel)
+         */
+        BGR8(3, true),
+        
+        /**
+         * Packed RGBA pixels (4 bytes per pixel)
+         */
+        RGBA8(4, false),
+        
+        /**
+         * Packed BGRA pixels (4 bytes per pixel)
+         */
+        BGRA8(4, true),
+        
+        /**
+         * Planar YUV 4:2:0 (BT.601, limited range): The Y plane is 
+         * followed by the U and the V plane, which have half the width
+         * and half the height of the Y plane, rounded up. Unless a 
+         * chroma row pitch is given explicitly, the rows of the U and 
+         * V plane are tightly packed. This layout can only be uploaded.
+         */
+        I420(0, false);
+        
+        /**
+         * The number of bytes per pixel, or 0 for planar layouts
+         */
+        private final int channels;
+        
+        /**
+         * Whether the layout stores the blue channel first
+         */
+        private final boolean blueFirst;
+        
+        /**
+         * Creates a new layout
+         * 
+         * @param channels The number of bytes per pixel
+         * @param blueFirst Whether the blue channel is stored first
+         */
+        private HostLayout(int channels, boolean blueFirst)
+        {
+            this.channels = channels;
+            this.blueFirst = blueFirst;
+        }
+    }
+    
+    /**
+     * The number of staging buffers
+     */
+    private static final int NUM_STAGING_BUFFERS = 2;
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue queue;
+    
+    /**
+     * The staging buffers
+     */
+    private final cl_mem stagingBuffers[];
+    
+    /**
+     * The sizes of the staging buffers, in bytes
+     */
+    private final long stagingSizes[];
+    
+    /**
+     * The events of the pending copy operations from the staging 
+     * buffers, or <code>null</code>
+     */
+    private final cl_event pendingCopies[];
+    
+    /**
+     * The index of the staging buffer that will be used next
+     */
+    private int nextStagingBuffer;
+    
+    /**
+     * The image formats that have been chosen for the host layouts,
+     * lazily initialized
+     */
+    private final cl_image_format imageFormats[];
+    
+    /**
+     * Creates a new image transfer for the given context and 
+     * (in-order) command queue
+     * 
+     * @param context The context
+     * @param queue The command queue
+     */
+    public ImageTransfer(cl_context context, cl_command_queue queue)
+    {
+        this.context = context;
+        this.queue = queue;
+        this.stagingBuffers = new cl_mem[NUM_STAGING_BUFFERS];
+        this.stagingSizes = new long[NUM_STAGING_BUFFERS];
+        this.pendingCopies = new cl_event[NUM_STAGING_BUFFERS];
+        this.imageFormats = new cl_image_format[HostLayout.values().length];
+    }
+    
+    /**
+     * Returns the image format that will be used for images that are 
+     * transferred from and to the given host layout. This is an 
+     * 8 bit normalized format with the same channel order as the host 
+     * layout, if it is supported, or a supported format with a different
+     * channel order otherwise. 
+     * 
+     * @param layout The host layout
+     * @return The image format
+     * @throws CLException If no suitable image format is supported
+     */
+    public cl_image_format getImageFormat(HostLayout layout)
+    {
+        cl_image_format format = imageFormats[layout.ordinal()];
+        if (format == null)
+        {
+            format = chooseImageFormat(layout);
+            imageFormats[layout.ordinal()] = format;
+        }
+        return format;
+    }
+    
+    /**
+     * Create a 2D image with the given size, with the image format 
+     * that is returned by {@link #getImageFormat(HostLayout)}
+     * 
+     * @param layout The host layout
+     * @param flags The memory flags
+     * @param width The width
+     * @param height The height
+     * @return The image
+     */
+    public cl_mem createImage(HostLayout layout, long flags, 
+        int width, int height)
+    {
+        cl_image_desc imageDesc = new cl_image_desc();
+        imageDesc.image_type = CL_MEM_OBJECT_IMAGE2D;
+        imageDesc.image_width = width;
+        imageDesc.image_height = height;
+        return clCreateImage(context, flags, getImageFormat(layout), 
+            imageDesc, null, null);
+    }
+    
+    /**
+     * Write the given host data into the given image. The data is
+     * repacked into a staging buffer, and the copy from the staging 
+     * buffer into the image is enqueued. The host data may be reused 
+     * when this method returns.
+     * 
+     * @param image The image. Its format must be 8 bit normalized, 
+     * with the number of channels of the 
+     * {@link #getImageFormat(HostLayout) image format} for the layout.
+     * @param layout The host layout
+     * @param src The host data
+     * @param srcRowPitch The row pitch of the host data, in bytes, or 0 
+     * if the rows are tightly packed
+     * @param width The width of the region to write
+     * @param height The height of the region to write
+     * @param event The event for the copy operation. May be 
+     * <code>null</code>.
+     * @throws IllegalArgumentException If the image format is not 
+     * compatible with the layout, the width or height is not positive, 
+     * the row pitch is too small, or the host data is too small
+     */
+    public void writeImage(cl_mem image, HostLayout layout, Pointer src, 
+        long srcRowPitch, int width, int height, cl_event event)
+    {
+        writeImage(image, layout, src, srcRowPitch, 0, 
+            width, height, event);
+    }
+    
+    /**
+     * Write the given host data into the given image. The data is
+     * repacked into a staging buffer, and the copy from the staging 
+     * buffer into the image is enqueued. The host data may be reused 
+     * when this method returns.
+     * 
+     * @param image The image. Its format must be 8 bit normalized, 
+     * with the number of channels of the 
+     * {@link #getImageFormat(HostLayout) image format} for the layout.
+     * @param layout The host layout
+     * @param src The host data
+     * @param srcRowPitch The row pitch of the host data, in bytes, or 0 
+     * if the rows are tightly packed. For {@link HostLayout#I420}, this
+     * is the row pitch of the Y plane.
+     * @param srcChromaRowPitch The row pitch of the U and V plane for 
+     * {@link HostLayout#I420}, in bytes, or 0 if the rows are tightly 
+     * packed. Ignored for other layouts.
+     * @param width The width of the region to write
+     * @param height The height of the region to write
+     * @param event The event for the copy operation. May be 
+     * <code>null</code>.
+     * @throws IllegalArgumentException If the image format is not 
+     * compatible with the layout, the width or height is not positive, 
+     * a row pitch is too small, or the host data is too small
+     */
+    public void writeImage(cl_mem image, HostLayout layout, Pointer src, 
+        long srcRowPitch, long srcChromaRowPitch, int width, int height, 
+        cl_event event)
+    {
+        checkSize(width, height);
+        int format[] = getFormat(image);
+        int deviceChannels = getDeviceChannels(layout, format);
+        boolean swapRB = isSwapRB(layout, format);
+        long dstRowPitch = (long)width * deviceChannels;
+        long size = dstRowPitch * height;
+        if (layout == HostLayout.I420)
+        {
+            int chromaWidth = (width + 1) / 2;
+            int chromaHeight = (height + 1) / 2;
+            if (srcRowPitch == 0)
+            {
+                srcRowPitch = width;
+            }
+            if (srcChromaRowPitch == 0)
+            {
+                srcChromaRowPitch = chromaWidth;
+            }
+            checkRowPitch(srcRowPitch, width);
+            checkRowPitch(srcChromaRowPitch, chromaWidth);
+            long chromaPlaneSize = 
+                requiredSize(srcChromaRowPitch, chromaWidth, chromaHeight);
+            long requiredSize = srcRowPitch * height + 
+                srcChromaRowPitch * chromaHeight + chromaPlaneSize;
+            checkAvailableSize(src, requiredSize, "source");
+        }
+        else
+        {
+            long rowSize = (long)width * layout.channels;
+            if (srcRowPitch == 0)
+            {
+                srcRowPitch = rowSize;
+            }
+            checkRowPitch(srcRowPitch, rowSize);
+            checkAvailableSize(src, 
+                requiredSize(srcRowPitch, rowSize, height), "source");
+        }
+        
+        int index = acquireStagingBuffer(size);
+        cl_mem staging = stagingBuffers[index];
+        ByteBuffer mapped = clEnqueueMapBuffer(queue, staging, true, 
+            CL_MAP_WRITE, 0, size, 0, null, null, null);
+        if (layout == HostLayout.I420)
+        {
+            convertI420Native(src, srcRowPitch, srcChromaRowPitch, 
+                Pointer.to(mapped), dstRowPitch, width, height, swapRB);
+        }
+        else
+        {
+            repackNative(src, srcRowPitch, layout.channels, 
+                Pointer.to(mapped), dstRowPitch, deviceChannels, 
+                width, height, swapRB);
+        }
+        clEnqueueUnmapMemObject(queue, staging, mapped, 0, null, null);
+        
+        cl_event copyEvent = event;
+        if (copyEvent == null)
+        {
+            copyEvent = new cl_event();
+        }
+        clEnqueueCopyBufferToImage(queue, staging, image, 0, 
+            new long[]{ 0, 0, 0 }, new long[]{ width, height, 1 }, 
+            0, null, copyEvent);
+        if (event != null)
+        {
+            // The caller owns the event, so an own reference is 
+            // required for waiting for the copy operation later
+            clRetainEvent(copyEvent);
+        }
+        pendingCopies[index] = copyEvent;
+    }
+    
+    /**
+     * Read the contents of the given image into the given host memory. 
+     * This method blocks until the data has been written into the host 
+     * memory.
+     * 
+     * @param image The image. Its format must be 8 bit normalized, 
+     * with the number of channels of the 
+     * {@link #getImageFormat(HostLayout) image format} for the layout.
+     * @param layout The host layout. This may not be 
+     * {@link HostLayout#I420}.
+     * @param dst The host memory
+     * @param dstRowPitch The row pitch of the host memory, in bytes, or 0 
+     * if the rows should be tightly packed
+     * @param width The width of the region to read
+     * @param height The height of the region to read
+     * @throws IllegalArgumentException If the image format is not 
+     * compatible with the layout, the layout is {@link HostLayout#I420},
+     * the width or height is not positive, the row pitch is too small,
+     * or the host memory is too small
+     */
+    public void readImage(cl_mem image, HostLayout layout, Pointer dst, 
+        long dstRowPitch, int width, int height)
+    {
+        if (layout == HostLayout.I420)
+        {
+            throw new IllegalArgumentException(
+                "Planar layouts can not be read");
+        }
+        checkSize(width, height);
+        int format[] = getFormat(image);
+        int deviceChannels = getDeviceChannels(layout, format);
+        boolean swapRB = isSwapRB(layout, format);
+        long srcRowPitch = (long)width * deviceChannels;
+        long size = srcRowPitch * height;
+        long rowSize = (long)width * layout.channels;
+        if (dstRowPitch == 0)
+        {
+            dstRowPitch = rowSize;
+        }
+        checkRowPitch(dstRowPitch, rowSize);
+        checkAvailableSize(dst, 
+            requiredSize(dstRowPitch, rowSize, height), "destination");
+        
+        int index = acquireStagingBuffer(size);
+        cl_mem staging = stagingBuffers[index];
+        clEnqueueCopyImageToBuffer(queue, image, staging, 
+            new long[]{ 0, 0, 0 }, new long[]{ width, height, 1 }, 
+            0, 0, null, null);
+        ByteBuffer mapped = clEnqueueMapBuffer(queue, staging, true, 
+            CL_MAP_READ, 0, size, 0, null, null, null);
+        repackNative(Pointer.to(mapped), srcRowPitch, deviceChannels, 
+            dst, dstRowPitch, layout.channels, width, height, swapRB);
+        clEnqueueUnmapMemObject(queue, staging, mapped, 0, null, null);
+    }
+    
+    /**
+     * Release all resources of this image transfer. This will wait 
+     * for all pending copy operations.
+     */
+    public void release()
+    {
+        for (int i = 0; i < NUM_STAGING_BUFFERS; i++)
+        {
+            waitForPendingCopy(i);
+            if (stagingBuffers[i] != null)
+            {
+                clReleaseMemObject(stagingBuffers[i]);
+                stagingBuffers[i] = null;
+                stagingSizes[i] = 0;
+            }
+        }
+    }
+    
+    /**
+     * Obtain the next staging buffer, making sure that it has at least
+     * the given size and that its previous copy operation is complete, 
+     * and return its index
+     * 
+     * @param size The minimum size
+     * @return The index of the staging buffer
+     */
+    private int acquireStagingBuffer(long size)
+    {
+        int index = nextStagingBuffer;
+        nextStagingBuffer = (nextStagingBuffer + 1) % NUM_STAGING_BUFFERS;
+        waitForPendingCopy(index);
+        if (stagingSizes[index] < size)
+        {
+            if (stagingBuffers[index] != null)
+            {
+                clReleaseMemObject(stagingBuffers[index]);
+            }
+            stagingBuffers[index] = clCreateBuffer(context, 
+                CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, null, null);
+            stagingSizes[index] = size;
+        }
+        return index;
+    }
+    
+    /**
+     * Wait for the pending copy operation from the staging buffer with 
+     * the given index, if there is one, and release its event
+     * 
+     * @param index The index
+     */
+    private void waitForPendingCopy(int index)
+    {
+        cl_event event = pendingCopies[index];
+        if (event != null)
+        {
+            pendingCopies[index] = null;
+            clWaitForEvents(1, new cl_event[]{ event });
+            clReleaseEvent(event);
+        }
+    }
+    
+    /**
+     * Choose the image format for the given layout, from the formats
+     * that are supported by the context
+     * 
+     * @param layout The layout
+     * @return The image format
+     */
+    private cl_image_format chooseImageFormat(HostLayout layout)
+    {
+        int candidates[];
+        if (layout == HostLayout.GRAY8)
+        {
+            candidates = new int[]{ CL_R, CL_LUMINANCE };
+        }
+        else if (layout.blueFirst)
+        {
+            candidates = new int[]{ CL_BGRA, CL_RGBA };
+        }
+        else
+        {
+            candidates = new int[]{ CL_RGBA, CL_BGRA };
+        }
+        
+        int numFormats[] = new int[1];
+        clGetSupportedImageFormats(context, CL_MEM_READ_WRITE, 
+            CL_MEM_OBJECT_IMAGE2D, 0, null, numFormats);
+        cl_image_format formats[] = new cl_image_format[numFormats[0]];
+        for (int i = 0; i < formats.length; i++)
+        {
+            formats[i] = new cl_image_format();
+        }
+        clGetSupportedImageFormats(context, CL_MEM_READ_WRITE, 
+            CL_MEM_OBJECT_IMAGE2D, formats.length, formats, null);
+        for (int channelOrder : candidates)
+        {
+            for (cl_image_format format : formats)
+            {
+                if (format.image_channel_order == channelOrder && 
+                    format.image_channel_data_type == CL_UNORM_INT8)
+                {
+                    cl_image_format result = new cl_image_format();
+                    result.image_channel_order = channelOrder;
+                    result.image_channel_data_type = CL_UNORM_INT8;
+                    return result;
+                }
+            }
+        }
+        throw new CLException(
+            "No supported image format for " + layout, 
+            CL_IMAGE_FORMAT_NOT_SUPPORTED);
+    }
+    
+    /**
+     * Returns the channel order and channel data type of the given image
+     * 
+     * @param image The image
+     * @return The channel order and channel data type
+     */
+    private static int[] getFormat(cl_mem image)
+    {
+        int format[] = new int[2];
+        clGetImageInfo(image, CL_IMAGE_FORMAT, 
+            2 * Sizeof.cl_uint, Pointer.to(format), null);
+        return format;
+    }
+
+    /**
+     * Returns the number of channels of an image with the given format, 
+     * after checking that the format is compatible with the given layout
+     * 
+     * @param layout The layout
+     * @param format The channel order and channel data type
+     * @return The number of channels
+     * @throws IllegalArgumentException If the format is not compatible
+     */
+    private static int getDeviceChannels(HostLayout layout, int format[])
+    {
+        int channelOrder = format[0];
+        int channelDataType = format[1];
+        if (channelDataType == CL_UNORM_INT8 || 
+            channelDataType == CL_UNSIGNED_INT8)
+        {
+            if (layout == HostLayout.GRAY8 && 
+                (channelOrder == CL_R || channelOrder == CL_LUMINANCE || 
+                 channelOrder == CL_INTENSITY))
+            {
+                return 1;
+            }
+            if (layout != HostLayout.GRAY8 && 
+                (channelOrder == CL_RGBA || channelOrder == CL_BGRA))
+            {
+                return 4;
+            }
+        }
+        throw new IllegalArgumentException(
+            "The image format " + stringFor_cl_channel_order(channelOrder) + 
+            "/" + stringFor_cl_channel_type(channelDataType) + 
+            " is not compatible with " + layout);
+    }
+    
+    /**
+     * Returns whether the red and blue channels have to be swapped when
+     * transferring between the given layout and the given format
+     * 
+     * @param layout The layout
+     * @param format The channel order and channel data type
+     * @return Whether the channels have to be swapped
+     */
+    private static boolean isSwapRB(HostLayout layout, int format[])
+    {
+        if (layout == HostLayout.GRAY8)
+        {
+            return false;
+        }
+        boolean deviceBlueFirst = format[0] == CL_BGRA;
+        return layout.blueFirst != deviceBlueFirst;
+    }
+
+    /**
+     * Check whether the given width and height are positive
+     * 
+     * @param width The width
+     * @param height The height
+     * @throws IllegalArgumentException If the width or height is not
+     * positive
+     */
+    private static void checkSize(int width, int height)
+    {
+        if (width <= 0 || height <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The width and height must be positive, but are " + 
+                width + " and " + height);
+        }
+    }
+    
+    /**
+     * Check whether the given row pitch is at least the given row size
+     * 
+     * @param rowPitch The row pitch
+     * @param rowSize The row size
+     * @throws IllegalArgumentException If the row pitch is too small
+     */
+    private static void checkRowPitch(long rowPitch, long rowSize)
+    {
+        if (rowPitch < rowSize)
+        {
+            throw new IllegalArgumentException(
+                "The row pitch must be at least " + rowSize + 
+                ", but is " + rowPitch);
+        }
+    }
+    
+    /**
+     * Returns the number of bytes that are covered by the given number
+     * of rows with the given row pitch and row size
+     * 
+     * @param rowPitch The row pitch
+     * @param rowSize The row size
+     * @param rows The number of rows
+     * @return The size, in bytes
+     */
+    private static long requiredSize(long rowPitch, long rowSize, int rows)
+    {
+        return (rows - 1) * rowPitch + rowSize;
+    }
+    
+    /**
+     * Check whether the buffer or array that the given pointer refers
+     * to contains at least the given number of bytes, starting at the
+     * byte offset of the pointer. Pointers to native memory are not
+     * checked.
+     * 
+     * @param pointer The pointer
+     * @param requiredSize The required size, in bytes
+     * @param name The name of the pointer, for the error message
+     * @throws IllegalArgumentException If the pointer is 
+     * <code>null</code>, or refers to a buffer or array that is too 
+     * small
+     */
+    private static void checkAvailableSize(
+        Pointer pointer, long requiredSize, String name)
+    {
+        if (pointer == null)
+        {
+            throw new IllegalArgumentException(
+                "The " + name + " may not be null");
+        }
+        Buffer buffer = pointer.getBuffer();
+        if (buffer == null)
+        {
+            return;
+        }
+        long elements = buffer.isDirect() || !buffer.hasArray() ? 
+            buffer.capacity() : Array.getLength(buffer.array());
+        long available = 
+            elements * elementSize(buffer) - pointer.getByteOffset();
+        if (available < requiredSize)
+        {
+            throw new IllegalArgumentException(
+                "The " + name + " requires " + requiredSize + 
+                " bytes, but only " + available + " are available");
+        }
+    }
+    
+    /**
+     * Returns the size of one element of the given buffer, in bytes
+     * 
+     * @param buffer The buffer
+     * @return The element size
+     */
+    private static int elementSize(Buffer buffer)
+    {
+        if (buffer instanceof ShortBuffer || buffer instanceof CharBuffer)
+        {
+            return Sizeof.cl_short;
+        }
+        if (buffer instanceof IntBuffer || buffer instanceof FloatBuffer)
+        {
+            return Sizeof.cl_int;
+        }
+        if (buffer instanceof LongBuffer || buffer instanceof DoubleBuffer)
+        {
+            return Sizeof.cl_long;
+        }
+        return Sizeof.cl_char;
+    }
+    
+    private static native void repackNative(Pointer src, long srcRowPitch, 
+        int srcChannels, Pointer dst, long dstRowPitch, int dstChannels, 
+        int width, int height, boolean swapRB);
+    private static native void convertI420Native(Pointer src, 
+        long srcRowPitch, long chromaRowPitch, Pointer dst, 
+        long dstRowPitch, int width, int height, boolean swapRB);
+}
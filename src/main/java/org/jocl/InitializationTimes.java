@@ -0,0 +1,162 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+/**
+ * Timing information about the initialization of JOCL. <br>
+ * <br>
+ * The times are recorded while the native library is loaded and
+ * initialized, which happens when the {@link CL} class is used for
+ * the first time. They are intended for diagnostics and for
+ * benchmarking the startup time. All times are given in nanoseconds.
+ * If the respective step was not executed, the time will be 0.
+ */
+public final class InitializationTimes
+{
+    /**
+     * The time for loading the JOCL native library, including the
+     * extraction of the library and the execution of JNI_OnLoad
+     */
+    static long loadLibraryNanos = 0;
+    
+    /**
+     * The time for initializing the OpenCL implementation library,
+     * including all attempts for the library name candidates
+     */
+    static long initNativeLibraryNanos = 0;
+    
+    /**
+     * Returns the time that was spent for extracting the native 
+     * libraries from the JAR into temporary files. This will be 0 
+     * if the library could be loaded from the library path.
+     * 
+     * @return The time
+     */
+    public static long getLibraryExtractionNanos()
+    {
+        CL.loadNativeLibrary();
+        return LibUtils.getExtractionNanos();
+    }
+    
+    /**
+     * Returns the time that was spent for loading the JOCL native 
+     * library, excluding the time for the 
+     * {@link #getLibraryExtractionNanos() extraction}, but including 
+     * the time for {@link #getOnLoadNanos() JNI_OnLoad}.
+     * 
+     * @return The time
+     */
+    public static long getLibraryLoadNanos()
+    {
+        CL.loadNativeLibrary();
+        return loadLibraryNanos - getLibraryExtractionNanos();
+    }
+    
+    /**
+     * Returns the time that was spent in the JNI_OnLoad function
+     * of the JOCL native library, including the time for
+     * {@link #getRegisterNativesNanos() registering the natives}
+     * 
+     * @return The time
+     */
+    public static long getOnLoadNanos()
+    {
+        return getNativeTime(0);
+    }
+    
+    /**
+     * Returns the time that was spent for registering the native
+     * methods of the {@link CL} class
+     * 
+     * @return The time
+     */
+    public static long getRegisterNativesNanos()
+    {
+        return getNativeTime(1);
+    }
+    
+    /**
+     * Returns the time that was spent for loading the OpenCL 
+     * implementation library
+     * 
+     * @return The time
+     */
+    public static long getImplementationLibraryLoadNanos()
+    {
+        return getNativeTime(2);
+    }
+    
+    /**
+     * Returns the time that was spent for obtaining the pointers
+     * to the OpenCL functions from the implementation library
+     * 
+     * @return The time
+     */
+    public static long getFunctionPointerInitNanos()
+    {
+        return getNativeTime(3);
+    }
+    
+    /**
+     * Returns the total time that was spent for the initialization of 
+     * the OpenCL implementation library, including the time for 
+     * {@link #getImplementationLibraryLoadNanos() loading the library}
+     * and {@link #getFunctionPointerInitNanos() obtaining the function 
+     * pointers}
+     * 
+     * @return The time
+     */
+    public static long getImplementationInitNanos()
+    {
+        CL.loadNativeLibrary();
+        return initNativeLibraryNanos;
+    }
+    
+    /**
+     * Returns the time with the given index from the native library.
+     * See {@link CL#getInitializationTimesNative(long[])}
+     * 
+     * @param index The index
+     * @return The time
+     */
+    private static long getNativeTime(int index)
+    {
+        CL.loadNativeLibrary();
+        long times[] = new long[4];
+        CL.getInitializationTimesNative(times);
+        return times[index];
+    }
+    
+    /**
+     * Private constructor to prevent instantiation
+     */
+    private InitializationTimes()
+    {
+        // Private constructor to prevent instantiation
+    }
+}
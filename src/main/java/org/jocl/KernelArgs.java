@@ -0,0 +1,169 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+/**
+ * Controls the optional shadowing of kernel arguments.<br>
+ * <br>
+ * When the shadowing is enabled, then a native copy of the bytes of 
+ * each argument that is set with {@link CL#clSetKernelArg} is kept 
+ * for each kernel. When an argument is set to the same value that it
+ * already has, then the call returns <code>CL_SUCCESS</code> without
+ * calling the implementation. This avoids the cost of marshalling the
+ * value and of re-validating the argument in the driver, for the common
+ * case that most arguments do not change between kernel launches.<br>
+ * <br>
+ * The shadow of a kernel is removed when the kernel is released with
+ * {@link CL#clReleaseKernel}, and the shadow of an argument is removed
+ * when it is set with {@link CL#clSetKernelArgSVMPointer}. Only values 
+ * with a size of at most 1024 bytes are shadowed.<br>
+ * <br>
+ * Note that the shadowing compares the bytes of the values. For memory
+ * objects and samplers, these are the handles of the objects. Since 
+ * the implementation may reuse the handle of a released object for a 
+ * new object, the shadows of all arguments that have the handle as 
+ * their value are removed when the object is released with 
+ * {@link CL#clReleaseMemObject} or {@link CL#clReleaseSampler}.<br>
+ * <br>
+ * The shadowing is disabled by default.
+ */
+public final class KernelArgs
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * Enable or disable the shadowing of kernel arguments. When it is
+     * disabled, all shadows are removed.
+     * 
+     * @param enabled Whether the shadowing is enabled
+     */
+    public static void setShadowingEnabled(boolean enabled)
+    {
+        setShadowingEnabledNative(enabled);
+    }
+    
+    /**
+     * Returns whether the shadowing of kernel arguments is enabled
+     * 
+     * @return Whether the shadowing is enabled
+     */
+    public static boolean isShadowingEnabled()
+    {
+        return isShadowingEnabledNative();
+    }
+    
+    /**
+     * Returns the number of calls to {@link CL#clSetKernelArg} that 
+     * have been skipped because the value did not change
+     * 
+     * @return The number of skipped calls
+     */
+    public static long getSkippedCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of calls to {@link CL#clSetKernelArg} that 
+     * have been passed to the implementation while the shadowing was
+     * enabled
+     * 
+     * @return The number of forwarded calls
+     */
+    public static long getForwardedCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of kernels for which arguments are shadowed
+     * 
+     * @return The number of kernels
+     */
+    public static long getShadowedKernelCount()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Reset the counters of skipped and forwarded calls
+     */
+    public static void resetStatistics()
+    {
+        resetStatisticsNative();
+    }
+    
+    /**
+     * Remove the shadows of all arguments of the given kernel, so that
+     * the next call to {@link CL#clSetKernelArg} for each argument is
+     * passed to the implementation
+     * 
+     * @param kernel The kernel
+     */
+    public static void invalidate(cl_kernel kernel)
+    {
+        invalidateNative(kernel);
+    }
+    
+    /**
+     * Remove the shadows of all kernels
+     */
+    public static void clear()
+    {
+        clearNative();
+    }
+    
+    /**
+     * Returns the statistics of the shadowing
+     * 
+     * @return The statistics
+     */
+    private static long[] getStatistics()
+    {
+        long statistics[] = new long[3];
+        getStatisticsNative(statistics);
+        return statistics;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private KernelArgs()
+    {
+        // Private constructor to prevent instantiation.
+    }
+    
+    private static native void setShadowingEnabledNative(boolean enabled);
+    private static native boolean isShadowingEnabledNative();
+    private static native void getStatisticsNative(long statistics[]);
+    private static native void resetStatisticsNative();
+    private static native void invalidateNative(cl_kernel kernel);
+    private static native void clearNative();
+}
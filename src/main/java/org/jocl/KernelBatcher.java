@@ -0,0 +1,626 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * A class that merges many small invocations of the same elementwise
+ * kernel into a single launch.<br>
+ * <br>
+ * Requests are submitted with {@link #submit(ByteBuffer, ByteBuffer)}.
+ * A dispatcher thread collects the requests until either the total 
+ * number of elements reaches the maximum batch size, or the maximum
+ * delay after the first request of the batch has passed. The inputs 
+ * of all requests of a batch are then packed contiguously into one 
+ * buffer, the kernel is executed once over the combined range, and 
+ * the results are scattered back to the output buffers of the 
+ * individual requests.<br>
+ * <br>
+ * The kernel must compute each output element only from the input 
+ * element with the same index, and must have the following arguments:
+ * <pre><code>
+ * __kernel void example(
+ *     __global const InputType *input, 
+ *     __global OutputType *output, 
+ *     int n)
+ * </code></pre>
+ * where <code>n</code> is the number of elements of the batch. The
+ * global work size may be larger than <code>n</code> when the kernel
+ * is launched with a local work size. Further arguments may be set 
+ * by the caller before the first request is submitted. The kernel 
+ * must not be used otherwise while the batcher is active.<br>
+ * <br>
+ * A failing OpenCL call lets all requests of the affected batch fail 
+ * with a {@link CLException}, regardless of whether exceptions are
+ * enabled with {@link CL#setExceptionsEnabled(boolean)}.
+ */
+public final class KernelBatcher
+{
+    /**
+     * A request of the batcher. The result is the output buffer that 
+     * was given when the request was submitted.
+     */
+    private static final class Request implements Future<ByteBuffer>
+    {
+        /**
+         * The input data
+         */
+        private final ByteBuffer input;
+        
+        /**
+         * The output buffer
+         */
+        private final ByteBuffer output;
+        
+        /**
+         * The number of elements
+         */
+        private final int elements;
+        
+        /**
+         * The latch that is released when the request is done
+         */
+        private final CountDownLatch done = new CountDownLatch(1);
+        
+        /**
+         * The error that caused the request to fail, if any
+         */
+        private volatile Throwable error;
+        
+        /**
+         * Creates a new request
+         * 
+         * @param input The input data
+         * @param output The output buffer
+         * @param elements The number of elements
+         */
+        Request(ByteBuffer input, ByteBuffer output, int elements)
+        {
+            this.input = input;
+            this.output = output;
+            this.elements = elements;
+        }
+        
+        /**
+         * Mark this request as done
+         * 
+         * @param error The error, or null if the request succeeded
+         */
+        void complete(Throwable error)
+        {
+            this.error = error;
+            done.countDown();
+        }
+        
+        @Override
+        public boolean cancel(boolean mayInterruptIfRunning)
+        {
+            return false;
+        }
+
+        @Override
+        public boolean isCancelled()
+        {
+            return false;
+        }
+
+        @Override
+        public boolean isDone()
+        {
+            return done.getCount() == 0;
+        }
+
+        @Override
+        public ByteBuffer get() 
+            throws InterruptedException, ExecutionException
+        {
+            done.await();
+            return result();
+        }
+
+        @Override
+        public ByteBuffer get(long timeout, TimeUnit unit)
+            throws InterruptedException, ExecutionException, TimeoutException
+        {
+            if (!done.await(timeout, unit))
+            {
+                throw new TimeoutException();
+            }
+            return result();
+        }
+        
+        /**
+         * Returns the result of this request
+         * 
+         * @return The output buffer
+         * @throws ExecutionException If the request failed
+         */
+        private ByteBuffer result() throws ExecutionException
+        {
+            if (error != null)
+            {
+                throw new ExecutionException(error);
+            }
+            return output;
+        }
+    }
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue commandQueue;
+    
+    /**
+     * The kernel
+     */
+    private final cl_kernel kernel;
+    
+    /**
+     * The size of one input element, in bytes
+     */
+    private final int inputElementSize;
+    
+    /**
+     * The size of one output element, in bytes
+     */
+    private final int outputElementSize;
+    
+    /**
+     * The maximum number of elements in one batch
+     */
+    private final int maxBatchElements;
+    
+    /**
+     * The maximum time that a request waits for further requests, 
+     * in nanoseconds
+     */
+    private final long maxDelayNs;
+    
+    /**
+     * The local work size, or 0 if no local work size is used
+     */
+    private final int localWorkSize;
+    
+    /**
+     * The requests that have not been dispatched yet
+     */
+    private final BlockingQueue<Request> pendingRequests = 
+        new LinkedBlockingQueue<Request>();
+    
+    /**
+     * The dispatcher thread
+     */
+    private final Thread dispatcher;
+    
+    /**
+     * Whether this batcher was shut down
+     */
+    private volatile boolean shutdown;
+    
+    /**
+     * Whether the dispatcher thread has stopped taking requests
+     */
+    private volatile boolean terminated;
+    
+    /**
+     * The device buffers for the input and output, and the number 
+     * of elements that they can hold
+     */
+    private cl_mem inputMem;
+    private cl_mem outputMem;
+    private int capacity;
+    
+    /**
+     * The host buffers in which the inputs are packed and from which 
+     * the outputs are scattered
+     */
+    private ByteBuffer inputStaging;
+    private ByteBuffer outputStaging;
+    
+    /**
+     * The statistics
+     */
+    private final AtomicLong requestCount = new AtomicLong();
+    private final AtomicLong batchCount = new AtomicLong();
+    private final AtomicLong elementCount = new AtomicLong();
+    
+    /**
+     * Creates a new kernel batcher
+     * 
+     * @param context The context
+     * @param commandQueue The command queue
+     * @param kernel The kernel. See the class documentation for the 
+     * required arguments.
+     * @param inputElementSize The size of one input element, in bytes
+     * @param outputElementSize The size of one output element, in bytes
+     * @param maxBatchElements The maximum number of elements in one
+     * batch. Requests that are larger are executed individually.
+     * @param maxDelay The maximum time that a request waits for 
+     * further requests
+     * @param unit The unit of the maximum delay
+     * @param localWorkSize The local work size for the launches, or 0
+     * if the implementation should choose it. When it is positive, 
+     * the global work size is rounded up to a multiple of it.
+     * @throws IllegalArgumentException If any size is not positive,
+     * or the delay or local work size are negative
+     */
+    public KernelBatcher(cl_context context, cl_command_queue commandQueue,
+        cl_kernel kernel, int inputElementSize, int outputElementSize,
+        int maxBatchElements, long maxDelay, TimeUnit unit, 
+        int localWorkSize)
+    {
+        if (inputElementSize <= 0 || outputElementSize <= 0 || 
+            maxBatchElements <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The element sizes and batch size must be positive");
+        }
+        if (maxDelay < 0 || localWorkSize < 0)
+        {
+            throw new IllegalArgumentException(
+                "The delay and local work size may not be negative");
+        }
+        this.context = context;
+        this.commandQueue = commandQueue;
+        this.kernel = kernel;
+        this.inputElementSize = inputElementSize;
+        this.outputElementSize = outputElementSize;
+        this.maxBatchElements = maxBatchElements;
+        this.maxDelayNs = unit.toNanos(maxDelay);
+        this.localWorkSize = localWorkSize;
+        this.dispatcher = new Thread(new Runnable()
+        {
+            @Override
+            public void run()
+            {
+                dispatch();
+            }
+        }, "KernelBatcherThread");
+        this.dispatcher.setDaemon(true);
+        this.dispatcher.start();
+    }
+    
+    /**
+     * Submit a request. The number of elements is determined by the 
+     * remaining bytes of the input buffer. The results will be written
+     * into the output buffer, starting at its current position. The
+     * positions and limits of the given buffers are not modified. 
+     * Neither buffer may be modified until the request is done.
+     * 
+     * @param input The input data
+     * @param output The output buffer
+     * @return The future for the output buffer
+     * @throws IllegalArgumentException If the input size is not a 
+     * multiple of the input element size, or the output buffer has
+     * too few remaining bytes
+     * @throws IllegalStateException If this batcher was shut down
+     */
+    public Future<ByteBuffer> submit(ByteBuffer input, ByteBuffer output)
+    {
+        if (shutdown)
+        {
+            throw new IllegalStateException("The batcher was shut down");
+        }
+        if (input.remaining() % inputElementSize != 0)
+        {
+            throw new IllegalArgumentException(
+                "The input size " + input.remaining() + " is not a " + 
+                "multiple of the element size " + inputElementSize);
+        }
+        int elements = input.remaining() / inputElementSize;
+        if (output.remaining() < (long)elements * outputElementSize)
+        {
+            throw new IllegalArgumentException(
+                "The output buffer has " + output.remaining() + 
+                " bytes remaining, but " + elements * outputElementSize + 
+                " bytes are required");
+        }
+        Request request = new Request(
+            input.duplicate(), output.duplicate(), elements);
+        requestCount.incrementAndGet();
+        if (elements == 0)
+        {
+            request.complete(null);
+            return request;
+        }
+        pendingRequests.add(request);
+        
+        // If the dispatcher stopped in the meantime, it may not have
+        // seen the request. Whoever removes it lets it fail.
+        if (terminated && pendingRequests.remove(request))
+        {
+            request.complete(
+                new IllegalStateException("The batcher was shut down"));
+        }
+        return request;
+    }
+    
+    /**
+     * Returns the number of requests that have been submitted
+     * 
+     * @return The number of requests
+     */
+    public long getRequestCount()
+    {
+        return requestCount.get();
+    }
+    
+    /**
+     * Returns the number of kernel launches that have been performed
+     * 
+     * @return The number of batches
+     */
+    public long getBatchCount()
+    {
+        return batchCount.get();
+    }
+    
+    /**
+     * Returns the total number of elements that have been processed
+     * 
+     * @return The number of elements
+     */
+    public long getElementCount()
+    {
+        return elementCount.get();
+    }
+    
+    /**
+     * Shut down this batcher. All requests that have been submitted
+     * until now are processed, and the device buffers are released.
+     * The kernel, queue and context are not released. Requests that 
+     * are submitted concurrently with this call are either processed,
+     * or fail with an IllegalStateException.
+     * 
+     * @throws InterruptedException If the thread is interrupted while
+     * waiting for the pending requests
+     */
+    public void shutdown() throws InterruptedException
+    {
+        shutdown = true;
+        dispatcher.join();
+    }
+    
+    /**
+     * The method that is executed by the dispatcher thread
+     */
+    private void dispatch()
+    {
+        List<Request> batch = new ArrayList<Request>();
+        Request carry = null;
+        try
+        {
+            while (true)
+            {
+                Request first = carry;
+                carry = null;
+                if (first == null)
+                {
+                    first = pendingRequests.poll(10, TimeUnit.MILLISECONDS);
+                }
+                if (first == null)
+                {
+                    if (shutdown && pendingRequests.isEmpty())
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                batch.add(first);
+                long elements = first.elements;
+                long deadline = System.nanoTime() + maxDelayNs;
+                while (elements < maxBatchElements)
+                {
+                    long remaining = deadline - System.nanoTime();
+                    Request next = remaining > 0 ? 
+                        pendingRequests.poll(remaining, TimeUnit.NANOSECONDS) :
+                        pendingRequests.poll();
+                    if (next == null)
+                    {
+                        break;
+                    }
+                    if (elements + next.elements > maxBatchElements)
+                    {
+                        carry = next;
+                        break;
+                    }
+                    batch.add(next);
+                    elements += next.elements;
+                }
+                execute(batch, (int)elements);
+                batch.clear();
+            }
+        }
+        catch (InterruptedException e)
+        {
+            Thread.currentThread().interrupt();
+            fail(batch, carry, e);
+        }
+        finally
+        {
+            terminated = true;
+            fail(new ArrayList<Request>(), null, 
+                new IllegalStateException("The batcher was shut down"));
+            releaseBuffers();
+        }
+    }
+    
+    /**
+     * Execute the kernel for the given batch of requests
+     * 
+     * @param batch The requests
+     * @param elements The total number of elements
+     */
+    private void execute(List<Request> batch, int elements)
+    {
+        try
+        {
+            ensureCapacity(elements);
+            
+            inputStaging.clear();
+            for (Request request : batch)
+            {
+                inputStaging.put(request.input.duplicate());
+            }
+            requireSuccess(clEnqueueWriteBuffer(commandQueue, inputMem, 
+                CL_TRUE, 0, (long)elements * inputElementSize, 
+                Pointer.to(inputStaging), 0, null, null));
+            
+            long globalWorkSize = elements;
+            long localWorkSizes[] = null;
+            if (localWorkSize > 0)
+            {
+                globalWorkSize = 
+                    (elements + localWorkSize - 1) / localWorkSize * localWorkSize;
+                localWorkSizes = new long[]{ localWorkSize };
+            }
+            requireSuccess(clSetKernelArg(kernel, 0, Sizeof.cl_mem, 
+                Pointer.to(inputMem)));
+            requireSuccess(clSetKernelArg(kernel, 1, Sizeof.cl_mem, 
+                Pointer.to(outputMem)));
+            requireSuccess(clSetKernelArg(kernel, 2, Sizeof.cl_int, 
+                Pointer.to(new int[]{ elements })));
+            requireSuccess(clEnqueueNDRangeKernel(commandQueue, kernel, 1, 
+                null, new long[]{ globalWorkSize }, localWorkSizes, 
+                0, null, null));
+            
+            requireSuccess(clEnqueueReadBuffer(commandQueue, outputMem, 
+                CL_TRUE, 0, (long)elements * outputElementSize, 
+                Pointer.to(outputStaging), 0, null, null));
+            
+            int position = 0;
+            for (Request request : batch)
+            {
+                int size = request.elements * outputElementSize;
+                ByteBuffer slice = outputStaging.duplicate();
+                slice.limit(position + size);
+                slice.position(position);
+                request.output.duplicate().put(slice);
+                position += size;
+            }
+            batchCount.incrementAndGet();
+            elementCount.addAndGet(elements);
+            for (Request request : batch)
+            {
+                request.complete(null);
+            }
+        }
+        catch (RuntimeException e)
+        {
+            for (Request request : batch)
+            {
+                request.complete(e);
+            }
+        }
+    }
+    
+    /**
+     * Make sure that the buffers can hold the given number of elements
+     * 
+     * @param elements The number of elements
+     */
+    private void ensureCapacity(int elements)
+    {
+        if (elements <= capacity)
+        {
+            return;
+        }
+        releaseBuffers();
+        int newCapacity = Math.max(elements, maxBatchElements);
+        int errorCode[] = new int[1];
+        inputMem = clCreateBuffer(context, CL_MEM_READ_ONLY, 
+            (long)newCapacity * inputElementSize, null, errorCode);
+        requireSuccess(errorCode[0]);
+        outputMem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, 
+            (long)newCapacity * outputElementSize, null, errorCode);
+        requireSuccess(errorCode[0]);
+        inputStaging = ByteBuffer.allocateDirect(
+            newCapacity * inputElementSize).order(ByteOrder.nativeOrder());
+        outputStaging = ByteBuffer.allocateDirect(
+            newCapacity * outputElementSize).order(ByteOrder.nativeOrder());
+        capacity = newCapacity;
+    }
+    
+    /**
+     * Release the device buffers
+     */
+    private void releaseBuffers()
+    {
+        if (inputMem != null)
+        {
+            clReleaseMemObject(inputMem);
+            inputMem = null;
+        }
+        if (outputMem != null)
+        {
+            clReleaseMemObject(outputMem);
+            outputMem = null;
+        }
+        capacity = 0;
+    }
+    
+    /**
+     * Let the given requests and all pending requests fail with the 
+     * given error
+     * 
+     * @param batch The requests of the current batch
+     * @param carry The request that was carried to the next batch
+     * @param error The error
+     */
+    private void fail(List<Request> batch, Request carry, Throwable error)
+    {
+        List<Request> requests = new ArrayList<Request>(batch);
+        if (carry != null)
+        {
+            requests.add(carry);
+        }
+        pendingRequests.drainTo(requests);
+        for (Request request : requests)
+        {
+            request.complete(error);
+        }
+    }
+}
@@ -70,6 +70,12 @@ public final class LibUtils
      */
     private static final String LIBRARY_PATH_IN_JAR = "/lib";
     
+    /**
+     * The total time, in nanoseconds, that was spent for writing 
+     * library resources into temporary files
+     */
+    private static long extractionNanos = 0;
+    
     /**
      * Enumeration of common operating systems, independent of version 
      * or architecture. 
@@ -266,7 +272,9 @@ public final class LibUtils
                 "Writing resource  " + libraryResourceName);
             logger.log(level, 
                 "to temporary file " + libraryTempFile);
+            long before = System.nanoTime();
             writeResourceToFile(libraryResourceName, libraryTempFile);
+            extractionNanos += System.nanoTime() - before;
             if (trackCreatedTempFiles())
             {
                 LibTracker.track(libraryTempFile);
@@ -280,6 +288,18 @@ public final class LibUtils
     }
     
 
+    /**
+     * Returns the total time, in nanoseconds, that was spent for 
+     * extracting library resources into temporary files. This will
+     * be 0 if all libraries could be loaded as files.
+     * 
+     * @return The extraction time
+     */
+    static long getExtractionNanos()
+    {
+        return extractionNanos;
+    }
+
     /**
      * Create a file object representing the file with the given name
      * in the specified subdirectory of the default "temp" directory. 
@@ -0,0 +1,236 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+/**
+ * Utility methods for obtaining local work sizes for kernel launches, 
+ * without autotuning.<br>
+ * <br>
+ * When the platform of a command queue supports the 
+ * <code>cl_khr_suggested_local_work_size</code> extension, then the 
+ * local work size is obtained with 
+ * {@link CL#clGetKernelSuggestedLocalWorkSizeKHR}. Otherwise, it is 
+ * computed from the <code>CL_KERNEL_WORK_GROUP_SIZE</code> and 
+ * the <code>CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE</code> of
+ * the kernel: The size in the first dimension will be the largest 
+ * multiple of the preferred multiple that divides the global work 
+ * size, and the remaining work group size is distributed to the other
+ * dimensions. When the kernel was compiled with a 
+ * <code>reqd_work_group_size</code> attribute, this size is used.<br>
+ * <br>
+ * Note that the local work size must divide the global work size. 
+ * When the global work size is, for example, a prime number, then 
+ * the only possible local work size is 1, which usually causes a poor
+ * performance. In this case, the global work size should be padded to
+ * a multiple of the preferred work group size multiple, and the kernel
+ * should ignore the work-items that are beyond the actual problem 
+ * size.<br>
+ * <br>
+ * The results are cached natively, for each combination of kernel, 
+ * device and global work size. The entries for a kernel are removed 
+ * when {@link CL#clReleaseKernel} is called for the kernel.
+ */
+public final class LocalWorkSizes
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * Returns whether the platform of the device of the given command 
+     * queue supports the <code>cl_khr_suggested_local_work_size</code>
+     * extension.
+     * 
+     * @param command_queue The command queue
+     * @return Whether the suggested local work sizes are supported
+     */
+    public static boolean isSuggestionSupported(
+        cl_command_queue command_queue)
+    {
+        return isSuggestionSupportedNative(command_queue);
+    }
+    
+    /**
+     * Obtain the local work size for the given kernel and global work 
+     * size on the device of the given command queue. 
+     * 
+     * @param command_queue The command queue
+     * @param kernel The kernel, whose arguments have been set
+     * @param work_dim The number of dimensions, between 1 and 3
+     * @param global_work_offset The global work offset. May be 
+     * <code>null</code>.
+     * @param global_work_size The global work size
+     * @return The local work size, with <code>work_dim</code> elements,
+     * or <code>null</code> if it can not be obtained and exceptions 
+     * are disabled
+     * @throws CLException If exceptions are enabled and the local work
+     * size can not be obtained
+     */
+    public static long[] getLocalWorkSize(cl_command_queue command_queue, 
+        cl_kernel kernel, int work_dim, long global_work_offset[], 
+        long global_work_size[])
+    {
+        long local_work_size[] = new long[work_dim];
+        int result = getLocalWorkSizeNative(command_queue, kernel, 
+            work_dim, global_work_offset, global_work_size, 
+            local_work_size);
+        if (CL.checkResult(result) != CL.CL_SUCCESS)
+        {
+            return null;
+        }
+        return local_work_size;
+    }
+    
+    /**
+     * Enqueue the given kernel like 
+     * {@link CL#clEnqueueNDRangeKernel}, with a local work size that 
+     * is obtained as described in {@link #getLocalWorkSize}. The 
+     * lookup of the local work size and the enqueueing are done with
+     * a single native call.
+     * 
+     * @param command_queue The command queue
+     * @param kernel The kernel
+     * @param work_dim The number of dimensions, between 1 and 3
+     * @param global_work_offset The global work offset. May be 
+     * <code>null</code>.
+     * @param global_work_size The global work size
+     * @param num_events_in_wait_list The number of events in the wait
+     * list
+     * @param event_wait_list The events to wait for. May be 
+     * <code>null</code>.
+     * @param event The event for the kernel execution. May be 
+     * <code>null</code>.
+     * @return CL_SUCCESS if the function is executed successfully, or
+     * the error code otherwise
+     */
+    public static int enqueueNDRangeKernel(cl_command_queue command_queue, 
+        cl_kernel kernel, int work_dim, long global_work_offset[], 
+        long global_work_size[], int num_events_in_wait_list, 
+        cl_event event_wait_list[], cl_event event)
+    {
+        return CL.checkResult(enqueueNDRangeKernelNative(command_queue, 
+            kernel, work_dim, global_work_offset, global_work_size, 
+            num_events_in_wait_list, event_wait_list, event));
+    }
+    
+    /**
+     * Returns the number of cache hits, which is the number of local 
+     * work sizes that have been looked up in the cache
+     * 
+     * @return The number of cache hits
+     */
+    public static long getCacheHitCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of cache misses. Each miss caused a local 
+     * work size to be obtained from the implementation or the heuristic.
+     * 
+     * @return The number of cache misses
+     */
+    public static long getCacheMissCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of local work sizes that have been obtained
+     * from {@link CL#clGetKernelSuggestedLocalWorkSizeKHR}
+     * 
+     * @return The number of suggested local work sizes
+     */
+    public static long getSuggestedCount()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Returns the number of local work sizes that have been computed
+     * with the heuristic, because the extension was not supported
+     * 
+     * @return The number of computed local work sizes
+     */
+    public static long getComputedCount()
+    {
+        return getStatistics()[3];
+    }
+    
+    /**
+     * Returns the number of entries in the cache
+     * 
+     * @return The cache size
+     */
+    public static long getCacheSize()
+    {
+        return getStatistics()[4];
+    }
+    
+    /**
+     * Remove all entries from the cache
+     */
+    public static void clearCache()
+    {
+        clearCacheNative();
+    }
+    
+    /**
+     * Returns the statistics of the native cache
+     * 
+     * @return The statistics
+     */
+    private static long[] getStatistics()
+    {
+        long statistics[] = new long[5];
+        getStatisticsNative(statistics);
+        return statistics;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private LocalWorkSizes()
+    {
+        // Private constructor to prevent instantiation.
+    }
+    
+    private static native boolean isSuggestionSupportedNative(
+        cl_command_queue command_queue);
+    private static native int getLocalWorkSizeNative(
+        cl_command_queue command_queue, cl_kernel kernel, int work_dim, 
+        long global_work_offset[], long global_work_size[], 
+        long local_work_size[]);
+    private static native int enqueueNDRangeKernelNative(
+        cl_command_queue command_queue, cl_kernel kernel, int work_dim, 
+        long global_work_offset[], long global_work_size[], 
+        int num_events_in_wait_list, cl_event event_wait_list[], 
+        cl_event event);
+    private static native void getStatisticsNative(long statistics[]);
+    private static native void clearCacheNative();
+}
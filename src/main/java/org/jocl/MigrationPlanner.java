@@ -0,0 +1,671 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * A class that tracks on which device of a multi-device context the
+ * contents of memory objects currently reside, and issues explicit
+ * migrations with {@link CL#clEnqueueMigrateMemObjects} before kernels
+ * use a memory object on another device.<br>
+ * <br>
+ * Migrations are enqueued in a separate transfer queue for each device,
+ * so that they may overlap with the work that is currently executed in
+ * the compute queues. A migration waits for the event of the last
+ * command that wrote the memory object and for the pending commands
+ * that read it since then, and the kernel that uses the memory object 
+ * waits for the migration. A command that writes a memory object also
+ * waits for the pending commands that read it. This avoids the implicit
+ * on-demand migrations that an implementation would otherwise perform
+ * when the kernel is already about to be executed.<br>
+ * <br>
+ * The typical usage pattern is
+ * <pre><code>
+ * MigrationPlanner planner = new MigrationPlanner(context, devices);
+ * ...
+ * // Optionally, start the migration of the inputs early:
+ * planner.prefetch(device1, new cl_mem[]{ input });
+ * ...
+ * planner.enqueueNDRangeKernel(queue1, kernel, 1, null, 
+ *     globalWorkSize, null, new cl_mem[]{ input }, 
+ *     new cl_mem[]{ output }, null);
+ * ...
+ * planner.release();
+ * </code></pre>
+ * Memory objects that are written by commands that have not been 
+ * enqueued via this class should be reported with 
+ * {@link #recordWrite(cl_mem[], cl_device_id, cl_event)} or
+ * {@link #recordHostWrite(cl_mem, cl_event)}, and memory objects that
+ * are read by such commands should be reported with 
+ * {@link #recordRead(cl_mem[], cl_event)}.<br>
+ * <br>
+ * This class requires OpenCL 1.2. It is thread-safe: All methods,
+ * including {@link #enqueueNDRangeKernel}, are executed atomically.
+ * When the sequence of {@link #prepare}, the enqueue call and the 
+ * recording of the reads and writes is performed manually, then the
+ * caller is responsible for not interleaving it with other commands
+ * that use the same memory objects.
+ */
+public final class MigrationPlanner
+{
+    /**
+     * The residency information of a single memory object
+     */
+    private static final class Residency
+    {
+        /**
+         * The memory object
+         */
+        final cl_mem mem;
+        
+        /**
+         * The native pointer of the device where the contents of the
+         * memory object currently reside, or 0 if they reside on the
+         * host or are not known
+         */
+        long device;
+        
+        /**
+         * The event of the last command that wrote the memory object,
+         * or of the last migration. May be <code>null</code>. 
+         * This event is retained by the planner.
+         */
+        cl_event event;
+        
+        /**
+         * The events of the commands that read the memory object since
+         * the last write or migration, and that have not been found to
+         * be complete yet. These events are retained by the planner.
+         */
+        final List<cl_event> readers = new ArrayList<cl_event>();
+        
+        /**
+         * Creates a new residency information for the given memory object
+         * 
+         * @param mem The memory object
+         */
+        Residency(cl_mem mem)
+        {
+            this.mem = mem;
+        }
+    }
+
+    /**
+     * The transfer queues, one for each device, with the native pointer
+     * of the device as the key
+     */
+    private final Map<Long, cl_command_queue> transferQueues;
+    
+    /**
+     * The devices, with their native pointer as the key
+     */
+    private final Map<Long, cl_device_id> devices;
+    
+    /**
+     * The residency information, with the native pointer of the memory
+     * object as the key
+     */
+    private final Map<Long, Residency> residencies;
+    
+    /**
+     * The number of migrations that have been enqueued
+     */
+    private long migrationCount;
+    
+    /**
+     * Whether this planner has been released
+     */
+    private boolean released;
+    
+    /**
+     * Creates a new planner for the given devices of the given context.
+     * A transfer queue will be created for each device. These queues
+     * will be released when {@link #release()} is called.
+     * 
+     * @param context The context
+     * @param devices The devices
+     * @throws CLException If exceptions are enabled and the transfer
+     * queues can not be created
+     */
+    @SuppressWarnings("deprecation")
+    public MigrationPlanner(cl_context context, cl_device_id devices[])
+    {
+        this.transferQueues = new LinkedHashMap<Long, cl_command_queue>();
+        this.residencies = new HashMap<Long, Residency>();
+        this.devices = new HashMap<Long, cl_device_id>();
+        for (cl_device_id device : devices)
+        {
+            this.devices.put(device.getNativePointer(), device);
+            cl_command_queue queue = 
+                clCreateCommandQueue(context, device, 0, null);
+            transferQueues.put(device.getNativePointer(), queue);
+        }
+    }
+    
+    /**
+     * Returns the number of migrations that have been enqueued by
+     * this planner
+     * 
+     * @return The number of migrations
+     */
+    public synchronized long getMigrationCount()
+    {
+        return migrationCount;
+    }
+    
+    /**
+     * Returns the device where the contents of the given memory object
+     * are currently known to reside, or <code>null</code> if they 
+     * reside on the host or are not known.
+     * 
+     * @param mem The memory object
+     * @return The device
+     */
+    public synchronized cl_device_id getResidentDevice(cl_mem mem)
+    {
+        Residency residency = residencies.get(mem.getNativePointer());
+        if (residency == null)
+        {
+            return null;
+        }
+        return devices.get(residency.device);
+    }
+    
+    /**
+     * Start the migration of the given memory objects to the given
+     * device, if their contents do not already reside there. This may
+     * be called as early as possible, as a hint that the memory objects
+     * will be used by a kernel on the given device. The migrations will
+     * wait for the last commands that wrote the memory objects.
+     * 
+     * @param device The device
+     * @param mems The memory objects
+     * @throws IllegalArgumentException If the device is not one of the
+     * devices of this planner
+     * @throws IllegalStateException If this planner has been released
+     */
+    public synchronized void prefetch(cl_device_id device, cl_mem mems[])
+    {
+        migrateAll(device, mems, 0);
+    }
+
+    /**
+     * Prepare the execution of a command on the given device that reads 
+     * the given inputs and writes the given outputs. All memory objects
+     * whose contents do not reside on the given device will be migrated
+     * to this device. Outputs that are contained in the given 
+     * <code>discarded</code> array will be migrated with 
+     * <code>CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED</code>, meaning 
+     * that their current contents do not have to be transferred.<br>
+     * <br>
+     * The returned events are the events that the command has to wait 
+     * for. They have been retained, and the caller is responsible for 
+     * releasing them. After the command has been enqueued, its event 
+     * should be passed to {@link #recordWrite} for the outputs, and to
+     * {@link #recordRead} for the inputs.
+     * 
+     * @param device The device
+     * @param inputs The memory objects that are read. May be 
+     * <code>null</code>.
+     * @param outputs The memory objects that are written. May be 
+     * <code>null</code>.
+     * @param discarded The outputs whose contents will be completely
+     * overwritten. May be <code>null</code>.
+     * @return The events that the command has to wait for
+     * @throws IllegalArgumentException If the device is not one of the
+     * devices of this planner
+     * @throws IllegalStateException If this planner has been released
+     */
+    public synchronized cl_event[] prepare(cl_device_id device, 
+        cl_mem inputs[], cl_mem outputs[], cl_mem discarded[])
+    {
+        List<cl_event> events = new ArrayList<cl_event>();
+        if (discarded != null)
+        {
+            migrateAll(device, discarded, 
+                CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED);
+        }
+        migrateAll(device, inputs, 0);
+        migrateAll(device, outputs, 0);
+        collectEvents(inputs, false, events);
+        collectEvents(outputs, true, events);
+        collectEvents(discarded, true, events);
+        for (cl_event event : events)
+        {
+            clRetainEvent(event);
+        }
+        return events.toArray(new cl_event[events.size()]);
+    }
+    
+    /**
+     * Record that the given memory objects are written by the command 
+     * that is associated with the given event, on the given device
+     * 
+     * @param mems The memory objects
+     * @param device The device
+     * @param event The event of the command that writes the memory 
+     * objects. May be <code>null</code> if the command is already 
+     * complete. Otherwise, it will be retained by this planner.
+     */
+    public synchronized void recordWrite(
+        cl_mem mems[], cl_device_id device, cl_event event)
+    {
+        for (cl_mem mem : mems)
+        {
+            update(getResidency(mem), device.getNativePointer(), event);
+        }
+    }
+
+    /**
+     * Record that the given memory objects are read by the command that
+     * is associated with the given event. Subsequent writes and 
+     * migrations of the memory objects will wait for this command.
+     * 
+     * @param mems The memory objects
+     * @param event The event of the command that reads the memory 
+     * objects. May be <code>null</code> if the command is already 
+     * complete. Otherwise, it will be retained by this planner.
+     */
+    public synchronized void recordRead(cl_mem mems[], cl_event event)
+    {
+        if (event == null)
+        {
+            return;
+        }
+        for (cl_mem mem : mems)
+        {
+            addReader(getResidency(mem), event);
+        }
+    }
+    
+    /**
+     * Record that the given memory object is written by the host, 
+     * for example, with a call to {@link CL#clEnqueueWriteBuffer},
+     * or by unmapping it after it was mapped for writing.
+     * 
+     * @param mem The memory object
+     * @param event The event of the command that writes the memory 
+     * object. May be <code>null</code> if the command is already 
+     * complete. Otherwise, it will be retained by this planner.
+     */
+    public synchronized void recordHostWrite(cl_mem mem, cl_event event)
+    {
+        update(getResidency(mem), 0, event);
+    }
+    
+    /**
+     * Remove the residency information for the given memory object. 
+     * This should be called before the memory object is released.
+     * 
+     * @param mem The memory object
+     */
+    public synchronized void forget(cl_mem mem)
+    {
+        Residency residency = residencies.remove(mem.getNativePointer());
+        if (residency != null)
+        {
+            releaseEvents(residency);
+        }
+    }
+    
+    /**
+     * Enqueue the given kernel for execution in the given queue, 
+     * after the given inputs and outputs have been migrated to the 
+     * device of the queue, and record the outputs as being written
+     * on this device and the inputs as being read. 
+     * See {@link CL#clEnqueueNDRangeKernel}.
+     * 
+     * @param queue The command queue
+     * @param kernel The kernel
+     * @param workDim The work dimension
+     * @param globalWorkOffset The global work offset
+     * @param globalWorkSize The global work size
+     * @param localWorkSize The local work size
+     * @param inputs The memory objects that are read by the kernel.
+     * May be <code>null</code>.
+     * @param outputs The memory objects that are written by the kernel.
+     * May be <code>null</code>.
+     * @param event The event for the kernel execution. May be 
+     * <code>null</code>.
+     * @return The result of the kernel enqueue call
+     */
+    public synchronized int enqueueNDRangeKernel(cl_command_queue queue, 
+        cl_kernel kernel, int workDim, long globalWorkOffset[], 
+        long globalWorkSize[], long localWorkSize[], 
+        cl_mem inputs[], cl_mem outputs[], cl_event event)
+    {
+        cl_device_id device[] = new cl_device_id[1];
+        clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, 
+            Sizeof.cl_device_id, Pointer.to(device), null);
+        
+        // The kernel event is always requested, so that it can be 
+        // recorded as the event of the last write of the outputs
+        cl_event kernelEvent = event;
+        if (kernelEvent == null)
+        {
+            kernelEvent = new cl_event();
+        }
+        cl_event waitList[] = prepare(device[0], inputs, outputs, null);
+        try
+        {
+            int result = clEnqueueNDRangeKernel(queue, kernel, workDim, 
+                globalWorkOffset, globalWorkSize, localWorkSize, 
+                waitList.length, waitList.length == 0 ? null : waitList, 
+                kernelEvent);
+            if (result == CL_SUCCESS && inputs != null)
+            {
+                recordRead(inputs, kernelEvent);
+            }
+            if (result == CL_SUCCESS && outputs != null)
+            {
+                recordWrite(outputs, device[0], kernelEvent);
+            }
+            return result;
+        }
+        finally
+        {
+            for (cl_event waitEvent : waitList)
+            {
+                clReleaseEvent(waitEvent);
+            }
+            if (kernelEvent != event && kernelEvent.getNativePointer() != 0)
+            {
+                clReleaseEvent(kernelEvent);
+            }
+        }
+    }
+    
+    /**
+     * Release all events that are retained by this planner, and the
+     * transfer queues. The memory objects are not released.
+     */
+    public synchronized void release()
+    {
+        if (released)
+        {
+            return;
+        }
+        released = true;
+        for (Residency residency : residencies.values())
+        {
+            releaseEvents(residency);
+        }
+        residencies.clear();
+        for (cl_command_queue queue : transferQueues.values())
+        {
+            clReleaseCommandQueue(queue);
+        }
+        transferQueues.clear();
+    }
+    
+    /**
+     * Enqueue the migrations of all given memory objects whose contents 
+     * do not reside on the given device. The migrations of all memory 
+     * objects that are not written by pending commands are enqueued 
+     * with a single call.
+     * 
+     * @param device The device
+     * @param mems The memory objects. May be <code>null</code>.
+     * @param flags The migration flags
+     */
+    private void migrateAll(cl_device_id device, cl_mem mems[], long flags)
+    {
+        if (released)
+        {
+            throw new IllegalStateException(
+                "The planner has already been released");
+        }
+        long devicePointer = device.getNativePointer();
+        cl_command_queue queue = transferQueues.get(devicePointer);
+        if (queue == null)
+        {
+            throw new IllegalArgumentException(
+                "The device is not managed by this planner: " + device);
+        }
+        if (mems == null)
+        {
+            return;
+        }
+        List<Residency> unconstrained = new ArrayList<Residency>();
+        for (cl_mem mem : mems)
+        {
+            Residency residency = getResidency(mem);
+            if (residency.device == devicePointer)
+            {
+                continue;
+            }
+            List<cl_event> waitEvents = new ArrayList<cl_event>();
+            collectEvents(residency, true, waitEvents);
+            if (waitEvents.isEmpty())
+            {
+                if (!unconstrained.contains(residency))
+                {
+                    unconstrained.add(residency);
+                }
+                continue;
+            }
+            cl_event migrationEvent = new cl_event();
+            clEnqueueMigrateMemObjects(queue, 1, new cl_mem[]{ mem }, 
+                flags, waitEvents.size(), 
+                waitEvents.toArray(new cl_event[waitEvents.size()]), 
+                migrationEvent);
+            migrationCount++;
+            update(residency, devicePointer, migrationEvent);
+            clReleaseEvent(migrationEvent);
+        }
+        if (!unconstrained.isEmpty())
+        {
+            cl_mem batch[] = new cl_mem[unconstrained.size()];
+            for (int i = 0; i < batch.length; i++)
+            {
+                batch[i] = unconstrained.get(i).mem;
+            }
+            cl_event migrationEvent = new cl_event();
+            clEnqueueMigrateMemObjects(queue, batch.length, batch, 
+                flags, 0, null, migrationEvent);
+            migrationCount++;
+            for (Residency residency : unconstrained)
+            {
+                update(residency, devicePointer, migrationEvent);
+            }
+            clReleaseEvent(migrationEvent);
+        }
+    }
+    
+    /**
+     * Add the events of the last commands that wrote or migrated the 
+     * given memory objects to the given list, omitting duplicates. If
+     * the memory objects are about to be written, then the events of 
+     * the pending commands that read them are added as well.
+     * 
+     * @param mems The memory objects. May be <code>null</code>.
+     * @param write Whether the memory objects are about to be written
+     * @param events The list of events
+     */
+    private void collectEvents(
+        cl_mem mems[], boolean write, List<cl_event> events)
+    {
+        if (mems == null)
+        {
+            return;
+        }
+        for (cl_mem mem : mems)
+        {
+            collectEvents(getResidency(mem), write, events);
+        }
+    }
+    
+    /**
+     * Add the event of the last command that wrote or migrated the 
+     * memory object of the given residency information to the given 
+     * list, omitting duplicates. If the memory object is about to be 
+     * written or migrated, then the events of the pending commands that
+     * read it are added as well.
+     * 
+     * @param residency The residency information
+     * @param write Whether the memory object is about to be written
+     * @param events The list of events
+     */
+    private static void collectEvents(
+        Residency residency, boolean write, List<cl_event> events)
+    {
+        if (residency.event != null && 
+            !containsEvent(events, residency.event))
+        {
+            events.add(residency.event);
+        }
+        if (!write)
+        {
+            return;
+        }
+        for (cl_event reader : residency.readers)
+        {
+            if (!containsEvent(events, reader))
+            {
+                events.add(reader);
+            }
+        }
+    }
+    
+    /**
+     * Returns whether the given list contains an event with the same
+     * native pointer as the given event
+     * 
+     * @param events The list of events
+     * @param event The event
+     * @return Whether the event is contained in the list
+     */
+    private static boolean containsEvent(List<cl_event> events, cl_event event)
+    {
+        for (cl_event e : events)
+        {
+            if (e.getNativePointer() == event.getNativePointer())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Returns the residency information for the given memory object,
+     * creating it if necessary
+     * 
+     * @param mem The memory object
+     * @return The residency information
+     */
+    private Residency getResidency(cl_mem mem)
+    {
+        Long key = mem.getNativePointer();
+        Residency residency = residencies.get(key);
+        if (residency == null)
+        {
+            residency = new Residency(mem);
+            residencies.put(key, residency);
+        }
+        return residency;
+    }
+    
+    /**
+     * Add the given event to the pending readers of the given residency
+     * information. The event will be retained. Readers that are already
+     * complete are removed, so that the list does not grow when a 
+     * memory object is only read.
+     * 
+     * @param residency The residency information
+     * @param event The event
+     */
+    private static void addReader(Residency residency, cl_event event)
+    {
+        int status[] = new int[1];
+        for (int i = residency.readers.size() - 1; i >= 0; i--)
+        {
+            cl_event reader = residency.readers.get(i);
+            int result = clGetEventInfo(reader, 
+                CL_EVENT_COMMAND_EXECUTION_STATUS, Sizeof.cl_int, 
+                Pointer.to(status), null);
+            if (result == CL_SUCCESS && status[0] == CL_COMPLETE)
+            {
+                clReleaseEvent(reader);
+                residency.readers.remove(i);
+            }
+        }
+        if (!containsEvent(residency.readers, event))
+        {
+            clRetainEvent(event);
+            residency.readers.add(event);
+        }
+    }
+    
+    /**
+     * Release all events of the given residency information
+     * 
+     * @param residency The residency information
+     */
+    private static void releaseEvents(Residency residency)
+    {
+        if (residency.event != null)
+        {
+            clReleaseEvent(residency.event);
+            residency.event = null;
+        }
+        for (cl_event reader : residency.readers)
+        {
+            clReleaseEvent(reader);
+        }
+        residency.readers.clear();
+    }
+    
+    /**
+     * Update the given residency information after a write or a 
+     * migration. The given event will be retained, and the previous 
+     * event and the events of the pending readers will be released. 
+     * The write or migration has to wait for these readers.
+     * 
+     * @param residency The residency information
+     * @param device The native pointer of the device, or 0 for the host
+     * @param event The event. May be <code>null</code>.
+     */
+    private static void update(Residency residency, long device, cl_event event)
+    {
+        if (event != null)
+        {
+            clRetainEvent(event);
+        }
+        releaseEvents(residency);
+        residency.device = device;
+        residency.event = event;
+    }
+}
@@ -0,0 +1,203 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+/**
+ * A buffer for the output of the <code>printf</code> function in 
+ * kernels, for implementations that support the 
+ * <code>cl_arm_printf</code> extension.<br>
+ * <br>
+ * The output that the OpenCL implementation reports via the 
+ * <code>CL_PRINTF_CALLBACK_ARM</code> callback is only copied into a 
+ * native ring buffer, so that the thread of the implementation is not 
+ * blocked by calls to Java. The output is delivered to a 
+ * {@link PrintfCallbackFunction} in batches, by a dedicated thread.
+ * When the ring buffer is full, the output is dropped, and counted 
+ * in the {@link #getDroppedBytes() dropped bytes}.<br>
+ * <br>
+ * Usage:
+ * <pre><code>
+ * PrintfBuffer printfBuffer = new PrintfBuffer(1 &lt;&lt; 20, 100, 
+ *     callback, null);
+ * cl_context_properties contextProperties = new cl_context_properties();
+ * contextProperties.addProperty(CL_CONTEXT_PLATFORM, platform);
+ * contextProperties.addProperty(CL_PRINTF_CALLBACK_ARM, printfBuffer);
+ * cl_context context = clCreateContext(contextProperties, ...);
+ * ...
+ * clReleaseContext(context);
+ * printfBuffer.destroy();
+ * </code></pre>
+ * A buffer may only be used for a single context, and it must not be 
+ * destroyed before this context has been released.
+ */
+public final class PrintfBuffer extends NativePointerObject
+{
+    /**
+     * Creates a new printf buffer. A native thread will be started that 
+     * delivers the output to the given callback. The output will be 
+     * delivered after the given flush interval has passed, when the 
+     * buffer is half full, or when {@link #flush()} is called. The 
+     * callback will receive the concatenated output of all 
+     * <code>printf</code> calls since the previous delivery.
+     * 
+     * @param capacity The capacity of the ring buffer, in bytes
+     * @param flushIntervalMillis The flush interval, in milliseconds
+     * @param callback The callback
+     * @param userData The user data that will be passed to the callback
+     * @throws IllegalArgumentException If the capacity or the flush 
+     * interval are not positive, or the callback is <code>null</code>
+     */
+    public PrintfBuffer(int capacity, long flushIntervalMillis, 
+        PrintfCallbackFunction callback, Object userData)
+    {
+        if (capacity <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The capacity must be positive, but is " + capacity);
+        }
+        if (flushIntervalMillis <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The flush interval must be positive, but is " + 
+                flushIntervalMillis);
+        }
+        if (callback == null)
+        {
+            throw new IllegalArgumentException(
+                "The callback may not be null");
+        }
+        CL.loadNativeLibrary();
+        createNative(this, capacity, flushIntervalMillis, callback, userData);
+    }
+    
+    /**
+     * Wait until all output that is currently contained in the buffer
+     * has been delivered to the callback. This may not be called from
+     * the callback.
+     * 
+     * @throws IllegalStateException If this buffer has been destroyed,
+     * or this method is called from the callback
+     */
+    public void flush()
+    {
+        flushNative(this);
+    }
+    
+    /**
+     * Returns the number of bytes that have been delivered to the 
+     * callback
+     * 
+     * @return The number of delivered bytes
+     * @throws IllegalStateException If this buffer has been destroyed
+     */
+    public long getDeliveredBytes()
+    {
+        return getStatistic(0);
+    }
+    
+    /**
+     * Returns the number of calls to the callback
+     * 
+     * @return The number of delivered batches
+     * @throws IllegalStateException If this buffer has been destroyed
+     */
+    public long getDeliveredBatches()
+    {
+        return getStatistic(1);
+    }
+    
+    /**
+     * Returns the number of bytes that have been dropped because the 
+     * buffer was full
+     * 
+     * @return The number of dropped bytes
+     * @throws IllegalStateException If this buffer has been destroyed
+     */
+    public long getDroppedBytes()
+    {
+        return getStatistic(2);
+    }
+    
+    /**
+     * Returns the number of chunks of output, as reported by the OpenCL
+     * implementation, that have been dropped because the buffer was full
+     * 
+     * @return The number of dropped chunks
+     * @throws IllegalStateException If this buffer has been destroyed
+     */
+    public long getDroppedChunks()
+    {
+        return getStatistic(3);
+    }
+    
+    /**
+     * Destroy this buffer. The remaining output will be delivered to 
+     * the callback, and the delivery thread will be stopped. This may 
+     * only be called after the context that this buffer was used for 
+     * has been released, and it may not be called from the callback.
+     * 
+     * @throws IllegalStateException If this buffer has already been 
+     * destroyed, or this method is called from the callback
+     */
+    public void destroy()
+    {
+        destroyNative(this);
+    }
+    
+    /**
+     * Returns the statistic value with the given index
+     * 
+     * @param index The index
+     * @return The value
+     */
+    private long getStatistic(int index)
+    {
+        long statistics[] = new long[4];
+        getStatisticsNative(this, statistics);
+        return statistics[index];
+    }
+    
+    /**
+     * Returns a String representation of this object.
+     * 
+     * @return A String representation of this object.
+     */
+    @Override
+    public String toString()
+    {
+        return "PrintfBuffer[0x"+Long.toHexString(getNativePointer())+"]";
+    }
+
+    private static native void createNative(PrintfBuffer buffer, 
+        int capacity, long flushIntervalMillis, 
+        PrintfCallbackFunction callback, Object userData);
+    private static native void flushNative(PrintfBuffer buffer);
+    private static native void getStatisticsNative(
+        PrintfBuffer buffer, long statistics[]);
+    private static native void destroyNative(PrintfBuffer buffer);
+}
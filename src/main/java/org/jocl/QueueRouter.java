@@ -0,0 +1,404 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.EnumMap;
+import java.util.Map;
+
+/**
+ * A class that routes work to command queues of different priorities,
+ * based on a {@link ServiceClass}.<br>
+ * <br>
+ * All queues of one instance are created for the same context and
+ * device. When the device supports the <code>cl_khr_priority_hints</code>
+ * or <code>cl_khr_throttle_hints</code> extension, the queues are
+ * created with the respective {@link CL#CL_QUEUE_PRIORITY_KHR} and
+ * {@link CL#CL_QUEUE_THROTTLE_KHR} properties, so that bulk work that
+ * is enqueued in a {@link ServiceClass#BULK} queue does not delay 
+ * latency-critical work. When neither extension is supported, all 
+ * service classes share a single command queue, which still allows 
+ * using the same code path on all devices. This queue is created with
+ * <code>clCreateCommandQueue</code>, so that it may also be used on 
+ * platforms that do not support OpenCL 2.0. The hints are only used on
+ * platforms that support <code>clCreateCommandQueueWithProperties</code>.
+ */
+public final class QueueRouter
+{
+    /**
+     * The name of the priority hints extension
+     */
+    private static final String PRIORITY_HINTS_EXTENSION = 
+        "cl_khr_priority_hints";
+    
+    /**
+     * The name of the throttle hints extension
+     */
+    private static final String THROTTLE_HINTS_EXTENSION = 
+        "cl_khr_throttle_hints";
+    
+    /**
+     * The classes of service that requests may be routed by
+     */
+    public static enum ServiceClass
+    {
+        /**
+         * Requests that should be scheduled as early as possible, 
+         * with a high priority and high throttle hint
+         */
+        LATENCY_CRITICAL(CL_QUEUE_PRIORITY_HIGH_KHR, 
+            CL_QUEUE_THROTTLE_HIGH_KHR),
+        
+        /**
+         * Requests with the default priority and throttle hint
+         */
+        DEFAULT(CL_QUEUE_PRIORITY_MED_KHR, 
+            CL_QUEUE_THROTTLE_MED_KHR),
+        
+        /**
+         * Background requests, with a low priority and low throttle hint
+         */
+        BULK(CL_QUEUE_PRIORITY_LOW_KHR, 
+            CL_QUEUE_THROTTLE_LOW_KHR);
+        
+        /**
+         * The cl_queue_priority_khr value
+         */
+        private final int priority;
+        
+        /**
+         * The cl_queue_throttle_khr value
+         */
+        private final int throttle;
+        
+        /**
+         * Creates a new service class
+         * 
+         * @param priority The cl_queue_priority_khr value
+         * @param throttle The cl_queue_throttle_khr value
+         */
+        private ServiceClass(int priority, int throttle)
+        {
+            this.priority = priority;
+            this.throttle = throttle;
+        }
+        
+        /**
+         * Returns the <code>cl_queue_priority_khr</code> value that is
+         * used for queues of this service class
+         * 
+         * @return The priority
+         */
+        public int getPriority()
+        {
+            return priority;
+        }
+        
+        /**
+         * Returns the <code>cl_queue_throttle_khr</code> value that is
+         * used for queues of this service class
+         * 
+         * @return The throttle hint
+         */
+        public int getThrottle()
+        {
+            return throttle;
+        }
+    }
+    
+    /**
+     * The prefix of the <code>CL_PLATFORM_VERSION</code> string
+     */
+    private static final String PLATFORM_VERSION_PREFIX = "OpenCL ";
+    
+    /**
+     * Whether the device supports cl_khr_priority_hints, and its 
+     * platform supports OpenCL 2.0
+     */
+    private final boolean priorityHintsSupported;
+    
+    /**
+     * Whether the device supports cl_khr_throttle_hints, and its 
+     * platform supports OpenCL 2.0
+     */
+    private final boolean throttleHintsSupported;
+    
+    /**
+     * The queues for the service classes. When no hints are supported,
+     * all entries refer to the same queue.
+     */
+    private final Map<ServiceClass, cl_command_queue> queues;
+    
+    /**
+     * Whether this router was already released
+     */
+    private boolean released = false;
+    
+    /**
+     * Creates a new router that creates one command queue for each 
+     * {@link ServiceClass}, for the given context and device.
+     * 
+     * @param context The context
+     * @param device The device
+     * @param properties The bitfield of <code>cl_command_queue_properties</code>
+     * that should be used for all queues, e.g. 
+     * {@link CL#CL_QUEUE_PROFILING_ENABLE}. May be 0.
+     * @throws CLException If a queue can not be created
+     */
+    public QueueRouter(cl_context context, cl_device_id device, 
+        long properties)
+    {
+        boolean queuePropertiesSupported = 
+            isQueuePropertiesSupported(device);
+        this.priorityHintsSupported = queuePropertiesSupported &&
+            Extensions.isSupported(device, PRIORITY_HINTS_EXTENSION);
+        this.throttleHintsSupported = queuePropertiesSupported &&
+            Extensions.isSupported(device, THROTTLE_HINTS_EXTENSION);
+        this.queues = 
+            new EnumMap<ServiceClass, cl_command_queue>(ServiceClass.class);
+        
+        if (!priorityHintsSupported && !throttleHintsSupported)
+        {
+            cl_command_queue queue = createQueue(
+                context, device, properties, null);
+            for (ServiceClass serviceClass : ServiceClass.values())
+            {
+                queues.put(serviceClass, queue);
+            }
+            return;
+        }
+        try
+        {
+            for (ServiceClass serviceClass : ServiceClass.values())
+            {
+                queues.put(serviceClass, createQueue(
+                    context, device, properties, serviceClass));
+            }
+        }
+        catch (RuntimeException e)
+        {
+            for (cl_command_queue queue : queues.values())
+            {
+                clReleaseCommandQueue(queue);
+            }
+            throw e;
+        }
+    }
+    
+    /**
+     * Returns whether the platform of the given device supports 
+     * OpenCL 2.0, and thus <code>clCreateCommandQueueWithProperties</code>,
+     * according to its <code>CL_PLATFORM_VERSION</code>
+     * 
+     * @param device The device
+     * @return Whether queue properties are supported
+     */
+    private static boolean isQueuePropertiesSupported(cl_device_id device)
+    {
+        cl_platform_id platforms[] = new cl_platform_id[1];
+        clGetDeviceInfo(device, CL_DEVICE_PLATFORM, 
+            Sizeof.cl_platform_id, Pointer.to(platforms), null);
+        long size[] = new long[1];
+        clGetPlatformInfo(platforms[0], CL_PLATFORM_VERSION, 0, null, size);
+        byte buffer[] = new byte[(int)size[0]];
+        clGetPlatformInfo(platforms[0], CL_PLATFORM_VERSION, 
+            buffer.length, Pointer.to(buffer), null);
+        String version = 
+            new String(buffer, 0, Math.max(0, buffer.length - 1)).trim();
+        if (!version.startsWith(PLATFORM_VERSION_PREFIX))
+        {
+            return false;
+        }
+        String number = version.substring(PLATFORM_VERSION_PREFIX.length());
+        int dot = number.indexOf('.');
+        if (dot <= 0)
+        {
+            return false;
+        }
+        try
+        {
+            return Integer.parseInt(number.substring(0, dot)) >= 2;
+        }
+        catch (NumberFormatException e)
+        {
+            return false;
+        }
+    }
+    
+    /**
+     * Create a command queue with the given properties and the hints
+     * for the given service class. If the service class is 
+     * <code>null</code>, the queue is created without hints, using
+     * <code>clCreateCommandQueue</code>.
+     * 
+     * @param context The context
+     * @param device The device
+     * @param properties The cl_command_queue_properties
+     * @param serviceClass The optional service class
+     * @return The command queue
+     * @throws CLException If the queue can not be created
+     */
+    @SuppressWarnings("deprecation")
+    private cl_command_queue createQueue(cl_context context, 
+        cl_device_id device, long properties, ServiceClass serviceClass)
+    {
+        int errcode_ret[] = new int[1];
+        if (serviceClass == null)
+        {
+            cl_command_queue queue = clCreateCommandQueue(
+                context, device, properties, errcode_ret);
+            requireSuccess(errcode_ret[0]);
+            return queue;
+        }
+        cl_queue_properties queueProperties = new cl_queue_properties();
+        if (properties != 0)
+        {
+            queueProperties.addProperty(CL_QUEUE_PROPERTIES, properties);
+        }
+        if (serviceClass != null && priorityHintsSupported)
+        {
+            queueProperties.addProperty(
+                CL_QUEUE_PRIORITY_KHR, serviceClass.getPriority());
+        }
+        if (serviceClass != null && throttleHintsSupported)
+        {
+            queueProperties.addProperty(
+                CL_QUEUE_THROTTLE_KHR, serviceClass.getThrottle());
+        }
+        cl_command_queue queue = clCreateCommandQueueWithProperties(
+            context, device, queueProperties, errcode_ret);
+        requireSuccess(errcode_ret[0]);
+        return queue;
+    }
+    
+    /**
+     * Returns whether the device supports the 
+     * <code>cl_khr_priority_hints</code> extension, and its platform
+     * supports OpenCL 2.0
+     * 
+     * @return Whether priority hints are supported
+     */
+    public boolean isPriorityHintsSupported()
+    {
+        return priorityHintsSupported;
+    }
+    
+    /**
+     * Returns whether the device supports the 
+     * <code>cl_khr_throttle_hints</code> extension, and its platform
+     * supports OpenCL 2.0
+     * 
+     * @return Whether throttle hints are supported
+     */
+    public boolean isThrottleHintsSupported()
+    {
+        return throttleHintsSupported;
+    }
+    
+    /**
+     * Returns the command queue that requests of the given service
+     * class should be enqueued in. When the device supports neither
+     * priority nor throttle hints, then this is the same queue for 
+     * all service classes.
+     * 
+     * @param serviceClass The service class
+     * @return The command queue
+     * @throws IllegalStateException If this router was already released
+     */
+    public synchronized cl_command_queue getQueue(ServiceClass serviceClass)
+    {
+        checkNotReleased();
+        return queues.get(serviceClass);
+    }
+    
+    /**
+     * Flush all queues of this router
+     * 
+     * @throws IllegalStateException If this router was already released
+     */
+    public synchronized void flush()
+    {
+        checkNotReleased();
+        for (ServiceClass serviceClass : ServiceClass.values())
+        {
+            clFlush(queues.get(serviceClass));
+        }
+    }
+    
+    /**
+     * Wait until all commands in all queues of this router are finished
+     * 
+     * @throws IllegalStateException If this router was already released
+     */
+    public synchronized void finish()
+    {
+        checkNotReleased();
+        for (ServiceClass serviceClass : ServiceClass.values())
+        {
+            clFinish(queues.get(serviceClass));
+        }
+    }
+    
+    /**
+     * Finish and release all queues of this router
+     */
+    public synchronized void release()
+    {
+        if (released)
+        {
+            return;
+        }
+        finish();
+        cl_command_queue shared = null;
+        for (ServiceClass serviceClass : ServiceClass.values())
+        {
+            cl_command_queue queue = queues.get(serviceClass);
+            if (queue == shared)
+            {
+                continue;
+            }
+            clReleaseCommandQueue(queue);
+            shared = queue;
+        }
+        released = true;
+    }
+    
+    /**
+     * Check whether this router was already released
+     * 
+     * @throws IllegalStateException If this router was already released
+     */
+    private void checkNotReleased()
+    {
+        if (released)
+        {
+            throw new IllegalStateException(
+                "The QueueRouter was already released");
+        }
+    }
+}
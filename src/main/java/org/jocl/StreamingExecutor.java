@@ -0,0 +1,792 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.io.EOFException;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.FileChannel;
+
+/**
+ * An executor that applies a kernel to datasets that are larger than
+ * the device memory, by streaming them through the device in tiles.<br>
+ * <br>
+ * The dataset is partitioned into tiles of a fixed number of elements.
+ * The tiles are cycled through a fixed pool of device buffers, with 
+ * three separate command queues for uploading, computing and 
+ * downloading, so that the upload of one tile, the computation of the
+ * next one and the download of a third one can overlap. The stages 
+ * are ordered with events, so the throughput is bounded by the slowest
+ * stage, and not by the sum of all stages.<br>
+ * <br>
+ * The input and output may be any <code>ByteBuffer</code>: Direct 
+ * buffers (including <code>MappedByteBuffer</code>s of memory-mapped
+ * files) are transferred directly. Heap buffers (for example, created
+ * with <code>ByteBuffer.wrap</code> for a Java array) are copied 
+ * through direct staging buffers of each slot. Datasets that do not 
+ * fit into a single <code>ByteBuffer</code> can be processed with 
+ * {@link #execute(TileSource, long, TileSink)}, which reads and 
+ * writes the tiles at <code>long</code> byte offsets, for example 
+ * from and to a <code>FileChannel</code>.<br>
+ * <br>
+ * For stencil kernels, each tile may be extended by a <i>halo</i> of
+ * elements on both sides, which is clamped at the borders of the 
+ * dataset. The kernel must have the following arguments:
+ * <pre><code>
+ * __kernel void example(
+ *     __global const Type *input,  // haloBefore + n + haloAfter elements
+ *     __global Type *output,       // n elements
+ *     int n,                       // number of elements of the tile
+ *     int haloBefore,              // number of halo elements before it
+ *     int haloAfter,               // number of halo elements after it
+ *     long tileStart)              // index of the first element 
+ * </code></pre>
+ * so that <code>output[i]</code> corresponds to 
+ * <code>input[haloBefore + i]</code>. The kernel is launched with a 
+ * global work size of <code>n</code>. The input and output elements 
+ * must have the same size. Further kernel arguments may be set by 
+ * the caller before calling {@link #execute(ByteBuffer, ByteBuffer)}.
+ */
+public final class StreamingExecutor
+{
+    /**
+     * The source of the input data of 
+     * {@link StreamingExecutor#execute(TileSource, long, TileSink)}
+     */
+    public interface TileSource
+    {
+        /**
+         * Read the input bytes starting at the given offset into the 
+         * remaining bytes of the given buffer. The buffer has to be 
+         * filled completely.
+         * 
+         * @param offset The offset in the input, in bytes
+         * @param target The target buffer
+         * @throws IOException If the data can not be read
+         */
+        void read(long offset, ByteBuffer target) throws IOException;
+    }
+    
+    /**
+     * The sink for the output data of 
+     * {@link StreamingExecutor#execute(TileSource, long, TileSink)}
+     */
+    public interface TileSink
+    {
+        /**
+         * Write the remaining bytes of the given buffer into the output, 
+         * starting at the given offset. All remaining bytes have to be
+         * written.
+         * 
+         * @param offset The offset in the output, in bytes
+         * @param source The source buffer
+         * @throws IOException If the data can not be written
+         */
+        void write(long offset, ByteBuffer source) throws IOException;
+    }
+    
+    /**
+     * Returns a tile source that reads from the given channel, with 
+     * the given position of the first input byte. The position of the
+     * channel is not modified.
+     * 
+     * @param channel The channel
+     * @param position The position of the input in the channel
+     * @return The tile source
+     */
+    public static TileSource source(
+        final FileChannel channel, final long position)
+    {
+        return new TileSource()
+        {
+            @Override
+            public void read(long offset, ByteBuffer target) throws IOException
+            {
+                long p = position + offset;
+                while (target.hasRemaining())
+                {
+                    int n = channel.read(target, p);
+                    if (n < 0)
+                    {
+                        throw new EOFException(
+                            "Unexpected end of input at position " + p);
+                    }
+                    p += n;
+                }
+            }
+        };
+    }
+    
+    /**
+     * Returns a tile sink that writes into the given channel, with 
+     * the given position of the first output byte. The position of 
+     * the channel is not modified.
+     * 
+     * @param channel The channel
+     * @param position The position of the output in the channel
+     * @return The tile sink
+     */
+    public static TileSink sink(
+        final FileChannel channel, final long position)
+    {
+        return new TileSink()
+        {
+            @Override
+            public void write(long offset, ByteBuffer source) throws IOException
+            {
+                long p = position + offset;
+                while (source.hasRemaining())
+                {
+                    p += channel.write(source, p);
+                }
+            }
+        };
+    }
+    
+    /**
+     * The default number of slots
+     */
+    public static final int DEFAULT_SLOT_COUNT = 3;
+    
+    /**
+     * A slot of the pipeline, consisting of the device buffers for one
+     * tile, the staging buffers for non-direct data, and the events of
+     * the last tile that used the slot
+     */
+    private static final class Slot
+    {
+        /**
+         * The device buffers
+         */
+        private cl_mem inputMem;
+        private cl_mem outputMem;
+        
+        /**
+         * The staging buffers for non-direct data, created on demand
+         */
+        private ByteBuffer inputStaging;
+        private ByteBuffer outputStaging;
+        
+        /**
+         * The events of the last tile that used this slot, or null
+         */
+        private cl_event uploaded;
+        private cl_event computed;
+        private cl_event downloaded;
+        
+        /**
+         * For staged output: The sink and the range where the staged 
+         * data of the last tile has to be written to
+         */
+        private TileSink pendingSink;
+        private long pendingOutputOffset;
+        private int pendingOutputBytes;
+    }
+    
+    /**
+     * The queues for the three stages
+     */
+    private final cl_command_queue uploadQueue;
+    private final cl_command_queue computeQueue;
+    private final cl_command_queue downloadQueue;
+    
+    /**
+     * The kernel
+     */
+    private final cl_kernel kernel;
+    
+    /**
+     * The size of one element, in bytes
+     */
+    private final int elementSize;
+    
+    /**
+     * The number of elements per tile
+     */
+    private final int tileElements;
+    
+    /**
+     * The number of halo elements on each side of a tile
+     */
+    private final int haloElements;
+    
+    /**
+     * The size of the input of a tile including its halos, and the 
+     * size of the output of a tile, in bytes
+     */
+    private final int inputTileBytes;
+    private final int outputTileBytes;
+    
+    /**
+     * The slots
+     */
+    private final Slot slots[];
+    
+    /**
+     * The number of tiles that have been processed
+     */
+    private long tileCount;
+    
+    /**
+     * Creates a new streaming executor with {@link #DEFAULT_SLOT_COUNT}
+     * slots
+     * 
+     * @param context The context
+     * @param device The device
+     * @param kernel The kernel. See the class documentation for the 
+     * required arguments.
+     * @param elementSize The size of one element, in bytes
+     * @param tileElements The number of elements per tile
+     * @param haloElements The number of halo elements on each side 
+     * of a tile
+     * @throws IllegalArgumentException If the element size or tile 
+     * size are not positive, or the halo size is negative
+     * @throws CLException If the queues or buffers can not be created
+     */
+    public StreamingExecutor(cl_context context, cl_device_id device, 
+        cl_kernel kernel, int elementSize, int tileElements, 
+        int haloElements)
+    {
+        this(context, device, kernel, elementSize, tileElements, 
+            haloElements, DEFAULT_SLOT_COUNT);
+    }
+    
+    /**
+     * Creates a new streaming executor
+     * 
+     * @param context The context
+     * @param device The device
+     * @param kernel The kernel. See the class documentation for the 
+     * required arguments.
+     * @param elementSize The size of one element, in bytes
+     * @param tileElements The number of elements per tile
+     * @param haloElements The number of halo elements on each side 
+     * of a tile
+     * @param slotCount The number of slots. At least 3 slots are 
+     * required for overlapping all three stages.
+     * @throws IllegalArgumentException If the element size, tile size
+     * or slot count are not positive, the halo size is negative, or 
+     * a tile including its halos has more than Integer.MAX_VALUE bytes
+     * @throws CLException If the queues or buffers can not be created
+     */
+    public StreamingExecutor(cl_context context, cl_device_id device, 
+        cl_kernel kernel, int elementSize, int tileElements, 
+        int haloElements, int slotCount)
+    {
+        if (elementSize <= 0 || tileElements <= 0 || slotCount <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The element size, tile size and slot count must be positive");
+        }
+        if (haloElements < 0)
+        {
+            throw new IllegalArgumentException(
+                "The halo size may not be negative: " + haloElements);
+        }
+        long inputBytes = 
+            ((long)tileElements + 2L * haloElements) * elementSize;
+        if (inputBytes > Integer.MAX_VALUE)
+        {
+            throw new IllegalArgumentException(
+                "A tile with its halos has " + inputBytes + " bytes, " + 
+                "but may have at most " + Integer.MAX_VALUE);
+        }
+        this.kernel = kernel;
+        this.elementSize = elementSize;
+        this.tileElements = tileElements;
+        this.haloElements = haloElements;
+        this.inputTileBytes = (int)inputBytes;
+        this.outputTileBytes = tileElements * elementSize;
+        
+        // Only objects that have been created successfully are stored,
+        // so that they can be released if a later creation fails
+        cl_command_queue queues[] = new cl_command_queue[3];
+        Slot newSlots[] = new Slot[slotCount];
+        try
+        {
+            int errorCode[] = new int[1];
+            for (int i = 0; i < queues.length; i++)
+            {
+                cl_command_queue queue = clCreateCommandQueue(
+                    context, device, 0, errorCode);
+                requireSuccess(errorCode[0]);
+                queues[i] = queue;
+            }
+            for (int i = 0; i < slotCount; i++)
+            {
+                Slot slot = new Slot();
+                newSlots[i] = slot;
+                cl_mem inputMem = clCreateBuffer(context, CL_MEM_READ_ONLY, 
+                    inputTileBytes, null, errorCode);
+                requireSuccess(errorCode[0]);
+                slot.inputMem = inputMem;
+                cl_mem outputMem = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                    outputTileBytes, null, errorCode);
+                requireSuccess(errorCode[0]);
+                slot.outputMem = outputMem;
+            }
+        }
+        catch (RuntimeException e)
+        {
+            releaseObjects(queues, newSlots);
+            throw e;
+        }
+        this.uploadQueue = queues[0];
+        this.computeQueue = queues[1];
+        this.downloadQueue = queues[2];
+        this.slots = newSlots;
+    }
+    
+    /**
+     * Apply the kernel to all elements of the given input, and write 
+     * the results into the given output. The elements are the 
+     * remaining bytes of the input. The results are written starting
+     * at the position of the output. The positions and limits of the
+     * buffers are not modified. This method returns when all results
+     * have been written.
+     * 
+     * @param input The input
+     * @param output The output
+     * @throws IllegalArgumentException If the input size is not a 
+     * multiple of the element size, or the output is too small
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void execute(ByteBuffer input, ByteBuffer output)
+    {
+        if (output.remaining() < input.remaining())
+        {
+            throw new IllegalArgumentException(
+                "The output has " + output.remaining() + " bytes " + 
+                "remaining, but " + input.remaining() + " are required");
+        }
+        try
+        {
+            run(input.remaining(), 
+                input.isDirect() ? input : null, 
+                input.isDirect() ? null : bufferSource(input), 
+                output.isDirect() ? output : null, 
+                output.isDirect() ? null : bufferSink(output));
+        }
+        catch (IOException e)
+        {
+            // The sources and sinks for buffers do not throw
+            throw new AssertionError(e);
+        }
+    }
+    
+    /**
+     * Apply the kernel to the given number of input bytes that are 
+     * read from the given source, and write the results into the 
+     * given sink. The input and output are always copied through 
+     * direct staging buffers of each slot, and the byte offsets of the
+     * tiles are <code>long</code> values, so the size of the dataset
+     * is not limited by the size of a <code>ByteBuffer</code>. This 
+     * method returns when all results have been written.
+     * 
+     * @param source The source of the input
+     * @param size The size of the input, in bytes
+     * @param sink The sink for the output
+     * @throws IllegalArgumentException If the size is negative or not
+     * a multiple of the element size
+     * @throws IOException If the source or sink throws an IOException
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void execute(TileSource source, long size, TileSink sink) 
+        throws IOException
+    {
+        if (size < 0)
+        {
+            throw new IllegalArgumentException(
+                "The size may not be negative: " + size);
+        }
+        run(size, null, source, null, sink);
+    }
+    
+    /**
+     * Process the given number of input bytes. The input is uploaded
+     * directly from the given direct input buffer, if it is not null,
+     * and read from the given source otherwise. The output is 
+     * downloaded directly into the given direct output buffer, if it
+     * is not null, and written into the given sink otherwise.
+     * 
+     * @param size The size of the input, in bytes
+     * @param directInput The optional direct input buffer
+     * @param source The source of the input
+     * @param directOutput The optional direct output buffer
+     * @param sink The sink for the output
+     * @throws IllegalArgumentException If the input size is not a 
+     * multiple of the element size
+     * @throws IOException If the source or sink throws an IOException
+     */
+    private void run(long size, ByteBuffer directInput, TileSource source,
+        ByteBuffer directOutput, TileSink sink) throws IOException
+    {
+        if (size % elementSize != 0)
+        {
+            throw new IllegalArgumentException(
+                "The input size " + size + " is not a " + 
+                "multiple of the element size " + elementSize);
+        }
+        long totalElements = size / elementSize;
+        long tiles = (totalElements + tileElements - 1) / tileElements;
+        for (long t = 0; t < tiles; t++)
+        {
+            Slot slot = slots[(int)(t % slots.length)];
+            long tileStart = t * tileElements;
+            int n = (int)Math.min(tileElements, totalElements - tileStart);
+            long inputStart = Math.max(0, tileStart - haloElements);
+            long inputEnd = 
+                Math.min(totalElements, tileStart + n + haloElements);
+            int haloBefore = (int)(tileStart - inputStart);
+            int haloAfter = (int)(inputEnd - tileStart - n);
+            
+            // The slot may be reused when its previous tile has been 
+            // uploaded and downloaded. This also writes the staged 
+            // results of the previous tile into the sink.
+            completeSlot(slot);
+            
+            long inputOffset = inputStart * elementSize;
+            int inputBytes = (int)((inputEnd - inputStart) * elementSize);
+            long outputOffset = tileStart * elementSize;
+            int outputBytes = (int)((long)n * elementSize);
+            
+            upload(slot, directInput, source, inputOffset, inputBytes);
+            compute(slot, n, haloBefore, haloAfter, tileStart);
+            download(slot, directOutput, sink, outputOffset, outputBytes);
+            tileCount++;
+        }
+        for (Slot slot : slots)
+        {
+            completeSlot(slot);
+        }
+    }
+    
+    /**
+     * Returns the number of tiles that have been processed
+     * 
+     * @return The number of tiles
+     */
+    public long getTileCount()
+    {
+        return tileCount;
+    }
+    
+    /**
+     * Release the buffers and queues of this executor. The kernel is
+     * not released.
+     */
+    public void release()
+    {
+        for (Slot slot : slots)
+        {
+            try
+            {
+                completeSlot(slot);
+            }
+            catch (IOException e)
+            {
+                // The output of an aborted execution is discarded
+            }
+            clReleaseMemObject(slot.inputMem);
+            clReleaseMemObject(slot.outputMem);
+        }
+        clReleaseCommandQueue(uploadQueue);
+        clReleaseCommandQueue(computeQueue);
+        clReleaseCommandQueue(downloadQueue);
+    }
+    
+    /**
+     * Enqueue the upload of the given range of the input into the 
+     * input buffer of the given slot
+     * 
+     * @param slot The slot
+     * @param directInput The optional direct input buffer
+     * @param source The source of the input
+     * @param offset The offset of the range, in bytes
+     * @param bytes The size of the range, in bytes
+     * @throws IOException If the source throws an IOException
+     */
+    private void upload(Slot slot, ByteBuffer directInput, 
+        TileSource source, long offset, int bytes) throws IOException
+    {
+        Pointer pointer = null;
+        if (directInput != null)
+        {
+            pointer = Pointer.to(directInput).withByteOffset(
+                directInput.position() + offset);
+        }
+        else
+        {
+            if (slot.inputStaging == null)
+            {
+                slot.inputStaging = allocateStaging(inputTileBytes);
+            }
+            slot.inputStaging.clear();
+            slot.inputStaging.limit(bytes);
+            source.read(offset, slot.inputStaging);
+            pointer = Pointer.to(slot.inputStaging);
+        }
+        cl_event uploaded = new cl_event();
+        requireSuccess(clEnqueueWriteBuffer(uploadQueue, slot.inputMem, 
+            CL_NON_BLOCKING, 0, bytes, pointer, 0, null, uploaded));
+        slot.uploaded = uploaded;
+        clFlush(uploadQueue);
+    }
+    
+    /**
+     * Enqueue the computation of the tile in the given slot
+     * 
+     * @param slot The slot
+     * @param n The number of elements of the tile
+     * @param haloBefore The number of halo elements before the tile
+     * @param haloAfter The number of halo elements after the tile
+     * @param tileStart The index of the first element of the tile
+     */
+    private void compute(Slot slot, int n, 
+        int haloBefore, int haloAfter, long tileStart)
+    {
+        requireSuccess(clSetKernelArg(kernel, 0, Sizeof.cl_mem, 
+            Pointer.to(slot.inputMem)));
+        requireSuccess(clSetKernelArg(kernel, 1, Sizeof.cl_mem, 
+            Pointer.to(slot.outputMem)));
+        requireSuccess(clSetKernelArg(kernel, 2, Sizeof.cl_int, 
+            Pointer.to(new int[]{ n })));
+        requireSuccess(clSetKernelArg(kernel, 3, Sizeof.cl_int, 
+            Pointer.to(new int[]{ haloBefore })));
+        requireSuccess(clSetKernelArg(kernel, 4, Sizeof.cl_int, 
+            Pointer.to(new int[]{ haloAfter })));
+        requireSuccess(clSetKernelArg(kernel, 5, Sizeof.cl_long, 
+            Pointer.to(new long[]{ tileStart })));
+        cl_event computed = new cl_event();
+        requireSuccess(clEnqueueNDRangeKernel(computeQueue, kernel, 1, null, 
+            new long[]{ n }, null, 1, new cl_event[]{ slot.uploaded }, 
+            computed));
+        slot.computed = computed;
+        clFlush(computeQueue);
+    }
+    
+    /**
+     * Enqueue the download of the output buffer of the given slot into
+     * the given range of the output
+     * 
+     * @param slot The slot
+     * @param directOutput The optional direct output buffer
+     * @param sink The sink for the output
+     * @param offset The offset of the range, in bytes
+     * @param bytes The size of the range, in bytes
+     */
+    private void download(Slot slot, ByteBuffer directOutput, 
+        TileSink sink, long offset, int bytes)
+    {
+        Pointer pointer = null;
+        if (directOutput != null)
+        {
+            pointer = Pointer.to(directOutput).withByteOffset(
+                directOutput.position() + offset);
+        }
+        else
+        {
+            if (slot.outputStaging == null)
+            {
+                slot.outputStaging = allocateStaging(outputTileBytes);
+            }
+            pointer = Pointer.to(slot.outputStaging);
+            slot.pendingSink = sink;
+            slot.pendingOutputOffset = offset;
+            slot.pendingOutputBytes = bytes;
+        }
+        cl_event downloaded = new cl_event();
+        requireSuccess(clEnqueueReadBuffer(downloadQueue, slot.outputMem, 
+            CL_NON_BLOCKING, 0, bytes, pointer, 
+            1, new cl_event[]{ slot.computed }, downloaded));
+        slot.downloaded = downloaded;
+        clFlush(downloadQueue);
+    }
+    
+    /**
+     * Wait until the last tile of the given slot has been uploaded and 
+     * downloaded, and write the staged output into the sink if 
+     * necessary
+     * 
+     * @param slot The slot
+     * @throws IOException If the sink throws an IOException
+     */
+    private void completeSlot(Slot slot) throws IOException
+    {
+        cl_event waitList[] = events(slot.uploaded, slot.downloaded);
+        if (waitList.length == 0)
+        {
+            return;
+        }
+        requireSuccess(clWaitForEvents(waitList.length, waitList));
+        releaseEvent(slot.uploaded);
+        releaseEvent(slot.computed);
+        releaseEvent(slot.downloaded);
+        slot.uploaded = null;
+        slot.computed = null;
+        slot.downloaded = null;
+        if (slot.pendingSink != null)
+        {
+            TileSink sink = slot.pendingSink;
+            slot.pendingSink = null;
+            ByteBuffer source = slot.outputStaging.duplicate();
+            source.limit(slot.pendingOutputBytes);
+            source.position(0);
+            sink.write(slot.pendingOutputOffset, source);
+        }
+    }
+    
+    /**
+     * Returns a tile source that reads from the remaining bytes of the
+     * given buffer
+     * 
+     * @param input The input buffer
+     * @return The tile source
+     */
+    private static TileSource bufferSource(final ByteBuffer input)
+    {
+        final int position = input.position();
+        return new TileSource()
+        {
+            @Override
+            public void read(long offset, ByteBuffer target)
+            {
+                ByteBuffer source = input.duplicate();
+                int start = position + (int)offset;
+                source.limit(start + target.remaining());
+                source.position(start);
+                target.put(source);
+            }
+        };
+    }
+    
+    /**
+     * Returns a tile sink that writes into the given buffer, starting
+     * at its current position
+     * 
+     * @param output The output buffer
+     * @return The tile sink
+     */
+    private static TileSink bufferSink(final ByteBuffer output)
+    {
+        final int position = output.position();
+        return new TileSink()
+        {
+            @Override
+            public void write(long offset, ByteBuffer source)
+            {
+                ByteBuffer target = output.duplicate();
+                target.position(position + (int)offset);
+                target.put(source);
+            }
+        };
+    }
+    
+    /**
+     * Release the given queues and the buffers of the given slots, 
+     * ignoring null elements
+     * 
+     * @param queues The queues
+     * @param slots The slots
+     */
+    private static void releaseObjects(cl_command_queue queues[], Slot slots[])
+    {
+        for (Slot slot : slots)
+        {
+            if (slot != null && slot.inputMem != null)
+            {
+                clReleaseMemObject(slot.inputMem);
+            }
+            if (slot != null && slot.outputMem != null)
+            {
+                clReleaseMemObject(slot.outputMem);
+            }
+        }
+        for (cl_command_queue queue : queues)
+        {
+            if (queue != null)
+            {
+                clReleaseCommandQueue(queue);
+            }
+        }
+    }
+    
+    /**
+     * Allocate a direct staging buffer with the given size
+     * 
+     * @param size The size
+     * @return The buffer
+     */
+    private static ByteBuffer allocateStaging(int size)
+    {
+        return ByteBuffer.allocateDirect(size).order(ByteOrder.nativeOrder());
+    }
+    
+    /**
+     * Returns an array containing the given events that are not null
+     * 
+     * @param events The events
+     * @return The array
+     */
+    private static cl_event[] events(cl_event ... events)
+    {
+        int n = 0;
+        for (cl_event event : events)
+        {
+            if (event != null)
+            {
+                n++;
+            }
+        }
+        cl_event result[] = new cl_event[n];
+        n = 0;
+        for (cl_event event : events)
+        {
+            if (event != null)
+            {
+                result[n++] = event;
+            }
+        }
+        return result;
+    }
+    
+    /**
+     * Release the given event, if it is not null
+     * 
+     * @param event The event
+     */
+    private static void releaseEvent(cl_event event)
+    {
+        if (event != null)
+        {
+            clReleaseEvent(event);
+        }
+    }
+}
@@ -0,0 +1,408 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+/**
+ * Utility methods for sub-group aware kernel launches.<br>
+ * <br>
+ * The sub-group information of a kernel is obtained with 
+ * {@link CL#clGetKernelSubGroupInfo} on OpenCL 2.1 devices, or with
+ * {@link CL#clGetKernelSubGroupInfoKHR} on devices that support the 
+ * <code>cl_khr_subgroups</code> extension. The results are cached 
+ * natively, for each combination of kernel, device and input value,
+ * and the entries for a kernel are removed when 
+ * {@link CL#clReleaseKernel} is called for the kernel.<br>
+ * <br>
+ * The launch helpers round the local work size in the first dimension
+ * to a multiple of the sub-group size, so that no sub-group is only 
+ * partially filled. When the device does not support sub-groups, the
+ * <code>CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE</code> of the 
+ * kernel is used instead, which usually is the SIMD width.
+ */
+public final class SubGroups
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * Returns whether the given device supports queries for the 
+     * sub-group information, either with OpenCL 2.1 or with the 
+     * <code>cl_khr_subgroups</code> extension
+     * 
+     * @param device The device
+     * @return Whether sub-groups are supported
+     */
+    public static boolean isSupported(cl_device_id device)
+    {
+        return isSupportedNative(device);
+    }
+    
+    /**
+     * Returns the maximum sub-group size for the given kernel, when it 
+     * is executed with the given local work size
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param local_work_size The local work size
+     * @return The maximum sub-group size
+     * @throws CLException If the information can not be obtained
+     */
+    public static long getMaxSubGroupSize(cl_kernel kernel, 
+        cl_device_id device, long local_work_size[])
+    {
+        return query(kernel, device, 
+            CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE, local_work_size, 1)[0];
+    }
+    
+    /**
+     * Returns the number of sub-groups for the given kernel, when it
+     * is executed with the given local work size
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param local_work_size The local work size
+     * @return The number of sub-groups
+     * @throws CLException If the information can not be obtained
+     */
+    public static long getSubGroupCount(cl_kernel kernel, 
+        cl_device_id device, long local_work_size[])
+    {
+        return query(kernel, device, 
+            CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE, local_work_size, 1)[0];
+    }
+    
+    /**
+     * Returns the maximum number of sub-groups in a work-group for the
+     * given kernel. This requires OpenCL 2.1.
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @return The maximum number of sub-groups
+     * @throws CLException If the information can not be obtained
+     */
+    public static long getMaxNumSubGroups(cl_kernel kernel, 
+        cl_device_id device)
+    {
+        return query(kernel, device, 
+            CL_KERNEL_MAX_NUM_SUB_GROUPS, null, 1)[0];
+    }
+    
+    /**
+     * Returns the number of sub-groups that was specified with the 
+     * <code>required_num_sub_groups</code> attribute of the kernel, 
+     * or 0. This requires OpenCL 2.1.
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @return The number of sub-groups
+     * @throws CLException If the information can not be obtained
+     */
+    public static long getCompileNumSubGroups(cl_kernel kernel, 
+        cl_device_id device)
+    {
+        return query(kernel, device, 
+            CL_KERNEL_COMPILE_NUM_SUB_GROUPS, null, 1)[0];
+    }
+    
+    /**
+     * Returns the local work size that results in the given number of 
+     * sub-groups. All elements of the result will be 0 if there is no 
+     * such local work size. This requires OpenCL 2.1.
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param subGroupCount The desired number of sub-groups
+     * @param work_dim The number of dimensions, between 1 and 3
+     * @return The local work size
+     * @throws CLException If the information can not be obtained
+     */
+    public static long[] getLocalSizeForSubGroupCount(cl_kernel kernel, 
+        cl_device_id device, long subGroupCount, int work_dim)
+    {
+        return query(kernel, device, 
+            CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT, 
+            new long[]{ subGroupCount }, work_dim);
+    }
+    
+    /**
+     * Returns a copy of the given local work size, where the size in 
+     * the first dimension is rounded to the nearest multiple of the 
+     * sub-group size. The result is at least one sub-group, and the 
+     * total size does not exceed the <code>CL_KERNEL_WORK_GROUP_SIZE</code>
+     * of the kernel. If the sub-group size can not be obtained, the 
+     * <code>CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE</code> is used.
+     * If the given local work size is <code>null</code>, meaning that
+     * the implementation chooses it, then <code>null</code> is returned.
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param local_work_size The local work size. May be <code>null</code>.
+     * @return The rounded local work size
+     */
+    public static long[] roundLocalWorkSize(cl_kernel kernel, 
+        cl_device_id device, long local_work_size[])
+    {
+        if (local_work_size == null)
+        {
+            return null;
+        }
+        long result[] = local_work_size.clone();
+        long multiple = getSubGroupWidth(kernel, device, local_work_size);
+        if (multiple <= 1)
+        {
+            return result;
+        }
+        long others = 1;
+        for (int i = 1; i < result.length; i++)
+        {
+            others *= Math.max(1, result[i]);
+        }
+        long limit = getKernelWorkGroupInfo(kernel, device, 
+            CL_KERNEL_WORK_GROUP_SIZE) / others;
+        if (limit < multiple)
+        {
+            return result;
+        }
+        long rounded = ((result[0] + multiple / 2) / multiple) * multiple;
+        rounded = Math.max(multiple, rounded);
+        rounded = Math.min(rounded, (limit / multiple) * multiple);
+        result[0] = rounded;
+        return result;
+    }
+    
+    /**
+     * Returns a copy of the given global work size, where each element
+     * is rounded up to the next multiple of the respective element of
+     * the given local work size. If the local work size is 
+     * <code>null</code>, the global work size is not rounded.
+     * 
+     * @param global_work_size The global work size
+     * @param local_work_size The local work size. May be <code>null</code>.
+     * @return The rounded global work size
+     */
+    public static long[] roundGlobalWorkSize(
+        long global_work_size[], long local_work_size[])
+    {
+        if (local_work_size == null)
+        {
+            return global_work_size.clone();
+        }
+        long result[] = new long[global_work_size.length];
+        for (int i = 0; i < result.length; i++)
+        {
+            long local = Math.max(1, local_work_size[i]);
+            result[i] = ((global_work_size[i] + local - 1) / local) * local;
+        }
+        return result;
+    }
+    
+    /**
+     * Enqueue the given kernel like {@link CL#clEnqueueNDRangeKernel},
+     * with the local work size rounded as described in 
+     * {@link #roundLocalWorkSize}, and the global work size rounded 
+     * up to a multiple of the local work size. Since the global work
+     * size may be increased, the kernel has to check whether the global 
+     * IDs are in the original range.
+     * 
+     * @param command_queue The command queue
+     * @param kernel The kernel
+     * @param work_dim The number of dimensions, between 1 and 3
+     * @param global_work_offset The global work offset. May be 
+     * <code>null</code>.
+     * @param global_work_size The global work size
+     * @param local_work_size The desired local work size. May be 
+     * <code>null</code>, in which case it is passed to 
+     * <code>clEnqueueNDRangeKernel</code> unchanged, and chosen by the
+     * implementation.
+     * @param num_events_in_wait_list The number of events in the wait
+     * list
+     * @param event_wait_list The events to wait for. May be 
+     * <code>null</code>.
+     * @param event The event for the kernel execution. May be 
+     * <code>null</code>.
+     * @return CL_SUCCESS if the function is executed successfully, or
+     * the error code otherwise
+     */
+    public static int enqueueNDRangeKernel(cl_command_queue command_queue, 
+        cl_kernel kernel, int work_dim, long global_work_offset[], 
+        long global_work_size[], long local_work_size[], 
+        int num_events_in_wait_list, cl_event event_wait_list[], 
+        cl_event event)
+    {
+        cl_device_id device[] = new cl_device_id[1];
+        clGetCommandQueueInfo(command_queue, CL_QUEUE_DEVICE, 
+            Sizeof.cl_device_id, Pointer.to(device), null);
+        long local[] = roundLocalWorkSize(kernel, device[0], local_work_size);
+        long global[] = roundGlobalWorkSize(global_work_size, local);
+        return clEnqueueNDRangeKernel(command_queue, kernel, work_dim, 
+            global_work_offset, global, local, 
+            num_events_in_wait_list, event_wait_list, event);
+    }
+    
+    /**
+     * Returns the number of cache hits
+     * 
+     * @return The number of cache hits
+     */
+    public static long getCacheHitCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of cache misses. Each miss caused a query 
+     * to the implementation.
+     * 
+     * @return The number of cache misses
+     */
+    public static long getCacheMissCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of entries in the cache
+     * 
+     * @return The cache size
+     */
+    public static long getCacheSize()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Remove all entries from the cache
+     */
+    public static void clearCache()
+    {
+        clearCacheNative();
+    }
+    
+    /**
+     * Returns the width that the local work size should be a multiple
+     * of: The maximum sub-group size if sub-groups are supported, and 
+     * the preferred work group size multiple otherwise.
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param local_work_size The local work size
+     * @return The width
+     */
+    private static long getSubGroupWidth(cl_kernel kernel, 
+        cl_device_id device, long local_work_size[])
+    {
+        if (isSupported(device))
+        {
+            long result[] = new long[1];
+            int errorCode = getKernelSubGroupInfoNative(kernel, device, 
+                CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE, local_work_size, 
+                result);
+            if (errorCode == CL_SUCCESS && result[0] > 0)
+            {
+                return result[0];
+            }
+        }
+        return getKernelWorkGroupInfo(kernel, device, 
+            CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE);
+    }
+    
+    /**
+     * Returns the <code>size_t</code> value of the given kernel work 
+     * group info
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param paramName The parameter name
+     * @return The value
+     */
+    private static long getKernelWorkGroupInfo(cl_kernel kernel, 
+        cl_device_id device, int paramName)
+    {
+        long value[] = new long[1];
+        clGetKernelWorkGroupInfo(kernel, device, paramName, 
+            Sizeof.size_t, Pointer.to(value), null);
+        return value[0];
+    }
+    
+    /**
+     * Query the sub-group information with the given parameter name
+     * 
+     * @param kernel The kernel
+     * @param device The device
+     * @param paramName The parameter name
+     * @param input The input values. May be <code>null</code>.
+     * @param outputCount The number of output values
+     * @return The output values
+     * @throws CLException If the information can not be obtained
+     */
+    private static long[] query(cl_kernel kernel, cl_device_id device, 
+        int paramName, long input[], int outputCount)
+    {
+        long output[] = new long[outputCount];
+        int result = getKernelSubGroupInfoNative(
+            kernel, device, paramName, input, output);
+        if (result != CL_SUCCESS)
+        {
+            throw new CLException(
+                "Could not obtain " + 
+                stringFor_cl_kernel_sub_group_info(paramName) + ": " + 
+                stringFor_errorCode(result), result);
+        }
+        return output;
+    }
+    
+    /**
+     * Returns the statistics of the native cache
+     * 
+     * @return The statistics
+     */
+    private static long[] getStatistics()
+    {
+        long statistics[] = new long[3];
+        getStatisticsNative(statistics);
+        return statistics;
+    }
+    
+    /**
+     * Private constructor to prevent instantiation.
+     */
+    private SubGroups()
+    {
+        // Private constructor to prevent instantiation.
+    }
+    
+    private static native boolean isSupportedNative(cl_device_id device);
+    private static native int getKernelSubGroupInfoNative(cl_kernel kernel, 
+        cl_device_id device, int param_name, long input_value[], 
+        long param_value[]);
+    private static native void getStatisticsNative(long statistics[]);
+    private static native void clearCacheNative();
+}
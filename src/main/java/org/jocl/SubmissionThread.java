@@ -0,0 +1,552 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * A native thread that submits commands to the command queues of one 
+ * device on behalf of arbitrary Java threads.<br>
+ * <br>
+ * When many threads call the <code>clEnqueue*</code> functions on 
+ * shared command queues, they contend on locks inside the OpenCL 
+ * implementation. With a submission thread, the calling threads only
+ * write a compact command descriptor into a bounded, lock-free native 
+ * ring, and return immediately. A single native thread per device 
+ * drains the ring and issues the actual OpenCL calls. The queues are
+ * flushed in batches: When the ring becomes empty, or optionally after
+ * a fixed number of commands.<br>
+ * <br>
+ * Each <code>enqueue</code> method returns a <i>ticket</i>. The 
+ * {@link #awaitSubmitted(long)} method waits until the command with
+ * a given ticket has been passed to the implementation. Since the 
+ * commands are only submitted asynchronously, the following rules 
+ * apply:
+ * <ul>
+ *   <li>
+ *     The queues, kernels and memory objects must not be released
+ *     before the commands that use them have been submitted.
+ *   </li>
+ *   <li>
+ *     Kernel argument values that are passed to 
+ *     {@link #enqueueNDRangeKernel(cl_command_queue, cl_kernel, int, 
+ *     long[], long[], long[], long[], Pointer[])} are copied when the
+ *     command is enqueued, and set by the submission thread right 
+ *     before the kernel is submitted. Without such values, the kernel
+ *     uses the arguments that are set when it is submitted, so a 
+ *     kernel that is used by several producers must either receive
+ *     its arguments with each command, or each producer must use its
+ *     own kernel object.
+ *   </li>
+ *   <li>
+ *     Transfers are always non-blocking, and only accept pointers to
+ *     direct buffers or native memory. The submission thread keeps
+ *     the pointer reachable until the transfer is complete. The 
+ *     memory must remain unmodified until then, which is ensured by
+ *     calling {@link #finish()}.
+ *   </li>
+ *   <li>
+ *     Errors can not be reported to the calling thread. They are 
+ *     counted, and each {@link #finish()} call reports the result
+ *     of the <code>clFinish</code> calls that it caused.
+ *   </li>
+ * </ul>
+ * The producers only block when the ring is full.
+ */
+public final class SubmissionThread
+{
+    static
+    {
+        CL.loadNativeLibrary();
+    }
+    
+    /**
+     * The default number of commands that the ring can hold
+     */
+    public static final int DEFAULT_CAPACITY = 4096;
+    
+    /**
+     * The submission threads, by the native pointer of their device
+     */
+    private static final Map<Long, SubmissionThread> instances = 
+        new HashMap<Long, SubmissionThread>();
+    
+    /**
+     * Returns the submission thread for the given device, creating
+     * it with the {@link #DEFAULT_CAPACITY} and without a flush
+     * interval if necessary.
+     * 
+     * @param device The device
+     * @return The submission thread
+     */
+    public static SubmissionThread obtain(cl_device_id device)
+    {
+        return obtain(device, DEFAULT_CAPACITY, 0);
+    }
+    
+    /**
+     * Returns the submission thread for the given device. If no such
+     * thread exists, it is created with the given parameters.
+     * 
+     * @param device The device
+     * @param capacity The number of commands that the ring can hold. 
+     * This will be rounded up to the next power of two.
+     * @param flushInterval The number of commands after which the
+     * queues are flushed even if there are more commands in the ring.
+     * If this is 0, the queues are only flushed when the ring is empty.
+     * @return The submission thread
+     * @throws IllegalArgumentException If the capacity is not positive,
+     * or the flush interval is negative
+     */
+    public static synchronized SubmissionThread obtain(
+        cl_device_id device, int capacity, int flushInterval)
+    {
+        if (capacity <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The capacity must be positive, but is " + capacity);
+        }
+        if (flushInterval < 0)
+        {
+            throw new IllegalArgumentException(
+                "The flush interval may not be negative: " + flushInterval);
+        }
+        Long key = device.getNativePointer();
+        SubmissionThread instance = instances.get(key);
+        if (instance == null)
+        {
+            instance = new SubmissionThread(
+                device, createNative(capacity, flushInterval));
+            instances.put(key, instance);
+        }
+        return instance;
+    }
+    
+    /**
+     * Shut down all submission threads. See {@link #shutdown()}.
+     */
+    public static synchronized void shutdownAll()
+    {
+        for (SubmissionThread instance : instances.values())
+        {
+            instance.shutdownInternal();
+        }
+        instances.clear();
+    }
+    
+    /**
+     * The device of this thread
+     */
+    private final cl_device_id device;
+    
+    /**
+     * The pointer to the native submitter, or 0 if it was shut down
+     */
+    private volatile long handle;
+    
+    /**
+     * Creates a new submission thread
+     * 
+     * @param device The device
+     * @param handle The pointer to the native submitter
+     */
+    private SubmissionThread(cl_device_id device, long handle)
+    {
+        this.device = device;
+        this.handle = handle;
+    }
+    
+    /**
+     * Returns the device of this submission thread
+     * 
+     * @return The device
+     */
+    public cl_device_id getDevice()
+    {
+        return device;
+    }
+    
+    /**
+     * Submit a command to execute the given kernel with the arguments
+     * that are set when the command is submitted. The parameters 
+     * are the same as for {@link CL#clEnqueueNDRangeKernel}, except 
+     * that there is no event wait list and no event.
+     * 
+     * @param command_queue The command queue of the device
+     * @param kernel The kernel
+     * @param work_dim The number of dimensions, 1 to 3
+     * @param global_work_offset The global work offset. May be null.
+     * @param global_work_size The global work size
+     * @param local_work_size The local work size. May be null.
+     * @return The ticket of the command
+     * @throws IllegalArgumentException If the work dimension is not
+     * in [1,3], or the arrays have fewer than work_dim elements
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long enqueueNDRangeKernel(cl_command_queue command_queue, 
+        cl_kernel kernel, int work_dim, long global_work_offset[], 
+        long global_work_size[], long local_work_size[])
+    {
+        return enqueueNDRangeKernel(command_queue, kernel, work_dim, 
+            global_work_offset, global_work_size, local_work_size, 
+            null, null);
+    }
+    
+    /**
+     * Submit a command to execute the given kernel with the given 
+     * argument values. The values are copied when this method is 
+     * called. The argument with index <code>i</code> is set with 
+     * <code>arg_sizes[i]</code> and <code>arg_values[i]</code>, as
+     * in {@link CL#clSetKernelArg}, right before the kernel is 
+     * submitted. A <code>null</code> value is used for arguments 
+     * in local memory.
+     * 
+     * @param command_queue The command queue of the device
+     * @param kernel The kernel
+     * @param work_dim The number of dimensions, 1 to 3
+     * @param global_work_offset The global work offset. May be null.
+     * @param global_work_size The global work size
+     * @param local_work_size The local work size. May be null.
+     * @param arg_sizes The sizes of the arguments. If this is null,
+     * the arguments that are set when the command is submitted are
+     * used.
+     * @param arg_values The values of the arguments
+     * @return The ticket of the command
+     * @throws IllegalArgumentException If the work dimension is not
+     * in [1,3], the arrays have fewer than work_dim elements, or the
+     * argument arrays have different lengths
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long enqueueNDRangeKernel(cl_command_queue command_queue, 
+        cl_kernel kernel, int work_dim, long global_work_offset[], 
+        long global_work_size[], long local_work_size[],
+        long arg_sizes[], Pointer arg_values[])
+    {
+        if (arg_sizes != null && 
+            (arg_values == null || arg_values.length != arg_sizes.length))
+        {
+            throw new IllegalArgumentException(
+                "The argument sizes and values must have the same length");
+        }
+        if (work_dim < 1 || work_dim > 3)
+        {
+            throw new IllegalArgumentException(
+                "The work dimension must be in [1,3], but is " + work_dim);
+        }
+        if (global_work_size == null)
+        {
+            throw new IllegalArgumentException(
+                "The global work size may not be null");
+        }
+        long offset[] = toSizes(global_work_offset, work_dim);
+        long globalSizes[] = toSizes(global_work_size, work_dim);
+        long local[] = toSizes(local_work_size, work_dim);
+        return pushNDRangeKernelNative(handle(), 
+            command_queue.getNativePointer(), kernel.getNativePointer(), 
+            work_dim, offset[0], offset[1], offset[2], 
+            globalSizes[0], globalSizes[1], globalSizes[2],
+            local[0], local[1], local[2], arg_sizes, arg_values);
+    }
+    
+    /**
+     * Submit a non-blocking command to write into the given buffer
+     * 
+     * @param command_queue The command queue of the device
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param cb The number of bytes to write
+     * @param ptr The pointer to the source data. This must be a 
+     * pointer to a direct buffer or to native memory.
+     * @return The ticket of the command
+     * @throws IllegalArgumentException If the pointer does not point
+     * to a direct buffer or native memory
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long enqueueWriteBuffer(cl_command_queue command_queue, 
+        cl_mem buffer, long offset, long cb, Pointer ptr)
+    {
+        return pushWriteBufferNative(handle(), 
+            command_queue.getNativePointer(), buffer.getNativePointer(), 
+            offset, cb, ptr);
+    }
+    
+    /**
+     * Submit a non-blocking command to read from the given buffer. The
+     * data is only available after {@link #finish()} was called.
+     * 
+     * @param command_queue The command queue of the device
+     * @param buffer The buffer
+     * @param offset The offset in the buffer, in bytes
+     * @param cb The number of bytes to read
+     * @param ptr The pointer to the target memory. This must be a 
+     * pointer to a direct buffer or to native memory.
+     * @return The ticket of the command
+     * @throws IllegalArgumentException If the pointer does not point
+     * to a direct buffer or native memory
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long enqueueReadBuffer(cl_command_queue command_queue, 
+        cl_mem buffer, long offset, long cb, Pointer ptr)
+    {
+        return pushReadBufferNative(handle(), 
+            command_queue.getNativePointer(), buffer.getNativePointer(), 
+            offset, cb, ptr);
+    }
+    
+    /**
+     * Submit a command to copy data between buffers
+     * 
+     * @param command_queue The command queue of the device
+     * @param src_buffer The source buffer
+     * @param dst_buffer The destination buffer
+     * @param src_offset The offset in the source buffer, in bytes
+     * @param dst_offset The offset in the destination buffer, in bytes
+     * @param cb The number of bytes to copy
+     * @return The ticket of the command
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long enqueueCopyBuffer(cl_command_queue command_queue, 
+        cl_mem src_buffer, cl_mem dst_buffer, 
+        long src_offset, long dst_offset, long cb)
+    {
+        return pushCopyBufferNative(handle(), 
+            command_queue.getNativePointer(), 
+            src_buffer.getNativePointer(), dst_buffer.getNativePointer(), 
+            src_offset, dst_offset, cb);
+    }
+    
+    /**
+     * Submit a command to flush the given queue
+     * 
+     * @param command_queue The command queue
+     * @return The ticket of the command
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public long flush(cl_command_queue command_queue)
+    {
+        return pushFlushNative(handle(), command_queue.getNativePointer());
+    }
+    
+    /**
+     * Wait until the command with the given ticket has been submitted
+     * to the implementation. This does not mean that the command is 
+     * complete.
+     * 
+     * @param ticket The ticket
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public void awaitSubmitted(long ticket)
+    {
+        awaitSubmittedNative(handle(), ticket);
+    }
+    
+    /**
+     * Wait until all commands that have been enqueued until now have 
+     * been submitted, and call <code>clFinish</code> for all queues 
+     * that received commands since the last call to this method.
+     * 
+     * @return The last error code that was returned by the 
+     * <code>clFinish</code> calls of this method, or 
+     * <code>CL_SUCCESS</code>
+     * @throws CLException If exceptions are enabled and clFinish
+     * returned an error
+     * @throws IllegalStateException If this thread was shut down
+     */
+    public int finish()
+    {
+        return CL.checkResult(finishNative(handle()));
+    }
+    
+    /**
+     * Returns the number of commands that have been enqueued
+     * 
+     * @return The number of commands
+     */
+    public long getEnqueuedCount()
+    {
+        return getStatistics()[0];
+    }
+    
+    /**
+     * Returns the number of commands that have been submitted
+     * 
+     * @return The number of commands
+     */
+    public long getSubmittedCount()
+    {
+        return getStatistics()[1];
+    }
+    
+    /**
+     * Returns the number of batched flushes that have been performed
+     * 
+     * @return The number of flushes
+     */
+    public long getFlushCount()
+    {
+        return getStatistics()[2];
+    }
+    
+    /**
+     * Returns the number of times that a producer had to wait because 
+     * the ring was full
+     * 
+     * @return The number of waits
+     */
+    public long getFullWaitCount()
+    {
+        return getStatistics()[3];
+    }
+    
+    /**
+     * Returns the number of commands that failed
+     * 
+     * @return The number of errors
+     */
+    public long getErrorCount()
+    {
+        return getStatistics()[4];
+    }
+    
+    /**
+     * Returns the error code of the last command that failed, or
+     * <code>CL_SUCCESS</code>
+     * 
+     * @return The last error code
+     */
+    public int getLastError()
+    {
+        return (int)getStatistics()[5];
+    }
+    
+    /**
+     * Shut down this submission thread. All commands that have been 
+     * enqueued until now are submitted, and the queues are flushed.
+     * Afterwards, the native thread is terminated, and all methods 
+     * of this instance will throw an IllegalStateException. This 
+     * method may not be called while other threads are still 
+     * enqueueing commands in this instance.
+     */
+    public void shutdown()
+    {
+        synchronized (SubmissionThread.class)
+        {
+            shutdownInternal();
+            instances.remove(device.getNativePointer());
+        }
+    }
+    
+    /**
+     * Terminate the native thread, if it was not terminated yet
+     */
+    private void shutdownInternal()
+    {
+        long h = handle;
+        if (h != 0)
+        {
+            handle = 0;
+            destroyNative(h);
+        }
+    }
+    
+    /**
+     * Returns the handle of the native submitter
+     * 
+     * @return The handle
+     * @throws IllegalStateException If this thread was shut down
+     */
+    private long handle()
+    {
+        long h = handle;
+        if (h == 0)
+        {
+            throw new IllegalStateException(
+                "The submission thread was shut down");
+        }
+        return h;
+    }
+    
+    /**
+     * Returns the statistics of this submission thread
+     * 
+     * @return The statistics
+     */
+    private long[] getStatistics()
+    {
+        long statistics[] = new long[6];
+        getStatisticsNative(handle(), statistics);
+        return statistics;
+    }
+    
+    /**
+     * Returns a 3-element array containing the first <code>n</code> 
+     * elements of the given array, padded with zeros. If the given
+     * array is null, an array of zeros is returned.
+     * 
+     * @param sizes The sizes
+     * @param n The number of elements to use
+     * @return The array
+     * @throws IllegalArgumentException If the array has fewer than 
+     * <code>n</code> elements
+     */
+    private static long[] toSizes(long sizes[], int n)
+    {
+        long result[] = new long[3];
+        if (sizes == null)
+        {
+            return result;
+        }
+        if (sizes.length < n)
+        {
+            throw new IllegalArgumentException(
+                "Expected " + n + " elements, but found " + sizes.length);
+        }
+        System.arraycopy(sizes, 0, result, 0, n);
+        return result;
+    }
+    
+    private static native long createNative(int capacity, int flushInterval);
+    private static native long pushNDRangeKernelNative(long handle, 
+        long queue, long kernel, int workDim, 
+        long offset0, long offset1, long offset2,
+        long global0, long global1, long global2,
+        long local0, long local1, long local2,
+        long argSizes[], Pointer argValues[]);
+    private static native long pushWriteBufferNative(long handle, 
+        long queue, long mem, long offset, long size, Pointer pointer);
+    private static native long pushReadBufferNative(long handle, 
+        long queue, long mem, long offset, long size, Pointer pointer);
+    private static native long pushCopyBufferNative(long handle, 
+        long queue, long srcMem, long dstMem, 
+        long srcOffset, long dstOffset, long size);
+    private static native long pushFlushNative(long handle, long queue);
+    private static native int finishNative(long handle);
+    private static native void awaitSubmittedNative(long handle, long ticket);
+    private static native void getStatisticsNative(long handle, long statistics[]);
+    private static native void destroyNative(long handle);
+}
@@ -0,0 +1,528 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Deque;
+import java.util.List;
+
+/**
+ * A linear allocator for transient device memory that is used within
+ * one iteration (<i>frame</i>) of a pipeline.<br>
+ * <br>
+ * The allocator carves regions out of one large buffer. It is used as
+ * a ring: Each {@link #allocate(long)} call advances a bump pointer, 
+ * and {@link #endFrame()} closes the current frame with an event that
+ * completes when all commands of the frame are complete. The regions 
+ * of a frame are recycled when this event completes, which is 
+ * detected with an event callback. In the steady state, allocating a
+ * region therefore does not call the OpenCL implementation at all. 
+ * Only when the buffer is full, the allocator waits for the oldest 
+ * frame to complete.<br>
+ * <br>
+ * A {@link Region} is described by the underlying buffer and an 
+ * offset, which can be passed to kernels or to the buffer transfer 
+ * functions directly. If a separate memory object is required, 
+ * {@link #allocateSubBuffer(long, long)} creates a sub-buffer for the 
+ * region, which is released when the frame is recycled.<br>
+ * <br>
+ * The regions are aligned to the <code>CL_DEVICE_MEM_BASE_ADDR_ALIGN</code> 
+ * of the device, so that sub-buffers can be created for them. 
+ * Instances of this class are not thread-safe. They are intended to 
+ * be used by the thread that enqueues the commands of the frames.
+ */
+public final class TransientAllocator
+{
+    /**
+     * A region of the buffer of a {@link TransientAllocator}
+     */
+    public static final class Region
+    {
+        /**
+         * The buffer
+         */
+        private final cl_mem buffer;
+        
+        /**
+         * The offset, in bytes
+         */
+        private final long offset;
+        
+        /**
+         * The size, in bytes
+         */
+        private final long size;
+        
+        /**
+         * Creates a new region
+         * 
+         * @param buffer The buffer
+         * @param offset The offset
+         * @param size The size
+         */
+        Region(cl_mem buffer, long offset, long size)
+        {
+            this.buffer = buffer;
+            this.offset = offset;
+            this.size = size;
+        }
+        
+        /**
+         * Returns the buffer that this region is a part of
+         * 
+         * @return The buffer
+         */
+        public cl_mem getBuffer()
+        {
+            return buffer;
+        }
+        
+        /**
+         * Returns the offset of this region in the buffer, in bytes
+         * 
+         * @return The offset
+         */
+        public long getOffset()
+        {
+            return offset;
+        }
+        
+        /**
+         * Returns the size of this region, in bytes
+         * 
+         * @return The size
+         */
+        public long getSize()
+        {
+            return size;
+        }
+        
+        @Override
+        public String toString()
+        {
+            return "Region[offset=" + offset + ",size=" + size + "]";
+        }
+    }
+    
+    /**
+     * A frame that has been closed, and is not recycled yet
+     */
+    private static final class Frame
+    {
+        /**
+         * The number of bytes of the buffer that are occupied by the
+         * frame, including alignment padding
+         */
+        private final long consumed;
+        
+        /**
+         * The sub-buffers that have been created in the frame
+         */
+        private final List<cl_mem> subBuffers;
+        
+        /**
+         * The event that completes when the frame is complete, or null
+         */
+        private final cl_event event;
+        
+        /**
+         * Whether the frame is complete
+         */
+        private volatile boolean complete;
+        
+        /**
+         * Creates a new frame
+         * 
+         * @param consumed The number of consumed bytes
+         * @param subBuffers The sub-buffers
+         * @param event The event
+         */
+        Frame(long consumed, List<cl_mem> subBuffers, cl_event event)
+        {
+            this.consumed = consumed;
+            this.subBuffers = subBuffers;
+            this.event = event;
+        }
+    }
+    
+    /**
+     * The callback that marks frames as complete
+     */
+    private static final EventCallbackFunction COMPLETION_CALLBACK = 
+        new EventCallbackFunction()
+    {
+        @Override
+        public void function(cl_event event, 
+            int command_exec_callback_type, Object user_data)
+        {
+            Frame frame = (Frame)user_data;
+            frame.complete = true;
+        }
+    };
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue commandQueue;
+    
+    /**
+     * The buffer
+     */
+    private final cl_mem buffer;
+    
+    /**
+     * The size of the buffer
+     */
+    private final long capacity;
+    
+    /**
+     * The alignment of the regions, in bytes
+     */
+    private final long alignment;
+    
+    /**
+     * The frames that have been closed and not recycled yet, oldest first
+     */
+    private final Deque<Frame> frames = new ArrayDeque<Frame>();
+    
+    /**
+     * The position after the last allocated region
+     */
+    private long tail;
+    
+    /**
+     * The number of bytes that are occupied by all frames that are not
+     * recycled yet, including the current one
+     */
+    private long usedBytes;
+    
+    /**
+     * The number of bytes that are occupied by the current frame
+     */
+    private long frameBytes;
+    
+    /**
+     * The sub-buffers that have been created in the current frame
+     */
+    private List<cl_mem> frameSubBuffers = new ArrayList<cl_mem>();
+    
+    /**
+     * The number of times that an allocation had to wait for a frame
+     */
+    private long waitCount;
+    
+    /**
+     * Creates a new allocator with a buffer of the given size, for the
+     * device of the given command queue
+     * 
+     * @param context The context
+     * @param commandQueue The command queue, which must be an in-order 
+     * queue if frames are closed with {@link #endFrame()}
+     * @param capacity The size of the buffer, in bytes
+     * @throws IllegalArgumentException If the capacity is not positive
+     * @throws CLException If the buffer can not be created
+     */
+    public TransientAllocator(cl_context context, 
+        cl_command_queue commandQueue, long capacity)
+    {
+        if (capacity <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The capacity must be positive, but is " + capacity);
+        }
+        this.commandQueue = commandQueue;
+        this.capacity = capacity;
+        
+        cl_device_id devices[] = new cl_device_id[1];
+        clGetCommandQueueInfo(commandQueue, CL_QUEUE_DEVICE, 
+            Sizeof.cl_device_id, Pointer.to(devices), null);
+        int baseAddressAlignBits[] = new int[1];
+        clGetDeviceInfo(devices[0], CL_DEVICE_MEM_BASE_ADDR_ALIGN, 
+            Sizeof.cl_uint, Pointer.to(baseAddressAlignBits), null);
+        this.alignment = Math.max(1, baseAddressAlignBits[0] / 8);
+        
+        int errorCode[] = new int[1];
+        this.buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, 
+            capacity, null, errorCode);
+        if (errorCode[0] != CL_SUCCESS)
+        {
+            throw new CLException(
+                "Could not create buffer: " + 
+                stringFor_errorCode(errorCode[0]), errorCode[0]);
+        }
+    }
+    
+    /**
+     * Allocate a region of the given size in the current frame. If the 
+     * buffer is full, this waits until the oldest frames are complete.
+     * 
+     * @param size The size, in bytes
+     * @return The region
+     * @throws IllegalArgumentException If the size is not positive, or
+     * larger than the capacity
+     * @throws IllegalStateException If the region can not be allocated
+     * because the current frame occupies too much of the buffer
+     * @throws CLException If waiting for a frame fails
+     */
+    public Region allocate(long size)
+    {
+        if (size <= 0 || size > capacity)
+        {
+            throw new IllegalArgumentException(
+                "The size must be in [1," + capacity + "], but is " + size);
+        }
+        reclaim();
+        while (true)
+        {
+            long offset = (tail + alignment - 1) / alignment * alignment;
+            long consumed = offset - tail + size;
+            if (offset + size > capacity)
+            {
+                // Skip the end of the buffer, and wrap around
+                offset = 0;
+                consumed = capacity - tail + size;
+            }
+            if (consumed <= capacity - usedBytes)
+            {
+                tail = offset + size;
+                usedBytes += consumed;
+                frameBytes += consumed;
+                return new Region(buffer, offset, size);
+            }
+            if (frames.isEmpty())
+            {
+                throw new IllegalStateException(
+                    "Could not allocate " + size + " bytes, the " + 
+                    "current frame occupies " + frameBytes + " of " + 
+                    capacity + " bytes");
+            }
+            waitForOldestFrame();
+        }
+    }
+    
+    /**
+     * Allocate a region of the given size in the current frame, and 
+     * create a sub-buffer for it. The sub-buffer is released when the 
+     * frame is recycled.
+     * 
+     * @param size The size, in bytes
+     * @param flags The memory flags for the sub-buffer, or 0 to use the
+     * flags of the underlying buffer
+     * @return The sub-buffer
+     * @throws IllegalArgumentException If the size is not positive, or
+     * larger than the capacity
+     * @throws IllegalStateException If the region can not be allocated
+     * because the current frame occupies too much of the buffer
+     * @throws CLException If the sub-buffer can not be created
+     */
+    public cl_mem allocateSubBuffer(long size, long flags)
+    {
+        Region region = allocate(size);
+        cl_buffer_region bufferRegion = 
+            new cl_buffer_region(region.getOffset(), region.getSize());
+        int errorCode[] = new int[1];
+        cl_mem subBuffer = clCreateSubBuffer(buffer, flags, 
+            CL_BUFFER_CREATE_TYPE_REGION, bufferRegion, errorCode);
+        if (errorCode[0] != CL_SUCCESS)
+        {
+            throw new CLException(
+                "Could not create sub-buffer: " + 
+                stringFor_errorCode(errorCode[0]), errorCode[0]);
+        }
+        frameSubBuffers.add(subBuffer);
+        return subBuffer;
+    }
+    
+    /**
+     * Close the current frame, by enqueueing a marker in the command 
+     * queue. The regions of the frame are recycled when all commands 
+     * that have been enqueued in the queue until now are complete.
+     * 
+     * @throws CLException If the marker can not be enqueued. The frame
+     * remains open in this case.
+     */
+    public void endFrame()
+    {
+        if (frameBytes == 0)
+        {
+            return;
+        }
+        cl_event marker = new cl_event();
+        requireSuccess(
+            clEnqueueMarkerWithWaitList(commandQueue, 0, null, marker));
+        closeFrame(marker);
+    }
+    
+    /**
+     * Close the current frame. The regions of the frame are recycled 
+     * when the given event is complete. The event is retained until 
+     * then. If the event is <code>null</code>, the caller guarantees 
+     * that the frame is already complete.
+     * 
+     * @param completion The completion event of the frame
+     */
+    public void endFrame(cl_event completion)
+    {
+        if (completion != null)
+        {
+            clRetainEvent(completion);
+        }
+        closeFrame(completion);
+    }
+    
+    /**
+     * Returns the size of the buffer
+     * 
+     * @return The capacity, in bytes
+     */
+    public long getCapacity()
+    {
+        return capacity;
+    }
+    
+    /**
+     * Returns the number of bytes that are occupied by the frames that 
+     * have not been recycled yet, including alignment padding
+     * 
+     * @return The number of used bytes
+     */
+    public long getUsedBytes()
+    {
+        return usedBytes;
+    }
+    
+    /**
+     * Returns the number of closed frames that are not recycled yet
+     * 
+     * @return The number of pending frames
+     */
+    public int getPendingFrameCount()
+    {
+        return frames.size();
+    }
+    
+    /**
+     * Returns the number of times that an allocation had to wait until
+     * a frame was complete
+     * 
+     * @return The number of waits
+     */
+    public long getWaitCount()
+    {
+        return waitCount;
+    }
+    
+    /**
+     * Close the current frame with a marker like {@link #endFrame()}, 
+     * wait until all frames are complete, and release the buffer and 
+     * all sub-buffers. The buffer is also released when waiting fails.
+     * 
+     * @throws CLException If the marker can not be enqueued, or waiting
+     * for a frame fails
+     */
+    public void release()
+    {
+        try
+        {
+            endFrame();
+            while (!frames.isEmpty())
+            {
+                waitForOldestFrame();
+            }
+        }
+        finally
+        {
+            clReleaseMemObject(buffer);
+        }
+    }
+    
+    /**
+     * Close the current frame with the given event
+     * 
+     * @param event The event, or null
+     */
+    private void closeFrame(cl_event event)
+    {
+        Frame frame = new Frame(frameBytes, frameSubBuffers, event);
+        if (event == null)
+        {
+            frame.complete = true;
+        }
+        else
+        {
+            clSetEventCallback(event, CL_COMPLETE, COMPLETION_CALLBACK, frame);
+        }
+        frames.addLast(frame);
+        frameBytes = 0;
+        frameSubBuffers = new ArrayList<cl_mem>();
+        reclaim();
+    }
+    
+    /**
+     * Recycle all frames at the head of the ring that are complete
+     */
+    private void reclaim()
+    {
+        while (!frames.isEmpty() && frames.peekFirst().complete)
+        {
+            Frame frame = frames.removeFirst();
+            usedBytes -= frame.consumed;
+            for (cl_mem subBuffer : frame.subBuffers)
+            {
+                clReleaseMemObject(subBuffer);
+            }
+            if (frame.event != null)
+            {
+                clReleaseEvent(frame.event);
+            }
+        }
+        if (usedBytes == 0)
+        {
+            tail = 0;
+        }
+    }
+    
+    /**
+     * Wait until the oldest frame is complete, and recycle it
+     * 
+     * @throws CLException If waiting for the frame fails
+     */
+    private void waitForOldestFrame()
+    {
+        Frame frame = frames.peekFirst();
+        if (!frame.complete)
+        {
+            waitCount++;
+            requireSuccess(clWaitForEvents(1, new cl_event[]{ frame.event }));
+            frame.complete = true;
+        }
+        reclaim();
+    }
+}
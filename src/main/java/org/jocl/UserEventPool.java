@@ -0,0 +1,401 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * A pool of user events that may be used as cheap gates in dependency 
+ * chains.<br>
+ * <br>
+ * User events can not be reset, so each gate requires a new event. 
+ * This pool creates the user events in batches on a background thread, 
+ * and hands them out from a lock-free queue with {@link #acquire()}. 
+ * When a gate is opened with {@link #signal(cl_event)}, the event is 
+ * completed and collected, and the collected events are released in 
+ * bulk by the background thread.<br>
+ * <br>
+ * Usage:
+ * <pre><code>
+ * UserEventPool pool = new UserEventPool(context, 256);
+ * ...
+ * cl_event gate = pool.acquire();
+ * clEnqueueNDRangeKernel(queue, kernel, 1, null, globalWorkSize, null, 
+ *     1, new cl_event[]{ gate }, null);
+ * ...
+ * pool.signal(gate);
+ * ...
+ * pool.shutdown();
+ * </code></pre>
+ * After an event has been passed to {@link #signal(cl_event)} or
+ * {@link #fail(cl_event, int)}, it is owned by the pool again, and 
+ * must no longer be used by the caller. The caller must not release 
+ * the events that are obtained from this pool.<br>
+ * <br>
+ * This class requires OpenCL 1.1. It is thread-safe.
+ */
+public final class UserEventPool
+{
+    /**
+     * The context for which the user events are created
+     */
+    private final cl_context context;
+    
+    /**
+     * The number of events that are created in one batch
+     */
+    private final int batchSize;
+    
+    /**
+     * The events that are available for {@link #acquire()}
+     */
+    private final ConcurrentLinkedQueue<cl_event> available;
+    
+    /**
+     * The number of elements in the {@link #available} queue. 
+     * (The size() method of the queue is not a constant-time operation)
+     */
+    private final AtomicInteger availableCount;
+    
+    /**
+     * The events that have been signalled and are waiting to be released
+     */
+    private final ConcurrentLinkedQueue<cl_event> retired;
+    
+    /**
+     * The number of elements in the {@link #retired} queue
+     */
+    private final AtomicInteger retiredCount;
+    
+    /**
+     * The number of events that had to be created by 
+     * {@link #acquire()} because the pool was empty
+     */
+    private final AtomicLong missCount;
+    
+    /**
+     * The total number of events that have been created
+     */
+    private final AtomicLong createdCount;
+    
+    /**
+     * The background thread that creates and releases the events
+     */
+    private final Thread thread;
+    
+    /**
+     * Whether {@link #shutdown()} has been called
+     */
+    private volatile boolean shutdown;
+    
+    /**
+     * Creates a new pool for user events in the given context. The 
+     * given batch size is the number of events that are created at 
+     * once. A new batch will be created when less than half of the 
+     * batch size is available. The signalled events will be released 
+     * when at least half of the batch size has been collected.
+     * 
+     * @param context The context
+     * @param batchSize The batch size
+     * @throws IllegalArgumentException If the batch size is not positive
+     */
+    public UserEventPool(cl_context context, int batchSize)
+    {
+        if (batchSize <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The batch size must be positive, but is " + batchSize);
+        }
+        this.context = context;
+        this.batchSize = batchSize;
+        this.available = new ConcurrentLinkedQueue<cl_event>();
+        this.availableCount = new AtomicInteger();
+        this.retired = new ConcurrentLinkedQueue<cl_event>();
+        this.retiredCount = new AtomicInteger();
+        this.missCount = new AtomicLong();
+        this.createdCount = new AtomicLong();
+        
+        // Create the first batch synchronously, so that the 
+        // pool is already filled when it is used first
+        createBatch();
+        
+        this.thread = new Thread(new Runnable()
+        {
+            @Override
+            public void run()
+            {
+                runMaintenance();
+            }
+        }, "UserEventPoolThread");
+        this.thread.setDaemon(true);
+        this.thread.start();
+    }
+    
+    /**
+     * Obtain a user event with the execution status CL_SUBMITTED. 
+     * If the pool is empty, the event will be created directly.
+     * 
+     * @return The user event
+     * @throws IllegalStateException If the pool has been shut down
+     */
+    public cl_event acquire()
+    {
+        if (shutdown)
+        {
+            throw new IllegalStateException(
+                "The pool has already been shut down");
+        }
+        cl_event event = available.poll();
+        if (event == null)
+        {
+            missCount.incrementAndGet();
+            createdCount.incrementAndGet();
+            LockSupport.unpark(thread);
+            return clCreateUserEvent(context, null);
+        }
+        int remaining = availableCount.decrementAndGet();
+        if (remaining <= batchSize / 2)
+        {
+            LockSupport.unpark(thread);
+        }
+        return event;
+    }
+    
+    /**
+     * Open the given gate: The execution status of the given event is 
+     * set to CL_COMPLETE, and the event is returned to the pool, to be
+     * released later.
+     * 
+     * @param event The event that was obtained from {@link #acquire()}
+     */
+    public void signal(cl_event event)
+    {
+        finish(event, CL_COMPLETE);
+    }
+    
+    /**
+     * Set the execution status of the given event to the given (negative)
+     * error code, so that all commands that are waiting for it are 
+     * terminated, and return the event to the pool, to be released 
+     * later.
+     * 
+     * @param event The event that was obtained from {@link #acquire()}
+     * @param errorCode The error code, which must be negative
+     * @throws IllegalArgumentException If the error code is not negative
+     */
+    public void fail(cl_event event, int errorCode)
+    {
+        if (errorCode >= 0)
+        {
+            throw new IllegalArgumentException(
+                "The error code must be negative, but is " + errorCode);
+        }
+        finish(event, errorCode);
+    }
+    
+    /**
+     * Returns the number of events that are currently available
+     * 
+     * @return The number of available events
+     */
+    public int getAvailableCount()
+    {
+        return availableCount.get();
+    }
+    
+    /**
+     * Returns the number of events that had to be created directly 
+     * in {@link #acquire()}, because the pool was empty. If this 
+     * number is large, the batch size should be increased.
+     * 
+     * @return The number of misses
+     */
+    public long getMissCount()
+    {
+        return missCount.get();
+    }
+
+    /**
+     * Returns the total number of events that have been created 
+     * by this pool
+     * 
+     * @return The number of created events
+     */
+    public long getCreatedCount()
+    {
+        return createdCount.get();
+    }
+    
+    /**
+     * Shut down this pool. The background thread is stopped, and all 
+     * events that are available or waiting to be released are 
+     * released. Events that are still in use are not affected, and 
+     * may still be passed to {@link #signal(cl_event)} or 
+     * {@link #fail(cl_event, int)}, which will then release them 
+     * directly.
+     */
+    public void shutdown()
+    {
+        if (shutdown)
+        {
+            return;
+        }
+        shutdown = true;
+        LockSupport.unpark(thread);
+        boolean interrupted = false;
+        while (thread.isAlive())
+        {
+            try
+            {
+                thread.join();
+            }
+            catch (InterruptedException e)
+            {
+                interrupted = true;
+            }
+        }
+        if (interrupted)
+        {
+            Thread.currentThread().interrupt();
+        }
+        releaseAll(available, availableCount);
+        releaseAll(retired, retiredCount);
+    }
+    
+    /**
+     * Set the execution status of the given event, and add it to the
+     * events that are waiting to be released
+     * 
+     * @param event The event
+     * @param executionStatus The execution status
+     */
+    private void finish(cl_event event, int executionStatus)
+    {
+        clSetUserEventStatus(event, executionStatus);
+        if (shutdown)
+        {
+            clReleaseEvent(event);
+            return;
+        }
+        retired.add(event);
+        int count = retiredCount.incrementAndGet();
+        if (count >= batchSize / 2)
+        {
+            LockSupport.unpark(thread);
+        }
+    }
+    
+    /**
+     * The method that is executed by the background thread: It creates
+     * new batches of events when the number of available events becomes
+     * low, and releases the retired events in bulk.
+     */
+    private void runMaintenance()
+    {
+        while (!shutdown)
+        {
+            if (retiredCount.get() > 0)
+            {
+                releaseAll(retired, retiredCount);
+            }
+            if (availableCount.get() <= batchSize / 2)
+            {
+                if (createBatch() > 0)
+                {
+                    continue;
+                }
+            }
+            // Wait until acquire() or finish() signal that there is
+            // something to do. The timeout makes sure that retired 
+            // events are released eventually.
+            LockSupport.parkNanos(this, 100000000L);
+        }
+    }
+    
+    /**
+     * Create a batch of user events with a single native call, and add 
+     * them to the available events. Errors are not reported here: When
+     * the pool is empty, {@link #acquire()} will try to create the 
+     * event directly, and report the error.
+     * 
+     * @return The number of events that have been created
+     */
+    private int createBatch()
+    {
+        cl_event events[] = new cl_event[batchSize];
+        for (int i = 0; i < batchSize; i++)
+        {
+            events[i] = new cl_event();
+        }
+        int errcode_ret[] = new int[1];
+        int created = createUserEventsNative(context, events, errcode_ret);
+        for (int i = 0; i < created; i++)
+        {
+            available.add(events[i]);
+        }
+        availableCount.addAndGet(created);
+        createdCount.addAndGet(created);
+        return created;
+    }
+    
+    /**
+     * Remove all events from the given queue, and release them with
+     * a single native call
+     * 
+     * @param queue The queue
+     * @param count The counter for the number of elements in the queue
+     */
+    private static void releaseAll(
+        ConcurrentLinkedQueue<cl_event> queue, AtomicInteger count)
+    {
+        int n = count.get();
+        if (n <= 0)
+        {
+            return;
+        }
+        cl_event events[] = new cl_event[n];
+        int removed = 0;
+        while (removed < n)
+        {
+            cl_event event = queue.poll();
+            if (event == null)
+            {
+                break;
+            }
+            events[removed] = event;
+            removed++;
+        }
+        count.addAndGet(-removed);
+        releaseEventsNative(events, removed);
+    }
+}
@@ -0,0 +1,744 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+package org.jocl;
+
+import static org.jocl.CL.*;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * A class that combines many small updates of buffers into few 
+ * commands.<br>
+ * <br>
+ * Instead of calling <code>clEnqueueWriteBuffer</code> for each small
+ * update, the updates are appended to a pinned staging buffer (created
+ * with <code>CL_MEM_ALLOC_HOST_PTR</code>), which stays mapped while 
+ * the updates are collected, together with records of their target 
+ * buffer, offset and size. When the updates are {@link #flush() 
+ * flushed}, they are coalesced: For each target buffer, overlapping 
+ * and adjacent updates are merged into contiguous runs, where later 
+ * updates overwrite earlier ones. Runs that consist of a single update
+ * are applied directly from where the update was appended. Only merged
+ * runs are packed into a separate region of the same staging buffer.
+ * After the staging buffer is unmapped, the runs are applied to each
+ * target buffer either with one <code>clEnqueueCopyBuffer</code> per 
+ * run, or, when there are many runs for one target, with a single 
+ * launch of a scatter kernel.<br>
+ * <br>
+ * Two pinned staging buffers are used alternately: The buffer for the
+ * next flush is only mapped with the first update after a flush. Note
+ * that this blocking map is enqueued in the same in-order queue as the
+ * commands of the previous flush, so it still waits until these 
+ * commands are complete.<br>
+ * <br>
+ * Updates only become visible in the target buffers after a flush. 
+ * The commands of a flush are enqueued in the command queue of this 
+ * instance, so later commands in this (in-order) queue see the 
+ * updates. Updates that are larger than a quarter of the staging 
+ * capacity are written directly, after flushing the pending updates.
+ * <br>
+ * A failing OpenCL call causes a CLException, regardless of whether
+ * exceptions are enabled with {@link CL#setExceptionsEnabled(boolean)}.
+ * When a flush fails, the pending updates are kept, so that the flush
+ * may be retried.<br>
+ * <br>
+ * Instances of this class are not thread-safe.
+ */
+public final class WriteCombiner
+{
+    /**
+     * The default number of runs for one target buffer from which on
+     * the scatter kernel is used
+     */
+    public static final int DEFAULT_SCATTER_THRESHOLD = 8;
+    
+    /**
+     * The source code of the scatter kernel. Each work-group copies 
+     * one run. The records are (source offset, target offset, size) 
+     * triples that are stored in the staging buffer.
+     */
+    private static final String SCATTER_SOURCE = 
+        "__kernel void scatter(\n" +
+        "    __global const uchar *staging, __global uchar *target,\n" +
+        "    ulong recordsOffset, int count)\n" +
+        "{\n" +
+        "    int r = get_group_id(0);\n" +
+        "    if (r >= count) return;\n" +
+        "    __global const ulong *records = \n" +
+        "        (__global const ulong*)(staging + recordsOffset);\n" +
+        "    ulong source = records[3 * r + 0];\n" +
+        "    ulong offset = records[3 * r + 1];\n" +
+        "    ulong size = records[3 * r + 2];\n" +
+        "    for (ulong i = get_local_id(0); i < size; i += get_local_size(0))\n" +
+        "    {\n" +
+        "        target[offset + i] = staging[source + i];\n" +
+        "    }\n" +
+        "}\n";
+    
+    /**
+     * The local work size of the scatter kernel
+     */
+    private static final int SCATTER_LOCAL_SIZE = 64;
+    
+    /**
+     * The size of one record in the staging buffer, in bytes
+     */
+    private static final int RECORD_SIZE = 3 * Sizeof.cl_ulong;
+    
+    /**
+     * A contiguous range of a target buffer that is written in a flush
+     */
+    private static final class Run
+    {
+        /**
+         * The start and end offset in the target buffer
+         */
+        private long start;
+        private long end;
+        
+        /**
+         * The number of updates that have been merged into this run
+         */
+        private int updates;
+        
+        /**
+         * The offset of the data in the pinned staging buffer
+         */
+        private long stagingOffset;
+    }
+    
+    /**
+     * The context
+     */
+    private final cl_context context;
+    
+    /**
+     * The command queue
+     */
+    private final cl_command_queue commandQueue;
+    
+    /**
+     * The capacity of the staging area, in bytes
+     */
+    private final int capacity;
+    
+    /**
+     * The maximum number of pending updates
+     */
+    private final int maxUpdates;
+    
+    /**
+     * The number of runs for one target buffer from which on the 
+     * scatter kernel is used, or 0 if it should never be used
+     */
+    private final int scatterThreshold;
+    
+    /**
+     * The records of the pending updates. The positions refer to the
+     * data area of the current pinned staging buffer.
+     */
+    private final cl_mem targets[];
+    private final long offsets[];
+    private final int positions[];
+    private final int sizes[];
+    private int updateCount;
+    private int dataPosition;
+    
+    /**
+     * The pinned staging buffers, which are used alternately. Each 
+     * consists of the data area that the updates are appended to, the
+     * area that merged runs are packed into (both with the capacity 
+     * as their size), and the records for the scatter kernel.
+     */
+    private final cl_mem pinnedStaging[] = new cl_mem[2];
+    private final long pinnedSize;
+    private int pinnedIndex;
+    
+    /**
+     * The mapped memory of the current pinned staging buffer, or null
+     * if it is not mapped
+     */
+    private ByteBuffer mapped;
+    
+    /**
+     * The program and kernel for scattering, created on demand. The
+     * kernel is null if the program could not be built.
+     */
+    private cl_program scatterProgram;
+    private cl_kernel scatterKernel;
+    private boolean scatterUnavailable;
+    
+    /**
+     * The statistics
+     */
+    private long totalUpdates;
+    private long totalFlushes;
+    private long totalCommands;
+    
+    /**
+     * Creates a new write combiner with the default scatter threshold
+     * 
+     * @param context The context
+     * @param commandQueue The command queue
+     * @param capacity The capacity of the staging area, in bytes
+     * @param maxUpdates The maximum number of pending updates
+     * @throws IllegalArgumentException If the capacity or maximum 
+     * number of updates is not positive
+     * @throws CLException If the staging buffers can not be created
+     */
+    public WriteCombiner(cl_context context, cl_command_queue commandQueue, 
+        int capacity, int maxUpdates)
+    {
+        this(context, commandQueue, capacity, maxUpdates, 
+            DEFAULT_SCATTER_THRESHOLD);
+    }
+    
+    /**
+     * Creates a new write combiner
+     * 
+     * @param context The context
+     * @param commandQueue The command queue
+     * @param capacity The capacity of the staging area, in bytes
+     * @param maxUpdates The maximum number of pending updates
+     * @param scatterThreshold The number of runs for one target buffer
+     * from which on a scatter kernel is used instead of individual 
+     * copies, or 0 if only copies should be used
+     * @throws IllegalArgumentException If the capacity or maximum 
+     * number of updates is not positive, or the threshold is negative
+     * @throws CLException If the staging buffers can not be created
+     */
+    public WriteCombiner(cl_context context, cl_command_queue commandQueue, 
+        int capacity, int maxUpdates, int scatterThreshold)
+    {
+        if (capacity <= 0 || maxUpdates <= 0)
+        {
+            throw new IllegalArgumentException(
+                "The capacity and maximum number of updates must be positive");
+        }
+        if (scatterThreshold < 0)
+        {
+            throw new IllegalArgumentException(
+                "The scatter threshold may not be negative: " + 
+                scatterThreshold);
+        }
+        this.context = context;
+        this.commandQueue = commandQueue;
+        this.capacity = capacity;
+        this.maxUpdates = maxUpdates;
+        this.scatterThreshold = scatterThreshold;
+        this.targets = new cl_mem[maxUpdates];
+        this.offsets = new long[maxUpdates];
+        this.positions = new int[maxUpdates];
+        this.sizes = new int[maxUpdates];
+        this.pinnedSize = alignRecords(2L * capacity) + 
+            (long)maxUpdates * RECORD_SIZE;
+        
+        int errorCode[] = new int[1];
+        try
+        {
+            for (int i = 0; i < pinnedStaging.length; i++)
+            {
+                pinnedStaging[i] = clCreateBuffer(context, 
+                    CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, 
+                    pinnedSize, null, errorCode);
+                requireSuccess(errorCode[0]);
+            }
+        }
+        catch (RuntimeException e)
+        {
+            for (cl_mem pinned : pinnedStaging)
+            {
+                if (pinned != null)
+                {
+                    clReleaseMemObject(pinned);
+                }
+            }
+            throw e;
+        }
+    }
+    
+    /**
+     * Append an update of the given buffer with the remaining bytes of
+     * the given data. The position of the data is not modified.
+     * 
+     * @param buffer The target buffer
+     * @param offset The offset in the target buffer, in bytes
+     * @param data The data
+     * @throws CLException If the staging buffer can not be mapped, or 
+     * a flush is necessary and fails
+     */
+    public void update(cl_mem buffer, long offset, ByteBuffer data)
+    {
+        int size = data.remaining();
+        if (size == 0)
+        {
+            return;
+        }
+        totalUpdates++;
+        if (size > capacity / 4)
+        {
+            flush();
+            requireSuccess(clEnqueueWriteBuffer(commandQueue, buffer, 
+                CL_TRUE, offset, size, Pointer.toBuffer(data), 
+                0, null, null));
+            totalCommands++;
+            return;
+        }
+        if (updateCount == maxUpdates || capacity - dataPosition < size)
+        {
+            flush();
+        }
+        ensureMapped();
+        ByteBuffer target = mapped.duplicate();
+        target.position(dataPosition);
+        target.put(data.duplicate());
+        targets[updateCount] = buffer;
+        offsets[updateCount] = offset;
+        positions[updateCount] = dataPosition;
+        sizes[updateCount] = size;
+        updateCount++;
+        dataPosition += size;
+    }
+    
+    /**
+     * Append an update of the given buffer with the given values
+     * 
+     * @param buffer The target buffer
+     * @param offset The offset in the target buffer, in bytes
+     * @param values The values
+     * @throws CLException If the staging buffer can not be mapped, or 
+     * a flush is necessary and fails
+     */
+    public void update(cl_mem buffer, long offset, float values[])
+    {
+        ByteBuffer data = ByteBuffer.allocate(values.length * Sizeof.cl_float)
+            .order(ByteOrder.nativeOrder());
+        data.asFloatBuffer().put(values);
+        update(buffer, offset, data);
+    }
+    
+    /**
+     * Append an update of the given buffer with the given values
+     * 
+     * @param buffer The target buffer
+     * @param offset The offset in the target buffer, in bytes
+     * @param values The values
+     * @throws CLException If the staging buffer can not be mapped, or 
+     * a flush is necessary and fails
+     */
+    public void update(cl_mem buffer, long offset, int values[])
+    {
+        ByteBuffer data = ByteBuffer.allocate(values.length * Sizeof.cl_int)
+            .order(ByteOrder.nativeOrder());
+        data.asIntBuffer().put(values);
+        update(buffer, offset, data);
+    }
+    
+    /**
+     * Returns the number of updates that are pending
+     * 
+     * @return The number of pending updates
+     */
+    public int getPendingUpdateCount()
+    {
+        return updateCount;
+    }
+    
+    /**
+     * Returns the total number of updates
+     * 
+     * @return The number of updates
+     */
+    public long getUpdateCount()
+    {
+        return totalUpdates;
+    }
+    
+    /**
+     * Returns the number of flushes that applied pending updates
+     * 
+     * @return The number of flushes
+     */
+    public long getFlushCount()
+    {
+        return totalFlushes;
+    }
+    
+    /**
+     * Returns the number of commands that have been enqueued for 
+     * applying the updates, including the unmapping of the staging 
+     * buffer
+     * 
+     * @return The number of commands
+     */
+    public long getCommandCount()
+    {
+        return totalCommands;
+    }
+    
+    /**
+     * Apply all pending updates. If this fails, the pending updates 
+     * are kept, and a later flush will try to apply them again.
+     * 
+     * @throws CLException If an OpenCL operation fails
+     */
+    public void flush()
+    {
+        if (updateCount == 0)
+        {
+            return;
+        }
+        
+        // Group the updates by their target buffer
+        Map<Long, List<Integer>> groups = 
+            new LinkedHashMap<Long, List<Integer>>();
+        for (int i = 0; i < updateCount; i++)
+        {
+            Long key = targets[i].getNativePointer();
+            List<Integer> group = groups.get(key);
+            if (group == null)
+            {
+                group = new ArrayList<Integer>();
+                groups.put(key, group);
+            }
+            group.add(i);
+        }
+        
+        // Compute the runs for each target buffer. Runs of a single 
+        // update are applied from the data area, merged runs from 
+        // the packing area
+        List<List<Run>> allRuns = new ArrayList<List<Run>>();
+        long packedSize = 0;
+        int totalRuns = 0;
+        for (List<Integer> group : groups.values())
+        {
+            List<Run> runs = computeRuns(group);
+            for (Run run : runs)
+            {
+                if (run.updates > 1)
+                {
+                    run.stagingOffset = capacity + packedSize;
+                    packedSize += run.end - run.start;
+                }
+            }
+            totalRuns += runs.size();
+            allRuns.add(runs);
+        }
+        long recordsOffset = alignRecords(2L * capacity);
+        
+        // Pack the merged runs and write the records. The buffer is 
+        // no longer mapped here if a previous flush failed after 
+        // unmapping it, and is mapped again while keeping the data
+        ensureMapped();
+        int groupIndex = 0;
+        for (List<Integer> group : groups.values())
+        {
+            List<Run> runs = allRuns.get(groupIndex++);
+            for (int i : group)
+            {
+                Run run = findRun(runs, offsets[i]);
+                if (run.updates == 1)
+                {
+                    run.stagingOffset = positions[i];
+                    continue;
+                }
+                ByteBuffer source = mapped.duplicate();
+                source.limit(positions[i] + sizes[i]);
+                source.position(positions[i]);
+                ByteBuffer target = mapped.duplicate();
+                target.position(
+                    (int)(run.stagingOffset + offsets[i] - run.start));
+                target.put(source);
+            }
+        }
+        int recordIndex = 0;
+        for (List<Run> runs : allRuns)
+        {
+            for (Run run : runs)
+            {
+                int position = (int)(recordsOffset + recordIndex * RECORD_SIZE);
+                mapped.putLong(position, run.stagingOffset);
+                mapped.putLong(position + Sizeof.cl_ulong, run.start);
+                mapped.putLong(position + 2 * Sizeof.cl_ulong, 
+                    run.end - run.start);
+                recordIndex++;
+            }
+        }
+        cl_mem pinned = pinnedStaging[pinnedIndex];
+        requireSuccess(clEnqueueUnmapMemObject(commandQueue, pinned, mapped, 
+            0, null, null));
+        mapped = null;
+        totalCommands++;
+        
+        // Apply the runs to the target buffers
+        recordIndex = 0;
+        groupIndex = 0;
+        for (List<Integer> group : groups.values())
+        {
+            cl_mem target = targets[group.get(0)];
+            List<Run> runs = allRuns.get(groupIndex++);
+            if (scatterThreshold > 0 && runs.size() >= scatterThreshold && 
+                obtainScatterKernel() != null)
+            {
+                scatter(pinned, target, 
+                    recordsOffset + (long)recordIndex * RECORD_SIZE, 
+                    runs.size());
+            }
+            else
+            {
+                for (Run run : runs)
+                {
+                    requireSuccess(clEnqueueCopyBuffer(commandQueue, pinned, 
+                        target, run.stagingOffset, run.start, 
+                        run.end - run.start, 0, null, null));
+                    totalCommands++;
+                }
+            }
+            recordIndex += runs.size();
+        }
+        
+        Arrays.fill(targets, 0, updateCount, null);
+        updateCount = 0;
+        dataPosition = 0;
+        pinnedIndex = (pinnedIndex + 1) % pinnedStaging.length;
+        totalFlushes++;
+    }
+    
+    /**
+     * Flush all pending updates, and release the staging buffers and
+     * the scatter kernel. The target buffers are not released. The 
+     * resources are also released when the flush fails.
+     * 
+     * @throws CLException If the flush fails
+     */
+    public void release()
+    {
+        try
+        {
+            flush();
+        }
+        finally
+        {
+            if (mapped != null)
+            {
+                clEnqueueUnmapMemObject(commandQueue, 
+                    pinnedStaging[pinnedIndex], mapped, 0, null, null);
+                mapped = null;
+            }
+            clFinish(commandQueue);
+            for (cl_mem pinned : pinnedStaging)
+            {
+                clReleaseMemObject(pinned);
+            }
+            if (scatterKernel != null)
+            {
+                clReleaseKernel(scatterKernel);
+            }
+            if (scatterProgram != null)
+            {
+                clReleaseProgram(scatterProgram);
+            }
+        }
+    }
+    
+    /**
+     * Map the current pinned staging buffer, if it is not mapped yet.
+     * When there are pending updates (because a flush failed after 
+     * unmapping it), their data is kept. Otherwise, the previous 
+     * contents are invalidated.
+     * 
+     * @throws CLException If the buffer can not be mapped
+     */
+    private void ensureMapped()
+    {
+        if (mapped != null)
+        {
+            return;
+        }
+        long flags = updateCount > 0 ? 
+            CL_MAP_READ | CL_MAP_WRITE : CL_MAP_WRITE_INVALIDATE_REGION;
+        int errorCode[] = new int[1];
+        ByteBuffer buffer = clEnqueueMapBuffer(commandQueue, 
+            pinnedStaging[pinnedIndex], CL_TRUE, flags, 0, pinnedSize, 
+            0, null, null, errorCode);
+        requireSuccess(errorCode[0]);
+        mapped = buffer.order(ByteOrder.nativeOrder());
+    }
+    
+    /**
+     * Compute the runs for the given updates of one target buffer, 
+     * sorted by their start offset
+     * 
+     * @param group The indices of the updates
+     * @return The runs
+     */
+    private List<Run> computeRuns(List<Integer> group)
+    {
+        Integer sorted[] = group.toArray(new Integer[group.size()]);
+        Arrays.sort(sorted, new Comparator<Integer>()
+        {
+            @Override
+            public int compare(Integer i0, Integer i1)
+            {
+                long o0 = offsets[i0];
+                long o1 = offsets[i1];
+                return o0 < o1 ? -1 : (o0 > o1 ? 1 : 0);
+            }
+        });
+        List<Run> runs = new ArrayList<Run>();
+        Run current = null;
+        for (int i : sorted)
+        {
+            long start = offsets[i];
+            long end = start + sizes[i];
+            if (current != null && start <= current.end)
+            {
+                current.end = Math.max(current.end, end);
+                current.updates++;
+            }
+            else
+            {
+                current = new Run();
+                current.start = start;
+                current.end = end;
+                current.updates = 1;
+                runs.add(current);
+            }
+        }
+        return runs;
+    }
+    
+    /**
+     * Returns the run that contains the given offset, from the given
+     * list of runs that is sorted by the start offset
+     * 
+     * @param runs The runs
+     * @param offset The offset
+     * @return The run
+     */
+    private static Run findRun(List<Run> runs, long offset)
+    {
+        int low = 0;
+        int high = runs.size() - 1;
+        while (low < high)
+        {
+            int mid = (low + high + 1) >>> 1;
+            if (runs.get(mid).start <= offset)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+        return runs.get(low);
+    }
+    
+    /**
+     * Enqueue the scatter kernel for the given records
+     * 
+     * @param pinned The staging buffer
+     * @param target The target buffer
+     * @param recordsOffset The offset of the first record
+     * @param count The number of records
+     */
+    private void scatter(cl_mem pinned, cl_mem target, 
+        long recordsOffset, int count)
+    {
+        requireSuccess(clSetKernelArg(scatterKernel, 0, Sizeof.cl_mem, 
+            Pointer.to(pinned)));
+        requireSuccess(clSetKernelArg(scatterKernel, 1, Sizeof.cl_mem, 
+            Pointer.to(target)));
+        requireSuccess(clSetKernelArg(scatterKernel, 2, Sizeof.cl_ulong, 
+            Pointer.to(new long[]{ recordsOffset })));
+        requireSuccess(clSetKernelArg(scatterKernel, 3, Sizeof.cl_int, 
+            Pointer.to(new int[]{ count })));
+        requireSuccess(clEnqueueNDRangeKernel(commandQueue, scatterKernel, 1, 
+            null, new long[]{ (long)count * SCATTER_LOCAL_SIZE }, 
+            new long[]{ SCATTER_LOCAL_SIZE }, 0, null, null));
+        totalCommands++;
+    }
+    
+    /**
+     * Returns the scatter kernel, building it if necessary. Returns 
+     * null if the program can not be built.
+     * 
+     * @return The scatter kernel
+     */
+    private cl_kernel obtainScatterKernel()
+    {
+        if (scatterKernel != null || scatterUnavailable)
+        {
+            return scatterKernel;
+        }
+        // The fallback to copies does not depend on exceptions being
+        // enabled, so the error codes are checked explicitly here
+        try
+        {
+            int errorCode[] = new int[1];
+            scatterProgram = clCreateProgramWithSource(context, 1, 
+                new String[]{ SCATTER_SOURCE }, null, errorCode);
+            if (errorCode[0] == CL_SUCCESS && 
+                clBuildProgram(scatterProgram, 0, null, null, null, null) 
+                    == CL_SUCCESS)
+            {
+                scatterKernel = 
+                    clCreateKernel(scatterProgram, "scatter", errorCode);
+            }
+            if (errorCode[0] != CL_SUCCESS)
+            {
+                scatterKernel = null;
+            }
+        }
+        catch (CLException e)
+        {
+            scatterKernel = null;
+        }
+        scatterUnavailable = scatterKernel == null;
+        return scatterKernel;
+    }
+    
+    /**
+     * Returns the given offset, aligned to the size of a record element
+     * 
+     * @param offset The offset
+     * @return The aligned offset
+     */
+    private static long alignRecords(long offset)
+    {
+        long alignment = Sizeof.cl_ulong;
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
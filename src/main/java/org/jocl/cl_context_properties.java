@@ -50,6 +50,19 @@ public final class cl_context_properties extends cl_abstract_properties
         addProperty(id, value.getNativePointer());
     }
     
+    /**
+     * Add the specified property to these properties. This is 
+     * intended for the <code>CL_PRINTF_CALLBACK_ARM</code> property,
+     * see {@link PrintfBuffer}.
+     * 
+     * @param id The property ID
+     * @param value The property value
+     */
+    public void addProperty(long id, PrintfBuffer value)
+    {
+        addProperty(id, value.getNativePointer());
+    }
+    
     @Override
     protected String propertyString(long value)
     {
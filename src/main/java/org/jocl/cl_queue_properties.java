@@ -50,6 +50,14 @@ public final class cl_queue_properties extends cl_abstract_properties
         {
             return "CL_QUEUE_SIZE";
         }
+        if (value == CL.CL_QUEUE_PRIORITY_KHR)
+        {
+            return "CL_QUEUE_PRIORITY_KHR";
+        }
+        if (value == CL.CL_QUEUE_THROTTLE_KHR)
+        {
+            return "CL_QUEUE_THROTTLE_KHR";
+        }
         return "(unknown)";
     }
     
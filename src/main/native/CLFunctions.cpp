@@ -87,6 +87,7 @@ clSetKernelExecInfoFunctionPointerType clSetKernelExecInfoFP = NULL;
 clGetKernelInfoFunctionPointerType clGetKernelInfoFP = NULL;
 clGetKernelArgInfoFunctionPointerType clGetKernelArgInfoFP = NULL;
 clGetKernelWorkGroupInfoFunctionPointerType clGetKernelWorkGroupInfoFP = NULL;
+clGetKernelSubGroupInfoFunctionPointerType clGetKernelSubGroupInfoFP = NULL;
 clWaitForEventsFunctionPointerType clWaitForEventsFP = NULL;
 clGetEventInfoFunctionPointerType clGetEventInfoFP = NULL;
 clCreateUserEventFunctionPointerType clCreateUserEventFP = NULL;
@@ -143,6 +144,7 @@ clGetGLObjectInfoFunctionPointerType clGetGLObjectInfoFP = NULL;
 clGetGLTextureInfoFunctionPointerType clGetGLTextureInfoFP = NULL;
 clEnqueueAcquireGLObjectsFunctionPointerType clEnqueueAcquireGLObjectsFP = NULL;
 clEnqueueReleaseGLObjectsFunctionPointerType clEnqueueReleaseGLObjectsFP = NULL;
+clCreateEventFromGLsyncKHRFunctionPointerType clCreateEventFromGLsyncKHRFP = NULL;
 clCreateFromGLTexture2DFunctionPointerType clCreateFromGLTexture2DFP = NULL;
 clCreateFromGLTexture3DFunctionPointerType clCreateFromGLTexture3DFP = NULL;
 
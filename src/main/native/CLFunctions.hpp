@@ -388,6 +388,18 @@ typedef CL_API_ENTRY cl_int (CL_API_CALL
                          void *                     /* param_value */,
                          size_t *                   /* param_value_size_ret */) CL_API_SUFFIX__VERSION_1_0;
 
+/* The same type is used for clGetKernelSubGroupInfoKHR of the 
+   cl_khr_subgroups extension, which is obtained per platform */
+typedef CL_API_ENTRY cl_int (CL_API_CALL
+*clGetKernelSubGroupInfoFunctionPointerType)(cl_kernel    /* kernel */,
+                         cl_device_id  /* device */,
+                         cl_uint       /* param_name */,
+                         size_t        /* input_value_size */,
+                         const void *  /* input_value */,
+                         size_t        /* param_value_size */,
+                         void *        /* param_value */,
+                         size_t *      /* param_value_size_ret */) CL_API_SUFFIX__VERSION_2_1;
+
 /* Event Object APIs */
 typedef CL_API_ENTRY cl_int (CL_API_CALL
 *clWaitForEventsFunctionPointerType)(cl_uint             /* num_events */,
@@ -873,6 +885,22 @@ typedef CL_API_ENTRY cl_int (CL_API_CALL
                           const cl_event *      /* event_wait_list */,
                           cl_event *            /* event */) CL_API_SUFFIX__VERSION_1_0;
 
+/* cl_khr_gl_event */
+typedef CL_API_ENTRY cl_event (CL_API_CALL
+*clCreateEventFromGLsyncKHRFunctionPointerType)(cl_context /* context */,
+                           cl_GLsync  /* cl_GLsync */,
+                           cl_int *   /* errcode_ret */) CL_API_SUFFIX__VERSION_1_1;
+
+/* cl_khr_suggested_local_work_size. This function is obtained per 
+   platform, via clGetExtensionFunctionAddressForPlatform */
+typedef CL_API_ENTRY cl_int (CL_API_CALL
+*clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType)(cl_command_queue /* command_queue */,
+                           cl_kernel        /* kernel */,
+                           cl_uint          /* work_dim */,
+                           const size_t *   /* global_work_offset */,
+                           const size_t *   /* global_work_size */,
+                           size_t *         /* suggested_local_work_size */) CL_API_SUFFIX__VERSION_1_0;
+
 
 /* Deprecated OpenCL 1.1 APIs */
 typedef CL_API_ENTRY CL_EXT_PREFIX__VERSION_1_1_DEPRECATED cl_mem (CL_API_CALL
@@ -958,6 +986,7 @@ extern clSetKernelExecInfoFunctionPointerType clSetKernelExecInfoFP;
 extern clGetKernelInfoFunctionPointerType clGetKernelInfoFP;
 extern clGetKernelArgInfoFunctionPointerType clGetKernelArgInfoFP;
 extern clGetKernelWorkGroupInfoFunctionPointerType clGetKernelWorkGroupInfoFP;
+extern clGetKernelSubGroupInfoFunctionPointerType clGetKernelSubGroupInfoFP;
 extern clWaitForEventsFunctionPointerType clWaitForEventsFP;
 extern clGetEventInfoFunctionPointerType clGetEventInfoFP;
 extern clCreateUserEventFunctionPointerType clCreateUserEventFP;
@@ -1014,6 +1043,7 @@ extern clGetGLObjectInfoFunctionPointerType clGetGLObjectInfoFP;
 extern clGetGLTextureInfoFunctionPointerType clGetGLTextureInfoFP;
 extern clEnqueueAcquireGLObjectsFunctionPointerType clEnqueueAcquireGLObjectsFP;
 extern clEnqueueReleaseGLObjectsFunctionPointerType clEnqueueReleaseGLObjectsFP;
+extern clCreateEventFromGLsyncKHRFunctionPointerType clCreateEventFromGLsyncKHRFP;
 extern clCreateFromGLTexture2DFunctionPointerType clCreateFromGLTexture2DFP;
 extern clCreateFromGLTexture3DFunctionPointerType clCreateFromGLTexture3DFP;
 
@@ -0,0 +1,319 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EventWaitLists.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "CLFunctions.hpp"
+
+// The normalization of event wait lists for the enqueue functions.
+// Events that appear in a wait list for the first time are retained,
+// and a CL_COMPLETE callback is registered for them. When the callback
+// reports that the event completed successfully, the event is added to
+// the set of completed events, and will be removed from all further
+// wait lists. The events in this set remain retained until they are
+// evicted from the set, so that their handles can not be reused by the
+// implementation for other events while they are in the set.
+
+/**
+ * The maximum number of events in the set of completed events. When
+ * this number is exceeded, the oldest events are evicted and released.
+ */
+#define MAX_COMPLETED_EVENTS 4096
+
+/**
+ * Whether the normalization is enabled
+ */
+static std::atomic<bool> waitListNormalizationEnabled(false);
+
+/**
+ * The length above which wait lists are collapsed into a marker, or 0
+ * if they should never be collapsed
+ */
+static std::atomic<int> waitListCollapseThreshold(0);
+
+/**
+ * The mutex protecting the sets of events and the statistics
+ */
+static std::mutex waitListMutex;
+
+/**
+ * The events for which a completion callback has been registered, 
+ * and which did not complete yet. These events are retained.
+ */
+static std::unordered_set<cl_event> pendingEvents;
+
+/**
+ * The events that are known to be complete. These events are retained.
+ */
+static std::unordered_set<cl_event> completedEvents;
+
+/**
+ * The completed events, in the order in which they completed
+ */
+static std::deque<cl_event> completedEventsOrder;
+
+/**
+ * The statistics: The number of duplicates that have been removed, 
+ * the number of complete events that have been removed, and the
+ * number of lists that have been collapsed into a marker
+ */
+static jlong waitListDuplicatesRemoved = 0;
+static jlong waitListCompletedRemoved = 0;
+static jlong waitListsCollapsed = 0;
+
+
+/**
+ * Release the given events
+ */
+static void releaseEvents(const std::vector<cl_event> &events)
+{
+    if (clReleaseEventFP == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        (clReleaseEventFP)(events[i]);
+    }
+}
+
+/**
+ * The callback that is registered for events that appear in a wait
+ * list for the first time
+ */
+static void CL_CALLBACK WaitListEventCompleteCallback(cl_event event, cl_int event_command_exec_status, void *UNUSED(user_data))
+{
+    std::vector<cl_event> released;
+    {
+        std::lock_guard<std::mutex> lock(waitListMutex);
+        pendingEvents.erase(event);
+        if (event_command_exec_status == CL_COMPLETE && waitListNormalizationEnabled.load())
+        {
+            if (completedEvents.insert(event).second)
+            {
+                completedEventsOrder.push_back(event);
+            }
+            else
+            {
+                released.push_back(event);
+            }
+            while (completedEventsOrder.size() > MAX_COMPLETED_EVENTS)
+            {
+                cl_event evicted = completedEventsOrder.front();
+                completedEventsOrder.pop_front();
+                completedEvents.erase(evicted);
+                released.push_back(evicted);
+            }
+        }
+        else
+        {
+            released.push_back(event);
+        }
+    }
+    releaseEvents(released);
+}
+
+/**
+ * Remove all events from the set of completed events, and release them
+ */
+static void clearCompletedEvents()
+{
+    std::vector<cl_event> released;
+    {
+        std::lock_guard<std::mutex> lock(waitListMutex);
+        released.assign(completedEventsOrder.begin(), completedEventsOrder.end());
+        completedEvents.clear();
+        completedEventsOrder.clear();
+    }
+    releaseEvents(released);
+}
+
+/**
+ * Remove the duplicates and the complete events from the given list,
+ * and register completion callbacks for the events that have not been
+ * seen before. Returns the new number of events.
+ */
+static cl_uint pruneEventWaitList(cl_event *event_wait_list, cl_uint num_events_in_wait_list)
+{
+    std::sort(event_wait_list, event_wait_list + num_events_in_wait_list);
+    cl_uint num_unique = (cl_uint)(std::unique(event_wait_list, event_wait_list + num_events_in_wait_list) - event_wait_list);
+
+    std::vector<cl_event> untracked;
+    cl_uint n = 0;
+    {
+        std::lock_guard<std::mutex> lock(waitListMutex);
+        waitListDuplicatesRemoved += num_events_in_wait_list - num_unique;
+        for (cl_uint i = 0; i < num_unique; i++)
+        {
+            cl_event event = event_wait_list[i];
+            if (event != NULL && completedEvents.count(event) != 0)
+            {
+                waitListCompletedRemoved++;
+                continue;
+            }
+            event_wait_list[n++] = event;
+            if (event != NULL && pendingEvents.count(event) == 0)
+            {
+                pendingEvents.insert(event);
+                untracked.push_back(event);
+            }
+        }
+    }
+
+    // Register the callbacks outside of the lock, because they may be
+    // called immediately, on this thread
+    for (size_t i = 0; i < untracked.size(); i++)
+    {
+        cl_event event = untracked[i];
+        cl_int result = CL_INVALID_OPERATION;
+        if (clRetainEventFP != NULL && clSetEventCallbackFP != NULL)
+        {
+            result = (clRetainEventFP)(event);
+            if (result == CL_SUCCESS)
+            {
+                result = (clSetEventCallbackFP)(event, CL_COMPLETE, &WaitListEventCompleteCallback, NULL);
+                if (result != CL_SUCCESS)
+                {
+                    (clReleaseEventFP)(event);
+                }
+            }
+        }
+        if (result != CL_SUCCESS)
+        {
+            // The event is invalid or can not be tracked. It remains in 
+            // the list, so that the enqueue function reports the error.
+            std::lock_guard<std::mutex> lock(waitListMutex);
+            pendingEvents.erase(event);
+        }
+    }
+    return n;
+}
+
+NormalizedEventWaitList::NormalizedEventWaitList(cl_command_queue command_queue, cl_event *event_wait_list, cl_uint num_events_in_wait_list, bool waitAllIfEmpty)
+    : num_events(num_events_in_wait_list), events(event_wait_list), marker(NULL)
+{
+    if (!waitListNormalizationEnabled.load() || event_wait_list == NULL || num_events_in_wait_list == 0)
+    {
+        return;
+    }
+    cl_event first = event_wait_list[0];
+    num_events = pruneEventWaitList(event_wait_list, num_events_in_wait_list);
+    if (num_events == 0)
+    {
+        if (waitAllIfEmpty)
+        {
+            // An empty list would make the command wait for all 
+            // previous commands, so one (complete) event is kept
+            event_wait_list[0] = first;
+            num_events = 1;
+            return;
+        }
+        events = NULL;
+        return;
+    }
+    int threshold = waitListCollapseThreshold.load();
+    if (waitAllIfEmpty || threshold <= 0 || num_events <= (cl_uint)threshold || clEnqueueMarkerWithWaitListFP == NULL)
+    {
+        return;
+    }
+    cl_int result = (clEnqueueMarkerWithWaitListFP)(command_queue, num_events, event_wait_list, &marker);
+    if (result != CL_SUCCESS)
+    {
+        Logger::log(LOG_DEBUG, "Could not collapse wait list, using all events\n");
+        marker = NULL;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(waitListMutex);
+        waitListsCollapsed++;
+    }
+    num_events = 1;
+    events = &marker;
+}
+
+NormalizedEventWaitList::~NormalizedEventWaitList()
+{
+    if (marker != NULL && clReleaseEventFP != NULL)
+    {
+        (clReleaseEventFP)(marker);
+    }
+}
+
+
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_EventWaitLists_setEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jboolean enabled)
+{
+    waitListNormalizationEnabled.store(enabled == JNI_TRUE);
+    if (!enabled)
+    {
+        clearCompletedEvents();
+    }
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL Java_org_jocl_EventWaitLists_isEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    return waitListNormalizationEnabled.load();
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_EventWaitLists_setCollapseThresholdNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jint threshold)
+{
+    waitListCollapseThreshold.store(threshold);
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_EventWaitLists_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray statistics)
+{
+    std::lock_guard<std::mutex> lock(waitListMutex);
+    if (!set(env, statistics, 0, waitListDuplicatesRemoved)) return;
+    if (!set(env, statistics, 1, waitListCompletedRemoved)) return;
+    if (!set(env, statistics, 2, waitListsCollapsed)) return;
+    if (!set(env, statistics, 3, (jlong)completedEvents.size())) return;
+    if (!set(env, statistics, 4, (jlong)pendingEvents.size())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_EventWaitLists_clearNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    clearCompletedEvents();
+}
@@ -0,0 +1,58 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EVENT_WAIT_LISTS_HPP
+#define EVENT_WAIT_LISTS_HPP
+
+#include "JOCLCommon.hpp"
+
+/**
+ * The event wait list that is passed to an enqueue function, after
+ * the optional normalization: When the normalization is enabled (via
+ * the EventWaitLists class), duplicate events and events that are 
+ * known to be complete are removed, and lists that are longer than
+ * the collapse threshold are replaced by a single marker event. The
+ * marker is released when this object goes out of scope.
+ * For commands that wait for all previous commands when their wait 
+ * list is empty (markers and barriers), the list is never collapsed, 
+ * and at least one event is kept.
+ */
+struct NormalizedEventWaitList
+{
+    cl_uint num_events;
+    const cl_event *events;
+    cl_event marker;
+
+    NormalizedEventWaitList(cl_command_queue command_queue, cl_event *event_wait_list, cl_uint num_events_in_wait_list, bool waitAllIfEmpty = false);
+    ~NormalizedEventWaitList();
+
+private:
+    NormalizedEventWaitList(const NormalizedEventWaitList &other);
+    NormalizedEventWaitList& operator=(const NormalizedEventWaitList &other);
+};
+
+#endif // EVENT_WAIT_LISTS_HPP
@@ -29,6 +29,10 @@
 
 #include "CLFunctions.hpp"
 
+#include <string>
+#include <map>
+#include <mutex>
+
 /**
  * Template method that obtains the pointer to the function
  * with the given name, and stores it in the given pointer.
@@ -98,6 +102,7 @@ void initFunctionPointers()
     initFunctionPointer(&clGetKernelInfoFP, "clGetKernelInfo");
     initFunctionPointer(&clGetKernelArgInfoFP, "clGetKernelArgInfo");
     initFunctionPointer(&clGetKernelWorkGroupInfoFP, "clGetKernelWorkGroupInfo");
+    initFunctionPointer(&clGetKernelSubGroupInfoFP, "clGetKernelSubGroupInfo");
     initFunctionPointer(&clWaitForEventsFP, "clWaitForEvents");
     initFunctionPointer(&clGetEventInfoFP, "clGetEventInfo");
     initFunctionPointer(&clCreateUserEventFP, "clCreateUserEvent");
@@ -154,6 +159,7 @@ void initFunctionPointers()
     initFunctionPointer(&clGetGLTextureInfoFP, "clGetGLTextureInfo");
     initFunctionPointer(&clEnqueueAcquireGLObjectsFP, "clEnqueueAcquireGLObjects");
     initFunctionPointer(&clEnqueueReleaseGLObjectsFP, "clEnqueueReleaseGLObjects");
+    initFunctionPointer(&clCreateEventFromGLsyncKHRFP, "clCreateEventFromGLsyncKHR");
     initFunctionPointer(&clCreateFromGLTexture2DFP, "clCreateFromGLTexture2D");
     initFunctionPointer(&clCreateFromGLTexture3DFP, "clCreateFromGLTexture3D");
 
@@ -161,3 +167,46 @@ void initFunctionPointers()
 
 
 }
+
+/**
+ * The mutex protecting the extensionFunctionPointers
+ */
+static std::mutex extensionFunctionPointersMutex;
+
+/**
+ * The pointers to extension functions that have been obtained for 
+ * each platform, with the function name as the second key element.
+ * The value is NULL if the platform does not provide the function.
+ */
+static std::map<std::pair<cl_platform_id, std::string>, void*> extensionFunctionPointers;
+
+/**
+ * Obtain the pointer to the extension function with the given name, 
+ * for the platform of the given device, via 
+ * clGetExtensionFunctionAddressForPlatform. The result is cached for 
+ * each platform. Returns NULL if the function is not available.
+ */
+void* obtainExtensionFunctionPointer(cl_device_id device, const char* name)
+{
+    if (clGetDeviceInfoFP == NULL || clGetExtensionFunctionAddressForPlatformFP == NULL)
+    {
+        return NULL;
+    }
+    cl_platform_id platform = NULL;
+    cl_int result = (clGetDeviceInfoFP)(device, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &platform, NULL);
+    if (result != CL_SUCCESS)
+    {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(extensionFunctionPointersMutex);
+    std::pair<cl_platform_id, std::string> key(platform, name);
+    std::map<std::pair<cl_platform_id, std::string>, void*>::iterator iter =
+        extensionFunctionPointers.find(key);
+    if (iter != extensionFunctionPointers.end())
+    {
+        return iter->second;
+    }
+    void *function = (clGetExtensionFunctionAddressForPlatformFP)(platform, name);
+    extensionFunctionPointers[key] = function;
+    return function;
+}
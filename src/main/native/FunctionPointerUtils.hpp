@@ -36,7 +36,10 @@
     #include <stdint.h>
 #endif
 
+#include "JOCLCommon.hpp"
+
 intptr_t obtainFunctionPointer(const char* name);
+void* obtainExtensionFunctionPointer(cl_device_id device, const char* name);
 bool loadImplementationLibrary(const char *libraryName);
 void initFunctionPointers();
 bool unloadImplementationLibrary();
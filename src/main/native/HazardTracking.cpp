@@ -0,0 +1,455 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "HazardTracking.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <atomic>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+#include "CLFunctions.hpp"
+
+// The tracking of hazards on memory objects. For each memory object,
+// the event of the last command that wrote it, and the events of the
+// commands that read it since then are stored. These events are 
+// retained. The access modes of the kernel arguments are declared via
+// the HazardTracker class, and the memory objects that are set as 
+// these arguments are recorded in clSetKernelArg. The state is locked 
+// from the construction of a HazardWaitList until the command has been
+// enqueued and committed, so that concurrent commands on the same 
+// memory objects are ordered consistently. Blocking transfers are 
+// enqueued as non-blocking ones, and only waited for after the state
+// was unlocked, so that the lock is never held while waiting for the
+// device.
+
+/**
+ * The access modes, as defined in the HazardTracker class
+ */
+#define HAZARD_ACCESS_READ 1
+#define HAZARD_ACCESS_WRITE 2
+
+/**
+ * The number of readers of a memory object above which the readers
+ * that are complete are removed
+ */
+#define MAX_TRACKED_READERS 64
+
+/**
+ * The events that are stored for one memory object
+ */
+struct MemHazards
+{
+    cl_event lastWriter;
+    std::vector<cl_event> readers;
+
+    MemHazards() : lastWriter(NULL) {}
+};
+
+/**
+ * The declared access modes of the arguments of one kernel, and the
+ * memory objects that are set as these arguments
+ */
+struct KernelAccesses
+{
+    std::vector<jint> modes;
+    std::vector<cl_mem> mems;
+};
+
+/**
+ * Whether the hazard tracking is enabled
+ */
+static std::atomic<bool> hazardTrackingEnabled(false);
+
+/**
+ * The mutex protecting the tracking state and the statistics
+ */
+static std::mutex hazardMutex;
+
+/**
+ * The tracking state of each memory object
+ */
+static std::unordered_map<cl_mem, MemHazards> memHazards;
+
+/**
+ * The declared accesses of each kernel
+ */
+static std::unordered_map<cl_kernel, KernelAccesses> kernelAccesses;
+
+/**
+ * The statistics: The number of commands that have been tracked, and
+ * the number of events that have been added to wait lists
+ */
+static jlong hazardCommandsTracked = 0;
+static jlong hazardDependenciesAdded = 0;
+
+
+/**
+ * Release the given event, if it is not NULL
+ */
+static void releaseHazardEvent(cl_event event)
+{
+    if (event != NULL && clReleaseEventFP != NULL)
+    {
+        (clReleaseEventFP)(event);
+    }
+}
+
+/**
+ * Release all events that are stored for the given memory object
+ */
+static void releaseMemHazards(MemHazards &hazards)
+{
+    releaseHazardEvent(hazards.lastWriter);
+    hazards.lastWriter = NULL;
+    for (size_t i = 0; i < hazards.readers.size(); i++)
+    {
+        releaseHazardEvent(hazards.readers[i]);
+    }
+    hazards.readers.clear();
+}
+
+/**
+ * Remove the readers that are complete from the given state
+ */
+static void pruneCompletedReaders(MemHazards &hazards)
+{
+    if (clGetEventInfoFP == NULL)
+    {
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < hazards.readers.size(); i++)
+    {
+        cl_event reader = hazards.readers[i];
+        cl_int status = CL_QUEUED;
+        cl_int result = (clGetEventInfoFP)(reader, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        if (result == CL_SUCCESS && status == CL_COMPLETE)
+        {
+            releaseHazardEvent(reader);
+        }
+        else
+        {
+            hazards.readers[n++] = reader;
+        }
+    }
+    hazards.readers.resize(n);
+}
+
+/**
+ * Remove all tracking state, releasing all events
+ */
+static void clearHazards()
+{
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    for (std::unordered_map<cl_mem, MemHazards>::iterator iter = memHazards.begin(); iter != memHazards.end(); ++iter)
+    {
+        releaseMemHazards(iter->second);
+    }
+    memHazards.clear();
+}
+
+HazardWaitList::HazardWaitList(cl_kernel kernel, cl_event *event_wait_list, cl_uint num_events_in_wait_list)
+    : num_events(num_events_in_wait_list), events(event_wait_list), internalEvent(NULL), usedEventPointer(NULL), committed(false), deferredBlocking(false)
+{
+    if (!hazardTrackingEnabled.load() || kernel == NULL)
+    {
+        return;
+    }
+    lock = std::unique_lock<std::mutex>(hazardMutex);
+    std::unordered_map<cl_kernel, KernelAccesses>::iterator iter = kernelAccesses.find(kernel);
+    if (iter != kernelAccesses.end())
+    {
+        const KernelAccesses &accesses = iter->second;
+        for (size_t i = 0; i < accesses.modes.size(); i++)
+        {
+            cl_mem mem = accesses.mems[i];
+            if (mem == NULL)
+            {
+                continue;
+            }
+            if (accesses.modes[i] & HAZARD_ACCESS_WRITE)
+            {
+                writeMems.push_back(mem);
+            }
+            else if (accesses.modes[i] & HAZARD_ACCESS_READ)
+            {
+                readMems.push_back(mem);
+            }
+        }
+    }
+    init(event_wait_list, num_events_in_wait_list);
+}
+
+HazardWaitList::HazardWaitList(cl_mem readMem, cl_mem writeMem, cl_event *event_wait_list, cl_uint num_events_in_wait_list)
+    : num_events(num_events_in_wait_list), events(event_wait_list), internalEvent(NULL), usedEventPointer(NULL), committed(false), deferredBlocking(false)
+{
+    if (!hazardTrackingEnabled.load())
+    {
+        return;
+    }
+    lock = std::unique_lock<std::mutex>(hazardMutex);
+    if (readMem != NULL)
+    {
+        readMems.push_back(readMem);
+    }
+    if (writeMem != NULL)
+    {
+        writeMems.push_back(writeMem);
+    }
+    init(event_wait_list, num_events_in_wait_list);
+}
+
+void HazardWaitList::init(cl_event *event_wait_list, cl_uint num_events_in_wait_list)
+{
+    if (readMems.empty() && writeMems.empty())
+    {
+        lock.unlock();
+        return;
+    }
+
+    // A memory object that is written does not have to be treated 
+    // as being read as well
+    std::sort(writeMems.begin(), writeMems.end());
+    writeMems.erase(std::unique(writeMems.begin(), writeMems.end()), writeMems.end());
+    std::sort(readMems.begin(), readMems.end());
+    readMems.erase(std::unique(readMems.begin(), readMems.end()), readMems.end());
+    std::vector<cl_mem> onlyRead;
+    std::set_difference(readMems.begin(), readMems.end(), writeMems.begin(), writeMems.end(), std::back_inserter(onlyRead));
+    readMems.swap(onlyRead);
+
+    if (event_wait_list != NULL)
+    {
+        combined.assign(event_wait_list, event_wait_list + num_events_in_wait_list);
+    }
+    size_t userEvents = combined.size();
+    for (size_t i = 0; i < writeMems.size(); i++)
+    {
+        std::unordered_map<cl_mem, MemHazards>::iterator iter = memHazards.find(writeMems[i]);
+        if (iter != memHazards.end())
+        {
+            const MemHazards &hazards = iter->second;
+            if (hazards.lastWriter != NULL)
+            {
+                combined.push_back(hazards.lastWriter);
+            }
+            combined.insert(combined.end(), hazards.readers.begin(), hazards.readers.end());
+        }
+    }
+    for (size_t i = 0; i < readMems.size(); i++)
+    {
+        std::unordered_map<cl_mem, MemHazards>::iterator iter = memHazards.find(readMems[i]);
+        if (iter != memHazards.end() && iter->second.lastWriter != NULL)
+        {
+            combined.push_back(iter->second.lastWriter);
+        }
+    }
+    if (combined.size() == userEvents)
+    {
+        return;
+    }
+    hazardDependenciesAdded += (jlong)(combined.size() - userEvents);
+    std::sort(combined.begin(), combined.end());
+    combined.erase(std::unique(combined.begin(), combined.end()), combined.end());
+    num_events = (cl_uint)combined.size();
+    events = combined.data();
+}
+
+HazardWaitList::~HazardWaitList()
+{
+    if (!committed)
+    {
+        releaseHazardEvent(internalEvent);
+    }
+}
+
+cl_event* HazardWaitList::eventPointer(cl_event *userEventPointer)
+{
+    if (!lock.owns_lock())
+    {
+        return userEventPointer;
+    }
+    usedEventPointer = userEventPointer != NULL ? userEventPointer : &internalEvent;
+    return usedEventPointer;
+}
+
+cl_bool HazardWaitList::blocking(cl_bool userBlocking)
+{
+    if (!lock.owns_lock() || !userBlocking || clWaitForEventsFP == NULL)
+    {
+        return userBlocking;
+    }
+    deferredBlocking = true;
+    return CL_FALSE;
+}
+
+cl_int HazardWaitList::commit(cl_int result)
+{
+    if (!lock.owns_lock())
+    {
+        return result;
+    }
+    committed = true;
+    cl_event event = usedEventPointer == NULL ? NULL : *usedEventPointer;
+    if (result == CL_SUCCESS && event != NULL && clRetainEventFP != NULL)
+    {
+        for (size_t i = 0; i < writeMems.size(); i++)
+        {
+            MemHazards &hazards = memHazards[writeMems[i]];
+            releaseMemHazards(hazards);
+            (clRetainEventFP)(event);
+            hazards.lastWriter = event;
+        }
+        for (size_t i = 0; i < readMems.size(); i++)
+        {
+            MemHazards &hazards = memHazards[readMems[i]];
+            (clRetainEventFP)(event);
+            hazards.readers.push_back(event);
+            if (hazards.readers.size() > MAX_TRACKED_READERS)
+            {
+                pruneCompletedReaders(hazards);
+            }
+        }
+        hazardCommandsTracked++;
+    }
+    lock.unlock();
+    if (deferredBlocking && result == CL_SUCCESS && event != NULL)
+    {
+        result = (clWaitForEventsFP)(1, &event);
+    }
+    releaseHazardEvent(internalEvent);
+    internalEvent = NULL;
+    return result;
+}
+
+void recordKernelArgMem(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value)
+{
+    if (!hazardTrackingEnabled.load())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    std::unordered_map<cl_kernel, KernelAccesses>::iterator iter = kernelAccesses.find(kernel);
+    if (iter == kernelAccesses.end() || arg_index >= iter->second.mems.size())
+    {
+        return;
+    }
+    cl_mem mem = NULL;
+    if (arg_size == sizeof(cl_mem) && arg_value != NULL)
+    {
+        mem = *(const cl_mem*)arg_value;
+    }
+    iter->second.mems[arg_index] = mem;
+}
+
+void invalidateKernelAccesses(cl_kernel kernel)
+{
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    kernelAccesses.erase(kernel);
+}
+
+void invalidateMemHazards(cl_mem mem)
+{
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    std::unordered_map<cl_mem, MemHazards>::iterator iter = memHazards.find(mem);
+    if (iter == memHazards.end() || clGetMemObjectInfoFP == NULL)
+    {
+        return;
+    }
+    cl_uint referenceCount = 0;
+    cl_int result = (clGetMemObjectInfoFP)(mem, CL_MEM_REFERENCE_COUNT, sizeof(cl_uint), &referenceCount, NULL);
+    if (result != CL_SUCCESS || referenceCount <= 1)
+    {
+        releaseMemHazards(iter->second);
+        memHazards.erase(iter);
+    }
+}
+
+
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_HazardTracker_setEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jboolean enabled)
+{
+    hazardTrackingEnabled.store(enabled == JNI_TRUE);
+    if (!enabled)
+    {
+        clearHazards();
+    }
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL Java_org_jocl_HazardTracker_isEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    return hazardTrackingEnabled.load();
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_HazardTracker_declareKernelAccessesNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject kernel, jintArray modes)
+{
+    if (kernel == NULL || modes == NULL)
+    {
+        return;
+    }
+    cl_kernel nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    jsize length = env->GetArrayLength(modes);
+    std::vector<jint> nativeModes(length);
+    if (length > 0)
+    {
+        env->GetIntArrayRegion(modes, 0, length, nativeModes.data());
+        if (env->ExceptionCheck())
+        {
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    KernelAccesses &accesses = kernelAccesses[nativeKernel];
+    accesses.modes.swap(nativeModes);
+    accesses.mems.assign(length, (cl_mem)NULL);
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_HazardTracker_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray statistics)
+{
+    std::lock_guard<std::mutex> lock(hazardMutex);
+    if (!set(env, statistics, 0, hazardCommandsTracked)) return;
+    if (!set(env, statistics, 1, hazardDependenciesAdded)) return;
+    if (!set(env, statistics, 2, (jlong)memHazards.size())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_HazardTracker_clearNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    clearHazards();
+}
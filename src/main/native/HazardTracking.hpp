@@ -0,0 +1,131 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HAZARD_TRACKING_HPP
+#define HAZARD_TRACKING_HPP
+
+#include <vector>
+#include <mutex>
+
+#include "JOCLCommon.hpp"
+
+/**
+ * The event wait list that is passed to an enqueue function, extended
+ * with the events that the command has to wait for due to hazards on
+ * the memory objects that it accesses, when hazard tracking is enabled
+ * (via the HazardTracker class):
+ * When the command reads a memory object, it waits for the last command
+ * that wrote it. When it writes a memory object, it additionally waits
+ * for all commands that read it since then. 
+ * While this object exists, the tracking state is locked, so that the
+ * wait list and the event of the command are consistent. After the
+ * command was enqueued, commit has to be called with the result, to
+ * record the event of the command as the last writer or as a reader
+ * of the memory objects. Blocking transfers are enqueued as 
+ * non-blocking ones while the state is locked, and commit waits for 
+ * them after the state was unlocked.
+ */
+class HazardWaitList
+{
+public:
+    cl_uint num_events;
+    cl_event *events;
+
+    /**
+     * Creates the wait list for a kernel, based on the access modes that
+     * have been declared for the kernel arguments, and the memory 
+     * objects that have been set as these arguments
+     */
+    HazardWaitList(cl_kernel kernel, cl_event *event_wait_list, cl_uint num_events_in_wait_list);
+
+    /**
+     * Creates the wait list for a command that reads the given memory
+     * object and writes the other. Either of them may be NULL.
+     */
+    HazardWaitList(cl_mem readMem, cl_mem writeMem, cl_event *event_wait_list, cl_uint num_events_in_wait_list);
+
+    ~HazardWaitList();
+
+    /**
+     * Returns the pointer that should receive the event of the command.
+     * This is the given pointer, or a pointer to an internal event if
+     * the given pointer is NULL and the command is tracked.
+     */
+    cl_event* eventPointer(cl_event *userEventPointer);
+
+    /**
+     * Returns the blocking flag that should be passed to the enqueue 
+     * function. This is CL_FALSE if the command is tracked, and the
+     * waiting is deferred to the commit call.
+     */
+    cl_bool blocking(cl_bool userBlocking);
+
+    /**
+     * Record the event of the command, if the given result is 
+     * CL_SUCCESS, and unlock the tracking state. If the blocking of 
+     * the command was deferred, then this waits for the command. 
+     * Returns the given result, or the error of the waiting.
+     */
+    cl_int commit(cl_int result);
+
+private:
+    std::unique_lock<std::mutex> lock;
+    std::vector<cl_mem> readMems;
+    std::vector<cl_mem> writeMems;
+    std::vector<cl_event> combined;
+    cl_event internalEvent;
+    cl_event *usedEventPointer;
+    bool committed;
+    bool deferredBlocking;
+
+    void init(cl_event *event_wait_list, cl_uint num_events_in_wait_list);
+
+    HazardWaitList(const HazardWaitList &other);
+    HazardWaitList& operator=(const HazardWaitList &other);
+};
+
+/**
+ * Record the memory object that is set as the given kernel argument, 
+ * if hazard tracking is enabled and an access mode has been declared
+ * for this argument
+ */
+void recordKernelArgMem(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value);
+
+/**
+ * Remove the declared access modes and argument memory objects of the
+ * given kernel
+ */
+void invalidateKernelAccesses(cl_kernel kernel);
+
+/**
+ * Called before the given memory object is released. If this is the
+ * last reference, the tracking state of the memory object is removed,
+ * releasing the events that are stored for it.
+ */
+void invalidateMemHazards(cl_mem mem);
+
+#endif // HAZARD_TRACKING_HPP
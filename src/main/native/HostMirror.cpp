@@ -0,0 +1,193 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <jni.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOST_MIRROR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "JOCLCommon.hpp"
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+
+// Support for the HostMirror class: Allocation of aligned native memory
+// that is exposed as a direct ByteBuffer, and the detection of the 
+// blocks in which two such buffers differ. The comparison processes 
+// 64 bytes per iteration with SSE2 when it is available, and falls 
+// back to memcmp otherwise.
+
+/**
+ * Returns whether the given memory blocks with the given size differ
+ */
+static bool blockDiffers(const unsigned char *a, const unsigned char *b, size_t size)
+{
+    size_t i = 0;
+#if defined(HOST_MIRROR_SSE2)
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i d0 = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(a + i +  0)),
+            _mm_loadu_si128((const __m128i*)(b + i +  0)));
+        __m128i d1 = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(a + i + 16)),
+            _mm_loadu_si128((const __m128i*)(b + i + 16)));
+        __m128i d2 = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(a + i + 32)),
+            _mm_loadu_si128((const __m128i*)(b + i + 32)));
+        __m128i d3 = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(a + i + 48)),
+            _mm_loadu_si128((const __m128i*)(b + i + 48)));
+        __m128i d = _mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(d, _mm_setzero_si128())) != 0xFFFF)
+        {
+            return true;
+        }
+    }
+#endif
+    return memcmp(a + i, b + i, size - i) != 0;
+}
+
+/*
+ * Class:     org_jocl_HostMirror
+ * Method:    allocateNative
+ * Signature: (II)Ljava/nio/ByteBuffer;
+ */
+extern "C"
+JNIEXPORT jobject JNICALL Java_org_jocl_HostMirror_allocateNative
+  (JNIEnv *env, jclass UNUSED(cls), jint size, jint alignment)
+{
+    void *memory = NULL;
+#if defined(_WIN32)
+    memory = _aligned_malloc((size_t)size, (size_t)alignment);
+#else
+    if (posix_memalign(&memory, (size_t)alignment, (size_t)size) != 0)
+    {
+        memory = NULL;
+    }
+#endif
+    if (memory == NULL)
+    {
+        ThrowByName(env, "java/lang/OutOfMemoryError",
+            "Out of memory while allocating host mirror memory");
+        return NULL;
+    }
+    memset(memory, 0, (size_t)size);
+    jobject result = env->NewDirectByteBuffer(memory, (jlong)size);
+    if (result == NULL)
+    {
+#if defined(_WIN32)
+        _aligned_free(memory);
+#else
+        free(memory);
+#endif
+    }
+    return result;
+}
+
+/*
+ * Class:     org_jocl_HostMirror
+ * Method:    freeNative
+ * Signature: (Ljava/nio/ByteBuffer;)V
+ */
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_HostMirror_freeNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject buffer)
+{
+    void *memory = env->GetDirectBufferAddress(buffer);
+    if (memory == NULL)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+/*
+ * Class:     org_jocl_HostMirror
+ * Method:    findChangedRangesNative
+ * Signature: (Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;JI[J)I
+ */
+extern "C"
+JNIEXPORT jint JNICALL Java_org_jocl_HostMirror_findChangedRangesNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject current, jobject snapshot, jlong size, jint blockSize, jlongArray ranges)
+{
+    const unsigned char *a = (const unsigned char*)env->GetDirectBufferAddress(current);
+    const unsigned char *b = (const unsigned char*)env->GetDirectBufferAddress(snapshot);
+    if (a == NULL || b == NULL)
+    {
+        ThrowByName(env, "java/lang/IllegalArgumentException",
+            "The buffers must be direct buffers");
+        return -1;
+    }
+    jsize maxRanges = env->GetArrayLength(ranges) / 2;
+    std::vector<jlong> result;
+    size_t nativeSize = (size_t)size;
+    size_t nativeBlockSize = (size_t)blockSize;
+    bool inRange = false;
+    for (size_t offset = 0; offset < nativeSize; offset += nativeBlockSize)
+    {
+        size_t n = nativeSize - offset < nativeBlockSize ? nativeSize - offset : nativeBlockSize;
+        if (blockDiffers(a + offset, b + offset, n))
+        {
+            if (inRange)
+            {
+                result.back() = (jlong)(offset + n);
+            }
+            else
+            {
+                if ((jsize)(result.size() / 2) == maxRanges)
+                {
+                    return -1;
+                }
+                result.push_back((jlong)offset);
+                result.push_back((jlong)(offset + n));
+                inRange = true;
+            }
+        }
+        else
+        {
+            inRange = false;
+        }
+    }
+    if (!result.empty())
+    {
+        env->SetLongArrayRegion(ranges, 0, (jsize)result.size(), result.data());
+    }
+    return (jint)(result.size() / 2);
+}
@@ -0,0 +1,261 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <jni.h>
+#include <string.h>
+
+#include "JOCLCommon.hpp"
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGE_TRANSFER_SSSE3
+#define IMAGE_TRANSFER_SSSE3_TARGET __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define IMAGE_TRANSFER_SSSE3
+#define IMAGE_TRANSFER_SSSE3_TARGET
+#include <intrin.h>
+#include <tmmintrin.h>
+#endif
+
+// Repacking functions for ImageTransfer. The inner loops are written
+// so that they can be vectorized by the compiler. On x86, the 
+// conversion from 3 to 4 channels (which is the most common one, for 
+// RGB video frames) uses an explicit SSSE3 shuffle when the CPU 
+// supports it. The SSSE3 function is compiled for this instruction
+// set regardless of the build flags, and is only called after a 
+// runtime check.
+
+/**
+ * Clamp the given value to [0,255]
+ */
+static inline unsigned char clampByte(int value)
+{
+    return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+#if defined(IMAGE_TRANSFER_SSSE3)
+/**
+ * Returns whether the CPU supports SSSE3
+ */
+static bool isSSSE3Supported()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+/**
+ * Whether the CPU supports SSSE3, determined once
+ */
+static const bool ssse3Supported = isSSSE3Supported();
+
+/**
+ * Convert the first pixels of a row from 3 to 4 channels, with an 
+ * alpha value of 255, optionally swapping the first and third
+ * channel. Each step reads 16 bytes (of which 12 are used) and
+ * writes 4 pixels. Returns the number of pixels that have been
+ * converted.
+ */
+IMAGE_TRANSFER_SSSE3_TARGET
+static int repackRow3To4SSSE3(const unsigned char *src, unsigned char *dst, int width, bool swapRB)
+{
+    const __m128i mask = swapRB ?
+        _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+        _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    int x = 0;
+    for (; x + 6 <= width; x += 4)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + x * 3));
+        __m128i out = _mm_or_si128(_mm_shuffle_epi8(in, mask), alpha);
+        _mm_storeu_si128((__m128i*)(dst + x * 4), out);
+    }
+    return x;
+}
+#endif
+
+/**
+ * Repack one row of pixels with the given number of source and 
+ * destination channels. Supported are 1->1, 3->4, 4->3 and 4->4
+ * channels. When a channel is added, it receives the value 255. 
+ * When swapRB is true, the first and third channel are swapped.
+ */
+static void repackRow(const unsigned char *src, int srcChannels, unsigned char *dst, int dstChannels, int width, bool swapRB)
+{
+    const int r = swapRB ? 2 : 0;
+    const int b = swapRB ? 0 : 2;
+    int x = 0;
+    if (srcChannels == dstChannels && !swapRB)
+    {
+        memcpy(dst, src, (size_t)width * (size_t)srcChannels);
+    }
+    else if (srcChannels == 3 && dstChannels == 4)
+    {
+#if defined(IMAGE_TRANSFER_SSSE3)
+        if (ssse3Supported)
+        {
+            x = repackRow3To4SSSE3(src, dst, width, swapRB);
+        }
+#endif
+        for (; x < width; x++)
+        {
+            dst[x * 4 + 0] = src[x * 3 + r];
+            dst[x * 4 + 1] = src[x * 3 + 1];
+            dst[x * 4 + 2] = src[x * 3 + b];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    else if (srcChannels == 4 && dstChannels == 3)
+    {
+        for (; x < width; x++)
+        {
+            dst[x * 3 + 0] = src[x * 4 + r];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + b];
+        }
+    }
+    else if (srcChannels == 4 && dstChannels == 4)
+    {
+        for (; x < width; x++)
+        {
+            dst[x * 4 + 0] = src[x * 4 + r];
+            dst[x * 4 + 1] = src[x * 4 + 1];
+            dst[x * 4 + 2] = src[x * 4 + b];
+            dst[x * 4 + 3] = src[x * 4 + 3];
+        }
+    }
+}
+
+/**
+ * Convert one row of a planar YUV 4:2:0 image (BT.601, limited range)
+ * into 4 channels with an alpha value of 255. When swapRB is false, 
+ * the result is RGBA, otherwise it is BGRA.
+ */
+static void convertRowI420(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *dst, int width, bool swapRB)
+{
+    const int r = swapRB ? 2 : 0;
+    const int b = swapRB ? 0 : 2;
+    for (int x = 0; x < width; x++)
+    {
+        int c = 298 * ((int)y[x] - 16);
+        int d = (int)u[x >> 1] - 128;
+        int e = (int)v[x >> 1] - 128;
+        dst[x * 4 + r] = clampByte((c + 409 * e + 128) >> 8);
+        dst[x * 4 + 1] = clampByte((c - 100 * d - 208 * e + 128) >> 8);
+        dst[x * 4 + b] = clampByte((c + 516 * d + 128) >> 8);
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Class:     org_jocl_ImageTransfer
+ * Method:    repackNative
+ * Signature: (Lorg/jocl/Pointer;JILorg/jocl/Pointer;JIIIZ)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_ImageTransfer_repackNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject src, jlong srcRowPitch, jint srcChannels, jobject dst, jlong dstRowPitch, jint dstChannels, jint width, jint height, jboolean swapRB)
+{
+    Logger::log(LOG_TRACE, "Executing repack\n");
+
+    PointerData *srcPointerData = initPointerData(env, src);
+    if (srcPointerData == NULL)
+    {
+        return;
+    }
+    PointerData *dstPointerData = initPointerData(env, dst);
+    if (dstPointerData == NULL)
+    {
+        releasePointerData(env, srcPointerData, JNI_ABORT);
+        return;
+    }
+    const unsigned char *srcBytes = (const unsigned char*)srcPointerData->pointer;
+    unsigned char *dstBytes = (unsigned char*)dstPointerData->pointer;
+    for (jint row = 0; row < height; row++)
+    {
+        repackRow(srcBytes + row * srcRowPitch, srcChannels, 
+            dstBytes + row * dstRowPitch, dstChannels, width, swapRB == JNI_TRUE);
+    }
+    releasePointerData(env, dstPointerData);
+    releasePointerData(env, srcPointerData, JNI_ABORT);
+}
+
+/*
+ * Class:     org_jocl_ImageTransfer
+ * Method:    convertI420Native
+ * Signature: (Lorg/jocl/Pointer;JJLorg/jocl/Pointer;JIIZ)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_ImageTransfer_convertI420Native
+  (JNIEnv *env, jclass UNUSED(cls), jobject src, jlong srcRowPitch, jlong chromaRowPitch, jobject dst, jlong dstRowPitch, jint width, jint height, jboolean swapRB)
+{
+    Logger::log(LOG_TRACE, "Executing convertI420\n");
+
+    PointerData *srcPointerData = initPointerData(env, src);
+    if (srcPointerData == NULL)
+    {
+        return;
+    }
+    PointerData *dstPointerData = initPointerData(env, dst);
+    if (dstPointerData == NULL)
+    {
+        releasePointerData(env, srcPointerData, JNI_ABORT);
+        return;
+    }
+
+    // The U and V planes follow the Y plane, with the given row 
+    // pitch and half of its height, rounded up. The sizes have been
+    // validated on Java side.
+    const unsigned char *yPlane = (const unsigned char*)srcPointerData->pointer;
+    const unsigned char *uPlane = yPlane + srcRowPitch * height;
+    const unsigned char *vPlane = uPlane + chromaRowPitch * ((height + 1) / 2);
+    unsigned char *dstBytes = (unsigned char*)dstPointerData->pointer;
+    for (jint row = 0; row < height; row++)
+    {
+        convertRowI420(yPlane + row * srcRowPitch, 
+            uPlane + (row / 2) * chromaRowPitch, 
+            vPlane + (row / 2) * chromaRowPitch, 
+            dstBytes + row * dstRowPitch, width, swapRB == JNI_TRUE);
+    }
+    releasePointerData(env, dstPointerData);
+    releasePointerData(env, srcPointerData, JNI_ABORT);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <string>
 #include <map>
+#include <chrono>
+#include <atomic>
 
 #include "Logger.hpp"
 #include "JOCLCommon.hpp"
@@ -39,6 +41,12 @@
 
 #include "CLFunctions.hpp"
 #include "FunctionPointerUtils.hpp"
+#include "PrintfBuffer.hpp"
+#include "LocalWorkSizes.hpp"
+#include "SubGroups.hpp"
+#include "EventWaitLists.hpp"
+#include "KernelArgs.hpp"
+#include "HazardTracking.hpp"
 
 // Static method IDs for the "function pointer" interfaces
 static jmethodID CreateContextFunction_function; // (Ljava/lang/String;Lorg/jocl/Pointer;JLjava/lang/Object;)V
@@ -49,6 +57,23 @@ static jmethodID EventCallback_function; // (Lorg/jocl/cl_event;ILjava/lang/Obje
 static jmethodID PrintfCallbackFunction_function; // (Lorg/jocl/cl_program;Ljava/lang/Object;)V
 static jmethodID SVMFreeFunction_function; // (Lorg/jocl/cl_command_queue;I[Lorg/jocl/Pointer;Ljava/lang/Object;)V
 
+// The durations of the initialization steps, in nanoseconds. These
+// are reported to Java via getInitializationTimesNative, and are
+// used for measuring the startup time of JOCL.
+static jlong onLoadNanos = 0;
+static jlong registerAllNativesNanos = 0;
+static jlong loadImplementationLibraryNanos = 0;
+static jlong initFunctionPointersNanos = 0;
+
+/**
+ * Returns the number of nanoseconds that passed since the given time
+ */
+static jlong nanosSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::steady_clock::duration duration =
+        std::chrono::steady_clock::now() - start;
+    return (jlong)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
 
 
 /**
@@ -63,6 +88,8 @@ void registerAllNatives(JNIEnv *env, jclass cls);
  */
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 {
+    std::chrono::steady_clock::time_point onLoadStart = std::chrono::steady_clock::now();
+
     JNIEnv *env = NULL;
     if (jvm->GetEnv((void**)&env, JNI_VERSION_1_4))
     {
@@ -81,7 +108,9 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
     jclass cls = NULL;
 
     if (!init(env, cls, "org/jocl/CL")) return JNI_ERR;
+    std::chrono::steady_clock::time_point registerStart = std::chrono::steady_clock::now();
     registerAllNatives(env, cls);
+    registerAllNativesNanos = nanosSince(registerStart);
 
     // Obtain the methodID for org.jocl.CreateContextFunction#function
     if (!init(env, cls, "org/jocl/CreateContextFunction")) return JNI_ERR;
@@ -111,6 +140,7 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
     if (!init(env, cls, "org/jocl/SVMFreeFunction")) return JNI_ERR;
     if (!init(env, cls, SVMFreeFunction_function, "function", "(Lorg/jocl/cl_command_queue;I[Lorg/jocl/Pointer;Ljava/lang/Object;)V")) return JNI_ERR;
 
+    onLoadNanos = nanosSince(onLoadStart);
     return JNI_VERSION_1_4;
 }
 
@@ -491,13 +521,17 @@ JNIEXPORT jboolean JNICALL Java_org_jocl_CL_initNativeLibrary
     }
 
     Logger::log(LOG_DEBUGTRACE, "    Native library name: '%s'\n", fullNameNative);
+    std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
     bool loaded = loadImplementationLibrary(fullNameNative);
+    loadImplementationLibraryNanos += nanosSince(loadStart);
     delete[] fullNameNative;
 
     if (loaded)
     {
         Logger::log(LOG_DEBUGTRACE, "    Initializing function pointers\n");
+        std::chrono::steady_clock::time_point initStart = std::chrono::steady_clock::now();
         initFunctionPointers();
+        initFunctionPointersNanos = nanosSince(initStart);
         return JNI_TRUE;
     }
     Logger::log(LOG_DEBUGTRACE, "    Could not load native library\n");
@@ -517,6 +551,21 @@ JNIEXPORT void JNICALL Java_org_jocl_CL_setLogLevelNative
 }
 
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    getInitializationTimesNative
+ * Signature: ([J)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_CL_getInitializationTimesNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray times)
+{
+    if (!set(env, times, 0, onLoadNanos)) return;
+    if (!set(env, times, 1, registerAllNativesNanos)) return;
+    if (!set(env, times, 2, loadImplementationLibraryNanos)) return;
+    if (!set(env, times, 3, initFunctionPointersNanos)) return;
+}
+
+
 
 //=== CL functions ===========================================================
 
@@ -999,12 +1048,24 @@ JNIEXPORT jobject JNICALL Java_org_jocl_CL_clCreateContextNative
         }
         nativeUser_data = (void*)callbackInfo;
     }
+    PrintfBuffer *printfBuffer = preparePrintfBuffer(env, nativeProperties, &nativePfn_notify, &nativeUser_data);
+    if (env->ExceptionCheck())
+    {
+        deleteCallbackInfo(env, callbackInfo);
+        delete[] nativeDevices;
+        delete[] nativeProperties;
+        return NULL;
+    }
 
 
     nativeContext = (clCreateContextFP)(nativeProperties, nativeNum_devices, nativeDevices, nativePfn_notify, nativeUser_data, &nativeErrcode_ret);
     if (nativeContext != NULL)
     {
         contextCallbackMap[nativeContext] = callbackInfo;
+        if (printfBuffer != NULL)
+        {
+            attachPrintfBuffer(env, printfBuffer, nativeContext);
+        }
     }
     else
     {
@@ -1071,12 +1132,23 @@ JNIEXPORT jobject JNICALL Java_org_jocl_CL_clCreateContextFromTypeNative
         }
         nativeUser_data = (void*)callbackInfo;
     }
+    PrintfBuffer *printfBuffer = preparePrintfBuffer(env, nativeProperties, &nativePfn_notify, &nativeUser_data);
+    if (env->ExceptionCheck())
+    {
+        deleteCallbackInfo(env, callbackInfo);
+        delete[] nativeProperties;
+        return NULL;
+    }
 
 
     nativeContext = (clCreateContextFromTypeFP)(nativeProperties, nativeDevice_type, nativePfn_notify, nativeUser_data, &nativeErrcode_ret);
     if (nativeContext != NULL)
     {
         contextCallbackMap[nativeContext] = callbackInfo;
+        if (printfBuffer != NULL)
+        {
+            attachPrintfBuffer(env, printfBuffer, nativeContext);
+        }
     }
     else
     {
@@ -2066,6 +2138,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clReleaseMemObjectNative
     {
         nativeMemobj = (cl_mem)env->GetLongField(memobj, NativePointerObject_nativePointer);
     }
+    invalidateMemHazards(nativeMemobj);
+    invalidateKernelArgHandle(nativeMemobj);
     return (clReleaseMemObjectFP)(nativeMemobj);
 }
 
@@ -2602,6 +2676,7 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clReleaseSamplerNative
     {
         nativeSampler = (cl_sampler)env->GetLongField(sampler, NativePointerObject_nativePointer);
     }
+    invalidateKernelArgHandle(nativeSampler);
     return (clReleaseSamplerFP)(nativeSampler);
 }
 
@@ -3693,6 +3768,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clReleaseKernelNative
     {
         nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
     }
+    invalidateLocalWorkSizes(nativeKernel);
+    invalidateSubGroupInfo(nativeKernel);
+    invalidateKernelArgs(nativeKernel);
+    invalidateKernelAccesses(nativeKernel);
     return (clReleaseKernelFP)(nativeKernel);
 }
 
@@ -3735,7 +3814,16 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetKernelArgNative
     }
     nativeArg_value = (void*)arg_valuePointerData->pointer;
 
+    recordKernelArgMem(nativeKernel, nativeArg_index, nativeArg_size, nativeArg_value);
+
+    // Skip the call if the argument was already set to the same value
+    if (isKernelArgUnchanged(nativeKernel, nativeArg_index, nativeArg_size, nativeArg_value))
+    {
+        if (!releasePointerData(env, arg_valuePointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
+        return CL_SUCCESS;
+    }
     int result = (clSetKernelArgFP)(nativeKernel, nativeArg_index, nativeArg_size, nativeArg_value);
+    updateKernelArg(nativeKernel, nativeArg_index, nativeArg_size, nativeArg_value, result);
 
     // Write back native variable values and clean up
     if (!releasePointerData(env, arg_valuePointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
@@ -3779,6 +3867,7 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetKernelArgSVMPointerNative
     }
     nativeArg_value = (void*)arg_valuePointerData->pointer;
 
+    invalidateKernelArg(nativeKernel, nativeArg_index);
     int result = (clSetKernelArgSVMPointerFP)(nativeKernel, nativeArg_index, nativeArg_value);
 
     // Write back native variable values and clean up
@@ -3988,6 +4077,220 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelWorkGroupInfoNative
 
 
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSuggestedLocalWorkSizeKHRNative
+ * Signature: (Lorg/jocl/cl_command_queue;Lorg/jocl/cl_kernel;I[J[J[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSuggestedLocalWorkSizeKHRNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject command_queue, jobject kernel, jint work_dim, jlongArray global_work_offset, jlongArray global_work_size, jlongArray suggested_local_work_size)
+{
+    Logger::log(LOG_TRACE, "Executing clGetKernelSuggestedLocalWorkSizeKHR\n");
+
+    // Native variables declaration
+    cl_command_queue nativeCommand_queue = NULL;
+    cl_kernel nativeKernel = NULL;
+    cl_uint nativeWork_dim = 0;
+    size_t *nativeGlobal_work_offset = NULL;
+    size_t *nativeGlobal_work_size = NULL;
+    size_t nativeSuggested_local_work_size[3] = { 0, 0, 0 };
+
+    // Obtain native variable values
+    if (command_queue != NULL)
+    {
+        nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
+    }
+
+    // The function is obtained for the platform of the queue
+    clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType clGetKernelSuggestedLocalWorkSizeKHRFP =
+        getKernelSuggestedLocalWorkSizeFunction(nativeCommand_queue);
+    if (clGetKernelSuggestedLocalWorkSizeKHRFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clGetKernelSuggestedLocalWorkSizeKHR is not supported");
+        return CL_INVALID_OPERATION;
+    }
+    if (work_dim < 1 || work_dim > 3)
+    {
+        return CL_INVALID_WORK_DIMENSION;
+    }
+
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    nativeWork_dim = (cl_uint)work_dim;
+    if (global_work_offset != NULL)
+    {
+        nativeGlobal_work_offset = convertArray(env, global_work_offset);
+        if (nativeGlobal_work_offset == NULL)
+        {
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    if (global_work_size != NULL)
+    {
+        nativeGlobal_work_size = convertArray(env, global_work_size);
+        if (nativeGlobal_work_size == NULL)
+        {
+            delete[] nativeGlobal_work_offset;
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+
+    int result = (clGetKernelSuggestedLocalWorkSizeKHRFP)(nativeCommand_queue, nativeKernel, nativeWork_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeSuggested_local_work_size);
+
+    // Write back native variable values and clean up
+    delete[] nativeGlobal_work_offset;
+    delete[] nativeGlobal_work_size;
+    if (suggested_local_work_size != NULL)
+    {
+        for (int i = 0; i < work_dim; i++)
+        {
+            if (!set(env, suggested_local_work_size, i, (jlong)nativeSuggested_local_work_size[i])) return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+
+    return result;
+}
+
+
+
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSubGroupInfoNative
+ * Signature: (Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSubGroupInfoNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject kernel, jobject device, jint param_name, jlong input_value_size, jobject input_value, jlong param_value_size, jobject param_value, jlongArray param_value_size_ret)
+{
+    Logger::log(LOG_TRACE, "Executing clGetKernelSubGroupInfo\n");
+    if (clGetKernelSubGroupInfoFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clGetKernelSubGroupInfo is not supported");
+        return CL_INVALID_OPERATION;
+    }
+
+    // Native variables declaration
+    cl_kernel nativeKernel = NULL;
+    cl_device_id nativeDevice = NULL;
+    cl_uint nativeParam_name = 0;
+    size_t nativeInput_value_size = 0;
+    void *nativeInput_value = NULL;
+    size_t nativeParam_value_size = 0;
+    void *nativeParam_value = NULL;
+    size_t nativeParam_value_size_ret;
+
+    // Obtain native variable values
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    if (device != NULL)
+    {
+        nativeDevice = (cl_device_id)env->GetLongField(device, NativePointerObject_nativePointer);
+    }
+    nativeParam_name = (cl_uint)param_name;
+    nativeInput_value_size = (size_t)input_value_size;
+    PointerData *input_valuePointerData = initPointerData(env, input_value);
+    if (input_valuePointerData == NULL)
+    {
+        return CL_INVALID_HOST_PTR;
+    }
+    nativeInput_value = (void*)input_valuePointerData->pointer;
+    nativeParam_value_size = (size_t)param_value_size;
+    PointerData *param_valuePointerData = initPointerData(env, param_value);
+    if (param_valuePointerData == NULL)
+    {
+        releasePointerData(env, input_valuePointerData, JNI_ABORT);
+        return CL_INVALID_HOST_PTR;
+    }
+    nativeParam_value = (void*)param_valuePointerData->pointer;
+
+    int result = (clGetKernelSubGroupInfoFP)(nativeKernel, nativeDevice, nativeParam_name, nativeInput_value_size, nativeInput_value, nativeParam_value_size, nativeParam_value, &nativeParam_value_size_ret);
+
+    // Write back native variable values and clean up
+    if (!releasePointerData(env, input_valuePointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
+    if (!releasePointerData(env, param_valuePointerData)) return CL_INVALID_HOST_PTR;
+    if (!set(env, param_value_size_ret, 0, (long)nativeParam_value_size_ret)) return CL_OUT_OF_HOST_MEMORY;
+
+    return result;
+}
+
+
+
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSubGroupInfoKHRNative
+ * Signature: (Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSubGroupInfoKHRNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject kernel, jobject device, jint param_name, jlong input_value_size, jobject input_value, jlong param_value_size, jobject param_value, jlongArray param_value_size_ret)
+{
+    Logger::log(LOG_TRACE, "Executing clGetKernelSubGroupInfoKHR\n");
+
+    // Native variables declaration
+    cl_kernel nativeKernel = NULL;
+    cl_device_id nativeDevice = NULL;
+    cl_uint nativeParam_name = 0;
+    size_t nativeInput_value_size = 0;
+    void *nativeInput_value = NULL;
+    size_t nativeParam_value_size = 0;
+    void *nativeParam_value = NULL;
+    size_t nativeParam_value_size_ret;
+
+    // Obtain native variable values
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    if (device != NULL)
+    {
+        nativeDevice = (cl_device_id)env->GetLongField(device, NativePointerObject_nativePointer);
+    }
+
+    // The function is obtained for the platform of the device
+    clGetKernelSubGroupInfoFunctionPointerType clGetKernelSubGroupInfoKHRFP =
+        getKernelSubGroupInfoKHRFunction(nativeDevice);
+    if (clGetKernelSubGroupInfoKHRFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clGetKernelSubGroupInfoKHR is not supported");
+        return CL_INVALID_OPERATION;
+    }
+    nativeParam_name = (cl_uint)param_name;
+    nativeInput_value_size = (size_t)input_value_size;
+    PointerData *input_valuePointerData = initPointerData(env, input_value);
+    if (input_valuePointerData == NULL)
+    {
+        return CL_INVALID_HOST_PTR;
+    }
+    nativeInput_value = (void*)input_valuePointerData->pointer;
+    nativeParam_value_size = (size_t)param_value_size;
+    PointerData *param_valuePointerData = initPointerData(env, param_value);
+    if (param_valuePointerData == NULL)
+    {
+        releasePointerData(env, input_valuePointerData, JNI_ABORT);
+        return CL_INVALID_HOST_PTR;
+    }
+    nativeParam_value = (void*)param_valuePointerData->pointer;
+
+    int result = (clGetKernelSubGroupInfoKHRFP)(nativeKernel, nativeDevice, nativeParam_name, nativeInput_value_size, nativeInput_value, nativeParam_value_size, nativeParam_value, &nativeParam_value_size_ret);
+
+    // Write back native variable values and clean up
+    if (!releasePointerData(env, input_valuePointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
+    if (!releasePointerData(env, param_valuePointerData)) return CL_INVALID_HOST_PTR;
+    if (!set(env, param_value_size_ret, 0, (long)nativeParam_value_size_ret)) return CL_OUT_OF_HOST_MEMORY;
+
+    return result;
+}
+
+
+
+
 /*
  * Class:     org_jocl_CL
  * Method:    clWaitForEventsNative
@@ -4212,6 +4515,97 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetUserEventStatusNative
     return (clSetUserEventStatusFP)(nativeEvent, nativeExecution_status);
 }
 
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    createUserEventsNative
+ * Signature: (Lorg/jocl/cl_context;[Lorg/jocl/cl_event;[I)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_createUserEventsNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject context, jobjectArray events, jintArray errcode_ret)
+{
+    Logger::log(LOG_TRACE, "Executing createUserEvents\n");
+    if (clCreateUserEventFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clCreateUserEvent is not supported");
+        return 0;
+    }
+
+    // Native variables declaration
+    cl_context nativeContext = NULL;
+    cl_int nativeErrcode_ret = CL_SUCCESS;
+
+    // Obtain native variable values
+    if (context != NULL)
+    {
+        nativeContext = (cl_context)env->GetLongField(context, NativePointerObject_nativePointer);
+    }
+
+    // Create one user event for each (non-null) element of the 
+    // array, stopping at the first error
+    jsize length = env->GetArrayLength(events);
+    jint created = 0;
+    for (jsize i=0; i<length; i++)
+    {
+        jobject event = env->GetObjectArrayElement(events, i);
+        if (event == NULL)
+        {
+            continue;
+        }
+        cl_event nativeEvent = (clCreateUserEventFP)(nativeContext, &nativeErrcode_ret);
+        if (nativeErrcode_ret != CL_SUCCESS)
+        {
+            env->DeleteLocalRef(event);
+            break;
+        }
+        setNativePointer(env, event, (jlong)nativeEvent);
+        env->DeleteLocalRef(event);
+        created++;
+    }
+
+    // Write back native variable values and clean up
+    set(env, errcode_ret, 0, nativeErrcode_ret);
+    return created;
+}
+
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    releaseEventsNative
+ * Signature: ([Lorg/jocl/cl_event;I)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_releaseEventsNative
+  (JNIEnv *env, jclass UNUSED(cls), jobjectArray events, jint count)
+{
+    Logger::log(LOG_TRACE, "Executing releaseEvents\n");
+    if (clReleaseEventFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clReleaseEvent is not supported");
+        return CL_INVALID_OPERATION;
+    }
+
+    // Release all (non-null) events, and return the first error
+    cl_int result = CL_SUCCESS;
+    for (jint i=0; i<count; i++)
+    {
+        jobject event = env->GetObjectArrayElement(events, i);
+        if (event == NULL)
+        {
+            continue;
+        }
+        cl_event nativeEvent = (cl_event)env->GetLongField(event, NativePointerObject_nativePointer);
+        env->DeleteLocalRef(event);
+        cl_int releaseResult = (clReleaseEventFP)(nativeEvent);
+        if (result == CL_SUCCESS)
+        {
+            result = releaseResult;
+        }
+    }
+    return result;
+}
+
 //#endif // defined(CL_VERSION_1_1)
 
 
@@ -4262,6 +4656,134 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetEventCallbackNative
     return result;
 }
 
+
+
+/**
+ * A record that keeps a Java object (namely, the direct buffer of a
+ * non-blocking operation) reachable until the event of the operation
+ * is complete. See scheduleReferenceReleaseNative.
+ */
+struct ReferenceReleaseRecord
+{
+    jobject globalObject;
+    cl_event event;
+    ReferenceReleaseRecord *next;
+};
+
+// The records whose events are complete. This is a lock-free stack
+// that is filled by the ReferenceReleaseCallback on the threads of
+// the OpenCL implementation, and emptied by drainReferenceReleases.
+static std::atomic<ReferenceReleaseRecord*> completedReferenceReleases(nullptr);
+
+/**
+ * A pointer to this function will be passed to clSetEventCallback
+ * for non-blocking operations. The user_data is the 
+ * ReferenceReleaseRecord, which is pushed on the stack of completed 
+ * records. The global reference can not be deleted here, because
+ * this would require attaching the thread to the JVM.
+ */
+void CL_CALLBACK ReferenceReleaseCallback(cl_event UNUSED(event), cl_int UNUSED(command_exec_callback_type), void *user_data)
+{
+    ReferenceReleaseRecord *record = (ReferenceReleaseRecord*)user_data;
+    ReferenceReleaseRecord *head = completedReferenceReleases.load();
+    do
+    {
+        record->next = head;
+    }
+    while (!completedReferenceReleases.compare_exchange_weak(head, record));
+}
+
+/**
+ * Delete the global references and release the events of all 
+ * records whose events are complete
+ */
+static void drainReferenceReleases(JNIEnv *env)
+{
+    ReferenceReleaseRecord *record = completedReferenceReleases.exchange(nullptr);
+    while (record != nullptr)
+    {
+        ReferenceReleaseRecord *next = record->next;
+        env->DeleteGlobalRef(record->globalObject);
+        (clReleaseEventFP)(record->event);
+        delete record;
+        record = next;
+    }
+}
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    scheduleReferenceReleaseNative
+ * Signature: (Lorg/jocl/cl_event;Ljava/lang/Object;Z)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_scheduleReferenceReleaseNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject event, jobject object, jboolean doRetainEvent)
+{
+    Logger::log(LOG_TRACE, "Executing scheduleReferenceRelease\n");
+
+    // The references of earlier operations are released here, so that
+    // they do not accumulate even when clFinish is never called
+    drainReferenceReleases(env);
+
+    // Without event callbacks (OpenCL 1.0), the caller has to
+    // fall back to waiting for the event on a separate thread
+    if (clSetEventCallbackFP == NULL || clRetainEventFP == NULL)
+    {
+        return CL_INVALID_OPERATION;
+    }
+
+    // Native variables declaration
+    cl_event nativeEvent = NULL;
+
+    // Obtain native variable values
+    if (event != NULL)
+    {
+        nativeEvent = (cl_event)env->GetLongField(event, NativePointerObject_nativePointer);
+    }
+    ReferenceReleaseRecord *record = new (std::nothrow) ReferenceReleaseRecord();
+    if (record == NULL)
+    {
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    record->globalObject = env->NewGlobalRef(object);
+    if (record->globalObject == NULL)
+    {
+        delete record;
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    record->event = nativeEvent;
+    record->next = nullptr;
+
+    // The record always owns one reference to the event: Either the
+    // one of the event that was created only for this operation, or
+    // the one that is added here for the event of the caller
+    if (doRetainEvent)
+    {
+        (clRetainEventFP)(nativeEvent);
+    }
+    cl_int result = (clSetEventCallbackFP)(nativeEvent, CL_COMPLETE, &ReferenceReleaseCallback, record);
+    if (result != CL_SUCCESS)
+    {
+        if (doRetainEvent)
+        {
+            (clReleaseEventFP)(nativeEvent);
+        }
+        env->DeleteGlobalRef(record->globalObject);
+        delete record;
+    }
+    return result;
+}
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    drainReferenceReleasesNative
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_CL_drainReferenceReleasesNative
+  (JNIEnv *env, jclass UNUSED(cls))
+{
+    drainReferenceReleases(env);
+}
+
 //#endif // defined(CL_VERSION_1_1)
 
 
@@ -4437,7 +4959,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReadBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueReadBufferFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_read, nativeOffset, nativeCb, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    HazardWaitList nativeHazard_wait_list(nativeBuffer, NULL, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+    int result = (clEnqueueReadBufferFP)(nativeCommand_queue, nativeBuffer, nativeHazard_wait_list.blocking(nativeBlocking_read), nativeOffset, nativeCb, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+    result = nativeHazard_wait_list.commit(result);
 
     // Write back native variable values and clean up
     /* See notes about NON_BLOCKING_READ at end of file
@@ -4609,7 +5134,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReadBufferRectNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueReadBufferRectFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_read, nativeBuffer_offset, nativeHost_offset, nativeRegion, nativeBuffer_row_pitch, nativeBuffer_slice_pitch, nativeHost_row_pitch, nativeHost_slice_pitch, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueReadBufferRectFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_read, nativeBuffer_offset, nativeHost_offset, nativeRegion, nativeBuffer_row_pitch, nativeBuffer_slice_pitch, nativeHost_row_pitch, nativeHost_slice_pitch, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     /* See notes about NON_BLOCKING_READ at end of file
@@ -4710,7 +5236,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueWriteBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueWriteBufferFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_write, nativeOffset, nativeCb, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    HazardWaitList nativeHazard_wait_list(NULL, nativeBuffer, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+    int result = (clEnqueueWriteBufferFP)(nativeCommand_queue, nativeBuffer, nativeHazard_wait_list.blocking(nativeBlocking_write), nativeOffset, nativeCb, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+    result = nativeHazard_wait_list.commit(result);
 
     // Write back native variable values and clean up
     if (!releasePointerData(env, ptrPointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
@@ -4828,7 +5357,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueWriteBufferRectNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueWriteBufferRectFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_write, nativeBuffer_offset, nativeHost_offset, nativeRegion, nativeBuffer_row_pitch, nativeBuffer_slice_pitch, nativeHost_row_pitch, nativeHost_slice_pitch, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueWriteBufferRectFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_write, nativeBuffer_offset, nativeHost_offset, nativeRegion, nativeBuffer_row_pitch, nativeBuffer_slice_pitch, nativeHost_row_pitch, nativeHost_slice_pitch, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeBuffer_offset;
@@ -4906,7 +5436,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueFillBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueFillBufferFP)(nativeCommand_queue, nativeBuffer, nativePattern, nativePattern_size, nativeOffset, nativeSize, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    HazardWaitList nativeHazard_wait_list(NULL, nativeBuffer, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+    int result = (clEnqueueFillBufferFP)(nativeCommand_queue, nativeBuffer, nativePattern, nativePattern_size, nativeOffset, nativeSize, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+    nativeHazard_wait_list.commit(result);
 
     // Write back native variable values and clean up
     if (!releasePointerData(env, patternPointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
@@ -4979,7 +5512,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueCopyBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueCopyBufferFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_buffer, nativeSrc_offset, nativeDst_offset, nativeCb, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    HazardWaitList nativeHazard_wait_list(nativeSrc_buffer, nativeDst_buffer, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+    int result = (clEnqueueCopyBufferFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_buffer, nativeSrc_offset, nativeDst_offset, nativeCb, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+    nativeHazard_wait_list.commit(result);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -5085,7 +5621,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueCopyBufferRectNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueCopyBufferRectFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_buffer, nativeSrc_origin, nativeDst_origin, nativeRegion, nativeSrc_row_pitch, nativeSrc_slice_pitch, nativeDst_row_pitch, nativeDst_slice_pitch, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueCopyBufferRectFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_buffer, nativeSrc_origin, nativeDst_origin, nativeRegion, nativeSrc_row_pitch, nativeSrc_slice_pitch, nativeDst_row_pitch, nativeDst_slice_pitch, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeSrc_origin;
@@ -5194,7 +5731,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReadImageNative
     }
 
 
-    int result = (clEnqueueReadImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_read, nativeOrigin, nativeRegion, nativeRow_pitch, nativeSlice_pitch, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueReadImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_read, nativeOrigin, nativeRegion, nativeRow_pitch, nativeSlice_pitch, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // See notes about NON_BLOCKING_READ at end of file
 
@@ -5294,7 +5832,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueWriteImageNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueWriteImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_write, nativeOrigin, nativeRegion, nativeInput_row_pitch, nativeInput_slice_pitch, nativePtr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueWriteImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_write, nativeOrigin, nativeRegion, nativeInput_row_pitch, nativeInput_slice_pitch, nativePtr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeOrigin;
@@ -5385,7 +5924,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueFillImageNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueFillImageFP)(nativeCommand_queue, nativeImage, nativeFill_color, nativeOrigin, nativeRegion, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueFillImageFP)(nativeCommand_queue, nativeImage, nativeFill_color, nativeOrigin, nativeRegion, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeOrigin;
@@ -5487,7 +6027,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueCopyImageNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueCopyImageFP)(nativeCommand_queue, nativeSrc_image, nativeDst_image, nativeSrc_origin, nativeDst_origin, nativeRegion, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueCopyImageFP)(nativeCommand_queue, nativeSrc_image, nativeDst_image, nativeSrc_origin, nativeDst_origin, nativeRegion, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeSrc_origin;
@@ -5578,7 +6119,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueCopyImageToBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueCopyImageToBufferFP)(nativeCommand_queue, nativeSrc_image, nativeDst_buffer, nativeSrc_origin, nativeRegion, nativeDst_offset, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueCopyImageToBufferFP)(nativeCommand_queue, nativeSrc_image, nativeDst_buffer, nativeSrc_origin, nativeRegion, nativeDst_offset, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeSrc_origin;
@@ -5667,7 +6209,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueCopyBufferToImageNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueCopyBufferToImageFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_image, nativeSrc_offset, nativeDst_origin, nativeRegion, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueCopyBufferToImageFP)(nativeCommand_queue, nativeSrc_buffer, nativeDst_image, nativeSrc_offset, nativeDst_origin, nativeRegion, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeDst_origin;
@@ -5739,7 +6282,8 @@ JNIEXPORT jobject JNICALL Java_org_jocl_CL_clEnqueueMapBufferNative
         nativeEventPointer = &nativeEvent;
     }
 
-    nativeHostPointer = (clEnqueueMapBufferFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_map, nativeMap_flags, nativeOffset, nativeCb, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer, &nativeErrcode_ret);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    nativeHostPointer = (clEnqueueMapBufferFP)(nativeCommand_queue, nativeBuffer, nativeBlocking_map, nativeMap_flags, nativeOffset, nativeCb, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer, &nativeErrcode_ret);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -5832,7 +6376,8 @@ JNIEXPORT jobject JNICALL Java_org_jocl_CL_clEnqueueMapImageNative
         nativeEventPointer = &nativeEvent;
     }
 
-    nativeHostPointer = (clEnqueueMapImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_map, nativeMap_flags, nativeOrigin, nativeRegion, &nativeImage_row_pitch, &nativeImage_slice_pitch, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer, &nativeErrcode_ret);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    nativeHostPointer = (clEnqueueMapImageFP)(nativeCommand_queue, nativeImage, nativeBlocking_map, nativeMap_flags, nativeOrigin, nativeRegion, &nativeImage_row_pitch, &nativeImage_slice_pitch, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer, &nativeErrcode_ret);
 
     // Write back native variable values and clean up
     delete[] nativeOrigin;
@@ -5912,7 +6457,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueUnmapMemObjectNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueUnmapMemObjectFP)(nativeCommand_queue, nativeMemobj, nativeMapped_ptr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueUnmapMemObjectFP)(nativeCommand_queue, nativeMemobj, nativeMapped_ptr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -5981,7 +6527,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueMigrateMemObjectsNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueMigrateMemObjectsFP)(nativeCommand_queue, nativeNum_mem_objects, nativeMem_objects, nativeFlags, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueMigrateMemObjectsFP)(nativeCommand_queue, nativeNum_mem_objects, nativeMem_objects, nativeFlags, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeMem_objects;
@@ -6077,7 +6624,10 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueNDRangeKernelNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueNDRangeKernelFP)(nativeCommand_queue, nativeKernel, nativeWork_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeLocal_work_size, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    HazardWaitList nativeHazard_wait_list(nativeKernel, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+    int result = (clEnqueueNDRangeKernelFP)(nativeCommand_queue, nativeKernel, nativeWork_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeLocal_work_size, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+    nativeHazard_wait_list.commit(result);
 
     // Write back native variable values and clean up
     delete[] nativeGlobal_work_offset;
@@ -6139,7 +6689,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueTaskNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueTaskFP)(nativeCommand_queue, nativeKernel, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueTaskFP)(nativeCommand_queue, nativeKernel, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -6248,7 +6799,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueNativeKernelNative
 
     // TODO: The call currently has to be blocking,
     // to prevent the nativeArgs from being deleted
-    int result = (clEnqueueNativeKernelFP)(nativeCommand_queue, nativeUser_func, nativeArgs, nativeCb_args, nativeNum_mem_objects, nativeMem_list, (const void**)nativeArgs_mem_loc, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueNativeKernelFP)(nativeCommand_queue, nativeUser_func, nativeArgs, nativeCb_args, nativeNum_mem_objects, nativeMem_list, (const void**)nativeArgs_mem_loc, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // TODO: Have to block in the current implementation
     (clWaitForEventsFP)(1, &nativeEvent);
@@ -6313,7 +6865,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueMarkerWithWaitListNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueMarkerWithWaitListFP)(nativeCommand_queue, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list, true);
+    int result = (clEnqueueMarkerWithWaitListFP)(nativeCommand_queue, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -6372,7 +6925,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueBarrierWithWaitListNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueBarrierWithWaitListFP)(nativeCommand_queue, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list, true);
+    int result = (clEnqueueBarrierWithWaitListFP)(nativeCommand_queue, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -6479,7 +7033,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMFreeNative
     {
         nativeEventPointer = &nativeEvent;
     }
-    int result = (clEnqueueSVMFreeFP)(nativeCommand_queue, nativeNum_svm_pointers, nativeSvm_pointers, nativePfn_free_func, nativeUser_data, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueSVMFreeFP)(nativeCommand_queue, nativeNum_svm_pointers, nativeSvm_pointers, nativePfn_free_func, nativeUser_data, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeSvm_pointers;
@@ -6490,6 +7045,39 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMFreeNative
 
 }
 
+/**
+ * Allocates host memory and copies the given number of bytes from the
+ * given host memory into it. This is used as a staging area for 
+ * non-blocking copies from Java arrays, because the array contents may
+ * not be accessed after the native method returned. Plain host memory
+ * is used (and not an SVM allocation), because coarse-grained SVM may 
+ * not be accessed by the host without mapping it. Returns NULL if the 
+ * staging area can not be used or the allocation failed.
+ */
+static void* createHostStaging(const void *source, size_t size)
+{
+    if (clSetEventCallbackFP == NULL)
+    {
+        return NULL;
+    }
+    void *staging = malloc(size);
+    if (staging != NULL)
+    {
+        memcpy(staging, source, size);
+    }
+    return staging;
+}
+
+/**
+ * The event callback that frees a staging area that was created with
+ * createHostStaging, after the command that used it completed or 
+ * was terminated
+ */
+static void CL_CALLBACK freeHostStaging(cl_event UNUSED(event), cl_int UNUSED(status), void *staging)
+{
+    free(staging);
+}
+
 /*
  * Class:     org_jocl_CL
  * Method:    clEnqueueSVMMemcpyNative
@@ -6508,7 +7096,7 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMemcpyNative
 
     // Native variables declaration
     cl_command_queue nativeCommand_queue = NULL;
-	cl_bool nativeBlocking_copy = CL_TRUE;
+    cl_bool nativeBlocking_copy = CL_TRUE;
     void* nativeDst_ptr = NULL;
     void* nativeSrc_ptr = NULL;
     size_t nativeSize = 0;
@@ -6516,39 +7104,99 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMemcpyNative
     cl_event *nativeEvent_wait_list = NULL;
     cl_event nativeEvent = NULL;
     cl_event *nativeEventPointer = NULL;
+    void *nativeStaging = NULL;
 
     // Obtain native variable values
     if (command_queue != NULL)
     {
         nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
     }
-	nativeBlocking_copy = (cl_bool)blocking_copy;
-    if (dst_ptr != NULL)
+    nativeBlocking_copy = (cl_bool)blocking_copy;
+    nativeSize = (size_t)size;
+
+    // The pointers may be SVM pointers (with a byte offset), pointers
+    // to direct buffers, or pointers to Java arrays
+    PointerData *dst_ptrPointerData = initPointerData(env, dst_ptr);
+    if (dst_ptrPointerData == NULL)
+    {
+        return CL_INVALID_VALUE;
+    }
+    nativeDst_ptr = (void*)dst_ptrPointerData->pointer;
+    PointerData *src_ptrPointerData = initPointerData(env, src_ptr);
+    if (src_ptrPointerData == NULL)
     {
-        nativeDst_ptr = (void*)env->GetLongField(dst_ptr, NativePointerObject_nativePointer);
+        releasePointerData(env, dst_ptrPointerData, JNI_ABORT);
+        return CL_INVALID_VALUE;
     }
-    if (src_ptr != NULL)
+    nativeSrc_ptr = (void*)src_ptrPointerData->pointer;
+
+    // A Java array can not be written after this method returned, 
+    // so copies into arrays are always blocking. Non-blocking copies 
+    // from arrays use a host staging area, which is freed by an event
+    // callback after the copy completed. If the staging area can not 
+    // be allocated, the copy is blocking.
+    bool dstIsArray = dst_ptrPointerData->pointerType == POINTER_TYPE_ARRAY;
+    bool srcIsArray = src_ptrPointerData->pointerType == POINTER_TYPE_ARRAY;
+    if (!nativeBlocking_copy && dstIsArray)
     {
-        nativeSrc_ptr = (void*)env->GetLongField(src_ptr, NativePointerObject_nativePointer);
+        nativeBlocking_copy = CL_TRUE;
     }
-    nativeSize = (size_t)size;
+    if (!nativeBlocking_copy && srcIsArray)
+    {
+        nativeStaging = createHostStaging(nativeSrc_ptr, nativeSize);
+        if (nativeStaging != NULL)
+        {
+            nativeSrc_ptr = nativeStaging;
+        }
+        else
+        {
+            nativeBlocking_copy = CL_TRUE;
+        }
+    }
+
     nativeNum_events_in_wait_list = (cl_uint)num_events_in_wait_list;
     if (event_wait_list != NULL)
     {
         nativeEvent_wait_list = createEventList(env, event_wait_list, nativeNum_events_in_wait_list);
         if (nativeEvent_wait_list == NULL)
         {
+            releasePointerData(env, dst_ptrPointerData, JNI_ABORT);
+            releasePointerData(env, src_ptrPointerData, JNI_ABORT);
+            free(nativeStaging);
             return CL_OUT_OF_HOST_MEMORY;
         }
     }
-    if (event != NULL)
+    if (event != NULL || nativeStaging != NULL)
     {
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueSVMMemcpyFP)(nativeCommand_queue, nativeBlocking_copy, nativeDst_ptr, nativeSrc_ptr, nativeSize, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueSVMMemcpyFP)(nativeCommand_queue, nativeBlocking_copy, nativeDst_ptr, nativeSrc_ptr, nativeSize, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
+
+    // Free the staging area after the copy completed. If the callback
+    // can not be registered, wait for the copy and free it directly.
+    if (nativeStaging != NULL)
+    {
+        if (result != CL_SUCCESS)
+        {
+            free(nativeStaging);
+        }
+        else if ((clSetEventCallbackFP)(nativeEvent, CL_COMPLETE, &freeHostStaging, nativeStaging) != CL_SUCCESS)
+        {
+            (clWaitForEventsFP)(1, &nativeEvent);
+            free(nativeStaging);
+        }
+        if (event == NULL && nativeEvent != NULL)
+        {
+            (clReleaseEventFP)(nativeEvent);
+            nativeEvent = NULL;
+        }
+    }
 
     // Write back native variable values and clean up
+    if (!releasePointerData(env, dst_ptrPointerData, dstIsArray ? 0 : JNI_ABORT)) return CL_INVALID_HOST_PTR;
+    if (!releasePointerData(env, src_ptrPointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
     delete[] nativeEvent_wait_list;
     setNativePointer(env, event, (jlong)nativeEvent);
 
@@ -6587,14 +7235,30 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMemFillNative
     {
         nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
     }
-    if (svm_ptr != NULL)
+
+    // The SVM pointer may have a byte offset. The pattern is copied by
+    // the implementation when the command is enqueued, so it may be
+    // given as any pointer, including pointers to Java arrays.
+    PointerData *svm_ptrPointerData = initPointerData(env, svm_ptr);
+    if (svm_ptrPointerData == NULL)
     {
-        nativeSvm_ptr = (void*)env->GetLongField(svm_ptr, NativePointerObject_nativePointer);
+        return CL_INVALID_VALUE;
     }
-    if (pattern != NULL)
+    if (svm_ptrPointerData->pointerType == POINTER_TYPE_ARRAY)
     {
-        nativePattern = (void*)env->GetLongField(pattern, NativePointerObject_nativePointer);
+        releasePointerData(env, svm_ptrPointerData, JNI_ABORT);
+        ThrowByName(env, "java/lang/IllegalArgumentException",
+            "The SVM pointer may not be a pointer to a Java array");
+        return CL_INVALID_VALUE;
     }
+    nativeSvm_ptr = (void*)svm_ptrPointerData->pointer;
+    PointerData *patternPointerData = initPointerData(env, pattern);
+    if (patternPointerData == NULL)
+    {
+        releasePointerData(env, svm_ptrPointerData, JNI_ABORT);
+        return CL_INVALID_VALUE;
+    }
+    nativePattern = (void*)patternPointerData->pointer;
     nativePattern_size = (size_t)pattern_size;
     nativeSize = (size_t)size;
     nativeNum_events_in_wait_list = (cl_uint)num_events_in_wait_list;
@@ -6603,6 +7267,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMemFillNative
         nativeEvent_wait_list = createEventList(env, event_wait_list, nativeNum_events_in_wait_list);
         if (nativeEvent_wait_list == NULL)
         {
+            releasePointerData(env, svm_ptrPointerData, JNI_ABORT);
+            releasePointerData(env, patternPointerData, JNI_ABORT);
             return CL_OUT_OF_HOST_MEMORY;
         }
     }
@@ -6611,9 +7277,12 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMemFillNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueSVMMemFillFP)(nativeCommand_queue, nativeSvm_ptr, nativePattern, nativePattern_size, nativeSize, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueSVMMemFillFP)(nativeCommand_queue, nativeSvm_ptr, nativePattern, nativePattern_size, nativeSize, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
+    if (!releasePointerData(env, svm_ptrPointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
+    if (!releasePointerData(env, patternPointerData, JNI_ABORT)) return CL_INVALID_HOST_PTR;
     delete[] nativeEvent_wait_list;
     setNativePointer(env, event, (jlong)nativeEvent);
 
@@ -6673,7 +7342,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMMapNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueSVMMapFP)(nativeCommand_queue, nativeBlocking_map, nativeFlags, nativeSvm_ptr, nativeSize, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueSVMMapFP)(nativeCommand_queue, nativeBlocking_map, nativeFlags, nativeSvm_ptr, nativeSize, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -6729,7 +7399,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueSVMUnmapNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueSVMUnmapFP)(nativeCommand_queue, nativeSvm_ptr, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueSVMUnmapFP)(nativeCommand_queue, nativeSvm_ptr, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeEvent_wait_list;
@@ -7279,7 +7950,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueAcquireGLObjectsNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueAcquireGLObjectsFP)(nativeCommand_queue, nativeNum_objects, nativeMem_objects, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueAcquireGLObjectsFP)(nativeCommand_queue, nativeNum_objects, nativeMem_objects, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeMem_objects;
@@ -7343,7 +8015,8 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReleaseGLObjectsNative
         nativeEventPointer = &nativeEvent;
     }
 
-    int result = (clEnqueueReleaseGLObjectsFP)(nativeCommand_queue, nativeNum_objects, nativeMem_objects, nativeNum_events_in_wait_list, nativeEvent_wait_list, nativeEventPointer);
+    NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+    int result = (clEnqueueReleaseGLObjectsFP)(nativeCommand_queue, nativeNum_objects, nativeMem_objects, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeEventPointer);
 
     // Write back native variable values and clean up
     delete[] nativeMem_objects;
@@ -7353,6 +8026,55 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReleaseGLObjectsNative
     return result;
 }
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    clCreateEventFromGLsyncKHRNative
+ * Signature: (Lorg/jocl/cl_context;J[I)Lorg/jocl/cl_event;
+ */
+JNIEXPORT jobject JNICALL Java_org_jocl_CL_clCreateEventFromGLsyncKHRNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject context, jlong sync, jintArray errcode_ret)
+{
+    Logger::log(LOG_TRACE, "Executing clCreateEventFromGLsyncKHR\n");
+    if (clCreateEventFromGLsyncKHRFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clCreateEventFromGLsyncKHR is not supported");
+        return NULL;
+    }
+
+    // Native variables declaration
+    cl_context nativeContext = NULL;
+    cl_GLsync nativeSync = NULL;
+    cl_int nativeErrcode_ret = 0;
+
+    // Obtain native variable values
+    if (context != NULL)
+    {
+        nativeContext = (cl_context)env->GetLongField(context, NativePointerObject_nativePointer);
+    }
+    nativeSync = (cl_GLsync)sync;
+
+    cl_event nativeEvent = (clCreateEventFromGLsyncKHRFP)(nativeContext, nativeSync, &nativeErrcode_ret);
+
+    // Write back native variable values and clean up
+    if (!set(env, errcode_ret, 0, nativeErrcode_ret)) return NULL;
+
+    if (nativeEvent == NULL)
+    {
+        return NULL;
+    }
+
+    // Create the event object which will be returned
+    jobject eventObject = env->NewObject(cl_event_Class, cl_event_Constructor);
+    if (env->ExceptionCheck())
+    {
+        return NULL;
+    }
+    setNativePointer(env, eventObject, (jlong)nativeEvent);
+
+    return eventObject;
+}
+
 /*
  * Class:     org_jocl_CL
  * Method:    clGetGLContextInfoAPPLENative
@@ -7414,6 +8136,11 @@ void registerAllNatives(JNIEnv *env, jclass cls)
     nativeMethod.signature = "(I)V";
     env->RegisterNatives(cls, &nativeMethod, 1);
 
+    nativeMethod.name = "getInitializationTimesNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_getInitializationTimesNative;
+    nativeMethod.signature = "([J)V";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
     nativeMethod.name = "allocateAlignedNative";
     nativeMethod.fnPtr = (void*)Java_org_jocl_CL_allocateAlignedNative;
     nativeMethod.signature = "(IILorg/jocl/Pointer;)Ljava/nio/ByteBuffer;";
@@ -7730,6 +8457,21 @@ void registerAllNatives(JNIEnv *env, jclass cls)
     nativeMethod.signature = "(Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;[J)I";
     env->RegisterNatives(cls, &nativeMethod, 1);
 
+    nativeMethod.name = "clGetKernelSuggestedLocalWorkSizeKHRNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clGetKernelSuggestedLocalWorkSizeKHRNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_command_queue;Lorg/jocl/cl_kernel;I[J[J[J)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
+    nativeMethod.name = "clGetKernelSubGroupInfoNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clGetKernelSubGroupInfoNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
+    nativeMethod.name = "clGetKernelSubGroupInfoKHRNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clGetKernelSubGroupInfoKHRNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
     nativeMethod.name = "clWaitForEventsNative";
     nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clWaitForEventsNative;
     nativeMethod.signature = "(I[Lorg/jocl/cl_event;)I";
@@ -7760,6 +8502,26 @@ void registerAllNatives(JNIEnv *env, jclass cls)
     nativeMethod.signature = "(Lorg/jocl/cl_event;I)I";
     env->RegisterNatives(cls, &nativeMethod, 1);
 
+    nativeMethod.name = "createUserEventsNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_createUserEventsNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_context;[Lorg/jocl/cl_event;[I)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
+    nativeMethod.name = "releaseEventsNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_releaseEventsNative;
+    nativeMethod.signature = "([Lorg/jocl/cl_event;I)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
+    nativeMethod.name = "scheduleReferenceReleaseNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_scheduleReferenceReleaseNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_event;Ljava/lang/Object;Z)I";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
+    nativeMethod.name = "drainReferenceReleasesNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_drainReferenceReleasesNative;
+    nativeMethod.signature = "()V";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+
     nativeMethod.name = "clSetEventCallbackNative";
     nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clSetEventCallbackNative;
     nativeMethod.signature = "(Lorg/jocl/cl_event;ILorg/jocl/EventCallbackFunction;Ljava/lang/Object;)I";
@@ -8001,6 +8763,13 @@ void registerAllNatives(JNIEnv *env, jclass cls)
     env->RegisterNatives(cls, &nativeMethod, 1);
 #endif
 
+#if defined (CL_GL_INTEROP_ENABLED)
+    nativeMethod.name = "clCreateEventFromGLsyncKHRNative";
+    nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clCreateEventFromGLsyncKHRNative;
+    nativeMethod.signature = "(Lorg/jocl/cl_context;J[I)Lorg/jocl/cl_event;";
+    env->RegisterNatives(cls, &nativeMethod, 1);
+#endif
+
 nativeMethod.name = "clGetGLContextInfoAPPLENative";
 nativeMethod.fnPtr = (void*)Java_org_jocl_CL_clGetGLContextInfoAPPLENative;
 nativeMethod.signature = "(Lorg/jocl/cl_context;JIJLorg/jocl/Pointer;[J)I";
@@ -986,6 +986,14 @@ JNIEXPORT jboolean JNICALL Java_org_jocl_CL_initNativeLibrary
 JNIEXPORT void JNICALL Java_org_jocl_CL_setLogLevelNative
   (JNIEnv *, jclass, jint);
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    getInitializationTimesNative
+ * Signature: ([J)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_CL_getInitializationTimesNative
+  (JNIEnv *, jclass, jlongArray);
+
 /*
  * Class:     org_jocl_CL
  * Method:    clGetPlatformIDsNative
@@ -1474,6 +1482,30 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelArgInfoNative
 JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelWorkGroupInfoNative
   (JNIEnv *, jclass, jobject, jobject, jint, jlong, jobject, jlongArray);
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSuggestedLocalWorkSizeKHRNative
+ * Signature: (Lorg/jocl/cl_command_queue;Lorg/jocl/cl_kernel;I[J[J[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSuggestedLocalWorkSizeKHRNative
+  (JNIEnv *, jclass, jobject, jobject, jint, jlongArray, jlongArray, jlongArray);
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSubGroupInfoNative
+ * Signature: (Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSubGroupInfoNative
+  (JNIEnv *, jclass, jobject, jobject, jint, jlong, jobject, jlong, jobject, jlongArray);
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    clGetKernelSubGroupInfoKHRNative
+ * Signature: (Lorg/jocl/cl_kernel;Lorg/jocl/cl_device_id;IJLorg/jocl/Pointer;JLorg/jocl/Pointer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_clGetKernelSubGroupInfoKHRNative
+  (JNIEnv *, jclass, jobject, jobject, jint, jlong, jobject, jlong, jobject, jlongArray);
+
 /*
  * Class:     org_jocl_CL
  * Method:    clWaitForEventsNative
@@ -1522,6 +1554,22 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clReleaseEventNative
 JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetUserEventStatusNative
   (JNIEnv *, jclass, jobject, jint);
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    createUserEventsNative
+ * Signature: (Lorg/jocl/cl_context;[Lorg/jocl/cl_event;[I)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_createUserEventsNative
+  (JNIEnv *, jclass, jobject, jobjectArray, jintArray);
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    releaseEventsNative
+ * Signature: ([Lorg/jocl/cl_event;I)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_releaseEventsNative
+  (JNIEnv *, jclass, jobjectArray, jint);
+
 /*
  * Class:     org_jocl_CL
  * Method:    clSetEventCallbackNative
@@ -1530,6 +1578,22 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetUserEventStatusNative
 JNIEXPORT jint JNICALL Java_org_jocl_CL_clSetEventCallbackNative
   (JNIEnv *, jclass, jobject, jint, jobject, jobject);
 
+/*
+ * Class:     org_jocl_CL
+ * Method:    scheduleReferenceReleaseNative
+ * Signature: (Lorg/jocl/cl_event;Ljava/lang/Object;Z)I
+ */
+JNIEXPORT jint JNICALL Java_org_jocl_CL_scheduleReferenceReleaseNative
+  (JNIEnv *, jclass, jobject, jobject, jboolean);
+
+/*
+ * Class:     org_jocl_CL
+ * Method:    drainReferenceReleasesNative
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_CL_drainReferenceReleasesNative
+  (JNIEnv *, jclass);
+
 /*
  * Class:     org_jocl_CL
  * Method:    clGetEventProfilingInfoNative
@@ -1874,6 +1938,14 @@ JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueAcquireGLObjectsNative
 JNIEXPORT jint JNICALL Java_org_jocl_CL_clEnqueueReleaseGLObjectsNative
   (JNIEnv *, jclass, jobject, jint, jobjectArray, jint, jobjectArray, jobject);
   
+/*
+ * Class:     org_jocl_CL
+ * Method:    clCreateEventFromGLsyncKHRNative
+ * Signature: (Lorg/jocl/cl_context;J[I)Lorg/jocl/cl_event;
+ */
+JNIEXPORT jobject JNICALL Java_org_jocl_CL_clCreateEventFromGLsyncKHRNative
+  (JNIEnv *, jclass, jobject, jlong, jintArray);
+
 /*
  * Class:     org_jocl_CL
  * Method:    clGetGLContextInfoAPPLENative
@@ -0,0 +1,304 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "KernelArgs.hpp"
+
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "CLFunctions.hpp"
+#include "PointerUtils.hpp"
+
+// The shadowing of kernel arguments. When it is enabled, a copy of the
+// bytes of each argument that is set with clSetKernelArg is stored for
+// each kernel. The number of arguments of a kernel is obtained from 
+// CL_KERNEL_NUM_ARGS when the first argument of the kernel is set. 
+// When an argument is set to the same value again, the call is skipped.
+// The shadow is only updated after the implementation accepted the
+// value. As for clSetKernelArg itself, setting the arguments of the 
+// same kernel from multiple threads requires external synchronization.
+
+/**
+ * The maximum size of an argument value that is shadowed. Larger
+ * values are always passed to the implementation.
+ */
+#define MAX_SHADOWED_ARG_SIZE 1024
+
+/**
+ * The shadow of a single kernel argument
+ */
+struct KernelArgShadow
+{
+    /**
+     * Whether the shadow contains the value that was last set
+     */
+    bool valid;
+
+    /**
+     * Whether the value was NULL (for __local arguments)
+     */
+    bool isNull;
+
+    /**
+     * The size of the value
+     */
+    size_t size;
+
+    /**
+     * The bytes of the value, if it was not NULL
+     */
+    std::vector<unsigned char> bytes;
+
+    KernelArgShadow() : valid(false), isNull(false), size(0) {}
+};
+
+/**
+ * Whether the shadowing is enabled
+ */
+static std::atomic<bool> kernelArgShadowingEnabled(false);
+
+/**
+ * The mutex protecting the shadows and the statistics
+ */
+static std::mutex kernelArgMutex;
+
+/**
+ * The argument shadows for each kernel
+ */
+static std::unordered_map<cl_kernel, std::vector<KernelArgShadow> > kernelArgShadows;
+
+/**
+ * The statistics: The number of calls that have been skipped, and the
+ * number of calls that have been passed to the implementation while
+ * the shadowing was enabled
+ */
+static jlong kernelArgsSkipped = 0;
+static jlong kernelArgsForwarded = 0;
+
+
+/**
+ * Returns the shadows for the arguments of the given kernel, creating
+ * them if necessary. Returns NULL if the number of arguments can not
+ * be obtained. Must be called while holding the kernelArgMutex.
+ */
+static std::vector<KernelArgShadow>* getKernelArgShadows(cl_kernel kernel)
+{
+    std::unordered_map<cl_kernel, std::vector<KernelArgShadow> >::iterator iter = kernelArgShadows.find(kernel);
+    if (iter != kernelArgShadows.end())
+    {
+        return &iter->second;
+    }
+    if (clGetKernelInfoFP == NULL)
+    {
+        return NULL;
+    }
+    cl_uint numArgs = 0;
+    cl_int result = (clGetKernelInfoFP)(kernel, CL_KERNEL_NUM_ARGS, sizeof(cl_uint), &numArgs, NULL);
+    if (result != CL_SUCCESS)
+    {
+        Logger::log(LOG_DEBUG, "Could not obtain number of kernel arguments, not shadowing\n");
+        return NULL;
+    }
+    std::vector<KernelArgShadow> &shadows = kernelArgShadows[kernel];
+    shadows.resize(numArgs);
+    return &shadows;
+}
+
+/**
+ * Returns whether the given value is equal to the shadowed value of the
+ * given kernel argument. Must be called while holding the kernelArgMutex.
+ */
+static bool isShadowEqual(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value)
+{
+    std::vector<KernelArgShadow> *shadows = getKernelArgShadows(kernel);
+    if (shadows == NULL || arg_index >= shadows->size())
+    {
+        return false;
+    }
+    const KernelArgShadow &shadow = (*shadows)[arg_index];
+    if (!shadow.valid || shadow.size != arg_size)
+    {
+        return false;
+    }
+    if (arg_value == NULL)
+    {
+        return shadow.isNull;
+    }
+    return !shadow.isNull && memcmp(shadow.bytes.data(), arg_value, arg_size) == 0;
+}
+
+bool isKernelArgUnchanged(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value)
+{
+    if (!kernelArgShadowingEnabled.load() || kernel == NULL)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    if (isShadowEqual(kernel, arg_index, arg_size, arg_value))
+    {
+        kernelArgsSkipped++;
+        return true;
+    }
+    kernelArgsForwarded++;
+    return false;
+}
+
+void updateKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value, cl_int result)
+{
+    if (!kernelArgShadowingEnabled.load() || kernel == NULL)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    std::vector<KernelArgShadow> *shadows = getKernelArgShadows(kernel);
+    if (shadows == NULL || arg_index >= shadows->size())
+    {
+        return;
+    }
+    KernelArgShadow &shadow = (*shadows)[arg_index];
+    if (result != CL_SUCCESS || arg_size > MAX_SHADOWED_ARG_SIZE)
+    {
+        shadow.valid = false;
+        return;
+    }
+    shadow.valid = true;
+    shadow.size = arg_size;
+    shadow.isNull = (arg_value == NULL);
+    if (arg_value == NULL)
+    {
+        shadow.bytes.clear();
+    }
+    else
+    {
+        const unsigned char *bytes = (const unsigned char*)arg_value;
+        shadow.bytes.assign(bytes, bytes + arg_size);
+    }
+}
+
+void invalidateKernelArg(cl_kernel kernel, cl_uint arg_index)
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    std::unordered_map<cl_kernel, std::vector<KernelArgShadow> >::iterator iter = kernelArgShadows.find(kernel);
+    if (iter != kernelArgShadows.end() && arg_index < iter->second.size())
+    {
+        iter->second[arg_index].valid = false;
+    }
+}
+
+void invalidateKernelArgs(cl_kernel kernel)
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    kernelArgShadows.erase(kernel);
+}
+
+void invalidateKernelArgHandle(const void *handle)
+{
+    if (!kernelArgShadowingEnabled.load() || handle == NULL)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    std::unordered_map<cl_kernel, std::vector<KernelArgShadow> >::iterator iter;
+    for (iter = kernelArgShadows.begin(); iter != kernelArgShadows.end(); ++iter)
+    {
+        std::vector<KernelArgShadow> &shadows = iter->second;
+        for (size_t i = 0; i < shadows.size(); i++)
+        {
+            KernelArgShadow &shadow = shadows[i];
+            if (shadow.valid && !shadow.isNull && shadow.size == sizeof(handle) &&
+                memcmp(shadow.bytes.data(), &handle, sizeof(handle)) == 0)
+            {
+                shadow.valid = false;
+            }
+        }
+    }
+}
+
+
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_KernelArgs_setShadowingEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jboolean enabled)
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    kernelArgShadowingEnabled.store(enabled == JNI_TRUE);
+    if (!enabled)
+    {
+        kernelArgShadows.clear();
+    }
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL Java_org_jocl_KernelArgs_isShadowingEnabledNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    return kernelArgShadowingEnabled.load();
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_KernelArgs_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray statistics)
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    if (!set(env, statistics, 0, kernelArgsSkipped)) return;
+    if (!set(env, statistics, 1, kernelArgsForwarded)) return;
+    if (!set(env, statistics, 2, (jlong)kernelArgShadows.size())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_KernelArgs_resetStatisticsNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    kernelArgsSkipped = 0;
+    kernelArgsForwarded = 0;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_KernelArgs_invalidateNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject kernel)
+{
+    if (kernel == NULL)
+    {
+        return;
+    }
+    cl_kernel nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    invalidateKernelArgs(nativeKernel);
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_KernelArgs_clearNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    std::lock_guard<std::mutex> lock(kernelArgMutex);
+    kernelArgShadows.clear();
+}
@@ -0,0 +1,66 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef KERNEL_ARGS_HPP
+#define KERNEL_ARGS_HPP
+
+#include "JOCLCommon.hpp"
+
+/**
+ * Returns whether the shadowing of kernel arguments is enabled, and the
+ * given argument value is equal to the value that was last set for the
+ * given argument of the given kernel. In this case, the call to
+ * clSetKernelArg may be skipped, and it is counted as a skipped call.
+ */
+bool isKernelArgUnchanged(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value);
+
+/**
+ * Update the shadow of the given kernel argument after clSetKernelArg
+ * has been called with the given result
+ */
+void updateKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value, cl_int result);
+
+/**
+ * Remove the shadow of the given kernel argument. This is called when
+ * the argument is set with a function other than clSetKernelArg.
+ */
+void invalidateKernelArg(cl_kernel kernel, cl_uint arg_index);
+
+/**
+ * Remove the shadows of all arguments of the given kernel
+ */
+void invalidateKernelArgs(cl_kernel kernel);
+
+/**
+ * Remove the shadows of all kernel arguments whose value is the given
+ * handle. This is called when a memory object or sampler is released,
+ * because the implementation may return the same handle value for a 
+ * new object afterwards.
+ */
+void invalidateKernelArgHandle(const void *handle);
+
+#endif // KERNEL_ARGS_HPP
@@ -0,0 +1,510 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LocalWorkSizes.hpp"
+
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+#include "CLJNIUtils.hpp"
+#include "FunctionPointerUtils.hpp"
+#include "EventWaitLists.hpp"
+#include "HazardTracking.hpp"
+
+// The cache for local work sizes that are used by the LocalWorkSizes
+// class. The local work sizes are either obtained from the
+// clGetKernelSuggestedLocalWorkSizeKHR function of the
+// cl_khr_suggested_local_work_size extension, or computed from the
+// CL_KERNEL_WORK_GROUP_SIZE and CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+// of the kernel, when the extension is not supported. The entries for
+// a kernel are removed when clReleaseKernel is called for the kernel.
+
+/**
+ * The maximum number of entries in the cache. When this number is 
+ * reached, the cache is cleared.
+ */
+#define MAX_LOCAL_WORK_SIZE_CACHE_ENTRIES 4096
+
+/**
+ * The key for the cache of local work sizes
+ */
+struct LocalWorkSizeKey
+{
+    cl_kernel kernel;
+    cl_device_id device;
+    cl_uint workDim;
+    size_t global[3];
+
+    bool operator<(const LocalWorkSizeKey &other) const
+    {
+        return 
+            std::tie(kernel, device, workDim, global[0], global[1], global[2]) <
+            std::tie(other.kernel, other.device, other.workDim, other.global[0], other.global[1], other.global[2]);
+    }
+};
+
+/**
+ * The value for the cache of local work sizes
+ */
+struct LocalWorkSizeValue
+{
+    size_t local[3];
+};
+
+/**
+ * The mutex protecting the cache and the statistics
+ */
+static std::mutex localWorkSizesMutex;
+
+/**
+ * The cache of local work sizes
+ */
+static std::map<LocalWorkSizeKey, LocalWorkSizeValue> localWorkSizes;
+
+/**
+ * The statistics: Cache hits, cache misses, the number of local work
+ * sizes that have been obtained from the implementation, and the 
+ * number of local work sizes that have been computed heuristically
+ */
+static jlong localWorkSizeCacheHits = 0;
+static jlong localWorkSizeCacheMisses = 0;
+static jlong localWorkSizesSuggested = 0;
+static jlong localWorkSizesComputed = 0;
+
+
+/**
+ * Obtain the clGetKernelSuggestedLocalWorkSizeKHR function for the 
+ * platform of the given device. Returns NULL if the function is not
+ * available.
+ */
+static clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType getKernelSuggestedLocalWorkSizeFunctionForDevice(cl_device_id device)
+{
+    return (clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType)
+        obtainExtensionFunctionPointer(device, "clGetKernelSuggestedLocalWorkSizeKHR");
+}
+
+/**
+ * Obtain the clGetKernelSuggestedLocalWorkSizeKHR function for the 
+ * platform of the device of the given command queue. Returns NULL if 
+ * the function is not available.
+ */
+clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType getKernelSuggestedLocalWorkSizeFunction(cl_command_queue command_queue)
+{
+    if (clGetCommandQueueInfoFP == NULL)
+    {
+        return NULL;
+    }
+    cl_device_id device = NULL;
+    cl_int result = (clGetCommandQueueInfoFP)(command_queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL);
+    if (result != CL_SUCCESS)
+    {
+        return NULL;
+    }
+    return getKernelSuggestedLocalWorkSizeFunctionForDevice(device);
+}
+
+/**
+ * Remove all cached local work sizes of the given kernel
+ */
+void invalidateLocalWorkSizes(cl_kernel kernel)
+{
+    std::lock_guard<std::mutex> lock(localWorkSizesMutex);
+    if (localWorkSizes.empty())
+    {
+        return;
+    }
+    LocalWorkSizeKey key;
+    memset(&key, 0, sizeof(LocalWorkSizeKey));
+    key.kernel = kernel;
+    std::map<LocalWorkSizeKey, LocalWorkSizeValue>::iterator iter = localWorkSizes.lower_bound(key);
+    while (iter != localWorkSizes.end() && iter->first.kernel == kernel)
+    {
+        iter = localWorkSizes.erase(iter);
+    }
+}
+
+/**
+ * Returns the largest value that is not larger than the given limit,
+ * is a multiple of the given step size, and divides the given global
+ * size. Returns 0 if there is no such value.
+ */
+static size_t largestDivisor(size_t global, size_t limit, size_t step)
+{
+    for (size_t candidate = limit - (limit % step); candidate >= step; candidate -= step)
+    {
+        if (global % candidate == 0)
+        {
+            return candidate;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Compute a local work size for the given kernel and global work size,
+ * when the cl_khr_suggested_local_work_size extension is not supported:
+ * If the kernel was compiled with a reqd_work_group_size attribute,
+ * then this size is used. Otherwise, the size in the first dimension
+ * is the largest multiple of the CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+ * that divides the global size, and the remaining work group size is 
+ * distributed to the other dimensions.
+ */
+static cl_int computeLocalWorkSize(cl_kernel kernel, cl_device_id device, cl_uint workDim, const size_t *global, size_t *local)
+{
+    if (clGetKernelWorkGroupInfoFP == NULL || clGetDeviceInfoFP == NULL)
+    {
+        return CL_INVALID_OPERATION;
+    }
+    size_t compileSize[3] = { 0, 0, 0 };
+    cl_int result = (clGetKernelWorkGroupInfoFP)(kernel, device, CL_KERNEL_COMPILE_WORK_GROUP_SIZE, sizeof(compileSize), compileSize, NULL);
+    if (result == CL_SUCCESS && compileSize[0] != 0)
+    {
+        for (cl_uint d = 0; d < workDim; d++)
+        {
+            local[d] = compileSize[d];
+        }
+        return CL_SUCCESS;
+    }
+    size_t maxSize = 0;
+    result = (clGetKernelWorkGroupInfoFP)(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxSize, NULL);
+    if (result != CL_SUCCESS)
+    {
+        return result;
+    }
+    size_t multiple = 1;
+    result = (clGetKernelWorkGroupInfoFP)(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &multiple, NULL);
+    if (result != CL_SUCCESS || multiple == 0)
+    {
+        multiple = 1;
+    }
+    size_t maxItemSizes[16];
+    size_t maxItemSizesSize = 0;
+    result = (clGetDeviceInfoFP)(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxItemSizes), maxItemSizes, &maxItemSizesSize);
+    if (result != CL_SUCCESS)
+    {
+        return result;
+    }
+
+    size_t remaining = maxSize == 0 ? 1 : maxSize;
+    for (cl_uint d = 0; d < workDim; d++)
+    {
+        size_t limit = remaining;
+        if (d < maxItemSizesSize / sizeof(size_t) && maxItemSizes[d] < limit)
+        {
+            limit = maxItemSizes[d];
+        }
+        if (global[d] < limit)
+        {
+            limit = global[d];
+        }
+        size_t size = 0;
+        if (d == 0 && multiple > 1)
+        {
+            size = largestDivisor(global[d], limit, multiple);
+        }
+        if (size == 0)
+        {
+            size = largestDivisor(global[d], limit, 1);
+        }
+        if (size == 0)
+        {
+            size = 1;
+        }
+        local[d] = size;
+        remaining /= size;
+    }
+    return CL_SUCCESS;
+}
+
+/**
+ * Obtain the local work size for the given kernel and global work size
+ * on the device of the given command queue, from the cache, or from 
+ * the implementation or the heuristic, if there is no cache entry yet.
+ */
+static cl_int obtainLocalWorkSize(cl_command_queue command_queue, cl_kernel kernel, cl_uint workDim, const size_t *offset, const size_t *global, size_t *local)
+{
+    if (workDim < 1 || workDim > 3)
+    {
+        return CL_INVALID_WORK_DIMENSION;
+    }
+    if (global == NULL)
+    {
+        return CL_INVALID_GLOBAL_WORK_SIZE;
+    }
+    if (clGetCommandQueueInfoFP == NULL)
+    {
+        return CL_INVALID_OPERATION;
+    }
+    cl_device_id device = NULL;
+    cl_int result = (clGetCommandQueueInfoFP)(command_queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL);
+    if (result != CL_SUCCESS)
+    {
+        return result;
+    }
+
+    LocalWorkSizeKey key;
+    memset(&key, 0, sizeof(LocalWorkSizeKey));
+    key.kernel = kernel;
+    key.device = device;
+    key.workDim = workDim;
+    for (cl_uint d = 0; d < workDim; d++)
+    {
+        key.global[d] = global[d];
+    }
+    {
+        std::lock_guard<std::mutex> lock(localWorkSizesMutex);
+        std::map<LocalWorkSizeKey, LocalWorkSizeValue>::iterator iter = localWorkSizes.find(key);
+        if (iter != localWorkSizes.end())
+        {
+            localWorkSizeCacheHits++;
+            for (cl_uint d = 0; d < workDim; d++)
+            {
+                local[d] = iter->second.local[d];
+            }
+            return CL_SUCCESS;
+        }
+        localWorkSizeCacheMisses++;
+    }
+
+    LocalWorkSizeValue value;
+    memset(&value, 0, sizeof(LocalWorkSizeValue));
+    bool suggested = false;
+    clGetKernelSuggestedLocalWorkSizeKHRFunctionPointerType function =
+        getKernelSuggestedLocalWorkSizeFunctionForDevice(device);
+    if (function != NULL)
+    {
+        result = (function)(command_queue, kernel, workDim, offset, global, value.local);
+        suggested = true;
+    }
+    else
+    {
+        result = computeLocalWorkSize(kernel, device, workDim, global, value.local);
+    }
+    if (result != CL_SUCCESS)
+    {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(localWorkSizesMutex);
+    if (suggested)
+    {
+        localWorkSizesSuggested++;
+    }
+    else
+    {
+        localWorkSizesComputed++;
+    }
+    if (localWorkSizes.size() >= MAX_LOCAL_WORK_SIZE_CACHE_ENTRIES)
+    {
+        localWorkSizes.clear();
+    }
+    localWorkSizes[key] = value;
+    for (cl_uint d = 0; d < workDim; d++)
+    {
+        local[d] = value.local[d];
+    }
+    return CL_SUCCESS;
+}
+
+
+
+extern "C"
+JNIEXPORT jboolean JNICALL Java_org_jocl_LocalWorkSizes_isSuggestionSupportedNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject command_queue)
+{
+    cl_command_queue nativeCommand_queue = NULL;
+    if (command_queue != NULL)
+    {
+        nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
+    }
+    return getKernelSuggestedLocalWorkSizeFunction(nativeCommand_queue) != NULL;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL Java_org_jocl_LocalWorkSizes_getLocalWorkSizeNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject command_queue, jobject kernel, jint work_dim, jlongArray global_work_offset, jlongArray global_work_size, jlongArray local_work_size)
+{
+    Logger::log(LOG_TRACE, "Executing LocalWorkSizes.getLocalWorkSize\n");
+
+    // Native variables declaration
+    cl_command_queue nativeCommand_queue = NULL;
+    cl_kernel nativeKernel = NULL;
+    size_t *nativeGlobal_work_offset = NULL;
+    size_t *nativeGlobal_work_size = NULL;
+    size_t nativeLocal_work_size[3] = { 0, 0, 0 };
+
+    // Obtain native variable values
+    if (command_queue != NULL)
+    {
+        nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
+    }
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    if (global_work_offset != NULL)
+    {
+        nativeGlobal_work_offset = convertArray(env, global_work_offset);
+        if (nativeGlobal_work_offset == NULL)
+        {
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    if (global_work_size != NULL)
+    {
+        nativeGlobal_work_size = convertArray(env, global_work_size);
+        if (nativeGlobal_work_size == NULL)
+        {
+            delete[] nativeGlobal_work_offset;
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+
+    int result = obtainLocalWorkSize(nativeCommand_queue, nativeKernel, (cl_uint)work_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeLocal_work_size);
+
+    // Write back native variable values and clean up
+    delete[] nativeGlobal_work_offset;
+    delete[] nativeGlobal_work_size;
+    if (result == CL_SUCCESS && local_work_size != NULL)
+    {
+        for (int d = 0; d < work_dim; d++)
+        {
+            if (!set(env, local_work_size, d, (jlong)nativeLocal_work_size[d])) return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL Java_org_jocl_LocalWorkSizes_enqueueNDRangeKernelNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject command_queue, jobject kernel, jint work_dim, jlongArray global_work_offset, jlongArray global_work_size, jint num_events_in_wait_list, jobjectArray event_wait_list, jobject event)
+{
+    Logger::log(LOG_TRACE, "Executing LocalWorkSizes.enqueueNDRangeKernel\n");
+    if (clEnqueueNDRangeKernelFP == NULL)
+    {
+        ThrowByName(env, "java/lang/UnsupportedOperationException",
+            "The function clEnqueueNDRangeKernel is not supported");
+        return CL_INVALID_OPERATION;
+    }
+
+    // Native variables declaration
+    cl_command_queue nativeCommand_queue = NULL;
+    cl_kernel nativeKernel = NULL;
+    cl_uint nativeWork_dim = 0;
+    size_t *nativeGlobal_work_offset = NULL;
+    size_t *nativeGlobal_work_size = NULL;
+    size_t nativeLocal_work_size[3] = { 0, 0, 0 };
+    cl_uint nativeNum_events_in_wait_list = 0;
+    cl_event *nativeEvent_wait_list = NULL;
+    cl_event nativeEvent = NULL;
+    cl_event *nativeEventPointer = NULL;
+
+    // Obtain native variable values
+    if (command_queue != NULL)
+    {
+        nativeCommand_queue = (cl_command_queue)env->GetLongField(command_queue, NativePointerObject_nativePointer);
+    }
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    nativeWork_dim = (cl_uint)work_dim;
+    if (global_work_offset != NULL)
+    {
+        nativeGlobal_work_offset = convertArray(env, global_work_offset);
+        if (nativeGlobal_work_offset == NULL)
+        {
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    if (global_work_size != NULL)
+    {
+        nativeGlobal_work_size = convertArray(env, global_work_size);
+        if (nativeGlobal_work_size == NULL)
+        {
+            delete[] nativeGlobal_work_offset;
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    nativeNum_events_in_wait_list = (cl_uint)num_events_in_wait_list;
+    if (event_wait_list != NULL)
+    {
+        nativeEvent_wait_list = createEventList(env, event_wait_list, nativeNum_events_in_wait_list);
+        if (nativeEvent_wait_list == NULL)
+        {
+            delete[] nativeGlobal_work_offset;
+            delete[] nativeGlobal_work_size;
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    if (event != NULL)
+    {
+        nativeEventPointer = &nativeEvent;
+    }
+
+    int result = obtainLocalWorkSize(nativeCommand_queue, nativeKernel, nativeWork_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeLocal_work_size);
+    if (result == CL_SUCCESS)
+    {
+        HazardWaitList nativeHazard_wait_list(nativeKernel, nativeEvent_wait_list, nativeNum_events_in_wait_list);
+        NormalizedEventWaitList nativeNormalized_wait_list(nativeCommand_queue, nativeHazard_wait_list.events, nativeHazard_wait_list.num_events);
+        result = (clEnqueueNDRangeKernelFP)(nativeCommand_queue, nativeKernel, nativeWork_dim, nativeGlobal_work_offset, nativeGlobal_work_size, nativeLocal_work_size, nativeNormalized_wait_list.num_events, nativeNormalized_wait_list.events, nativeHazard_wait_list.eventPointer(nativeEventPointer));
+        nativeHazard_wait_list.commit(result);
+    }
+
+    // Write back native variable values and clean up
+    delete[] nativeGlobal_work_offset;
+    delete[] nativeGlobal_work_size;
+    delete[] nativeEvent_wait_list;
+    setNativePointer(env, event, (jlong)nativeEvent);
+
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_LocalWorkSizes_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray statistics)
+{
+    std::lock_guard<std::mutex> lock(localWorkSizesMutex);
+    if (!set(env, statistics, 0, localWorkSizeCacheHits)) return;
+    if (!set(env, statistics, 1, localWorkSizeCacheMisses)) return;
+    if (!set(env, statistics, 2, localWorkSizesSuggested)) return;
+    if (!set(env, statistics, 3, localWorkSizesComputed)) return;
+    if (!set(env, statistics, 4, (jlong)localWorkSizes.size())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_LocalWorkSizes_clearCacheNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    std::lock_guard<std::mutex> lock(localWorkSizesMutex);
+    localWorkSizes.clear();
+}
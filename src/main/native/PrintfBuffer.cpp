@@ -0,0 +1,508 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "PrintfBuffer.hpp"
+
+#include <string.h>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+
+// The function that is passed to clCreateContext* for Java 
+// context notification callbacks, defined in JOCL.cpp
+void CL_CALLBACK CreateContextFunction(const char *errinfo, const void *private_info, size_t cb, void *user_dataInfo);
+
+/**
+ * A buffer for the output of the printf function in kernels, as it is 
+ * received via the callback of the cl_arm_printf extension.<br>
+ * <br>
+ * The callback only copies the output into a ring buffer, and returns 
+ * immediately, so that the thread of the OpenCL implementation is not 
+ * blocked by attaching to the JVM and calling Java. The output is 
+ * delivered to the Java PrintfCallbackFunction in batches, by a 
+ * dedicated thread. When the ring buffer is full, the output is 
+ * dropped, and the number of dropped bytes and chunks is counted.
+ */
+struct PrintfBuffer
+{
+    // The ring buffer, and the index of the first byte and the 
+    // number of bytes that it contains
+    std::vector<char> ring;
+    size_t head;
+    size_t size;
+
+    // Whether the delivery thread is currently calling Java
+    bool delivering;
+
+    // Whether the delivery thread should terminate
+    bool stopped;
+
+    // Whether the output should be delivered immediately
+    bool flushRequested;
+
+    // The maximum time that output is kept in the ring buffer
+    std::chrono::milliseconds flushInterval;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+
+    // The statistics, guarded by the mutex
+    jlong deliveredBytes;
+    jlong deliveredBatches;
+    jlong droppedBytes;
+    jlong droppedChunks;
+
+    // Global references to the Java callback, user data and 
+    // context object, and the callback method ID
+    jobject globalPfn_notify;
+    jobject globalUser_data;
+    jobject globalContext;
+    jmethodID function;
+
+    // The CallbackInfo for the context notification callback that 
+    // was given to clCreateContext*, or NULL
+    CallbackInfo *contextCallbackInfo;
+};
+
+// The set of buffers that have been created and not yet destroyed,
+// used for validating the handles that are passed in as context
+// properties
+static std::set<PrintfBuffer*> printfBuffers;
+static std::mutex printfBuffersMutex;
+
+/**
+ * Returns whether the given pointer is a valid PrintfBuffer
+ */
+static bool isValidPrintfBuffer(PrintfBuffer *printfBuffer)
+{
+    std::lock_guard<std::mutex> lock(printfBuffersMutex);
+    return printfBuffers.count(printfBuffer) > 0;
+}
+
+/**
+ * The function that is passed as the CL_PRINTF_CALLBACK_ARM context 
+ * property. The user_data is the PrintfBuffer. The data is copied into 
+ * the ring buffer, or dropped if the ring buffer is full.
+ */
+static void CL_CALLBACK PrintfBufferCallback(const char *buffer, unsigned int len, size_t UNUSED(complete), void *user_data)
+{
+    PrintfBuffer *printfBuffer = (PrintfBuffer*)user_data;
+    bool halfFull = false;
+    {
+        std::lock_guard<std::mutex> lock(printfBuffer->mutex);
+        size_t capacity = printfBuffer->ring.size();
+        if (len > capacity - printfBuffer->size)
+        {
+            printfBuffer->droppedBytes += len;
+            printfBuffer->droppedChunks++;
+            return;
+        }
+        size_t tail = (printfBuffer->head + printfBuffer->size) % capacity;
+        size_t first = capacity - tail;
+        if (first > len)
+        {
+            first = len;
+        }
+        memcpy(&printfBuffer->ring[tail], buffer, first);
+        memcpy(&printfBuffer->ring[0], buffer + first, len - first);
+        size_t half = capacity / 2;
+        halfFull = printfBuffer->size < half && printfBuffer->size + len >= half;
+        printfBuffer->size += len;
+    }
+    if (halfFull)
+    {
+        printfBuffer->condition.notify_all();
+    }
+}
+
+/**
+ * The function that is passed to clCreateContext* as the context 
+ * notification callback when a PrintfBuffer is used, because the 
+ * user_data is then the PrintfBuffer. It delegates to the 
+ * CreateContextFunction with the original CallbackInfo.
+ */
+static void CL_CALLBACK PrintfBufferContextCallback(const char *errinfo, const void *private_info, size_t cb, void *user_data)
+{
+    PrintfBuffer *printfBuffer = (PrintfBuffer*)user_data;
+    CreateContextFunction(errinfo, private_info, cb, printfBuffer->contextCallbackInfo);
+}
+
+/**
+ * The function that is executed by the delivery thread of the given 
+ * PrintfBuffer: It waits until the flush interval has passed, the
+ * ring buffer is half full, or a flush was requested, and passes
+ * all available output to Java with a single call.
+ */
+static void runDelivery(PrintfBuffer *printfBuffer)
+{
+    JNIEnv *env = NULL;
+    if (globalJvm->AttachCurrentThreadAsDaemon((void**)&env, NULL) != JNI_OK)
+    {
+        Logger::log(LOG_ERROR, "Could not attach printf delivery thread\n");
+        return;
+    }
+    std::vector<char> batch;
+    std::unique_lock<std::mutex> lock(printfBuffer->mutex);
+    while (true)
+    {
+        printfBuffer->condition.wait_for(lock, printfBuffer->flushInterval, [printfBuffer]()
+        {
+            return printfBuffer->stopped || printfBuffer->flushRequested ||
+                printfBuffer->size >= printfBuffer->ring.size() / 2;
+        });
+        printfBuffer->flushRequested = false;
+        if (printfBuffer->size == 0)
+        {
+            if (printfBuffer->stopped)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // Copy the contents of the ring buffer into the batch
+        size_t capacity = printfBuffer->ring.size();
+        size_t size = printfBuffer->size;
+        size_t first = capacity - printfBuffer->head;
+        if (first > size)
+        {
+            first = size;
+        }
+        batch.resize(size + 1);
+        memcpy(&batch[0], &printfBuffer->ring[printfBuffer->head], first);
+        memcpy(&batch[first], &printfBuffer->ring[0], size - first);
+        batch[size] = '\0';
+        printfBuffer->head = (printfBuffer->head + size) % capacity;
+        printfBuffer->size = 0;
+        printfBuffer->delivering = true;
+        lock.unlock();
+
+        // Call Java while the ring buffer may receive new output
+        if (printfBuffer->globalContext != NULL)
+        {
+            jstring batchString = env->NewStringUTF(&batch[0]);
+            if (batchString != NULL)
+            {
+                env->CallVoidMethod(printfBuffer->globalPfn_notify, printfBuffer->function,
+                    printfBuffer->globalContext, (jint)size, batchString, printfBuffer->globalUser_data);
+                env->DeleteLocalRef(batchString);
+            }
+            finishCallback(env);
+        }
+
+        lock.lock();
+        printfBuffer->delivering = false;
+        printfBuffer->deliveredBytes += (jlong)size;
+        printfBuffer->deliveredBatches++;
+        printfBuffer->condition.notify_all();
+    }
+    lock.unlock();
+    globalJvm->DetachCurrentThread();
+}
+
+/**
+ * Checks whether the given context properties contain the 
+ * CL_PRINTF_CALLBACK_ARM property. If this is the case, then its
+ * value is the PrintfBuffer that was created on Java side. The value
+ * is replaced by the PrintfBufferCallback, the user_data is replaced
+ * by the PrintfBuffer, and the context notification function (if any)
+ * is replaced by a function that delegates to the original one.
+ *
+ * Returns the PrintfBuffer, or NULL if no PrintfBuffer was given.
+ * If the PrintfBuffer is not valid, then an IllegalArgumentException
+ * is thrown and NULL is returned.
+ */
+PrintfBuffer* preparePrintfBuffer(JNIEnv *env, cl_context_properties *properties, CreateContextFunctionPointer *pfn_notify, void **user_data)
+{
+    if (properties == NULL)
+    {
+        return NULL;
+    }
+    for (int i=0; properties[i] != 0; i+=2)
+    {
+        if (properties[i] != CL_PRINTF_CALLBACK_ARM)
+        {
+            continue;
+        }
+        PrintfBuffer *printfBuffer = (PrintfBuffer*)properties[i+1];
+        if (!isValidPrintfBuffer(printfBuffer))
+        {
+            ThrowByName(env, "java/lang/IllegalArgumentException",
+                "The CL_PRINTF_CALLBACK_ARM property is not a valid PrintfBuffer");
+            return NULL;
+        }
+        properties[i+1] = (cl_context_properties)&PrintfBufferCallback;
+        printfBuffer->contextCallbackInfo = (CallbackInfo*)*user_data;
+        if (*pfn_notify != NULL)
+        {
+            *pfn_notify = &PrintfBufferContextCallback;
+        }
+        *user_data = (void*)printfBuffer;
+        return printfBuffer;
+    }
+    return NULL;
+}
+
+/**
+ * Attach the given PrintfBuffer to the given context that was created 
+ * with the properties that have been passed to preparePrintfBuffer: 
+ * The Java cl_context object is created, so that it can be passed to
+ * the Java callback
+ */
+void attachPrintfBuffer(JNIEnv *env, PrintfBuffer *printfBuffer, cl_context context)
+{
+    jclass contextClass = env->FindClass("org/jocl/cl_context");
+    if (contextClass == NULL)
+    {
+        return;
+    }
+    jmethodID constructor = env->GetMethodID(contextClass, "<init>", "()V");
+    if (constructor == NULL)
+    {
+        return;
+    }
+    jobject contextObject = env->NewObject(contextClass, constructor);
+    if (contextObject == NULL)
+    {
+        return;
+    }
+    setNativePointer(env, contextObject, (jlong)context);
+    jobject globalContext = env->NewGlobalRef(contextObject);
+    std::lock_guard<std::mutex> lock(printfBuffer->mutex);
+    if (printfBuffer->globalContext != NULL)
+    {
+        env->DeleteGlobalRef(printfBuffer->globalContext);
+    }
+    printfBuffer->globalContext = globalContext;
+}
+
+/**
+ * Obtain the PrintfBuffer from the native pointer of the given Java
+ * PrintfBuffer, throwing an IllegalStateException if it is NULL
+ */
+static PrintfBuffer* getPrintfBuffer(JNIEnv *env, jobject buffer)
+{
+    PrintfBuffer *printfBuffer = (PrintfBuffer*)env->GetLongField(buffer, NativePointerObject_nativePointer);
+    if (printfBuffer == NULL)
+    {
+        ThrowByName(env, "java/lang/IllegalStateException",
+            "The PrintfBuffer has already been destroyed");
+    }
+    return printfBuffer;
+}
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Class:     org_jocl_PrintfBuffer
+ * Method:    createNative
+ * Signature: (Lorg/jocl/PrintfBuffer;IJLorg/jocl/PrintfCallbackFunction;Ljava/lang/Object;)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_PrintfBuffer_createNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject buffer, jint capacity, jlong flushIntervalMillis, jobject pfn_notify, jobject user_data)
+{
+    Logger::log(LOG_TRACE, "Executing createPrintfBuffer\n");
+
+    jclass functionClass = env->FindClass("org/jocl/PrintfCallbackFunction");
+    if (functionClass == NULL)
+    {
+        return;
+    }
+    jmethodID function = env->GetMethodID(functionClass, "function", 
+        "(Lorg/jocl/cl_context;ILjava/lang/String;Ljava/lang/Object;)V");
+    if (function == NULL)
+    {
+        return;
+    }
+
+    PrintfBuffer *printfBuffer = new (std::nothrow) PrintfBuffer();
+    if (printfBuffer == NULL)
+    {
+        ThrowByName(env, "java/lang/OutOfMemoryError",
+            "Out of memory while creating printf buffer");
+        return;
+    }
+    try
+    {
+        printfBuffer->ring.resize((size_t)capacity);
+    }
+    catch (std::bad_alloc&)
+    {
+        delete printfBuffer;
+        ThrowByName(env, "java/lang/OutOfMemoryError",
+            "Out of memory while creating printf buffer");
+        return;
+    }
+    printfBuffer->head = 0;
+    printfBuffer->size = 0;
+    printfBuffer->delivering = false;
+    printfBuffer->stopped = false;
+    printfBuffer->flushRequested = false;
+    printfBuffer->flushInterval = std::chrono::milliseconds(flushIntervalMillis);
+    printfBuffer->deliveredBytes = 0;
+    printfBuffer->deliveredBatches = 0;
+    printfBuffer->droppedBytes = 0;
+    printfBuffer->droppedChunks = 0;
+    printfBuffer->globalPfn_notify = env->NewGlobalRef(pfn_notify);
+    printfBuffer->globalUser_data = NULL;
+    if (user_data != NULL)
+    {
+        printfBuffer->globalUser_data = env->NewGlobalRef(user_data);
+    }
+    printfBuffer->globalContext = NULL;
+    printfBuffer->function = function;
+    printfBuffer->contextCallbackInfo = NULL;
+    printfBuffer->thread = std::thread(runDelivery, printfBuffer);
+    {
+        std::lock_guard<std::mutex> lock(printfBuffersMutex);
+        printfBuffers.insert(printfBuffer);
+    }
+    setNativePointer(env, buffer, (jlong)printfBuffer);
+}
+
+/*
+ * Class:     org_jocl_PrintfBuffer
+ * Method:    flushNative
+ * Signature: (Lorg/jocl/PrintfBuffer;)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_PrintfBuffer_flushNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject buffer)
+{
+    Logger::log(LOG_TRACE, "Executing flushPrintfBuffer\n");
+
+    PrintfBuffer *printfBuffer = getPrintfBuffer(env, buffer);
+    if (printfBuffer == NULL)
+    {
+        return;
+    }
+    if (std::this_thread::get_id() == printfBuffer->thread.get_id())
+    {
+        ThrowByName(env, "java/lang/IllegalStateException",
+            "The PrintfBuffer may not be flushed from its callback");
+        return;
+    }
+    std::unique_lock<std::mutex> lock(printfBuffer->mutex);
+    printfBuffer->flushRequested = true;
+    printfBuffer->condition.notify_all();
+    while (printfBuffer->size > 0 || printfBuffer->delivering)
+    {
+        printfBuffer->condition.wait(lock);
+    }
+}
+
+/*
+ * Class:     org_jocl_PrintfBuffer
+ * Method:    getStatisticsNative
+ * Signature: (Lorg/jocl/PrintfBuffer;[J)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_PrintfBuffer_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject buffer, jlongArray statistics)
+{
+    PrintfBuffer *printfBuffer = getPrintfBuffer(env, buffer);
+    if (printfBuffer == NULL)
+    {
+        return;
+    }
+    jlong deliveredBytes = 0;
+    jlong deliveredBatches = 0;
+    jlong droppedBytes = 0;
+    jlong droppedChunks = 0;
+    {
+        std::lock_guard<std::mutex> lock(printfBuffer->mutex);
+        deliveredBytes = printfBuffer->deliveredBytes;
+        deliveredBatches = printfBuffer->deliveredBatches;
+        droppedBytes = printfBuffer->droppedBytes;
+        droppedChunks = printfBuffer->droppedChunks;
+    }
+    if (!set(env, statistics, 0, deliveredBytes)) return;
+    if (!set(env, statistics, 1, deliveredBatches)) return;
+    if (!set(env, statistics, 2, droppedBytes)) return;
+    if (!set(env, statistics, 3, droppedChunks)) return;
+}
+
+/*
+ * Class:     org_jocl_PrintfBuffer
+ * Method:    destroyNative
+ * Signature: (Lorg/jocl/PrintfBuffer;)V
+ */
+JNIEXPORT void JNICALL Java_org_jocl_PrintfBuffer_destroyNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject buffer)
+{
+    Logger::log(LOG_TRACE, "Executing destroyPrintfBuffer\n");
+
+    PrintfBuffer *printfBuffer = getPrintfBuffer(env, buffer);
+    if (printfBuffer == NULL)
+    {
+        return;
+    }
+    if (std::this_thread::get_id() == printfBuffer->thread.get_id())
+    {
+        ThrowByName(env, "java/lang/IllegalStateException",
+            "The PrintfBuffer may not be destroyed from its callback");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(printfBuffersMutex);
+        printfBuffers.erase(printfBuffer);
+    }
+
+    // Stop the delivery thread, which will deliver the remaining output
+    {
+        std::lock_guard<std::mutex> lock(printfBuffer->mutex);
+        printfBuffer->stopped = true;
+    }
+    printfBuffer->condition.notify_all();
+    printfBuffer->thread.join();
+
+    env->DeleteGlobalRef(printfBuffer->globalPfn_notify);
+    if (printfBuffer->globalUser_data != NULL)
+    {
+        env->DeleteGlobalRef(printfBuffer->globalUser_data);
+    }
+    if (printfBuffer->globalContext != NULL)
+    {
+        env->DeleteGlobalRef(printfBuffer->globalContext);
+    }
+    delete printfBuffer;
+    setNativePointer(env, buffer, (jlong)0);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PRINTF_BUFFER_HPP
+#define PRINTF_BUFFER_HPP
+
+#include "JOCLCommon.hpp"
+
+// The context properties of the cl_arm_printf extension
+#ifndef CL_PRINTF_CALLBACK_ARM
+#define CL_PRINTF_CALLBACK_ARM   0x40B0
+#endif
+#ifndef CL_PRINTF_BUFFERSIZE_ARM
+#define CL_PRINTF_BUFFERSIZE_ARM 0x40B1
+#endif
+
+struct PrintfBuffer;
+
+PrintfBuffer* preparePrintfBuffer(JNIEnv *env, cl_context_properties *properties, CreateContextFunctionPointer *pfn_notify, void **user_data);
+void attachPrintfBuffer(JNIEnv *env, PrintfBuffer *printfBuffer, cl_context context);
+
+#endif // PRINTF_BUFFER_HPP
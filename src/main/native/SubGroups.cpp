@@ -0,0 +1,344 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SubGroups.hpp"
+
+#include <string.h>
+#include <stdlib.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+#include "FunctionPointerUtils.hpp"
+
+// The cache for the sub-group information that is used by the
+// SubGroups class. The information is obtained with the core
+// clGetKernelSubGroupInfo function for OpenCL 2.1 devices, or with
+// clGetKernelSubGroupInfoKHR for devices that support the
+// cl_khr_subgroups extension. All queries are constant for a given
+// kernel, device and input value, so the results are cached until
+// clReleaseKernel is called for the kernel.
+
+/**
+ * The maximum number of entries in the cache. When this number is 
+ * reached, the cache is cleared.
+ */
+#define MAX_SUB_GROUP_INFO_CACHE_ENTRIES 4096
+
+/**
+ * The key for the cache of sub-group information. The input and 
+ * output are size_t values or arrays of up to 3 size_t values.
+ */
+struct SubGroupInfoKey
+{
+    cl_kernel kernel;
+    cl_device_id device;
+    cl_uint paramName;
+    size_t inputCount;
+    size_t input[3];
+    size_t outputCount;
+
+    bool operator<(const SubGroupInfoKey &other) const
+    {
+        return 
+            std::tie(kernel, device, paramName, inputCount, input[0], input[1], input[2], outputCount) <
+            std::tie(other.kernel, other.device, other.paramName, other.inputCount, other.input[0], other.input[1], other.input[2], other.outputCount);
+    }
+};
+
+/**
+ * The value for the cache of sub-group information
+ */
+struct SubGroupInfoValue
+{
+    size_t output[3];
+};
+
+/**
+ * The mutex protecting the caches and the statistics
+ */
+static std::mutex subGroupInfoMutex;
+
+/**
+ * The cache of sub-group information
+ */
+static std::map<SubGroupInfoKey, SubGroupInfoValue> subGroupInfos;
+
+/**
+ * The function that is used for each device. The value is NULL when 
+ * the device does not support sub-groups.
+ */
+static std::map<cl_device_id, clGetKernelSubGroupInfoFunctionPointerType> subGroupInfoFunctions;
+
+/**
+ * The statistics: Cache hits and cache misses
+ */
+static jlong subGroupInfoCacheHits = 0;
+static jlong subGroupInfoCacheMisses = 0;
+
+
+/**
+ * Obtain the clGetKernelSubGroupInfoKHR function for the platform of
+ * the given device. Returns NULL if the function is not available.
+ */
+clGetKernelSubGroupInfoFunctionPointerType getKernelSubGroupInfoKHRFunction(cl_device_id device)
+{
+    return (clGetKernelSubGroupInfoFunctionPointerType)
+        obtainExtensionFunctionPointer(device, "clGetKernelSubGroupInfoKHR");
+}
+
+/**
+ * Returns whether the CL_DEVICE_VERSION of the given device is at
+ * least OpenCL 2.1
+ */
+static bool isOpenCL21Device(cl_device_id device)
+{
+    if (clGetDeviceInfoFP == NULL)
+    {
+        return false;
+    }
+    char version[256];
+    memset(version, 0, sizeof(version));
+    cl_int result = (clGetDeviceInfoFP)(device, CL_DEVICE_VERSION, sizeof(version) - 1, version, NULL);
+    if (result != CL_SUCCESS || strncmp(version, "OpenCL ", 7) != 0)
+    {
+        return false;
+    }
+    char *end = NULL;
+    long major = strtol(version + 7, &end, 10);
+    long minor = 0;
+    if (end != NULL && *end == '.')
+    {
+        minor = strtol(end + 1, NULL, 10);
+    }
+    return major > 2 || (major == 2 && minor >= 1);
+}
+
+/**
+ * Obtain the function that should be used for querying the sub-group
+ * information for the given device: The core function for OpenCL 2.1
+ * devices, and the extension function otherwise. Returns NULL if the
+ * device does not support sub-groups.
+ */
+static clGetKernelSubGroupInfoFunctionPointerType getKernelSubGroupInfoFunction(cl_device_id device)
+{
+    {
+        std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+        std::map<cl_device_id, clGetKernelSubGroupInfoFunctionPointerType>::iterator iter =
+            subGroupInfoFunctions.find(device);
+        if (iter != subGroupInfoFunctions.end())
+        {
+            return iter->second;
+        }
+    }
+    clGetKernelSubGroupInfoFunctionPointerType function = NULL;
+    if (clGetKernelSubGroupInfoFP != NULL && isOpenCL21Device(device))
+    {
+        function = clGetKernelSubGroupInfoFP;
+    }
+    else
+    {
+        function = getKernelSubGroupInfoKHRFunction(device);
+    }
+    std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+    subGroupInfoFunctions[device] = function;
+    return function;
+}
+
+/**
+ * Remove all cached sub-group information of the given kernel
+ */
+void invalidateSubGroupInfo(cl_kernel kernel)
+{
+    std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+    if (subGroupInfos.empty())
+    {
+        return;
+    }
+    SubGroupInfoKey key;
+    memset(&key, 0, sizeof(SubGroupInfoKey));
+    key.kernel = kernel;
+    std::map<SubGroupInfoKey, SubGroupInfoValue>::iterator iter = subGroupInfos.lower_bound(key);
+    while (iter != subGroupInfos.end() && iter->first.kernel == kernel)
+    {
+        iter = subGroupInfos.erase(iter);
+    }
+}
+
+/**
+ * Query the sub-group information with the given parameter name, for
+ * the given input values, from the cache or from the implementation.
+ */
+static cl_int querySubGroupInfo(cl_kernel kernel, cl_device_id device, cl_uint paramName, const size_t *input, size_t inputCount, size_t *output, size_t outputCount)
+{
+    if (inputCount > 3 || outputCount < 1 || outputCount > 3)
+    {
+        return CL_INVALID_VALUE;
+    }
+    SubGroupInfoKey key;
+    memset(&key, 0, sizeof(SubGroupInfoKey));
+    key.kernel = kernel;
+    key.device = device;
+    key.paramName = paramName;
+    key.inputCount = inputCount;
+    for (size_t i = 0; i < inputCount; i++)
+    {
+        key.input[i] = input[i];
+    }
+    key.outputCount = outputCount;
+    {
+        std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+        std::map<SubGroupInfoKey, SubGroupInfoValue>::iterator iter = subGroupInfos.find(key);
+        if (iter != subGroupInfos.end())
+        {
+            subGroupInfoCacheHits++;
+            for (size_t i = 0; i < outputCount; i++)
+            {
+                output[i] = iter->second.output[i];
+            }
+            return CL_SUCCESS;
+        }
+        subGroupInfoCacheMisses++;
+    }
+
+    clGetKernelSubGroupInfoFunctionPointerType function = getKernelSubGroupInfoFunction(device);
+    if (function == NULL)
+    {
+        return CL_INVALID_OPERATION;
+    }
+    SubGroupInfoValue value;
+    memset(&value, 0, sizeof(SubGroupInfoValue));
+    cl_int result = (function)(kernel, device, paramName, 
+        inputCount * sizeof(size_t), inputCount == 0 ? NULL : key.input, 
+        outputCount * sizeof(size_t), value.output, NULL);
+    if (result != CL_SUCCESS)
+    {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+    if (subGroupInfos.size() >= MAX_SUB_GROUP_INFO_CACHE_ENTRIES)
+    {
+        subGroupInfos.clear();
+    }
+    subGroupInfos[key] = value;
+    for (size_t i = 0; i < outputCount; i++)
+    {
+        output[i] = value.output[i];
+    }
+    return CL_SUCCESS;
+}
+
+
+
+extern "C"
+JNIEXPORT jboolean JNICALL Java_org_jocl_SubGroups_isSupportedNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject device)
+{
+    cl_device_id nativeDevice = NULL;
+    if (device != NULL)
+    {
+        nativeDevice = (cl_device_id)env->GetLongField(device, NativePointerObject_nativePointer);
+    }
+    return getKernelSubGroupInfoFunction(nativeDevice) != NULL;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL Java_org_jocl_SubGroups_getKernelSubGroupInfoNative
+  (JNIEnv *env, jclass UNUSED(cls), jobject kernel, jobject device, jint param_name, jlongArray input_value, jlongArray param_value)
+{
+    Logger::log(LOG_TRACE, "Executing SubGroups.getKernelSubGroupInfo\n");
+
+    // Native variables declaration
+    cl_kernel nativeKernel = NULL;
+    cl_device_id nativeDevice = NULL;
+    size_t nativeInput_value[3] = { 0, 0, 0 };
+    size_t nativeInput_count = 0;
+    size_t nativeParam_value[3] = { 0, 0, 0 };
+    size_t nativeParam_count = 0;
+
+    // Obtain native variable values
+    if (kernel != NULL)
+    {
+        nativeKernel = (cl_kernel)env->GetLongField(kernel, NativePointerObject_nativePointer);
+    }
+    if (device != NULL)
+    {
+        nativeDevice = (cl_device_id)env->GetLongField(device, NativePointerObject_nativePointer);
+    }
+    if (input_value != NULL)
+    {
+        nativeInput_count = (size_t)env->GetArrayLength(input_value);
+        if (nativeInput_count > 3)
+        {
+            return CL_INVALID_VALUE;
+        }
+        jlong input[3];
+        env->GetLongArrayRegion(input_value, 0, (jsize)nativeInput_count, input);
+        for (size_t i = 0; i < nativeInput_count; i++)
+        {
+            nativeInput_value[i] = (size_t)input[i];
+        }
+    }
+    if (param_value != NULL)
+    {
+        nativeParam_count = (size_t)env->GetArrayLength(param_value);
+    }
+
+    int result = querySubGroupInfo(nativeKernel, nativeDevice, (cl_uint)param_name, nativeInput_value, nativeInput_count, nativeParam_value, nativeParam_count);
+
+    // Write back native variable values and clean up
+    if (result == CL_SUCCESS)
+    {
+        for (size_t i = 0; i < nativeParam_count; i++)
+        {
+            if (!set(env, param_value, (int)i, (jlong)nativeParam_value[i])) return CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_SubGroups_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlongArray statistics)
+{
+    std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+    if (!set(env, statistics, 0, subGroupInfoCacheHits)) return;
+    if (!set(env, statistics, 1, subGroupInfoCacheMisses)) return;
+    if (!set(env, statistics, 2, (jlong)subGroupInfos.size())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_SubGroups_clearCacheNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls))
+{
+    std::lock_guard<std::mutex> lock(subGroupInfoMutex);
+    subGroupInfos.clear();
+}
@@ -0,0 +1,907 @@
+/*
+ * JOCL - Java bindings for OpenCL
+ *
+ * Copyright (c) 2009-2015 Marco Hutter - http://www.jocl.org
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <jni.h>
+#include <string.h>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <system_error>
+#include <algorithm>
+#include <stdint.h>
+
+#include "JOCLCommon.hpp"
+#include "Logger.hpp"
+#include "JNIUtils.hpp"
+#include "PointerUtils.hpp"
+#include "CLFunctions.hpp"
+#include "KernelArgs.hpp"
+#include "HazardTracking.hpp"
+
+// The native part of the SubmissionThread class. Producers (arbitrary
+// Java threads) write compact command descriptors into a bounded, 
+// lock-free multi-producer single-consumer ring. A single native 
+// thread drains the ring and issues the commands through the function
+// pointers, so that only this thread contends on the locks of the 
+// implementation. The ring is the bounded queue by Dmitry Vyukov: 
+// Each slot carries a sequence number that tells producers and the 
+// consumer whether the slot is free or filled. Producers only block 
+// when the ring is full. The consumer sleeps on a condition variable 
+// when the ring is empty, and producers only take the associated 
+// mutex when the consumer is sleeping.
+//
+// Kernel argument values that are passed with a kernel command are
+// copied into the descriptor, and set by the consumer immediately 
+// before the kernel is enqueued. Transfers keep a global reference
+// to the Pointer of the host memory until their event is complete.
+
+/**
+ * The types of commands
+ */
+enum SubmissionCommandType
+{
+    SUBMISSION_NDRANGE_KERNEL,
+    SUBMISSION_WRITE_BUFFER,
+    SUBMISSION_READ_BUFFER,
+    SUBMISSION_COPY_BUFFER,
+    SUBMISSION_FLUSH,
+    SUBMISSION_FINISH,
+    SUBMISSION_STOP
+};
+
+/**
+ * The argument values of a kernel command. The values are stored
+ * consecutively in the 'values' vector. Arguments without a value
+ * (for local memory) have an offset of SIZE_MAX.
+ */
+struct SubmissionKernelArgs
+{
+    std::vector<size_t> sizes;
+    std::vector<size_t> offsets;
+    std::vector<unsigned char> values;
+};
+
+/**
+ * A command descriptor
+ */
+struct SubmissionCommand
+{
+    SubmissionCommandType type;
+    cl_command_queue queue;
+    cl_kernel kernel;
+    cl_uint workDim;
+    size_t globalOffset[3];
+    size_t globalSize[3];
+    size_t localSize[3];
+    SubmissionKernelArgs *kernelArgs;
+    cl_mem srcMem;
+    cl_mem dstMem;
+    size_t srcOffset;
+    size_t dstOffset;
+    size_t size;
+    void *hostPointer;
+    jobject hostReference;
+    cl_int *finishResult;
+};
+
+/**
+ * A transfer that has been enqueued, together with the global 
+ * reference to the Pointer of its host memory
+ */
+struct PendingTransfer
+{
+    cl_event event;
+    jobject hostReference;
+};
+
+/**
+ * A slot of the ring
+ */
+struct SubmissionSlot
+{
+    std::atomic<size_t> sequence;
+    SubmissionCommand command;
+};
+
+/**
+ * The state of one submission thread
+ */
+struct Submitter
+{
+    /**
+     * The slots of the ring, and the mask for the indices (the number
+     * of slots is a power of two)
+     */
+    SubmissionSlot *slots;
+    size_t mask;
+
+    /**
+     * The position where the next command will be written by a
+     * producer, and the position where the consumer will read the
+     * next command. The latter is only accessed by the consumer.
+     */
+    std::atomic<size_t> enqueuePosition;
+    size_t dequeuePosition;
+
+    /**
+     * The number of commands after which the queues are flushed, or 0
+     * if they should only be flushed when the ring is empty
+     */
+    int flushInterval;
+
+    /**
+     * The number of commands that have been submitted. The ticket of
+     * a command is its position plus one, so a command has been 
+     * submitted when this value is at least its ticket.
+     */
+    std::atomic<size_t> submitted;
+
+    /**
+     * The mutex and condition for the consumer waiting for commands
+     */
+    std::mutex commandMutex;
+    std::condition_variable commandCondition;
+    std::atomic<bool> consumerSleeping;
+
+    /**
+     * The mutex and condition for producers waiting until commands
+     * have been submitted
+     */
+    std::mutex submittedMutex;
+    std::condition_variable submittedCondition;
+    std::atomic<int> submittedWaiters;
+
+    /**
+     * The statistics: The number of flushes, the number of times that
+     * a producer found the ring full, the number of failed commands
+     * and the last error code
+     */
+    std::atomic<jlong> flushes;
+    std::atomic<jlong> fullWaits;
+    std::atomic<jlong> errors;
+    std::atomic<jint> lastError;
+
+    /**
+     * The transfers that may not be complete yet, and the number of 
+     * pending transfers at which the completed ones are released. 
+     * Only accessed by the consumer.
+     */
+    std::vector<PendingTransfer> pendingTransfers;
+    size_t pendingTransferLimit;
+
+    /**
+     * The submitting thread
+     */
+    std::thread thread;
+};
+
+/**
+ * Try to write the given command into the ring. Returns the ticket of 
+ * the command, or 0 if the ring is full.
+ */
+static size_t tryPush(Submitter *submitter, const SubmissionCommand &command)
+{
+    size_t position = submitter->enqueuePosition.load(std::memory_order_relaxed);
+    while (true)
+    {
+        SubmissionSlot *slot = &submitter->slots[position & submitter->mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0)
+        {
+            if (submitter->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot->command = command;
+                slot->sequence.store(position + 1, std::memory_order_release);
+                return position + 1;
+            }
+        }
+        else if (difference < 0)
+        {
+            return 0;
+        }
+        else
+        {
+            position = submitter->enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Write the given command into the ring, waiting while the ring is 
+ * full, and wake up the consumer if necessary. Returns the ticket.
+ */
+static size_t push(Submitter *submitter, const SubmissionCommand &command)
+{
+    size_t ticket = tryPush(submitter, command);
+    if (ticket == 0)
+    {
+        submitter->fullWaits++;
+        while (ticket == 0)
+        {
+            std::this_thread::yield();
+            ticket = tryPush(submitter, command);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (submitter->consumerSleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(submitter->commandMutex);
+        submitter->commandCondition.notify_one();
+    }
+    return ticket;
+}
+
+/**
+ * Returns whether the consumer can read the next command
+ */
+static bool isCommandAvailable(Submitter *submitter)
+{
+    size_t position = submitter->dequeuePosition;
+    SubmissionSlot *slot = &submitter->slots[position & submitter->mask];
+    return slot->sequence.load(std::memory_order_acquire) == position + 1;
+}
+
+/**
+ * Read the next command from the ring. Returns false if no command
+ * is available. Only called by the consumer.
+ */
+static bool pop(Submitter *submitter, SubmissionCommand &command)
+{
+    size_t position = submitter->dequeuePosition;
+    SubmissionSlot *slot = &submitter->slots[position & submitter->mask];
+    if (slot->sequence.load(std::memory_order_acquire) != position + 1)
+    {
+        return false;
+    }
+    command = slot->command;
+    slot->sequence.store(position + submitter->mask + 1, std::memory_order_release);
+    submitter->dequeuePosition = position + 1;
+    return true;
+}
+
+/**
+ * Mark all commands up to the current dequeue position as submitted,
+ * and wake up producers that are waiting for this
+ */
+static void publishSubmitted(Submitter *submitter)
+{
+    submitter->submitted.store(submitter->dequeuePosition);
+    if (submitter->submittedWaiters.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(submitter->submittedMutex);
+        submitter->submittedCondition.notify_all();
+    }
+}
+
+/**
+ * Record the given result of a command
+ */
+static void recordResult(Submitter *submitter, cl_int result)
+{
+    if (result != CL_SUCCESS)
+    {
+        submitter->errors++;
+        submitter->lastError.store(result);
+        Logger::log(LOG_DEBUG, "Submitted command failed with %d\n", result);
+    }
+}
+
+/**
+ * Release the pending transfers of the given submitter that are 
+ * complete, together with their host references. If 'wait' is true,
+ * then this waits until all transfers are complete.
+ */
+static void releaseTransfers(JNIEnv *env, Submitter *submitter, bool wait)
+{
+    std::vector<PendingTransfer> &transfers = submitter->pendingTransfers;
+    size_t kept = 0;
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+        PendingTransfer &transfer = transfers[i];
+        if (wait)
+        {
+            if (clWaitForEventsFP != NULL)
+            {
+                (clWaitForEventsFP)(1, &transfer.event);
+            }
+        }
+        else
+        {
+            cl_int status = CL_QUEUED;
+            cl_int result = clGetEventInfoFP == NULL ? CL_INVALID_OPERATION :
+                (clGetEventInfoFP)(transfer.event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if (result != CL_SUCCESS || status > CL_COMPLETE)
+            {
+                transfers[kept++] = transfer;
+                continue;
+            }
+        }
+        if (clReleaseEventFP != NULL)
+        {
+            (clReleaseEventFP)(transfer.event);
+        }
+        if (env != NULL)
+        {
+            env->DeleteGlobalRef(transfer.hostReference);
+        }
+    }
+    transfers.resize(kept);
+    submitter->pendingTransferLimit = std::max((size_t)64, kept * 2);
+}
+
+/**
+ * Set the kernel arguments that have been captured for the given
+ * kernel command
+ */
+static cl_int setKernelArgs(const SubmissionCommand &command)
+{
+    const SubmissionKernelArgs *kernelArgs = command.kernelArgs;
+    if (kernelArgs == NULL)
+    {
+        return CL_SUCCESS;
+    }
+    if (clSetKernelArgFP == NULL) return CL_INVALID_OPERATION;
+    for (size_t i = 0; i < kernelArgs->sizes.size(); i++)
+    {
+        cl_uint index = (cl_uint)i;
+        size_t size = kernelArgs->sizes[i];
+        const void *value = kernelArgs->offsets[i] == SIZE_MAX ? NULL : &kernelArgs->values[kernelArgs->offsets[i]];
+        recordKernelArgMem(command.kernel, index, size, value);
+        if (isKernelArgUnchanged(command.kernel, index, size, value))
+        {
+            continue;
+        }
+        cl_int result = (clSetKernelArgFP)(command.kernel, index, size, value);
+        updateKernelArg(command.kernel, index, size, value, result);
+        if (result != CL_SUCCESS)
+        {
+            return result;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+/**
+ * Enqueue the given read or write command. The host reference of the
+ * command is kept until the transfer is complete.
+ */
+static cl_int executeTransfer(JNIEnv *env, Submitter *submitter, const SubmissionCommand &command)
+{
+    cl_event event = NULL;
+    cl_int result = CL_INVALID_OPERATION;
+    if (command.type == SUBMISSION_WRITE_BUFFER)
+    {
+        if (clEnqueueWriteBufferFP != NULL)
+        {
+            result = (clEnqueueWriteBufferFP)(command.queue, command.dstMem, CL_FALSE,
+                command.dstOffset, command.size, command.hostPointer, 0, NULL, &event);
+        }
+    }
+    else
+    {
+        if (clEnqueueReadBufferFP != NULL)
+        {
+            result = (clEnqueueReadBufferFP)(command.queue, command.srcMem, CL_FALSE,
+                command.srcOffset, command.size, command.hostPointer, 0, NULL, &event);
+        }
+    }
+    if (result != CL_SUCCESS)
+    {
+        if (env != NULL)
+        {
+            env->DeleteGlobalRef(command.hostReference);
+        }
+        return result;
+    }
+    PendingTransfer transfer;
+    transfer.event = event;
+    transfer.hostReference = command.hostReference;
+    submitter->pendingTransfers.push_back(transfer);
+    if (submitter->pendingTransfers.size() >= submitter->pendingTransferLimit)
+    {
+        releaseTransfers(env, submitter, false);
+    }
+    return result;
+}
+
+/**
+ * Execute the given command
+ */
+static cl_int execute(JNIEnv *env, Submitter *submitter, const SubmissionCommand &command)
+{
+    switch (command.type)
+    {
+        case SUBMISSION_NDRANGE_KERNEL:
+        {
+            if (clEnqueueNDRangeKernelFP == NULL) return CL_INVALID_OPERATION;
+            cl_int result = setKernelArgs(command);
+            delete command.kernelArgs;
+            if (result != CL_SUCCESS)
+            {
+                return result;
+            }
+            const size_t *localSize = command.localSize[0] == 0 ? NULL : command.localSize;
+            return (clEnqueueNDRangeKernelFP)(command.queue, command.kernel, command.workDim,
+                command.globalOffset, command.globalSize, localSize, 0, NULL, NULL);
+        }
+        case SUBMISSION_WRITE_BUFFER:
+        case SUBMISSION_READ_BUFFER:
+        {
+            return executeTransfer(env, submitter, command);
+        }
+        case SUBMISSION_COPY_BUFFER:
+        {
+            if (clEnqueueCopyBufferFP == NULL) return CL_INVALID_OPERATION;
+            return (clEnqueueCopyBufferFP)(command.queue, command.srcMem, command.dstMem,
+                command.srcOffset, command.dstOffset, command.size, 0, NULL, NULL);
+        }
+        default:
+            break;
+    }
+    return CL_SUCCESS;
+}
+
+/**
+ * Flush all given queues, and clear the set
+ */
+static void flushQueues(Submitter *submitter, std::unordered_set<cl_command_queue> &queues)
+{
+    if (queues.empty() || clFlushFP == NULL)
+    {
+        return;
+    }
+    for (std::unordered_set<cl_command_queue>::iterator iter = queues.begin(); iter != queues.end(); ++iter)
+    {
+        recordResult(submitter, (clFlushFP)(*iter));
+    }
+    queues.clear();
+    submitter->flushes++;
+}
+
+/**
+ * Process the commands of the given submitter until a STOP command
+ * is received
+ */
+static void runCommands(JNIEnv *env, Submitter *submitter)
+{
+    // The queues that received commands since the last flush, and 
+    // all queues that received commands since the last finish
+    std::unordered_set<cl_command_queue> unflushedQueues;
+    std::unordered_set<cl_command_queue> unfinishedQueues;
+    int commandsSinceFlush = 0;
+    while (true)
+    {
+        SubmissionCommand command;
+        if (pop(submitter, command))
+        {
+            if (command.type == SUBMISSION_STOP)
+            {
+                flushQueues(submitter, unflushedQueues);
+                publishSubmitted(submitter);
+                return;
+            }
+            if (command.type == SUBMISSION_FINISH)
+            {
+                cl_int result = CL_SUCCESS;
+                for (std::unordered_set<cl_command_queue>::iterator iter = unfinishedQueues.begin(); iter != unfinishedQueues.end(); ++iter)
+                {
+                    cl_int finishResult = clFinishFP == NULL ? CL_INVALID_OPERATION : (clFinishFP)(*iter);
+                    recordResult(submitter, finishResult);
+                    if (finishResult != CL_SUCCESS)
+                    {
+                        result = finishResult;
+                    }
+                }
+                unflushedQueues.clear();
+                unfinishedQueues.clear();
+                commandsSinceFlush = 0;
+                releaseTransfers(env, submitter, true);
+                *command.finishResult = result;
+            }
+            else if (command.type == SUBMISSION_FLUSH)
+            {
+                recordResult(submitter, clFlushFP == NULL ? CL_INVALID_OPERATION : (clFlushFP)(command.queue));
+                unflushedQueues.erase(command.queue);
+            }
+            else
+            {
+                recordResult(submitter, execute(env, submitter, command));
+                unflushedQueues.insert(command.queue);
+                unfinishedQueues.insert(command.queue);
+                commandsSinceFlush++;
+                if (submitter->flushInterval > 0 && commandsSinceFlush >= submitter->flushInterval)
+                {
+                    flushQueues(submitter, unflushedQueues);
+                    commandsSinceFlush = 0;
+                }
+            }
+            publishSubmitted(submitter);
+            continue;
+        }
+
+        // The ring is empty: Flush the queues, release the completed
+        // transfers, and wait for commands
+        flushQueues(submitter, unflushedQueues);
+        commandsSinceFlush = 0;
+        releaseTransfers(env, submitter, false);
+        std::unique_lock<std::mutex> lock(submitter->commandMutex);
+        submitter->consumerSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!isCommandAvailable(submitter))
+        {
+            submitter->commandCondition.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        submitter->consumerSleeping.store(false);
+    }
+}
+
+/**
+ * The function that is executed by the submission thread
+ */
+static void runSubmitter(Submitter *submitter)
+{
+    // Without an attached thread, the host references of transfers
+    // can not be deleted. They are leaked instead of being deleted
+    // while the transfer may still be running.
+    JNIEnv *env = NULL;
+    if (globalJvm->AttachCurrentThreadAsDaemon((void**)&env, NULL) != JNI_OK)
+    {
+        Logger::log(LOG_ERROR, "Could not attach submission thread\n");
+        env = NULL;
+    }
+    runCommands(env, submitter);
+    releaseTransfers(env, submitter, true);
+    if (env != NULL)
+    {
+        globalJvm->DetachCurrentThread();
+    }
+}
+
+/**
+ * Wait until the command with the given ticket has been submitted
+ */
+static void awaitSubmitted(Submitter *submitter, size_t ticket)
+{
+    if (submitter->submitted.load() >= ticket)
+    {
+        return;
+    }
+    submitter->submittedWaiters++;
+    {
+        std::unique_lock<std::mutex> lock(submitter->submittedMutex);
+        while (submitter->submitted.load() < ticket)
+        {
+            submitter->submittedCondition.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+    submitter->submittedWaiters--;
+}
+
+/**
+ * Initialize the given command with default values
+ */
+static void initCommand(SubmissionCommand &command, SubmissionCommandType type, jlong queue)
+{
+    memset(&command, 0, sizeof(SubmissionCommand));
+    command.type = type;
+    command.queue = (cl_command_queue)queue;
+}
+
+/**
+ * Obtain the host pointer for a read or write command from the given
+ * Pointer object. Only pointers to native memory and to direct buffers
+ * are accepted, because the memory has to remain valid after the 
+ * native method returned. Returns NULL and throws an exception if 
+ * the pointer is not valid.
+ */
+static void* obtainHostPointer(JNIEnv *env, jobject pointer)
+{
+    PointerData *pointerData = initPointerData(env, pointer);
+    if (pointerData == NULL)
+    {
+        return NULL;
+    }
+    bool valid =
+        pointerData->pointerType == POINTER_TYPE_NATIVE ||
+        pointerData->pointerType == POINTER_TYPE_DIRECT_BUFFER;
+    void *hostPointer = (void*)pointerData->pointer;
+    releasePointerData(env, pointerData, JNI_ABORT);
+    if (!valid || hostPointer == NULL)
+    {
+        ThrowByName(env, "java/lang/IllegalArgumentException",
+            "Submitted transfers require pointers to native memory or direct buffers");
+        return NULL;
+    }
+    return hostPointer;
+}
+
+/**
+ * Create the captured kernel arguments from the given arrays. Returns
+ * NULL if there are no arguments. If an error occurs, then 'valid' 
+ * is set to false and an exception is pending.
+ */
+static SubmissionKernelArgs* createKernelArgs(JNIEnv *env, jlongArray argSizes, jobjectArray argValues, bool &valid)
+{
+    valid = true;
+    if (argSizes == NULL)
+    {
+        return NULL;
+    }
+    jsize count = env->GetArrayLength(argSizes);
+    jlong *sizes = env->GetLongArrayElements(argSizes, NULL);
+    if (sizes == NULL)
+    {
+        valid = false;
+        return NULL;
+    }
+    SubmissionKernelArgs *kernelArgs = new SubmissionKernelArgs();
+    for (jsize i = 0; i < count && valid; i++)
+    {
+        size_t size = (size_t)sizes[i];
+        kernelArgs->sizes.push_back(size);
+        jobject argValue = env->GetObjectArrayElement(argValues, i);
+        if (argValue == NULL)
+        {
+            kernelArgs->offsets.push_back(SIZE_MAX);
+            continue;
+        }
+        PointerData *pointerData = initPointerData(env, argValue);
+        if (pointerData == NULL)
+        {
+            valid = false;
+            break;
+        }
+        if (pointerData->pointer == 0)
+        {
+            kernelArgs->offsets.push_back(SIZE_MAX);
+        }
+        else
+        {
+            size_t offset = kernelArgs->values.size();
+            kernelArgs->offsets.push_back(offset);
+            kernelArgs->values.resize(offset + size);
+            memcpy(&kernelArgs->values[offset], (void*)pointerData->pointer, size);
+        }
+        if (!releasePointerData(env, pointerData, JNI_ABORT))
+        {
+            valid = false;
+        }
+        env->DeleteLocalRef(argValue);
+    }
+    env->ReleaseLongArrayElements(argSizes, sizes, JNI_ABORT);
+    if (!valid)
+    {
+        delete kernelArgs;
+        return NULL;
+    }
+    return kernelArgs;
+}
+
+
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_createNative
+  (JNIEnv *env, jclass UNUSED(cls), jint capacity, jint flushInterval)
+{
+    size_t slotCount = 2;
+    while (slotCount < (size_t)capacity)
+    {
+        slotCount *= 2;
+    }
+    Submitter *submitter = new Submitter();
+    submitter->slots = new SubmissionSlot[slotCount];
+    for (size_t i = 0; i < slotCount; i++)
+    {
+        submitter->slots[i].sequence.store(i);
+    }
+    submitter->mask = slotCount - 1;
+    submitter->enqueuePosition.store(0);
+    submitter->dequeuePosition = 0;
+    submitter->flushInterval = flushInterval;
+    submitter->submitted.store(0);
+    submitter->consumerSleeping.store(false);
+    submitter->submittedWaiters.store(0);
+    submitter->flushes.store(0);
+    submitter->fullWaits.store(0);
+    submitter->errors.store(0);
+    submitter->lastError.store(CL_SUCCESS);
+    submitter->pendingTransferLimit = 64;
+    try
+    {
+        submitter->thread = std::thread(runSubmitter, submitter);
+    }
+    catch (const std::system_error &)
+    {
+        delete[] submitter->slots;
+        delete submitter;
+        ThrowByName(env, "java/lang/IllegalStateException",
+            "Could not start the submission thread");
+        return 0;
+    }
+    return (jlong)submitter;
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_pushNDRangeKernelNative
+  (JNIEnv *env, jclass UNUSED(cls), jlong handle, jlong queue, jlong kernel, jint workDim,
+   jlong offset0, jlong offset1, jlong offset2,
+   jlong global0, jlong global1, jlong global2,
+   jlong local0, jlong local1, jlong local2,
+   jlongArray argSizes, jobjectArray argValues)
+{
+    bool valid = true;
+    SubmissionKernelArgs *kernelArgs = createKernelArgs(env, argSizes, argValues, valid);
+    if (!valid)
+    {
+        return 0;
+    }
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_NDRANGE_KERNEL, queue);
+    command.kernel = (cl_kernel)kernel;
+    command.kernelArgs = kernelArgs;
+    command.workDim = (cl_uint)workDim;
+    command.globalOffset[0] = (size_t)offset0;
+    command.globalOffset[1] = (size_t)offset1;
+    command.globalOffset[2] = (size_t)offset2;
+    command.globalSize[0] = (size_t)global0;
+    command.globalSize[1] = (size_t)global1;
+    command.globalSize[2] = (size_t)global2;
+    command.localSize[0] = (size_t)local0;
+    command.localSize[1] = (size_t)local1;
+    command.localSize[2] = (size_t)local2;
+    return (jlong)push(submitter, command);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_pushWriteBufferNative
+  (JNIEnv *env, jclass UNUSED(cls), jlong handle, jlong queue, jlong mem, jlong offset, jlong size, jobject pointer)
+{
+    void *hostPointer = obtainHostPointer(env, pointer);
+    if (hostPointer == NULL)
+    {
+        return 0;
+    }
+    jobject hostReference = env->NewGlobalRef(pointer);
+    if (hostReference == NULL)
+    {
+        return 0;
+    }
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_WRITE_BUFFER, queue);
+    command.dstMem = (cl_mem)mem;
+    command.dstOffset = (size_t)offset;
+    command.size = (size_t)size;
+    command.hostPointer = hostPointer;
+    command.hostReference = hostReference;
+    return (jlong)push(submitter, command);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_pushReadBufferNative
+  (JNIEnv *env, jclass UNUSED(cls), jlong handle, jlong queue, jlong mem, jlong offset, jlong size, jobject pointer)
+{
+    void *hostPointer = obtainHostPointer(env, pointer);
+    if (hostPointer == NULL)
+    {
+        return 0;
+    }
+    jobject hostReference = env->NewGlobalRef(pointer);
+    if (hostReference == NULL)
+    {
+        return 0;
+    }
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_READ_BUFFER, queue);
+    command.srcMem = (cl_mem)mem;
+    command.srcOffset = (size_t)offset;
+    command.size = (size_t)size;
+    command.hostPointer = hostPointer;
+    command.hostReference = hostReference;
+    return (jlong)push(submitter, command);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_pushCopyBufferNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jlong handle, jlong queue, jlong srcMem, jlong dstMem, jlong srcOffset, jlong dstOffset, jlong size)
+{
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_COPY_BUFFER, queue);
+    command.srcMem = (cl_mem)srcMem;
+    command.dstMem = (cl_mem)dstMem;
+    command.srcOffset = (size_t)srcOffset;
+    command.dstOffset = (size_t)dstOffset;
+    command.size = (size_t)size;
+    return (jlong)push(submitter, command);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL Java_org_jocl_SubmissionThread_pushFlushNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jlong handle, jlong queue)
+{
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_FLUSH, queue);
+    return (jlong)push(submitter, command);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL Java_org_jocl_SubmissionThread_finishNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jlong handle)
+{
+    // The result is written by the consumer before the command is
+    // published as submitted
+    Submitter *submitter = (Submitter*)handle;
+    cl_int result = CL_SUCCESS;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_FINISH, 0);
+    command.finishResult = &result;
+    size_t ticket = push(submitter, command);
+    awaitSubmitted(submitter, ticket);
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_SubmissionThread_awaitSubmittedNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jlong handle, jlong ticket)
+{
+    awaitSubmitted((Submitter*)handle, (size_t)ticket);
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_SubmissionThread_getStatisticsNative
+  (JNIEnv *env, jclass UNUSED(cls), jlong handle, jlongArray statistics)
+{
+    Submitter *submitter = (Submitter*)handle;
+    if (!set(env, statistics, 0, (jlong)submitter->enqueuePosition.load())) return;
+    if (!set(env, statistics, 1, (jlong)submitter->submitted.load())) return;
+    if (!set(env, statistics, 2, submitter->flushes.load())) return;
+    if (!set(env, statistics, 3, submitter->fullWaits.load())) return;
+    if (!set(env, statistics, 4, submitter->errors.load())) return;
+    if (!set(env, statistics, 5, (jlong)submitter->lastError.load())) return;
+}
+
+extern "C"
+JNIEXPORT void JNICALL Java_org_jocl_SubmissionThread_destroyNative
+  (JNIEnv *UNUSED(env), jclass UNUSED(cls), jlong handle)
+{
+    Submitter *submitter = (Submitter*)handle;
+    SubmissionCommand command;
+    initCommand(command, SUBMISSION_STOP, 0);
+    push(submitter, command);
+    submitter->thread.join();
+    delete[] submitter->slots;
+    delete submitter;
+}
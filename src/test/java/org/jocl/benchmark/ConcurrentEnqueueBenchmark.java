@@ -0,0 +1,540 @@
+package org.jocl.benchmark;
+
+import static org.jocl.CL.*;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Locale;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicReference;
+
+import org.jocl.*;
+
+/**
+ * A benchmark that measures how the throughput of common operations
+ * scales when they are executed concurrently from an increasing number
+ * of threads.<br>
+ * <br>
+ * Each {@link Workload} is executed with 1, 2, 4 ... N threads, once
+ * with all threads sharing a single command queue, and once with one
+ * command queue per thread. The resulting throughput is printed as a
+ * table, together with the scaling efficiency relative to the single
+ * threaded run. An efficiency that drops far below 1.0 while the
+ * device is not saturated indicates a serialization point, either in
+ * the OpenCL implementation or in the global state of JOCL (for
+ * example, the callback bookkeeping for event callbacks).<br>
+ * <br>
+ * Usage:
+ * <pre>
+ * ConcurrentEnqueueBenchmark [-threads N] [-duration ms] [-platform i]
+ *     [-device i] [-workload NAME] [-csv file]
+ * </pre>
+ */
+public class ConcurrentEnqueueBenchmark
+{
+    /**
+     * The source code of the kernel that is used for the launch workload
+     */
+    private static final String programSource =
+        "__kernel void increment(__global int *a, int n)" + "\n" +
+        "{" + "\n" +
+        "    int gid = get_global_id(0);" + "\n" +
+        "    if (gid < n) a[gid] += 1;" + "\n" +
+        "}";
+
+    /**
+     * The number of elements in the buffers that are used by each thread
+     */
+    private static final int ELEMENTS = 1024;
+
+    /**
+     * The number of operations that are enqueued before the queue
+     * is finished
+     */
+    private static final int BATCH_SIZE = 32;
+
+    /**
+     * The workloads that may be executed concurrently
+     */
+    enum Workload
+    {
+        /**
+         * Set the kernel arguments and enqueue a small kernel
+         */
+        KERNEL_LAUNCH,
+
+        /**
+         * Blocking write and read of a small buffer
+         */
+        BLOCKING_TRANSFER,
+
+        /**
+         * Non-blocking write of a small buffer from a direct buffer.
+         * This involves the reference tracking for non-blocking
+         * operations
+         */
+        NON_BLOCKING_TRANSFER,
+
+        /**
+         * Creation and release of memory objects
+         */
+        CREATE_RELEASE,
+
+        /**
+         * Enqueue a marker and register an event callback for it.
+         * This involves the callback bookkeeping of JOCL
+         */
+        EVENT_CALLBACK
+    }
+
+    /**
+     * The entry point of this benchmark
+     *
+     * @param args The command line arguments
+     */
+    public static void main(String args[])
+    {
+        int maxThreads = Runtime.getRuntime().availableProcessors();
+        long durationMs = 1000;
+        int platformIndex = 0;
+        int deviceIndex = 0;
+        String workloadName = null;
+        String csvFileName = null;
+        for (int i = 0; i + 1 < args.length; i += 2)
+        {
+            String key = args[i];
+            String value = args[i + 1];
+            if (key.equals("-threads"))
+            {
+                maxThreads = Integer.parseInt(value);
+            }
+            else if (key.equals("-duration"))
+            {
+                durationMs = Long.parseLong(value);
+            }
+            else if (key.equals("-platform"))
+            {
+                platformIndex = Integer.parseInt(value);
+            }
+            else if (key.equals("-device"))
+            {
+                deviceIndex = Integer.parseInt(value);
+            }
+            else if (key.equals("-workload"))
+            {
+                workloadName = value;
+            }
+            else if (key.equals("-csv"))
+            {
+                csvFileName = value;
+            }
+            else
+            {
+                System.err.println("Unknown argument: " + key);
+                return;
+            }
+        }
+
+        CL.setExceptionsEnabled(true);
+        ConcurrentEnqueueBenchmark benchmark =
+            new ConcurrentEnqueueBenchmark(platformIndex, deviceIndex);
+
+        List<Integer> threadCounts = createThreadCounts(maxThreads);
+        List<String> csvLines = new ArrayList<String>();
+        csvLines.add("workload,queues,threads,opsPerSecond,efficiency");
+        for (Workload workload : Workload.values())
+        {
+            if (workloadName != null && !workload.name().equals(workloadName))
+            {
+                continue;
+            }
+            for (int q = 0; q < 2; q++)
+            {
+                boolean sharedQueue = (q == 0);
+                String queues = sharedQueue ? "shared" : "perThread";
+                System.out.println(workload + ", " + queues + " queue(s):");
+                System.out.println(String.format(Locale.ENGLISH,
+                    "%8s %16s %12s", "threads", "ops/s", "efficiency"));
+                double singleThreaded = 0;
+                for (int threads : threadCounts)
+                {
+                    double opsPerSecond = benchmark.run(
+                        workload, threads, sharedQueue, durationMs);
+                    if (threads == 1)
+                    {
+                        singleThreaded = opsPerSecond;
+                    }
+                    double efficiency =
+                        opsPerSecond / (threads * singleThreaded);
+                    System.out.println(String.format(Locale.ENGLISH,
+                        "%8d %16.1f %12.3f", threads, opsPerSecond,
+                        efficiency));
+                    csvLines.add(String.format(Locale.ENGLISH,
+                        "%s,%s,%d,%.1f,%.4f", workload, queues, threads,
+                        opsPerSecond, efficiency));
+                }
+                System.out.println();
+            }
+        }
+        benchmark.shutdown();
+
+        if (csvFileName != null)
+        {
+            writeLines(csvFileName, csvLines);
+        }
+    }
+
+    /**
+     * Create the list of thread counts 1, 2, 4 ... that are smaller
+     * than the given maximum, and the maximum itself
+     *
+     * @param maxThreads The maximum number of threads
+     * @return The thread counts
+     */
+    private static List<Integer> createThreadCounts(int maxThreads)
+    {
+        List<Integer> threadCounts = new ArrayList<Integer>();
+        for (int n = 1; n < maxThreads; n *= 2)
+        {
+            threadCounts.add(n);
+        }
+        threadCounts.add(maxThreads);
+        return threadCounts;
+    }
+
+    /**
+     * Write the given lines into the specified file
+     *
+     * @param fileName The file name
+     * @param lines The lines
+     */
+    private static void writeLines(String fileName, List<String> lines)
+    {
+        PrintWriter pw = null;
+        try
+        {
+            pw = new PrintWriter(new FileWriter(fileName));
+            for (String line : lines)
+            {
+                pw.println(line);
+            }
+        }
+        catch (IOException e)
+        {
+            System.err.println("Could not write " + fileName + ": " +
+                e.getMessage());
+        }
+        finally
+        {
+            if (pw != null)
+            {
+                pw.close();
+            }
+        }
+    }
+
+    /**
+     * The context
+     */
+    private final cl_context context;
+
+    /**
+     * The device
+     */
+    private final cl_device_id device;
+
+    /**
+     * The program containing the benchmark kernel
+     */
+    private final cl_program program;
+
+    /**
+     * Creates a new benchmark for the specified device
+     *
+     * @param platformIndex The platform index
+     * @param deviceIndex The device index
+     */
+    ConcurrentEnqueueBenchmark(int platformIndex, int deviceIndex)
+    {
+        int numPlatformsArray[] = new int[1];
+        clGetPlatformIDs(0, null, numPlatformsArray);
+        cl_platform_id platforms[] = new cl_platform_id[numPlatformsArray[0]];
+        clGetPlatformIDs(platforms.length, platforms, null);
+        cl_platform_id platform = platforms[platformIndex];
+
+        int numDevicesArray[] = new int[1];
+        clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, null, numDevicesArray);
+        cl_device_id devices[] = new cl_device_id[numDevicesArray[0]];
+        clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, devices.length, devices, null);
+        device = devices[deviceIndex];
+
+        cl_context_properties contextProperties = new cl_context_properties();
+        contextProperties.addProperty(CL_CONTEXT_PLATFORM, platform);
+        context = clCreateContext(contextProperties, 1,
+            new cl_device_id[] { device }, null, null, null);
+
+        program = clCreateProgramWithSource(context, 1,
+            new String[] { programSource }, null, null);
+        clBuildProgram(program, 0, null, null, null, null);
+    }
+
+    /**
+     * Release all resources of this benchmark
+     */
+    void shutdown()
+    {
+        clReleaseProgram(program);
+        clReleaseContext(context);
+    }
+
+    /**
+     * Run the given workload with the given number of threads for
+     * the given duration, and return the total number of operations
+     * per second
+     *
+     * @param workload The workload
+     * @param numThreads The number of threads
+     * @param sharedQueue Whether all threads should use the same queue
+     * @param durationMs The duration, in milliseconds
+     * @return The number of operations per second
+     */
+    @SuppressWarnings("deprecation")
+    double run(final Workload workload, int numThreads,
+        boolean sharedQueue, long durationMs)
+    {
+        cl_command_queue queues[] = new cl_command_queue[numThreads];
+        for (int i = 0; i < numThreads; i++)
+        {
+            if (sharedQueue && i > 0)
+            {
+                queues[i] = queues[0];
+            }
+            else
+            {
+                queues[i] = clCreateCommandQueue(context, device, 0, null);
+            }
+        }
+
+        final AtomicBoolean running = new AtomicBoolean(true);
+        final AtomicLong totalOps = new AtomicLong();
+        final CountDownLatch ready = new CountDownLatch(numThreads);
+        final CountDownLatch start = new CountDownLatch(1);
+        final CountDownLatch done = new CountDownLatch(numThreads);
+        final AtomicReference<Throwable> failure = 
+            new AtomicReference<Throwable>();
+        for (int i = 0; i < numThreads; i++)
+        {
+            final cl_command_queue queue = queues[i];
+            Thread thread = new Thread(new Runnable()
+            {
+                @Override
+                public void run()
+                {
+                    WorkerState state = null;
+                    boolean counted = false;
+                    try
+                    {
+                        // Warm up, to exclude one-time initializations
+                        state = new WorkerState(queue);
+                        state.execute(workload);
+                        clFinish(queue);
+                        ready.countDown();
+                        counted = true;
+                        start.await();
+                        long ops = 0;
+                        while (running.get())
+                        {
+                            for (int j = 0; j < BATCH_SIZE; j++)
+                            {
+                                state.execute(workload);
+                            }
+                            clFinish(queue);
+                            ops += BATCH_SIZE;
+                        }
+                        totalOps.addAndGet(ops);
+                    }
+                    catch (InterruptedException e)
+                    {
+                        Thread.currentThread().interrupt();
+                    }
+                    catch (RuntimeException e)
+                    {
+                        failure.compareAndSet(null, e);
+                        running.set(false);
+                    }
+                    finally
+                    {
+                        if (!counted)
+                        {
+                            ready.countDown();
+                        }
+                        if (state != null)
+                        {
+                            state.release();
+                        }
+                        done.countDown();
+                    }
+                }
+            }, "ConcurrentEnqueueBenchmark-" + i);
+            thread.start();
+        }
+
+        long elapsedNs = 0;
+        try
+        {
+            ready.await();
+            long before = System.nanoTime();
+            start.countDown();
+            Thread.sleep(durationMs);
+            running.set(false);
+            done.await();
+            elapsedNs = System.nanoTime() - before;
+        }
+        catch (InterruptedException e)
+        {
+            Thread.currentThread().interrupt();
+        }
+
+        for (int i = 0; i < numThreads; i++)
+        {
+            if (!sharedQueue || i == 0)
+            {
+                clReleaseCommandQueue(queues[i]);
+            }
+        }
+        if (failure.get() != null)
+        {
+            throw new RuntimeException(
+                "A worker thread failed", failure.get());
+        }
+        return totalOps.get() / (elapsedNs * 1e-9);
+    }
+
+    /**
+     * The resources that are used by a single worker thread
+     */
+    private class WorkerState
+    {
+        /**
+         * The queue of this worker
+         */
+        private final cl_command_queue queue;
+
+        /**
+         * The kernel of this worker. Kernel arguments are not
+         * thread-safe, so each worker has its own kernel
+         */
+        private final cl_kernel kernel;
+
+        /**
+         * The memory object of this worker
+         */
+        private final cl_mem mem;
+
+        /**
+         * The host memory of this worker
+         */
+        private final ByteBuffer hostBuffer;
+
+        /**
+         * The callback for the EVENT_CALLBACK workload
+         */
+        private final EventCallbackFunction callback =
+            new EventCallbackFunction()
+        {
+            @Override
+            public void function(cl_event event,
+                int command_exec_callback_type, Object user_data)
+            {
+                // Nothing to do here
+            }
+        };
+
+        /**
+         * Creates the state for a worker using the given queue
+         *
+         * @param queue The queue
+         */
+        WorkerState(cl_command_queue queue)
+        {
+            this.queue = queue;
+            this.kernel = clCreateKernel(program, "increment", null);
+            this.mem = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                ELEMENTS * Sizeof.cl_int, null, null);
+            this.hostBuffer = ByteBuffer
+                .allocateDirect(ELEMENTS * Sizeof.cl_int)
+                .order(ByteOrder.nativeOrder());
+        }
+
+        /**
+         * Execute a single operation of the given workload
+         *
+         * @param workload The workload
+         */
+        void execute(Workload workload)
+        {
+            Pointer host = Pointer.to(hostBuffer);
+            long size = ELEMENTS * Sizeof.cl_int;
+            switch (workload)
+            {
+                case KERNEL_LAUNCH:
+                {
+                    clSetKernelArg(kernel, 0, Sizeof.cl_mem, Pointer.to(mem));
+                    clSetKernelArg(kernel, 1, Sizeof.cl_int,
+                        Pointer.to(new int[] { ELEMENTS }));
+                    clEnqueueNDRangeKernel(queue, kernel, 1, null,
+                        new long[] { ELEMENTS }, null, 0, null, null);
+                    break;
+                }
+                case BLOCKING_TRANSFER:
+                {
+                    clEnqueueWriteBuffer(queue, mem, CL_TRUE, 0, size,
+                        host, 0, null, null);
+                    clEnqueueReadBuffer(queue, mem, CL_TRUE, 0, size,
+                        host, 0, null, null);
+                    break;
+                }
+                case NON_BLOCKING_TRANSFER:
+                {
+                    clEnqueueWriteBuffer(queue, mem, CL_FALSE, 0, size,
+                        host, 0, null, null);
+                    break;
+                }
+                case CREATE_RELEASE:
+                {
+                    cl_mem m = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                        size, null, null);
+                    clReleaseMemObject(m);
+                    break;
+                }
+                case EVENT_CALLBACK:
+                {
+                    cl_event event = new cl_event();
+                    clEnqueueMarkerWithWaitList(queue, 0, null, event);
+                    clSetEventCallback(event, CL_COMPLETE, callback, null);
+                    clReleaseEvent(event);
+                    break;
+                }
+                default:
+                    throw new IllegalArgumentException(
+                        "Unknown workload: " + workload);
+            }
+        }
+
+        /**
+         * Release all resources of this worker
+         */
+        void release()
+        {
+            clReleaseMemObject(mem);
+            clReleaseKernel(kernel);
+        }
+    }
+}
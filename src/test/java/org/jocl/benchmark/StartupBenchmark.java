@@ -0,0 +1,473 @@
+package org.jocl.benchmark;
+
+import static org.jocl.CL.*;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.io.PrintWriter;
+import java.lang.management.ManagementFactory;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.Map.Entry;
+
+import org.jocl.*;
+
+/**
+ * A benchmark for the time from the start of the JVM until the first
+ * kernel has been executed.<br>
+ * <br>
+ * Each run is executed in a new JVM, so that all measurements are
+ * "cold". The time is broken down into the following phases:
+ * <ul>
+ *   <li>jvmStartup: JVM start until the main method is entered</li>
+ *   <li>libraryExtraction: Extracting the native library from the JAR
+ *   (0 when it is loaded from the <code>java.library.path</code>)</li>
+ *   <li>libraryLoad: Loading the JOCL native library, including
+ *   JNI_OnLoad</li>
+ *   <li>jniOnLoad: JNI_OnLoad, including registerNatives</li>
+ *   <li>registerNatives: Registering the native methods</li>
+ *   <li>implementationLoad: Loading the OpenCL implementation
+ *   library</li>
+ *   <li>functionPointers: Obtaining the OpenCL function pointers</li>
+ *   <li>discovery: Obtaining the platform and device IDs</li>
+ *   <li>contextCreation: Creating the context and the command queue</li>
+ *   <li>programBuild: Creating and building the program</li>
+ *   <li>firstLaunch: Creating the kernel, launching it and waiting
+ *   for its completion</li>
+ *   <li>total: JVM start until the first kernel has completed</li>
+ * </ul>
+ * The median and minimum of each phase are printed. The medians can be
+ * written into a CSV file, and compared to the results of a previous
+ * run, so that the benchmark can be used for tracking regressions,
+ * for example, with a CPU OpenCL implementation in a CI environment.
+ * If a regression is detected, the process exits with status 1.<br>
+ * <br>
+ * Usage:
+ * <pre>
+ * StartupBenchmark [-runs N] [-deviceType CPU|GPU|ALL] [-csv file]
+ *     [-baseline file] [-tolerance fraction] [-extract true|false]
+ * </pre>
+ * When <code>-extract true</code> is given, the native library is
+ * loaded without the <code>java.library.path</code>, so that it is
+ * extracted from the JAR file in each run.
+ */
+public class StartupBenchmark
+{
+    /**
+     * The prefix for lines that the child process prints to report
+     * the duration of a phase
+     */
+    private static final String PHASE_PREFIX = "PHASE ";
+
+    /**
+     * The source code of the program that is built and launched
+     */
+    private static final String programSource =
+        "__kernel void fill(__global int *a)" + "\n" +
+        "{" + "\n" +
+        "    a[get_global_id(0)] = 1;" + "\n" +
+        "}";
+
+    /**
+     * Regressions are only reported when a phase became slower than
+     * the baseline by more than this number of nanoseconds, to avoid
+     * false positives for phases that only take a few microseconds.
+     */
+    private static final long MIN_REGRESSION_NANOS = 1000000L;
+
+    /**
+     * The entry point of this benchmark
+     *
+     * @param args The command line arguments
+     * @throws Exception If the benchmark fails
+     */
+    public static void main(String args[]) throws Exception
+    {
+        if (args.length == 2 && args[0].equals("-child"))
+        {
+            runChild(args[1]);
+            return;
+        }
+        int runs = 10;
+        String deviceType = "CPU";
+        String csvFileName = null;
+        String baselineFileName = null;
+        double tolerance = 0.25;
+        boolean extract = false;
+        for (int i = 0; i + 1 < args.length; i += 2)
+        {
+            String key = args[i];
+            String value = args[i + 1];
+            if (key.equals("-runs"))
+            {
+                runs = Integer.parseInt(value);
+            }
+            else if (key.equals("-deviceType"))
+            {
+                deviceType = value;
+            }
+            else if (key.equals("-csv"))
+            {
+                csvFileName = value;
+            }
+            else if (key.equals("-baseline"))
+            {
+                baselineFileName = value;
+            }
+            else if (key.equals("-tolerance"))
+            {
+                tolerance = Double.parseDouble(value);
+            }
+            else if (key.equals("-extract"))
+            {
+                extract = Boolean.parseBoolean(value);
+            }
+            else
+            {
+                System.err.println("Unknown argument: " + key);
+                return;
+            }
+        }
+
+        Map<String, List<Long>> phases =
+            new LinkedHashMap<String, List<Long>>();
+        for (int i = 0; i < runs; i++)
+        {
+            Map<String, Long> run = runInNewProcess(deviceType, extract);
+            for (Entry<String, Long> entry : run.entrySet())
+            {
+                List<Long> values = phases.get(entry.getKey());
+                if (values == null)
+                {
+                    values = new ArrayList<Long>();
+                    phases.put(entry.getKey(), values);
+                }
+                values.add(entry.getValue());
+            }
+        }
+
+        Map<String, Long> medians = new LinkedHashMap<String, Long>();
+        System.out.println(String.format(Locale.ENGLISH,
+            "%-20s %14s %14s", "phase", "median (ms)", "min (ms)"));
+        for (Entry<String, List<Long>> entry : phases.entrySet())
+        {
+            List<Long> values = entry.getValue();
+            Collections.sort(values);
+            long median = values.get(values.size() / 2);
+            long min = values.get(0);
+            medians.put(entry.getKey(), median);
+            System.out.println(String.format(Locale.ENGLISH,
+                "%-20s %14.3f %14.3f", entry.getKey(),
+                median * 1e-6, min * 1e-6));
+        }
+
+        boolean regression = false;
+        if (baselineFileName != null && new File(baselineFileName).exists())
+        {
+            Map<String, Long> baseline = readCsv(baselineFileName);
+            regression = compare(baseline, medians, tolerance);
+        }
+        if (csvFileName != null)
+        {
+            writeCsv(csvFileName, medians);
+        }
+        if (regression)
+        {
+            System.exit(1);
+        }
+    }
+
+    /**
+     * Execute one run of the benchmark in a new JVM, and return the
+     * durations of the phases that have been reported by this run
+     *
+     * @param deviceType The device type
+     * @param extract Whether the native library should be extracted
+     * @return The phase durations, in nanoseconds
+     * @throws IOException If the process cannot be started
+     * @throws InterruptedException If the thread is interrupted
+     */
+    private static Map<String, Long> runInNewProcess(
+        String deviceType, boolean extract)
+        throws IOException, InterruptedException
+    {
+        String javaHome = System.getProperty("java.home");
+        String javaExecutable =
+            javaHome + File.separator + "bin" + File.separator + "java";
+        List<String> command = new ArrayList<String>();
+        command.add(javaExecutable);
+        command.add("-cp");
+        command.add(System.getProperty("java.class.path"));
+        if (extract)
+        {
+            command.add("-DuniqueLibraryNames=true");
+        }
+        else
+        {
+            String libraryPath = System.getProperty("java.library.path");
+            if (libraryPath != null)
+            {
+                command.add("-Djava.library.path=" + libraryPath);
+            }
+        }
+        command.add(StartupBenchmark.class.getName());
+        command.add("-child");
+        command.add(deviceType);
+
+        ProcessBuilder processBuilder = new ProcessBuilder(command);
+        processBuilder.redirectErrorStream(true);
+        Process process = processBuilder.start();
+        Map<String, Long> result = new LinkedHashMap<String, Long>();
+        BufferedReader reader = new BufferedReader(
+            new InputStreamReader(process.getInputStream()));
+        try
+        {
+            String line = null;
+            while ((line = reader.readLine()) != null)
+            {
+                if (line.startsWith(PHASE_PREFIX))
+                {
+                    String tokens[] = line.split(" ");
+                    result.put(tokens[1], Long.parseLong(tokens[2]));
+                }
+                else
+                {
+                    System.out.println(line);
+                }
+            }
+        }
+        finally
+        {
+            reader.close();
+        }
+        int exitValue = process.waitFor();
+        if (exitValue != 0)
+        {
+            throw new IllegalStateException(
+                "Benchmark process failed with exit value " + exitValue);
+        }
+        return result;
+    }
+
+    /**
+     * Execute the actual benchmark in the child process, and print
+     * the phase durations to the standard output
+     *
+     * @param deviceTypeName The device type name
+     */
+    @SuppressWarnings("deprecation")
+    private static void runChild(String deviceTypeName)
+    {
+        long mainMillis = System.currentTimeMillis();
+        long mainNanos = System.nanoTime();
+        long jvmStartMillis =
+            ManagementFactory.getRuntimeMXBean().getStartTime();
+        long jvmStartupNanos = (mainMillis - jvmStartMillis) * 1000000L;
+        printPhase("jvmStartup", jvmStartupNanos);
+
+        // The first use of the CL class loads and initializes
+        // the native library
+        CL.setExceptionsEnabled(true);
+
+        printPhase("libraryExtraction",
+            InitializationTimes.getLibraryExtractionNanos());
+        printPhase("libraryLoad",
+            InitializationTimes.getLibraryLoadNanos());
+        printPhase("jniOnLoad",
+            InitializationTimes.getOnLoadNanos());
+        printPhase("registerNatives",
+            InitializationTimes.getRegisterNativesNanos());
+        printPhase("implementationLoad",
+            InitializationTimes.getImplementationLibraryLoadNanos());
+        printPhase("functionPointers",
+            InitializationTimes.getFunctionPointerInitNanos());
+
+        long before = System.nanoTime();
+        long deviceType = CL_DEVICE_TYPE_ALL;
+        if (deviceTypeName.equals("CPU"))
+        {
+            deviceType = CL_DEVICE_TYPE_CPU;
+        }
+        else if (deviceTypeName.equals("GPU"))
+        {
+            deviceType = CL_DEVICE_TYPE_GPU;
+        }
+        cl_platform_id platform = null;
+        cl_device_id device = null;
+        int numPlatformsArray[] = new int[1];
+        clGetPlatformIDs(0, null, numPlatformsArray);
+        cl_platform_id platforms[] = new cl_platform_id[numPlatformsArray[0]];
+        clGetPlatformIDs(platforms.length, platforms, null);
+        for (cl_platform_id p : platforms)
+        {
+            int numDevicesArray[] = new int[1];
+            try
+            {
+                clGetDeviceIDs(p, deviceType, 0, null, numDevicesArray);
+            }
+            catch (CLException e)
+            {
+                // CL_DEVICE_NOT_FOUND: Try the next platform
+                continue;
+            }
+            if (numDevicesArray[0] > 0)
+            {
+                cl_device_id devices[] = new cl_device_id[1];
+                clGetDeviceIDs(p, deviceType, 1, devices, null);
+                platform = p;
+                device = devices[0];
+                break;
+            }
+        }
+        if (device == null)
+        {
+            throw new IllegalStateException(
+                "No device with type " + deviceTypeName + " found");
+        }
+        printPhase("discovery", System.nanoTime() - before);
+
+        before = System.nanoTime();
+        cl_context_properties contextProperties = new cl_context_properties();
+        contextProperties.addProperty(CL_CONTEXT_PLATFORM, platform);
+        cl_context context = clCreateContext(contextProperties, 1,
+            new cl_device_id[] { device }, null, null, null);
+        cl_command_queue queue =
+            clCreateCommandQueue(context, device, 0, null);
+        printPhase("contextCreation", System.nanoTime() - before);
+
+        before = System.nanoTime();
+        cl_program program = clCreateProgramWithSource(context, 1,
+            new String[] { programSource }, null, null);
+        clBuildProgram(program, 0, null, null, null, null);
+        printPhase("programBuild", System.nanoTime() - before);
+
+        before = System.nanoTime();
+        int n = 1024;
+        cl_kernel kernel = clCreateKernel(program, "fill", null);
+        cl_mem mem = clCreateBuffer(context, CL_MEM_READ_WRITE,
+            n * Sizeof.cl_int, null, null);
+        clSetKernelArg(kernel, 0, Sizeof.cl_mem, Pointer.to(mem));
+        clEnqueueNDRangeKernel(queue, kernel, 1, null,
+            new long[] { n }, null, 0, null, null);
+        clFinish(queue);
+        long end = System.nanoTime();
+        printPhase("firstLaunch", end - before);
+        printPhase("total", jvmStartupNanos + (end - mainNanos));
+
+        clReleaseMemObject(mem);
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+        clReleaseCommandQueue(queue);
+        clReleaseContext(context);
+    }
+
+    /**
+     * Print the given phase duration in the format that is expected
+     * by the parent process
+     *
+     * @param name The phase name
+     * @param nanos The duration, in nanoseconds
+     */
+    private static void printPhase(String name, long nanos)
+    {
+        System.out.println(PHASE_PREFIX + name + " " + nanos);
+    }
+
+    /**
+     * Compare the given results with the given baseline, print all
+     * regressions, and return whether there was any regression
+     *
+     * @param baseline The baseline
+     * @param current The current results
+     * @param tolerance The tolerance, as a fraction of the baseline value
+     * @return Whether there was a regression
+     */
+    private static boolean compare(Map<String, Long> baseline,
+        Map<String, Long> current, double tolerance)
+    {
+        boolean regression = false;
+        for (Entry<String, Long> entry : current.entrySet())
+        {
+            Long baselineValue = baseline.get(entry.getKey());
+            if (baselineValue == null)
+            {
+                continue;
+            }
+            long value = entry.getValue();
+            long limit = (long)(baselineValue * (1.0 + tolerance));
+            if (value > limit && value - baselineValue > MIN_REGRESSION_NANOS)
+            {
+                System.out.println(String.format(Locale.ENGLISH,
+                    "REGRESSION in %s: %.3f ms, baseline %.3f ms",
+                    entry.getKey(), value * 1e-6, baselineValue * 1e-6));
+                regression = true;
+            }
+        }
+        return regression;
+    }
+
+    /**
+     * Read the phase durations from the given CSV file, as it was
+     * written by {@link #writeCsv(String, Map)}
+     *
+     * @param fileName The file name
+     * @return The phase durations
+     * @throws IOException If the file cannot be read
+     */
+    private static Map<String, Long> readCsv(String fileName)
+        throws IOException
+    {
+        Map<String, Long> result = new LinkedHashMap<String, Long>();
+        BufferedReader reader = new BufferedReader(new FileReader(fileName));
+        try
+        {
+            String line = reader.readLine(); // Skip the header
+            while ((line = reader.readLine()) != null)
+            {
+                String tokens[] = line.split(",");
+                if (tokens.length >= 2)
+                {
+                    result.put(tokens[0], Long.parseLong(tokens[1].trim()));
+                }
+            }
+        }
+        finally
+        {
+            reader.close();
+        }
+        return result;
+    }
+
+    /**
+     * Write the given phase durations into a CSV file
+     *
+     * @param fileName The file name
+     * @param medians The phase durations
+     * @throws IOException If the file cannot be written
+     */
+    private static void writeCsv(String fileName, Map<String, Long> medians)
+        throws IOException
+    {
+        PrintWriter pw = new PrintWriter(new FileWriter(fileName));
+        try
+        {
+            pw.println("phase,medianNanos");
+            for (Entry<String, Long> entry : medians.entrySet())
+            {
+                pw.println(entry.getKey() + "," + entry.getValue());
+            }
+        }
+        finally
+        {
+            pw.close();
+        }
+    }
+}
@@ -0,0 +1,92 @@
+package org.jocl.test;
+
+import static org.jocl.CL.*;
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+
+import org.jocl.*;
+import org.jocl.Elementwise.Expression;
+import org.junit.Test;
+
+/**
+ * Test for the fused evaluation of elementwise expressions: 
+ * <code>c = a * b + d; e = max(c, 0)</code>
+ */
+public class ElementwiseTest extends JOCLAbstractTest
+{
+    @Test
+    public void testFusedExpression()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        
+        int n = 10;
+        float a[] = new float[n];
+        float b[] = new float[n];
+        float d[] = new float[n];
+        for (int i=0; i<n; i++)
+        {
+            a[i] = i;
+            b[i] = 2;
+            d[i] = -10;
+        }
+        cl_mem aMem = createBuffer(a);
+        cl_mem bMem = createBuffer(b);
+        cl_mem dMem = createBuffer(d);
+        cl_mem cMem = createBuffer(new float[n]);
+        cl_mem eMem = createBuffer(new float[n]);
+        
+        Elementwise elementwise = new Elementwise(context);
+        Expression c = Elementwise.input(aMem)
+            .times(Elementwise.input(bMem))
+            .plus(Elementwise.input(dMem));
+        Expression e = c.max(0.0f);
+        for (int i=0; i<2; i++)
+        {
+            elementwise.evaluate(commandQueue, n, 
+                new cl_mem[]{ cMem, eMem }, new Expression[]{ c, e }, 
+                0, null, null);
+        }
+        
+        float cResult[] = new float[n];
+        float eResult[] = new float[n];
+        clEnqueueReadBuffer(commandQueue, cMem, CL_TRUE, 0,
+            n * Sizeof.cl_float, Pointer.to(cResult), 0, null, null);
+        clEnqueueReadBuffer(commandQueue, eMem, CL_TRUE, 0,
+            n * Sizeof.cl_float, Pointer.to(eResult), 0, null, null);
+        long hits = elementwise.getCacheHitCount();
+        long misses = elementwise.getCacheMissCount();
+        
+        elementwise.release();
+        clReleaseMemObject(aMem);
+        clReleaseMemObject(bMem);
+        clReleaseMemObject(dMem);
+        clReleaseMemObject(cMem);
+        clReleaseMemObject(eMem);
+        shutdownCL();
+        
+        float cExpected[] = new float[n];
+        float eExpected[] = new float[n];
+        for (int i=0; i<n; i++)
+        {
+            cExpected[i] = a[i] * b[i] + d[i];
+            eExpected[i] = Math.max(cExpected[i], 0.0f);
+        }
+        assertArrayEquals(cExpected, cResult, 1e-6f);
+        assertArrayEquals(eExpected, eResult, 1e-6f);
+        assertEquals(1, hits);
+        assertEquals(1, misses);
+    }
+    
+    /**
+     * Create a buffer that is initialized with the given data
+     * 
+     * @param data The data
+     * @return The buffer
+     */
+    private cl_mem createBuffer(float data[])
+    {
+        return clCreateBuffer(context, 
+            CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+            Sizeof.cl_float * data.length, Pointer.to(data), null);
+    }
+}
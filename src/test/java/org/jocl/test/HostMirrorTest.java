@@ -0,0 +1,59 @@
+package org.jocl.test;
+
+import static org.jocl.CL.*;
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+
+import java.nio.FloatBuffer;
+
+import org.jocl.*;
+import org.junit.Test;
+
+/**
+ * Test for the delta uploads of a {@link HostMirror} with change 
+ * detection
+ */
+public class HostMirrorTest extends JOCLAbstractTest
+{
+    @Test
+    public void testDeltaUpload()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        
+        int n = 4096;
+        int size = n * Sizeof.cl_float;
+        cl_mem mem = clCreateBuffer(context, CL_MEM_READ_WRITE, 
+            size, null, null);
+        
+        HostMirror mirror = new HostMirror(mem, size, true);
+        FloatBuffer values = mirror.getBuffer().asFloatBuffer();
+        for (int i=0; i<n; i++)
+        {
+            values.put(i, i);
+        }
+        long fullBytes = mirror.upload(commandQueue);
+        
+        values.put(10, -1.0f);
+        values.put(3000, -2.0f);
+        long deltaBytes = mirror.upload(commandQueue);
+        
+        float result[] = new float[n];
+        clEnqueueReadBuffer(commandQueue, mem, CL_TRUE, 0, 
+            size, Pointer.to(result), 0, null, null);
+        
+        mirror.release();
+        clReleaseMemObject(mem);
+        shutdownCL();
+        
+        float expected[] = new float[n];
+        for (int i=0; i<n; i++)
+        {
+            expected[i] = i;
+        }
+        expected[10] = -1.0f;
+        expected[3000] = -2.0f;
+        assertArrayEquals(expected, result, 0.0f);
+        assertEquals(size, fullBytes);
+        assertEquals(2 * HostMirror.DEFAULT_BLOCK_SIZE, deltaBytes);
+    }
+}
@@ -0,0 +1,66 @@
+package org.jocl.test;
+
+import static org.jocl.CL.*;
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+
+import org.jocl.*;
+import org.junit.Test;
+
+/**
+ * Test whether redundant calls to clSetKernelArg are skipped when the
+ * kernel argument shadowing is enabled, and whether the kernel still
+ * receives the most recently set values
+ */
+public class KernelArgsTest extends JOCLAbstractTest
+{
+    /**
+     * The source code of the OpenCL program to execute
+     */
+    private static String programSource =
+        "__kernel void "+
+        "sampleKernel(__global float *a, float b)"+
+        "{"+
+        "    int gid = get_global_id(0);"+
+        "    a[gid] = b;"+
+        "}";
+    
+    @Test
+    public void testRedundantArgumentsAreSkipped()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        initKernel("sampleKernel", programSource);
+        KernelArgs.setShadowingEnabled(true);
+        KernelArgs.resetStatistics();
+        
+        int n = 10;
+        cl_mem mem = clCreateBuffer(context, CL_MEM_READ_WRITE, 
+            Sizeof.cl_float * n, null, null);
+        
+        float result[] = new float[n];
+        for (int i=0; i<3; i++)
+        {
+            clSetKernelArg(kernel, 0, Sizeof.cl_mem, Pointer.to(mem));
+            clSetKernelArg(kernel, 1, Sizeof.cl_float, 
+                Pointer.to(new float[]{ i == 2 ? 2.0f : 1.0f }));
+            clEnqueueNDRangeKernel(commandQueue, kernel, 1, null,
+                new long[] {n}, null, 0, null, null);
+        }
+        clEnqueueReadBuffer(commandQueue, mem, CL_TRUE, 0,
+            n * Sizeof.cl_float, Pointer.to(result), 0, null, null);
+        
+        long skipped = KernelArgs.getSkippedCount();
+        long forwarded = KernelArgs.getForwardedCount();
+        
+        clReleaseMemObject(mem);
+        shutdownKernel();
+        shutdownCL();
+        KernelArgs.setShadowingEnabled(false);
+        
+        float expected[] = new float[n];
+        java.util.Arrays.fill(expected, 2.0f);
+        assertArrayEquals(expected, result, 0.0f);
+        assertEquals(3, skipped);
+        assertEquals(3, forwarded);
+    }
+}
@@ -0,0 +1,155 @@
+package org.jocl.test;
+
+import static org.jocl.CL.*;
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+
+import org.jocl.*;
+import org.junit.Test;
+
+/**
+ * Test for the coalescing of updates in a {@link WriteCombiner}
+ */
+public class WriteCombinerTest extends JOCLAbstractTest
+{
+    /**
+     * The number of elements of the test buffers
+     */
+    private static final int N = 256;
+    
+    @Test
+    public void testOverlappingUpdates()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        
+        cl_mem mem = createZeroBuffer();
+        WriteCombiner combiner = 
+            new WriteCombiner(context, commandQueue, 4096, 16, 0);
+        combiner.update(mem, 0, new float[]{ 1, 1, 1, 1 });
+        combiner.update(mem, 2 * Sizeof.cl_float, new float[]{ 2, 2 });
+        combiner.update(mem, 1 * Sizeof.cl_float, new float[]{ 3 });
+        combiner.flush();
+        
+        float result[] = read(mem);
+        long commands = combiner.getCommandCount();
+        combiner.release();
+        clReleaseMemObject(mem);
+        shutdownCL();
+        
+        float expected[] = new float[N];
+        expected[0] = 1;
+        expected[1] = 3;
+        expected[2] = 2;
+        expected[3] = 2;
+        assertArrayEquals(expected, result, 0.0f);
+        
+        // One unmap and one copy for the merged run
+        assertEquals(2, commands);
+    }
+    
+    @Test
+    public void testAdjacentUpdates()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        
+        cl_mem mem = createZeroBuffer();
+        WriteCombiner combiner = 
+            new WriteCombiner(context, commandQueue, 4096, 16, 0);
+        combiner.update(mem, 2 * Sizeof.cl_float, new float[]{ 3, 4 });
+        combiner.update(mem, 0, new float[]{ 1, 2 });
+        combiner.update(mem, 8 * Sizeof.cl_float, new float[]{ 5 });
+        combiner.flush();
+        
+        float result[] = read(mem);
+        long commands = combiner.getCommandCount();
+        combiner.release();
+        clReleaseMemObject(mem);
+        shutdownCL();
+        
+        float expected[] = new float[N];
+        expected[0] = 1;
+        expected[1] = 2;
+        expected[2] = 3;
+        expected[3] = 4;
+        expected[8] = 5;
+        assertArrayEquals(expected, result, 0.0f);
+        
+        // One unmap, and one copy for each of the two runs
+        assertEquals(3, commands);
+    }
+    
+    @Test
+    public void testScatterThreshold()
+    {
+        initCL(defaultPlatformIndex, defaultDeviceType, defaultDeviceIndex);
+        
+        cl_mem memA = createZeroBuffer();
+        cl_mem memB = createZeroBuffer();
+        WriteCombiner combiner = 
+            new WriteCombiner(context, commandQueue, 4096, 64, 4);
+        float expectedA[] = new float[N];
+        float expectedB[] = new float[N];
+        for (int k = 0; k < 8; k++)
+        {
+            // Buffer A receives enough runs for the scatter kernel, 
+            // interleaved with updates of buffer B that stay below 
+            // the threshold
+            int indexA = k * 16 + 1;
+            combiner.update(memA, indexA * Sizeof.cl_float, 
+                new float[]{ k + 1, k + 2 });
+            expectedA[indexA] = k + 1;
+            expectedA[indexA + 1] = k + 2;
+            if (k < 2)
+            {
+                int indexB = k * 64;
+                combiner.update(memB, indexB * Sizeof.cl_float, 
+                    new float[]{ -k - 1 });
+                expectedB[indexB] = -k - 1;
+            }
+        }
+        combiner.update(memA, 1 * Sizeof.cl_float, new float[]{ 42 });
+        expectedA[1] = 42;
+        assertEquals(11, combiner.getPendingUpdateCount());
+        combiner.flush();
+        
+        float resultA[] = read(memA);
+        float resultB[] = read(memB);
+        int pending = combiner.getPendingUpdateCount();
+        long flushes = combiner.getFlushCount();
+        combiner.release();
+        clReleaseMemObject(memA);
+        clReleaseMemObject(memB);
+        shutdownCL();
+        
+        assertArrayEquals(expectedA, resultA, 0.0f);
+        assertArrayEquals(expectedB, resultB, 0.0f);
+        assertEquals(0, pending);
+        assertEquals(1, flushes);
+    }
+    
+    /**
+     * Create a buffer with N float elements that are all 0
+     * 
+     * @return The buffer
+     */
+    private cl_mem createZeroBuffer()
+    {
+        return clCreateBuffer(context, 
+            CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, N * Sizeof.cl_float, 
+            Pointer.to(new float[N]), null);
+    }
+    
+    /**
+     * Read the contents of the given buffer
+     * 
+     * @param mem The buffer
+     * @return The contents
+     */
+    private float[] read(cl_mem mem)
+    {
+        float result[] = new float[N];
+        clEnqueueReadBuffer(commandQueue, mem, CL_TRUE, 0, 
+            N * Sizeof.cl_float, Pointer.to(result), 0, null, null);
+        return result;
+    }
+}